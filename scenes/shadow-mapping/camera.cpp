@@ -78,32 +78,14 @@ glm::vec3 Camera::getCameraFrontDirection()
     return normalize(m_front);
 }
 
-void Camera::updateCameraMotion(bool* keys, GLfloat deltaTime)
+glm::vec3 Camera::getCameraRightDirection()
 {
-    // Calculate camera speed based on the delta time
-    // and update the camera position.
-    // We do not need to update the camera vectors when
-    // moving in a fixed set of directions.
-    GLfloat velocity = m_moveSpeed * deltaTime;
-    if (keys[GLFW_KEY_W])
-    {
-        m_position += m_front * velocity;
-    }
-
-    if (keys[GLFW_KEY_S])
-    {
-        m_position -= m_front * velocity;
-    }
-
-    if (keys[GLFW_KEY_A])
-    {
-        m_position -= m_right * velocity;
-    }
+    return normalize(m_right);
+}
 
-    if (keys[GLFW_KEY_D])
-    {
-        m_position += m_right * velocity;
-    }
+GLfloat Camera::getMoveSpeed()
+{
+    return m_moveSpeed;
 }
 
 void Camera::updateCameraOrientation(GLfloat xChange, GLfloat yChange)
@@ -48,9 +48,10 @@ public:
     // Add more getters here if required
     glm::vec3 getCameraPosition();
     glm::vec3 getCameraFrontDirection();
+    glm::vec3 getCameraRightDirection();
+    GLfloat getMoveSpeed();
 
     // Updates camera parameters to reflect the user inputs
-    void updateCameraMotion(bool* keys, GLfloat deltaTime);
     void updateCameraOrientation(GLfloat xChange, GLfloat yChange);
     
     // Generates the final view matrix 
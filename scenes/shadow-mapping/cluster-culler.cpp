@@ -0,0 +1,168 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "cluster-culler.h"
+#include "frustum.h"
+
+// Clusters handed out to a job at a time, and the cluster
+// count below which waking up the workers is not worth it
+static const size_t CLUSTER_CHUNK_SIZE = 64;
+static const size_t MIN_PARALLEL_CLUSTER_COUNT = 256;
+
+ClusterCuller::ClusterCuller() :
+    m_cameraPosition(0.0f),
+    m_clusters(nullptr),
+    m_visibility(nullptr),
+    m_modelMatrix(1.0f),
+    m_modelCameraPosition(0.0f),
+    m_modelScale(1.0f),
+    m_culledClusters(0),
+    m_testedClusters(0),
+    m_backFaceCulling(false),
+    m_jobSystem(nullptr)
+{
+}
+
+void ClusterCuller::createClusterCuller(JobSystem *jobSystem)
+{
+    clearClusterCuller();
+    m_jobSystem = jobSystem;
+}
+
+void ClusterCuller::setBackFaceCulling(bool backFaceCulling)
+{
+    m_backFaceCulling = backFaceCulling;
+}
+
+void ClusterCuller::setView(
+    const glm::mat4 &projection,
+    const glm::mat4 &view,
+    const glm::vec3 &cameraPosition)
+{
+    ExtractFrustumPlanes(projection * view, m_frustumPlanes);
+    m_cameraPosition = cameraPosition;
+}
+
+void ClusterCuller::cullClusters(
+    const std::vector<MeshCluster> &clusters,
+    const glm::mat4 &modelMatrix,
+    std::vector<unsigned char> &visibility)
+{
+    visibility.resize(clusters.size());
+    if (clusters.empty())
+    {
+        return;
+    }
+
+    m_clusters = &clusters;
+    m_visibility = &visibility[0];
+    m_modelMatrix = modelMatrix;
+    m_modelScale = glm::length(glm::vec3(modelMatrix[0]));
+
+    // The normal cones are tested in model space, which
+    // keeps the angles intact under a uniform scale
+    m_modelCameraPosition = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(m_cameraPosition, 1.0f));
+
+    m_testedClusters += clusters.size();
+
+    if (!m_jobSystem || clusters.size() < MIN_PARALLEL_CLUSTER_COUNT)
+    {
+        cullRange(0, clusters.size());
+        return;
+    }
+
+    m_jobSystem->parallelFor(clusters.size(), CLUSTER_CHUNK_SIZE, [this](size_t first, size_t last) {
+        cullRange(first, last);
+    });
+}
+
+void ClusterCuller::cullRange(size_t first, size_t last)
+{
+    const std::vector<MeshCluster> &clusters = *m_clusters;
+    size_t culledClusters = 0;
+
+    for (size_t i = first; i < last; ++i)
+    {
+        const MeshCluster &cluster = clusters[i];
+        bool visible = true;
+
+        // Facing away: the whole normal cone points
+        // away from the camera for every point of the sphere
+        glm::vec3 toCluster = cluster.center - m_modelCameraPosition;
+        if (m_backFaceCulling &&
+            glm::dot(toCluster, cluster.coneAxis) >= cluster.coneCutoff * glm::length(toCluster) + cluster.radius)
+        {
+            visible = false;
+        }
+
+        // Outside the frustum: the sphere is
+        // completely behind one of the planes
+        if (visible)
+        {
+            glm::vec4 center = m_modelMatrix * glm::vec4(cluster.center, 1.0f);
+            GLfloat radius = cluster.radius * m_modelScale;
+
+            for (int plane = 0; plane < 6; ++plane)
+            {
+                if (glm::dot(m_frustumPlanes[plane], glm::vec4(glm::vec3(center), 1.0f)) < -radius)
+                {
+                    visible = false;
+                    break;
+                }
+            }
+        }
+
+        m_visibility[i] = visible ? 1 : 0;
+        if (!visible)
+        {
+            ++culledClusters;
+        }
+    }
+
+    m_culledClusters += culledClusters;
+}
+
+void ClusterCuller::getStatistics(size_t &testedClusters, size_t &culledClusters)
+{
+    testedClusters = m_testedClusters;
+    culledClusters = m_culledClusters;
+}
+
+void ClusterCuller::resetStatistics()
+{
+    m_testedClusters = 0;
+    m_culledClusters = 0;
+}
+
+void ClusterCuller::clearClusterCuller()
+{
+    m_jobSystem = nullptr;
+    m_clusters = nullptr;
+    m_visibility = nullptr;
+}
+
+ClusterCuller::~ClusterCuller()
+{
+    clearClusterCuller();
+}
@@ -0,0 +1,97 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "job-system.h"
+#include "mesh-cluster.h"
+
+// Rejects the clusters of meshes that are outside the view
+// frustum or facing away from the camera. The clusters are
+// split into chunks that the workers of the job system and the
+// calling thread test side by side, so large meshes are culled
+// in a fraction of the time a single thread would take.
+class ClusterCuller
+{
+public:
+    ClusterCuller();
+
+    // Culls on the calling thread alone without a job system
+    void createClusterCuller(JobSystem *jobSystem);
+
+    // Clusters facing away from the camera are only rejected
+    // when the draws cull back faces, for two-sided drawing
+    // they would leave holes in open geometry
+    void setBackFaceCulling(bool backFaceCulling);
+
+    // Called once per frame before culling
+    void setView(
+        const glm::mat4 &projection,
+        const glm::mat4 &view,
+        const glm::vec3 &cameraPosition);
+
+    // Writes 1 into visibility for every cluster that may be
+    // visible with the given model matrix and 0 otherwise.
+    // The model matrix is expected to scale uniformly.
+    void cullClusters(
+        const std::vector<MeshCluster> &clusters,
+        const glm::mat4 &modelMatrix,
+        std::vector<unsigned char> &visibility);
+
+    // Clusters tested and rejected since the last call
+    void getStatistics(size_t &testedClusters, size_t &culledClusters);
+    void resetStatistics();
+
+    void clearClusterCuller();
+
+    ~ClusterCuller();
+
+private:
+    void cullRange(size_t first, size_t last);
+
+    // Planes of the view frustum in world space, the
+    // normals point into the frustum
+    glm::vec4 m_frustumPlanes[6];
+    glm::vec3 m_cameraPosition;
+
+    // Job currently being culled
+    const std::vector<MeshCluster> *m_clusters;
+    unsigned char *m_visibility;
+    glm::mat4 m_modelMatrix;
+    glm::vec3 m_modelCameraPosition;
+    GLfloat m_modelScale;
+    std::atomic<size_t> m_culledClusters;
+    size_t m_testedClusters;
+
+    bool m_backFaceCulling;
+
+    JobSystem *m_jobSystem;
+};
@@ -26,3 +26,35 @@
 const unsigned int MAX_POINT_LIGHTS = 3;
 const unsigned int MAX_SPOT_LIGHTS = 3;
 const float toRadians = 3.14159265f / 180.0f;
+
+// First of the 4 consecutive attribute locations
+// holding the per-instance model matrix, keep in
+// sync with the instanced vertex shaders
+const unsigned int INSTANCE_MODEL_ATTRIBUTE_LOCATION = 3;
+
+// Attribute location of the per-draw transform index
+// and the shader storage binding of the transforms used
+// by the indirect vertex shaders
+const unsigned int INDIRECT_TRANSFORM_INDEX_ATTRIBUTE_LOCATION = 7;
+const unsigned int INDIRECT_TRANSFORM_BUFFER_BINDING = 0;
+
+// Attribute location of the texture array layer
+// sampled by the main shaders when the textures
+// are packed into texture arrays
+const unsigned int TEXTURE_LAYER_ATTRIBUTE_LOCATION = 8;
+
+// Attribute location of the specular intensity and
+// shininess of a draw, read from the per-draw data by
+// the indirect vertex shader instead of the uniforms
+const unsigned int DRAW_MATERIAL_ATTRIBUTE_LOCATION = 9;
+
+// Number of regions cycled through by the streaming
+// buffers, so the CPU can write one region while the
+// GPU is still reading the previous frames. Buffers are
+// written once per pass, twice a frame with the shadow
+// pass, so this keeps three frames in flight.
+const unsigned int STREAMING_BUFFER_REGION_COUNT = 6;
+
+// Number of levels of detail generated for the models,
+// each level has about half the triangles of the previous
+const unsigned int MODEL_LEVEL_OF_DETAIL_COUNT = 4;
@@ -23,6 +23,7 @@
 //
 
 #include "directional-light-shadow-map.h"
+#include "gpu-resource-registry.h"
 
 DirectionalLightShadowMap::DirectionalLightShadowMap() :
     m_FBO(0),
@@ -89,6 +90,14 @@ bool DirectionalLightShadowMap::init()
 
     // Attach the texture to the frame buffer
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowMap, 0);
+
+    // The memory is the one of the depth texture attached to it
+    GetGpuResourceRegistry().addResource(GPU_RESOURCE_FRAMEBUFFER, m_FBO, 0, "Directional light shadow map");
+    GetGpuResourceRegistry().addResource(
+        GPU_RESOURCE_TEXTURE,
+        m_shadowMap,
+        GpuResourceRegistry::estimateTextureSize(m_shadowWidth, m_shadowHeight, 1, 4, false),
+        "Directional light shadow map");
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     
@@ -118,17 +127,24 @@ void DirectionalLightShadowMap::read(GLenum textureUnit)
     glBindTexture(GL_TEXTURE_2D, m_shadowMap);
 }
 
-DirectionalLightShadowMap::~DirectionalLightShadowMap()
+void DirectionalLightShadowMap::clearShadowMap()
 {
     if (m_FBO)
     {
+        GetGpuResourceRegistry().removeResource(GPU_RESOURCE_FRAMEBUFFER, m_FBO);
         glDeleteFramebuffers(1, &m_FBO);
         m_FBO = 0;
     }
 
     if (m_shadowMap)
     {
+        GetGpuResourceRegistry().removeResource(GPU_RESOURCE_TEXTURE, m_shadowMap);
         glDeleteTextures(1, &m_shadowMap);
         m_shadowMap = 0;
     }
 }
+
+DirectionalLightShadowMap::~DirectionalLightShadowMap()
+{
+    clearShadowMap();
+}
@@ -39,9 +39,15 @@ public:
     bool init();
     void write();
     void read(GLenum textureUnit);
+    void clearShadowMap();
 
     ~DirectionalLightShadowMap();
 
+private:
+    // Owns GL objects, a copy would delete them twice
+    DirectionalLightShadowMap(const DirectionalLightShadowMap&) = delete;
+    DirectionalLightShadowMap& operator=(const DirectionalLightShadowMap&) = delete;
+
 protected:
     GLuint m_FBO, m_shadowMap, m_shadowWidth, m_shadowHeight;
 };
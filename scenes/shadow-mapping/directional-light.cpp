@@ -80,7 +80,13 @@ glm::mat4 DirectionalLight::computeProjectionViewLightTransform()
                                     glm::vec3(0.0f, 1.0f, 0.0f)));
 }
 
+void DirectionalLight::clearShadowMap()
+{
+    m_directLightShadowMap->clearShadowMap();
+}
+
 DirectionalLight::~DirectionalLight()
 {
+    delete m_directLightShadowMap;
 }
 
@@ -40,9 +40,14 @@ public:
         GLuint directLightDirectionLocation);
     void computeShadowMap();
     glm::mat4 computeProjectionViewLightTransform();
+    void clearShadowMap();
 
     ~DirectionalLight();
 private:
+    // Owns its shadow map, a copy would delete it twice
+    DirectionalLight(const DirectionalLight&) = delete;
+    DirectionalLight& operator=(const DirectionalLight&) = delete;
+
     glm::vec3 m_directLightDirection;
     GLuint m_shadowMapWidth, m_shadowMapHeight;
     DirectionalLightShadowMap *m_directLightShadowMap;
@@ -0,0 +1,78 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cmath>
+
+#include "fixed-timestep.h"
+
+FixedTimestep::FixedTimestep() :
+    m_stepSeconds(1.0 / 60.0),
+    m_maxStepsPerAdvance(8),
+    m_accumulatedSeconds(0.0),
+    m_droppedSeconds(0.0),
+    m_stepCount(0)
+{
+}
+
+void FixedTimestep::createFixedTimestep(double stepSeconds, unsigned int maxStepsPerAdvance)
+{
+    m_stepSeconds = stepSeconds;
+    m_maxStepsPerAdvance = maxStepsPerAdvance ? maxStepsPerAdvance : 1;
+    m_accumulatedSeconds = 0.0;
+    m_droppedSeconds = 0.0;
+    m_stepCount = 0;
+}
+
+unsigned int FixedTimestep::advanceTime(double elapsedSeconds)
+{
+    if (elapsedSeconds > 0.0)
+    {
+        m_accumulatedSeconds += elapsedSeconds;
+    }
+
+    unsigned int steps = 0;
+    while (m_accumulatedSeconds >= m_stepSeconds && steps < m_maxStepsPerAdvance)
+    {
+        m_accumulatedSeconds -= m_stepSeconds;
+        ++steps;
+    }
+
+    // Whole steps still owed past the limit are dropped,
+    // the fraction of a step left is kept for the blending
+    if (m_accumulatedSeconds >= m_stepSeconds)
+    {
+        double remainder = fmod(m_accumulatedSeconds, m_stepSeconds);
+        m_droppedSeconds += m_accumulatedSeconds - remainder;
+        m_accumulatedSeconds = remainder;
+    }
+
+    m_stepCount += steps;
+    return steps;
+}
+
+float FixedTimestep::getInterpolationFactor() const
+{
+    float factor = (float)(m_accumulatedSeconds / m_stepSeconds);
+    return factor < 1.0f ? factor : 1.0f;
+}
@@ -0,0 +1,59 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+// Turns the time passed between frames into a number of steps
+// of a fixed length, so that a simulation advances the same way
+// whatever the frame rate. The time left over that does not
+// make up a whole step is carried over to the next frame and
+// tells how far to blend between the last two steps.
+class FixedTimestep
+{
+public:
+    FixedTimestep();
+
+    void createFixedTimestep(double stepSeconds, unsigned int maxStepsPerAdvance);
+
+    // Adds the time passed and returns how many steps are due.
+    // Time past the step limit is dropped, so after a stall the
+    // simulation falls behind for a moment rather than trying to
+    // catch up in a burst that stalls the next frame as well.
+    unsigned int advanceTime(double elapsedSeconds);
+
+    // How far the time is past the last step, from 0 to 1
+    float getInterpolationFactor() const;
+
+    double getStepSeconds() const { return m_stepSeconds; }
+    double getAccumulatedSeconds() const { return m_accumulatedSeconds; }
+    double getDroppedSeconds() const { return m_droppedSeconds; }
+    unsigned long long getStepCount() const { return m_stepCount; }
+
+private:
+    double m_stepSeconds;
+    unsigned int m_maxStepsPerAdvance;
+    double m_accumulatedSeconds;
+    double m_droppedSeconds;
+    unsigned long long m_stepCount;
+};
@@ -0,0 +1,203 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstdio>
+#include <stdlib.h>
+
+#include "frame-allocator.h"
+
+LinearArena::LinearArena() :
+    m_memory(nullptr),
+    m_capacity(0),
+    m_offset(0),
+    m_overflowSize(0),
+    m_overflowCount(0),
+    m_highWaterMark(0)
+{
+}
+
+bool LinearArena::createLinearArena(size_t capacity)
+{
+    clearLinearArena();
+
+    m_memory = static_cast<unsigned char*>(malloc(capacity));
+    if (!m_memory)
+    {
+        printf("Error: LinearArena::createLinearArena(): Failed to allocate %zu bytes\n", capacity);
+        return false;
+    }
+
+    m_capacity = capacity;
+    return true;
+}
+
+void* LinearArena::allocate(size_t size, size_t alignment)
+{
+    // Alignments are powers of two, round the offset up to the next multiple
+    size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+    if (offset + size <= m_capacity)
+    {
+        m_offset = offset + size;
+        if (m_offset + m_overflowSize > m_highWaterMark)
+        {
+            m_highWaterMark = m_offset + m_overflowSize;
+        }
+        return m_memory + offset;
+    }
+
+    // Out of room, fall back to the heap until the next reset
+    size_t alignedSize = (size + alignment - 1) & ~(alignment - 1);
+    void *memory = aligned_alloc(alignment < sizeof(void*) ? sizeof(void*) : alignment, alignedSize ? alignedSize : alignment);
+    if (!memory)
+    {
+        printf("Error: LinearArena::allocate(): Failed to allocate %zu bytes\n", size);
+        return nullptr;
+    }
+
+    m_overflowBlocks.push_back(memory);
+    m_overflowSize += alignedSize;
+    ++m_overflowCount;
+    if (m_offset + m_overflowSize > m_highWaterMark)
+    {
+        m_highWaterMark = m_offset + m_overflowSize;
+    }
+    return memory;
+}
+
+void LinearArena::rewindToMarker(size_t marker)
+{
+    // Overflow blocks are only given back by a reset
+    if (marker < m_offset)
+    {
+        m_offset = marker;
+    }
+}
+
+void LinearArena::resetArena()
+{
+    for (size_t i = 0; i < m_overflowBlocks.size(); ++i)
+    {
+        free(m_overflowBlocks[i]);
+    }
+    m_overflowBlocks.clear();
+    m_overflowSize = 0;
+    m_offset = 0;
+
+    // Make the block large enough for the busiest frame so far,
+    // after a few frames nothing goes to the heap anymore
+    if (m_highWaterMark > m_capacity)
+    {
+        size_t capacity = m_capacity;
+        while (capacity < m_highWaterMark)
+        {
+            capacity = capacity ? capacity * 2 : 4096;
+        }
+
+        unsigned char *memory = static_cast<unsigned char*>(malloc(capacity));
+        if (!memory)
+        {
+            printf("Warning: LinearArena::resetArena(): Failed to grow the arena to %zu bytes\n", capacity);
+            return;
+        }
+
+        free(m_memory);
+        m_memory = memory;
+        m_capacity = capacity;
+    }
+}
+
+void LinearArena::clearLinearArena()
+{
+    // Without a high water mark the reset won't grow the block
+    m_highWaterMark = 0;
+    resetArena();
+
+    free(m_memory);
+    m_memory = nullptr;
+    m_capacity = 0;
+    m_overflowCount = 0;
+}
+
+LinearArena::~LinearArena()
+{
+    clearLinearArena();
+}
+
+FrameAllocator::FrameAllocator() :
+    m_currentArena(0),
+    m_frameNumber(0)
+{
+}
+
+bool FrameAllocator::createFrameAllocator(size_t capacity)
+{
+    m_currentArena = 0;
+    m_frameNumber = 0;
+    return m_arenas[0].createLinearArena(capacity) && m_arenas[1].createLinearArena(capacity);
+}
+
+void FrameAllocator::endFrame()
+{
+    m_currentArena = 1 - m_currentArena;
+    m_arenas[m_currentArena].resetArena();
+    ++m_frameNumber;
+}
+
+size_t FrameAllocator::getHighWaterMark() const
+{
+    return m_arenas[0].getHighWaterMark() > m_arenas[1].getHighWaterMark() ?
+        m_arenas[0].getHighWaterMark() : m_arenas[1].getHighWaterMark();
+}
+
+size_t FrameAllocator::getCapacity() const
+{
+    return m_arenas[0].getCapacity() > m_arenas[1].getCapacity() ?
+        m_arenas[0].getCapacity() : m_arenas[1].getCapacity();
+}
+
+size_t FrameAllocator::getOverflowCount() const
+{
+    return m_arenas[0].getOverflowCount() + m_arenas[1].getOverflowCount();
+}
+
+void FrameAllocator::printStatistics() const
+{
+    printf("Frame allocator: %zu of %zu KB used at most, %zu allocations overflowed to the heap\n",
+        (getHighWaterMark() + 1023) / 1024,
+        getCapacity() / 1024,
+        getOverflowCount());
+}
+
+void FrameAllocator::clearFrameAllocator()
+{
+    m_arenas[0].clearLinearArena();
+    m_arenas[1].clearLinearArena();
+    m_currentArena = 0;
+    m_frameNumber = 0;
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    clearFrameAllocator();
+}
@@ -0,0 +1,194 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+// Bump allocator over a single block of memory for data that
+// only lives for a short while, such as the lists built while
+// drawing a frame. Allocating moves an offset forward and
+// nothing is freed on its own, the whole arena is reset at
+// once or rewound to a marker taken earlier. The arena is not
+// thread safe, it belongs to the thread that allocates from it.
+class LinearArena
+{
+public:
+    LinearArena();
+
+    bool createLinearArena(size_t capacity);
+
+    // Requests that do not fit in the block are served from
+    // the heap and counted as overflows. They stay valid until
+    // the arena is reset, which grows the block to make room
+    // for them from then on.
+    void* allocate(size_t size, size_t alignment);
+
+    // Uninitialised room for count objects of type T
+    template<typename T>
+    T* allocateArray(size_t count)
+    {
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    size_t getMarker() const { return m_offset; }
+    void rewindToMarker(size_t marker);
+    void resetArena();
+
+    size_t getUsedSize() const { return m_offset; }
+    size_t getCapacity() const { return m_capacity; }
+    size_t getHighWaterMark() const { return m_highWaterMark; }
+    size_t getOverflowCount() const { return m_overflowCount; }
+
+    void clearLinearArena();
+
+    ~LinearArena();
+
+private:
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    unsigned char *m_memory;
+    size_t m_capacity;
+    size_t m_offset;
+
+    std::vector<void*> m_overflowBlocks;
+    size_t m_overflowSize;
+    size_t m_overflowCount;
+
+    // Most memory in use at once since the arena was created
+    size_t m_highWaterMark;
+};
+
+// Rewinds the arena to where it was when the scope was entered,
+// so scratch data inside a function is given back on return
+class ArenaScope
+{
+public:
+    explicit ArenaScope(LinearArena &arena) :
+        m_arena(arena),
+        m_marker(arena.getMarker())
+    {
+    }
+
+    ~ArenaScope()
+    {
+        m_arena.rewindToMarker(m_marker);
+    }
+
+private:
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    LinearArena &m_arena;
+    size_t m_marker;
+};
+
+// Lets the standard containers allocate from an arena. Memory
+// is only given back when the arena is rewound or reset, so
+// reserve the containers up front rather than let them grow.
+template<typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(LinearArena &arena) :
+        m_arena(&arena)
+    {
+    }
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) :
+        m_arena(other.getArena())
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t)
+    {
+    }
+
+    LinearArena* getArena() const { return m_arena; }
+
+private:
+    LinearArena *m_arena;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T> &first, const ArenaAllocator<U> &second)
+{
+    return first.getArena() == second.getArena();
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &first, const ArenaAllocator<U> &second)
+{
+    return first.getArena() != second.getArena();
+}
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+// Two arenas used on alternate frames. What is allocated while
+// a frame is built stays valid through the next frame as well,
+// long enough for the next frame to start from the results of
+// the previous one, or for jobs started in one frame to read
+// their inputs while the following frame is being prepared.
+class FrameAllocator
+{
+public:
+    FrameAllocator();
+
+    bool createFrameAllocator(size_t capacity);
+
+    LinearArena& getFrameArena() { return m_arenas[m_currentArena]; }
+
+    // Switches to the other arena, freeing what was
+    // allocated in it two frames ago
+    void endFrame();
+
+    // Frames ended so far, data allocated in frame n
+    // can still be read up to the end of frame n + 1
+    size_t getFrameNumber() const { return m_frameNumber; }
+
+    size_t getHighWaterMark() const;
+    size_t getCapacity() const;
+    size_t getOverflowCount() const;
+    void printStatistics() const;
+
+    void clearFrameAllocator();
+
+    ~FrameAllocator();
+
+private:
+    LinearArena m_arenas[2];
+    unsigned int m_currentArena;
+    size_t m_frameNumber;
+};
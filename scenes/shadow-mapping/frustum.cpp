@@ -0,0 +1,45 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "frustum.h"
+
+void ExtractFrustumPlanes(const glm::mat4 &projectionView, glm::vec4 planes[6])
+{
+    // Each plane is the fourth row of the
+    // matrix plus or minus one of the other rows
+    for (int plane = 0; plane < 6; ++plane)
+    {
+        int row = plane / 2;
+        float sign = (plane % 2) ? -1.0f : 1.0f;
+
+        glm::vec4 coefficients(
+            projectionView[0][3] + sign * projectionView[0][row],
+            projectionView[1][3] + sign * projectionView[1][row],
+            projectionView[2][3] + sign * projectionView[2][row],
+            projectionView[3][3] + sign * projectionView[3][row]);
+
+        float length = glm::length(glm::vec3(coefficients));
+        planes[plane] = coefficients / length;
+    }
+}
@@ -0,0 +1,424 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "geometry-pool.h"
+#include "gpu-resource-registry.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+// Floats per vertex of the pooled vertex format
+static const GLuint POOL_VERTEX_FLOATS = 8;
+static const GLsizeiptr POOL_VERTEX_SIZE = sizeof(GLfloat) * POOL_VERTEX_FLOATS;
+
+GeometryPool::GeometryPool() :
+    m_pageVertexCount(0),
+    m_pageIndexCount(0)
+{
+}
+
+void GeometryPool::createGeometryPool(GLuint pageVertexCount, GLuint pageIndexCount)
+{
+    m_pageVertexCount = pageVertexCount;
+    m_pageIndexCount = pageIndexCount;
+}
+
+unsigned int GeometryPool::allocateGeometry(
+    const GLfloat *vertices,
+    GLuint vertexCount,
+    const GLuint *indices,
+    GLuint indexCount)
+{
+    Allocation allocation = { 0, RangeAllocator::INVALID_RANGE, RangeAllocator::INVALID_RANGE, true };
+
+    // First page with room for both the vertices and the indices
+    for (unsigned int i = 0; i < m_pages.size(); ++i)
+    {
+        Page &page = *m_pages[i];
+        if (!page.vboID)
+        {
+            continue;
+        }
+
+        allocation.vertexRange = page.vertexRanges.allocateRange(vertexCount);
+        if (allocation.vertexRange == RangeAllocator::INVALID_RANGE)
+        {
+            continue;
+        }
+
+        allocation.indexRange = page.indexRanges.allocateRange(indexCount);
+        if (allocation.indexRange == RangeAllocator::INVALID_RANGE)
+        {
+            page.vertexRanges.freeRange(allocation.vertexRange);
+            continue;
+        }
+
+        allocation.pageIndex = i;
+        break;
+    }
+
+    if (allocation.indexRange == RangeAllocator::INVALID_RANGE)
+    {
+        allocation.pageIndex = createPage(
+            std::max(m_pageVertexCount, vertexCount),
+            std::max(m_pageIndexCount, indexCount));
+
+        Page &page = *m_pages[allocation.pageIndex];
+        allocation.vertexRange = page.vertexRanges.allocateRange(vertexCount);
+        allocation.indexRange = page.indexRanges.allocateRange(indexCount);
+    }
+
+    Page &page = *m_pages[allocation.pageIndex];
+    ++page.allocationCount;
+
+    if (vertices)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, page.vboID);
+        glBufferSubData(
+            GL_ARRAY_BUFFER,
+            POOL_VERTEX_SIZE * page.vertexRanges.getRangeOffset(allocation.vertexRange),
+            POOL_VERTEX_SIZE * vertexCount,
+            vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Bound to the copy target, binding to the element array
+    // target would change the index buffer of the current VAO
+    if (indices)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.iboID);
+        glBufferSubData(
+            GL_COPY_WRITE_BUFFER,
+            sizeof(GLuint) * page.indexRanges.getRangeOffset(allocation.indexRange),
+            sizeof(GLuint) * indexCount,
+            indices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    unsigned int geometry = 0;
+    if (!m_freeAllocations.empty())
+    {
+        geometry = m_freeAllocations.back();
+        m_freeAllocations.pop_back();
+        m_allocations[geometry] = allocation;
+    }
+    else
+    {
+        geometry = m_allocations.size();
+        m_allocations.push_back(allocation);
+    }
+
+    return geometry;
+}
+
+void GeometryPool::freeGeometry(unsigned int geometry)
+{
+    if (geometry >= m_allocations.size() || !m_allocations[geometry].live)
+    {
+        printf("Error: GeometryPool::freeGeometry(): Geometry %u is not allocated\n", geometry);
+        return;
+    }
+
+    Allocation &allocation = m_allocations[geometry];
+    Page &page = *m_pages[allocation.pageIndex];
+    page.vertexRanges.freeRange(allocation.vertexRange);
+    page.indexRanges.freeRange(allocation.indexRange);
+    --page.allocationCount;
+
+    allocation.live = false;
+    m_freeAllocations.push_back(geometry);
+}
+
+GLint GeometryPool::getBaseVertex(unsigned int geometry) const
+{
+    const Allocation &allocation = m_allocations[geometry];
+    return m_pages[allocation.pageIndex]->vertexRanges.getRangeOffset(allocation.vertexRange);
+}
+
+GLuint GeometryPool::getFirstIndex(unsigned int geometry) const
+{
+    const Allocation &allocation = m_allocations[geometry];
+    return m_pages[allocation.pageIndex]->indexRanges.getRangeOffset(allocation.indexRange);
+}
+
+GLuint GeometryPool::getVertexBufferID(unsigned int geometry) const
+{
+    return m_pages[m_allocations[geometry].pageIndex]->vboID;
+}
+
+GLuint GeometryPool::getIndexBufferID(unsigned int geometry) const
+{
+    return m_pages[m_allocations[geometry].pageIndex]->iboID;
+}
+
+VertexArrayBinding& GeometryPool::getVertexArray(unsigned int geometry)
+{
+    return m_pages[m_allocations[geometry].pageIndex]->vertexArray;
+}
+
+void GeometryPool::defragmentGeometryPool()
+{
+    for (unsigned int i = 0; i < m_pages.size(); ++i)
+    {
+        Page &page = *m_pages[i];
+        if (!page.vboID)
+        {
+            continue;
+        }
+
+        if (!page.allocationCount)
+        {
+            clearPageBuffers(page);
+            continue;
+        }
+
+        // The ranges never overlap, so the page is packed
+        // when they end where their total size does
+        GLuint vertexEnd = 0, indexEnd = 0;
+        for (size_t j = 0; j < m_allocations.size(); ++j)
+        {
+            const Allocation &allocation = m_allocations[j];
+            if (allocation.live && allocation.pageIndex == i)
+            {
+                vertexEnd = std::max(vertexEnd,
+                    page.vertexRanges.getRangeOffset(allocation.vertexRange) + page.vertexRanges.getRangeSize(allocation.vertexRange));
+                indexEnd = std::max(indexEnd,
+                    page.indexRanges.getRangeOffset(allocation.indexRange) + page.indexRanges.getRangeSize(allocation.indexRange));
+            }
+        }
+
+        if (vertexEnd == page.vertexRanges.getUsedSize() && indexEnd == page.indexRanges.getUsedSize())
+        {
+            continue;
+        }
+
+        defragmentPage(i);
+    }
+}
+
+GeometryPoolStatistics GeometryPool::getStatistics() const
+{
+    GeometryPoolStatistics statistics;
+    for (size_t i = 0; i < m_pages.size(); ++i)
+    {
+        const Page &page = *m_pages[i];
+        if (!page.vboID)
+        {
+            continue;
+        }
+
+        ++statistics.pageCount;
+        statistics.allocationCount += page.allocationCount;
+        statistics.vertexCapacity += page.vertexRanges.getCapacity();
+        statistics.usedVertices += page.vertexRanges.getUsedSize();
+        statistics.indexCapacity += page.indexRanges.getCapacity();
+        statistics.usedIndices += page.indexRanges.getUsedSize();
+        statistics.freeRangeCount += page.vertexRanges.getFreeRangeCount() + page.indexRanges.getFreeRangeCount();
+        statistics.largestFreeVertexRange = std::max<size_t>(statistics.largestFreeVertexRange, page.vertexRanges.getLargestFreeRange());
+        statistics.largestFreeIndexRange = std::max<size_t>(statistics.largestFreeIndexRange, page.indexRanges.getLargestFreeRange());
+    }
+
+    return statistics;
+}
+
+void GeometryPool::printStatistics() const
+{
+    GeometryPoolStatistics statistics = getStatistics();
+    printf("Geometry pool: %zu meshes in %zu pages, %zu of %zu vertices and %zu of %zu indices used, %zu free ranges\n",
+        statistics.allocationCount,
+        statistics.pageCount,
+        statistics.usedVertices,
+        statistics.vertexCapacity,
+        statistics.usedIndices,
+        statistics.indexCapacity,
+        statistics.freeRangeCount);
+}
+
+void GeometryPool::clearGeometryPool()
+{
+    for (size_t i = 0; i < m_pages.size(); ++i)
+    {
+        clearPageBuffers(*m_pages[i]);
+    }
+
+    m_pages.clear();
+    m_allocations.clear();
+    m_freeAllocations.clear();
+}
+
+GeometryPool::~GeometryPool()
+{
+    clearGeometryPool();
+}
+
+unsigned int GeometryPool::createPage(GLuint vertexCapacity, GLuint indexCapacity)
+{
+    // Reuse the slot of a page emptied by defragmenting
+    unsigned int pageIndex = m_pages.size();
+    for (unsigned int i = 0; i < m_pages.size(); ++i)
+    {
+        if (!m_pages[i]->vboID)
+        {
+            pageIndex = i;
+            break;
+        }
+    }
+
+    if (pageIndex == m_pages.size())
+    {
+        m_pages.push_back(std::unique_ptr<Page>(new Page()));
+    }
+
+    Page &page = *m_pages[pageIndex];
+    page.vertexRanges.createRangeAllocator(vertexCapacity);
+    page.indexRanges.createRangeAllocator(indexCapacity);
+    page.allocationCount = 0;
+    createPageBuffers(page);
+
+    return pageIndex;
+}
+
+void GeometryPool::createPageBuffers(Page &page)
+{
+    glGenBuffers(1, &page.vboID);
+    glBindBuffer(GL_ARRAY_BUFFER, page.vboID);
+    glBufferData(GL_ARRAY_BUFFER, POOL_VERTEX_SIZE * page.vertexRanges.getCapacity(), nullptr, GL_STATIC_DRAW);
+    GetGpuResourceRegistry().addResource(GPU_RESOURCE_BUFFER, page.vboID, POOL_VERTEX_SIZE * page.vertexRanges.getCapacity(), "Geometry pool");
+
+    glGenVertexArrays(1, &page.vertexArray.vaoID);
+    glBindVertexArray(page.vertexArray.vaoID);
+
+        glGenBuffers(1, &page.iboID);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.iboID);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * page.indexRanges.getCapacity(), nullptr, GL_STATIC_DRAW);
+        GetGpuResourceRegistry().addResource(GPU_RESOURCE_BUFFER, page.iboID, sizeof(GLuint) * page.indexRanges.getCapacity(), "Geometry pool");
+
+        // Same vertex layout as the meshes with buffers of their own
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, POOL_VERTEX_SIZE, (const void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, POOL_VERTEX_SIZE, (const void*)(sizeof(GLfloat) * 3));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, POOL_VERTEX_SIZE, (const void*)(sizeof(GLfloat) * 5));
+        glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    page.vertexArray.attachedInstanceBufferID = 0;
+    page.vertexArray.attachedInstanceStorageGeneration = 0;
+    page.vertexArray.attachedInstanceBufferOffset = 0;
+}
+
+void GeometryPool::clearPageBuffers(Page &page)
+{
+    if (page.vertexArray.vaoID)
+    {
+        glDeleteVertexArrays(1, &page.vertexArray.vaoID);
+    }
+
+    GetGpuResourceRegistry().removeResource(GPU_RESOURCE_BUFFER, page.vboID);
+    GetGpuResourceRegistry().removeResource(GPU_RESOURCE_BUFFER, page.iboID);
+    GLuint buffers[] = { page.vboID, page.iboID };
+    glDeleteBuffers(2, buffers);
+
+    page.vboID = 0;
+    page.iboID = 0;
+    page.vertexArray = VertexArrayBinding();
+}
+
+void GeometryPool::defragmentPage(unsigned int pageIndex)
+{
+    Page &page = *m_pages[pageIndex];
+
+    // Allocations of the page in the order they sit in
+    // the vertex buffer, reallocating them in that order
+    // from an empty page packs them at the front
+    std::vector<unsigned int> pageAllocations;
+    for (unsigned int i = 0; i < m_allocations.size(); ++i)
+    {
+        if (m_allocations[i].live && m_allocations[i].pageIndex == pageIndex)
+        {
+            pageAllocations.push_back(i);
+        }
+    }
+
+    std::sort(pageAllocations.begin(), pageAllocations.end(), [this, &page](unsigned int a, unsigned int b) {
+        return page.vertexRanges.getRangeOffset(m_allocations[a].vertexRange) <
+            page.vertexRanges.getRangeOffset(m_allocations[b].vertexRange);
+    });
+
+    std::vector<GLuint> vertexOffsets, vertexCounts, indexOffsets, indexCounts;
+    for (size_t i = 0; i < pageAllocations.size(); ++i)
+    {
+        const Allocation &allocation = m_allocations[pageAllocations[i]];
+        vertexOffsets.push_back(page.vertexRanges.getRangeOffset(allocation.vertexRange));
+        vertexCounts.push_back(page.vertexRanges.getRangeSize(allocation.vertexRange));
+        indexOffsets.push_back(page.indexRanges.getRangeOffset(allocation.indexRange));
+        indexCounts.push_back(page.indexRanges.getRangeSize(allocation.indexRange));
+    }
+
+    GLuint oldVBO = page.vboID;
+    GLuint oldIBO = page.iboID;
+    GLuint oldVAO = page.vertexArray.vaoID;
+
+    page.vertexRanges.createRangeAllocator(page.vertexRanges.getCapacity());
+    page.indexRanges.createRangeAllocator(page.indexRanges.getCapacity());
+    createPageBuffers(page);
+
+    // Copied buffer to buffer on the GPU, the
+    // geometry never comes back to the CPU
+    for (size_t i = 0; i < pageAllocations.size(); ++i)
+    {
+        Allocation &allocation = m_allocations[pageAllocations[i]];
+        allocation.vertexRange = page.vertexRanges.allocateRange(vertexCounts[i]);
+        allocation.indexRange = page.indexRanges.allocateRange(indexCounts[i]);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, oldVBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.vboID);
+        glCopyBufferSubData(
+            GL_COPY_READ_BUFFER,
+            GL_COPY_WRITE_BUFFER,
+            POOL_VERTEX_SIZE * vertexOffsets[i],
+            POOL_VERTEX_SIZE * page.vertexRanges.getRangeOffset(allocation.vertexRange),
+            POOL_VERTEX_SIZE * vertexCounts[i]);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, oldIBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.iboID);
+        glCopyBufferSubData(
+            GL_COPY_READ_BUFFER,
+            GL_COPY_WRITE_BUFFER,
+            sizeof(GLuint) * indexOffsets[i],
+            sizeof(GLuint) * page.indexRanges.getRangeOffset(allocation.indexRange),
+            sizeof(GLuint) * indexCounts[i]);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteVertexArrays(1, &oldVAO);
+    GetGpuResourceRegistry().removeResource(GPU_RESOURCE_BUFFER, oldVBO);
+    GetGpuResourceRegistry().removeResource(GPU_RESOURCE_BUFFER, oldIBO);
+    GLuint oldBuffers[] = { oldVBO, oldIBO };
+    glDeleteBuffers(2, oldBuffers);
+}
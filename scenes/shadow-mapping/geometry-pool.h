@@ -0,0 +1,142 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "range-allocator.h"
+
+// Vertex array and the instance buffer region wired up to
+// its instance attributes, owned by a mesh of its own or
+// shared by all the meshes of a geometry pool page. The
+// storage generation tells a recreated buffer apart from
+// the deleted one it may have taken the name of.
+struct VertexArrayBinding
+{
+    GLuint vaoID = 0;
+    GLuint attachedInstanceBufferID = 0;
+    unsigned int attachedInstanceStorageGeneration = 0;
+    GLintptr attachedInstanceBufferOffset = 0;
+};
+
+struct GeometryPoolStatistics
+{
+    size_t pageCount = 0;
+    size_t allocationCount = 0;
+    size_t vertexCapacity = 0;
+    size_t usedVertices = 0;
+    size_t indexCapacity = 0;
+    size_t usedIndices = 0;
+    size_t freeRangeCount = 0;
+    size_t largestFreeVertexRange = 0;
+    size_t largestFreeIndexRange = 0;
+};
+
+// Keeps the geometry of many meshes in a few large vertex and
+// index buffers instead of a pair of buffers per mesh. Each page
+// holds one vertex and one index buffer with a vertex array set
+// up for them, and hands out ranges of both to the meshes. The
+// meshes keep their indices relative to their own first vertex
+// and draw with the base vertex of their range.
+//
+// All meshes of a pool share the vertex format of the scene
+// (position, texture coordinates, normal), a vertex format of
+// its own would get a pool of its own. The pool lives on the
+// render thread, meshes filled on an upload context are copied
+// into it on the render thread once their buffers are done.
+class GeometryPool
+{
+public:
+    static const unsigned int INVALID_GEOMETRY = 0xFFFFFFFF;
+
+    GeometryPool();
+
+    void createGeometryPool(GLuint pageVertexCount, GLuint pageIndexCount);
+
+    // Copies the geometry into a free range of a page, meshes
+    // larger than a page get a page sized to fit them. Null
+    // vertices and indices reserve the range unfilled.
+    unsigned int allocateGeometry(
+        const GLfloat *vertices,
+        GLuint vertexCount,
+        const GLuint *indices,
+        GLuint indexCount);
+    void freeGeometry(unsigned int geometry);
+
+    GLint getBaseVertex(unsigned int geometry) const;
+    GLuint getFirstIndex(unsigned int geometry) const;
+    GLuint getVertexBufferID(unsigned int geometry) const;
+    GLuint getIndexBufferID(unsigned int geometry) const;
+    VertexArrayBinding& getVertexArray(unsigned int geometry);
+
+    // Moves the geometry of every fragmented page to the front
+    // of a fresh pair of buffers with copies on the GPU, and
+    // frees the buffers of the pages left empty. The ranges
+    // of the meshes move, their geometry handles do not.
+    void defragmentGeometryPool();
+
+    GeometryPoolStatistics getStatistics() const;
+    void printStatistics() const;
+
+    void clearGeometryPool();
+
+    ~GeometryPool();
+
+private:
+    struct Page
+    {
+        GLuint vboID = 0;
+        GLuint iboID = 0;
+        VertexArrayBinding vertexArray;
+        RangeAllocator vertexRanges;
+        RangeAllocator indexRanges;
+        size_t allocationCount = 0;
+    };
+
+    struct Allocation
+    {
+        unsigned int pageIndex;
+        unsigned int vertexRange;
+        unsigned int indexRange;
+        bool live;
+    };
+
+    unsigned int createPage(GLuint vertexCapacity, GLuint indexCapacity);
+    void createPageBuffers(Page &page);
+    void clearPageBuffers(Page &page);
+    void defragmentPage(unsigned int pageIndex);
+
+    GLuint m_pageVertexCount;
+    GLuint m_pageIndexCount;
+
+    // Pages keep their index for the lifetime of the pool,
+    // the pages left empty by defragmenting are reused
+    std::vector<std::unique_ptr<Page> > m_pages;
+    std::vector<Allocation> m_allocations;
+    std::vector<unsigned int> m_freeAllocations;
+};
@@ -0,0 +1,289 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+#include "gpu-resource-registry.h"
+
+static const char* gpuResourceTypeNames[GPU_RESOURCE_TYPE_COUNT] = {
+    "Buffers",
+    "Textures",
+    "Framebuffers",
+    "Programs"
+};
+
+static const char* gpuResourceObjectNames[GPU_RESOURCE_TYPE_COUNT] = {
+    "Buffer",
+    "Texture",
+    "Framebuffer",
+    "Program"
+};
+
+GpuResourceRegistry::GpuResourceRegistry()
+{
+    for (unsigned int i = 0; i < GPU_RESOURCE_TYPE_COUNT; ++i)
+    {
+        m_usedSizes[i] = 0;
+        m_resourceCounts[i] = 0;
+        m_budgets[i] = 0;
+        m_overBudget[i] = false;
+    }
+}
+
+unsigned long long GpuResourceRegistry::getResourceKey(GpuResourceType type, GLuint id)
+{
+    // Every type of object has its own range of names
+    return ((unsigned long long)type << 32) | id;
+}
+
+void GpuResourceRegistry::addResource(GpuResourceType type, GLuint id, size_t byteSize, const std::string &owner)
+{
+    if (!id)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Resource &resource = m_resources[getResourceKey(type, id)];
+    if (resource.id)
+    {
+        // A name can only be reused once it has been deleted
+        printf("Warning: GpuResourceRegistry::addResource(): %s %u was never removed\n", gpuResourceObjectNames[type], id);
+        m_usedSizes[type] -= resource.byteSize;
+        --m_resourceCounts[type];
+    }
+
+    resource.type = type;
+    resource.id = id;
+    resource.byteSize = byteSize;
+    resource.owner = owner;
+
+    m_usedSizes[type] += byteSize;
+    ++m_resourceCounts[type];
+    checkBudget(type);
+}
+
+void GpuResourceRegistry::resizeResource(GpuResourceType type, GLuint id, size_t byteSize)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unordered_map<unsigned long long, Resource>::iterator it = m_resources.find(getResourceKey(type, id));
+    if (it == m_resources.end())
+    {
+        return;
+    }
+
+    m_usedSizes[type] = m_usedSizes[type] - it->second.byteSize + byteSize;
+    it->second.byteSize = byteSize;
+    checkBudget(type);
+}
+
+void GpuResourceRegistry::removeResource(GpuResourceType type, GLuint id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unordered_map<unsigned long long, Resource>::iterator it = m_resources.find(getResourceKey(type, id));
+    if (it == m_resources.end())
+    {
+        return;
+    }
+
+    m_usedSizes[type] -= it->second.byteSize;
+    --m_resourceCounts[type];
+    m_resources.erase(it);
+    checkBudget(type);
+}
+
+void GpuResourceRegistry::setBudget(GpuResourceType type, size_t byteSize)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_budgets[type] = byteSize;
+    m_overBudget[type] = false;
+    checkBudget(type);
+}
+
+void GpuResourceRegistry::checkBudget(GpuResourceType type)
+{
+    bool overBudget = m_budgets[type] && m_usedSizes[type] > m_budgets[type];
+
+    // Warn once each time the budget is crossed rather
+    // than for every object added while it is exceeded
+    if (overBudget && !m_overBudget[type])
+    {
+        printf("Warning: GpuResourceRegistry: %s take %.1f MB, over their budget of %.1f MB\n",
+            gpuResourceTypeNames[type],
+            m_usedSizes[type] / (1024.0 * 1024.0),
+            m_budgets[type] / (1024.0 * 1024.0));
+    }
+    m_overBudget[type] = overBudget;
+}
+
+bool GpuResourceRegistry::isOverBudget(GpuResourceType type)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_overBudget[type];
+}
+
+size_t GpuResourceRegistry::getUsedSize(GpuResourceType type)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_usedSizes[type];
+}
+
+size_t GpuResourceRegistry::getResourceCount(GpuResourceType type)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_resourceCounts[type];
+}
+
+void GpuResourceRegistry::printUsage()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t totalSize = 0;
+    for (unsigned int i = 0; i < GPU_RESOURCE_TYPE_COUNT; ++i)
+    {
+        totalSize += m_usedSizes[i];
+    }
+    printf("GPU memory: %.1f MB estimated in %zu objects\n", totalSize / (1024.0 * 1024.0), m_resources.size());
+
+    for (unsigned int i = 0; i < GPU_RESOURCE_TYPE_COUNT; ++i)
+    {
+        if (m_budgets[i])
+        {
+            printf("  %s: %zu objects, %.1f of %.1f MB\n",
+                gpuResourceTypeNames[i],
+                m_resourceCounts[i],
+                m_usedSizes[i] / (1024.0 * 1024.0),
+                m_budgets[i] / (1024.0 * 1024.0));
+        }
+        else
+        {
+            printf("  %s: %zu objects, %.1f MB\n",
+                gpuResourceTypeNames[i],
+                m_resourceCounts[i],
+                m_usedSizes[i] / (1024.0 * 1024.0));
+        }
+    }
+
+    // Largest owners first
+    std::map<std::string, size_t> ownerSizes;
+    for (std::unordered_map<unsigned long long, Resource>::const_iterator it = m_resources.begin(); it != m_resources.end(); ++it)
+    {
+        ownerSizes[it->second.owner] += it->second.byteSize;
+    }
+
+    std::vector<std::pair<size_t, std::string> > owners;
+    for (std::map<std::string, size_t>::const_iterator it = ownerSizes.begin(); it != ownerSizes.end(); ++it)
+    {
+        owners.push_back(std::make_pair(it->second, it->first));
+    }
+    std::sort(owners.rbegin(), owners.rend());
+
+    for (size_t i = 0; i < owners.size(); ++i)
+    {
+        printf("  %.1f MB %s\n", owners[i].first / (1024.0 * 1024.0), owners[i].second.c_str());
+    }
+}
+
+size_t GpuResourceRegistry::reportLeaks()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_resources.empty())
+    {
+        return 0;
+    }
+
+    size_t leakedSize = 0;
+    for (std::unordered_map<unsigned long long, Resource>::const_iterator it = m_resources.begin(); it != m_resources.end(); ++it)
+    {
+        leakedSize += it->second.byteSize;
+    }
+    printf("Warning: GpuResourceRegistry: %zu GL objects (%.1f KB) were never released\n",
+        m_resources.size(), leakedSize / 1024.0);
+
+    for (std::unordered_map<unsigned long long, Resource>::const_iterator it = m_resources.begin(); it != m_resources.end(); ++it)
+    {
+        const Resource &resource = it->second;
+        printf("  %s %u, %.1f KB, owned by %s\n",
+            gpuResourceObjectNames[resource.type],
+            resource.id,
+            resource.byteSize / 1024.0,
+            resource.owner.c_str());
+    }
+
+    return m_resources.size();
+}
+
+void GpuResourceRegistry::clearRegistry()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_resources.clear();
+    for (unsigned int i = 0; i < GPU_RESOURCE_TYPE_COUNT; ++i)
+    {
+        m_usedSizes[i] = 0;
+        m_resourceCounts[i] = 0;
+        m_budgets[i] = 0;
+        m_overBudget[i] = false;
+    }
+}
+
+size_t GpuResourceRegistry::estimateTextureSize(
+    GLsizei width,
+    GLsizei height,
+    GLsizei layers,
+    size_t bytesPerTexel,
+    bool mipmapped)
+{
+    size_t byteSize = 0;
+    while (true)
+    {
+        byteSize += (size_t)width * height * layers * bytesPerTexel;
+        if (!mipmapped || (width <= 1 && height <= 1))
+        {
+            break;
+        }
+
+        // Layers are not halved along with the levels
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    return byteSize;
+}
+
+GpuResourceRegistry& GetGpuResourceRegistry()
+{
+    // Never destroyed, global objects may still release
+    // their resources after it would have been torn down
+    static GpuResourceRegistry *registry = new GpuResourceRegistry();
+    return *registry;
+}
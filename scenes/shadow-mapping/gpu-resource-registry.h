@@ -0,0 +1,106 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+enum GpuResourceType
+{
+    GPU_RESOURCE_BUFFER,
+    GPU_RESOURCE_TEXTURE,
+    GPU_RESOURCE_FRAMEBUFFER,
+    GPU_RESOURCE_PROGRAM,
+    GPU_RESOURCE_TYPE_COUNT
+};
+
+// Keeps a record of the GL objects alive in the program, with
+// an estimate of the video memory each takes and a label of
+// who owns it. GL has no portable way of asking for the memory
+// in use, so the sizes are worked out from what was uploaded.
+// Objects can be added from any thread, the upload context
+// shares its object names with the window.
+class GpuResourceRegistry
+{
+public:
+    GpuResourceRegistry();
+
+    void addResource(GpuResourceType type, GLuint id, size_t byteSize, const std::string &owner);
+    void resizeResource(GpuResourceType type, GLuint id, size_t byteSize);
+    void removeResource(GpuResourceType type, GLuint id);
+
+    // A warning is printed whenever the memory of a type of
+    // object grows past its budget, zero leaves it unlimited
+    void setBudget(GpuResourceType type, size_t byteSize);
+    bool isOverBudget(GpuResourceType type);
+
+    size_t getUsedSize(GpuResourceType type);
+    size_t getResourceCount(GpuResourceType type);
+
+    // Memory in use per type of object and per owner
+    void printUsage();
+
+    // Lists the objects that are still around, meant to be
+    // called once everything should have been released.
+    // Returns the number of objects left.
+    size_t reportLeaks();
+
+    void clearRegistry();
+
+    // Bytes taken by a texture, or by every layer of a texture
+    // array, including its mipmap chain when it has one
+    static size_t estimateTextureSize(
+        GLsizei width,
+        GLsizei height,
+        GLsizei layers,
+        size_t bytesPerTexel,
+        bool mipmapped);
+
+private:
+    struct Resource
+    {
+        GpuResourceType type;
+        GLuint id;
+        size_t byteSize;
+        std::string owner;
+    };
+
+    static unsigned long long getResourceKey(GpuResourceType type, GLuint id);
+    void checkBudget(GpuResourceType type);
+
+    std::mutex m_mutex;
+    std::unordered_map<unsigned long long, Resource> m_resources;
+
+    size_t m_usedSizes[GPU_RESOURCE_TYPE_COUNT];
+    size_t m_resourceCounts[GPU_RESOURCE_TYPE_COUNT];
+    size_t m_budgets[GPU_RESOURCE_TYPE_COUNT];
+    bool m_overBudget[GPU_RESOURCE_TYPE_COUNT];
+};
+
+// The registry every GL object of the program is recorded in
+GpuResourceRegistry& GetGpuResourceRegistry();
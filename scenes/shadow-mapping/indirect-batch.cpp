@@ -0,0 +1,633 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include <cstddef>
+
+#include "constants.h"
+#include "gpu-resource-registry.h"
+#include "indirect-batch.h"
+
+IndirectBatch::IndirectBatch() :
+    m_transformsDirty(false),
+    m_transformBuffer(GL_SHADER_STORAGE_BUFFER),
+    m_commandBuffer(GL_DRAW_INDIRECT_BUFFER),
+    m_drawInstanceBuffer(GL_ARRAY_BUFFER),
+    m_vaoID(0),
+    m_vboID(0),
+    m_iboID(0)
+{
+}
+
+bool IndirectBatch::isSupported()
+{
+    return GLAD_GL_VERSION_4_3;
+}
+
+unsigned int IndirectBatch::addObject(GLsizei instanceCount)
+{
+    Object object;
+    object.firstTransformIndex = m_transforms.size();
+    object.instanceCount = instanceCount;
+    object.level = 0;
+    object.visible = true;
+    object.clusterCuller = nullptr;
+    object.instanceLevels = nullptr;
+    object.instanceVisibility = nullptr;
+    object.levelCount = 1;
+    object.firstLevelStart = 0;
+    m_objects.push_back(object);
+
+    m_transforms.resize(m_transforms.size() + instanceCount, glm::mat4(1.0f));
+    m_transformsDirty = true;
+
+    return m_objects.size() - 1;
+}
+
+void IndirectBatch::addMesh(
+    unsigned int objectIndex,
+    Mesh *mesh,
+    Texture *texture,
+    Material *material)
+{
+    Draw draw;
+    draw.objectIndex = objectIndex;
+    draw.geometryIndex = addGeometry(mesh);
+    draw.texture = texture;
+    draw.textureArray = nullptr;
+    draw.textureLayer = 0;
+    draw.material = material;
+    m_draws.push_back(draw);
+}
+
+void IndirectBatch::addMesh(
+    unsigned int objectIndex,
+    Mesh *mesh,
+    TextureArray *textureArray,
+    GLuint textureLayer,
+    Material *material)
+{
+    Draw draw;
+    draw.objectIndex = objectIndex;
+    draw.geometryIndex = addGeometry(mesh);
+    draw.texture = nullptr;
+    draw.textureArray = textureArray;
+    draw.textureLayer = textureLayer;
+    draw.material = material;
+    m_draws.push_back(draw);
+}
+
+void IndirectBatch::addModel(
+    unsigned int objectIndex,
+    Model &model,
+    Material *material)
+{
+    TextureArray *textureArray = model.getTextureArray();
+
+    for (size_t i = 0; i < model.getMeshCount(); ++i)
+    {
+        if (textureArray)
+        {
+            addMesh(objectIndex, model.getMesh(i), textureArray, model.getMeshTextureLayer(i), material);
+        }
+        else
+        {
+            addMesh(objectIndex, model.getMesh(i), model.getMeshTexture(i), material);
+        }
+    }
+}
+
+unsigned int IndirectBatch::addGeometry(Mesh *mesh)
+{
+    // Meshes drawn by several objects share
+    // the same copy of the geometry
+    std::map<Mesh*, unsigned int>::iterator it = m_geometryLookup.find(mesh);
+    if (it != m_geometryLookup.end())
+    {
+        return it->second;
+    }
+
+    Geometry geometry;
+    geometry.mesh = mesh;
+    geometry.firstIndex = 0;
+    geometry.baseVertex = 0;
+    m_geometries.push_back(geometry);
+
+    unsigned int geometryIndex = m_geometries.size() - 1;
+    m_geometryLookup[mesh] = geometryIndex;
+    return geometryIndex;
+}
+
+void IndirectBatch::setTransform(
+    unsigned int objectIndex,
+    const glm::mat4 &transform)
+{
+    m_transforms[m_objects[objectIndex].firstTransformIndex] = transform;
+    m_transformsDirty = true;
+}
+
+void IndirectBatch::setInstanceTransforms(
+    unsigned int objectIndex,
+    const glm::mat4 *transforms,
+    GLsizei instanceCount)
+{
+    const Object &object = m_objects[objectIndex];
+    if (instanceCount > object.instanceCount)
+    {
+        instanceCount = object.instanceCount;
+    }
+
+    std::copy(transforms, transforms + instanceCount, m_transforms.begin() + object.firstTransformIndex);
+    m_transformsDirty = true;
+}
+
+void IndirectBatch::setObjectLevelOfDetail(
+    unsigned int objectIndex,
+    unsigned int level)
+{
+    m_objects[objectIndex].level = level;
+}
+
+void IndirectBatch::setObjectVisible(
+    unsigned int objectIndex,
+    bool visible)
+{
+    m_objects[objectIndex].visible = visible;
+}
+
+void IndirectBatch::setInstanceSelection(
+    unsigned int objectIndex,
+    const unsigned int *instanceLevels,
+    const unsigned char *instanceVisibility)
+{
+    m_objects[objectIndex].instanceLevels = instanceLevels;
+    m_objects[objectIndex].instanceVisibility = instanceVisibility;
+}
+
+void IndirectBatch::setObjectClusterCuller(
+    unsigned int objectIndex,
+    ClusterCuller *clusterCuller)
+{
+    m_objects[objectIndex].clusterCuller = clusterCuller;
+}
+
+bool IndirectBatch::build()
+{
+    if (!isSupported())
+    {
+        printf("Error: IndirectBatch::build(): OpenGL 4.3 is required for multi draw indirect\n");
+        return false;
+    }
+
+    // Work out where each mesh lands
+    // inside the shared buffers
+    GLsizei totalVertexCount = 0;
+    GLsizei totalIndexCount = 0;
+    for (size_t i = 0; i < m_geometries.size(); ++i)
+    {
+        m_geometries[i].baseVertex = totalVertexCount;
+        m_geometries[i].firstIndex = totalIndexCount;
+        totalVertexCount += m_geometries[i].mesh->getVertexCount();
+        totalIndexCount += m_geometries[i].mesh->getAllLevelsIndexCount();
+    }
+
+    const GLsizeiptr vertexSize = sizeof(GLfloat) * 8;
+
+    glGenVertexArrays(1, &m_vaoID);
+    glBindVertexArray(m_vaoID);
+
+        glGenBuffers(1, &m_iboID);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iboID);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * totalIndexCount, nullptr, GL_STATIC_DRAW);
+        GetGpuResourceRegistry().addResource(GPU_RESOURCE_BUFFER, m_iboID, sizeof(GLuint) * totalIndexCount, "Indirect batch");
+
+        glGenBuffers(1, &m_vboID);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
+        glBufferData(GL_ARRAY_BUFFER, vertexSize * totalVertexCount, nullptr, GL_STATIC_DRAW);
+        GetGpuResourceRegistry().addResource(GPU_RESOURCE_BUFFER, m_vboID, vertexSize * totalVertexCount, "Indirect batch");
+
+        // Copy the geometry of the meshes over on the GPU
+        // side. The indices are kept as they are because
+        // each draw command carries its own base vertex,
+        // and the levels keep their offsets in the mesh.
+        for (size_t i = 0; i < m_geometries.size(); ++i)
+        {
+            Mesh *mesh = m_geometries[i].mesh;
+
+            glBindBuffer(GL_COPY_READ_BUFFER, mesh->getVertexBufferID());
+            glCopyBufferSubData(
+                GL_COPY_READ_BUFFER,
+                GL_ARRAY_BUFFER,
+                vertexSize * mesh->getBaseVertex(),
+                vertexSize * m_geometries[i].baseVertex,
+                vertexSize * mesh->getVertexCount());
+
+            glBindBuffer(GL_COPY_READ_BUFFER, mesh->getIndexBufferID());
+            glCopyBufferSubData(
+                GL_COPY_READ_BUFFER,
+                GL_ELEMENT_ARRAY_BUFFER,
+                sizeof(GLuint) * mesh->getFirstIndex(),
+                sizeof(GLuint) * m_geometries[i].firstIndex,
+                sizeof(GLuint) * mesh->getAllLevelsIndexCount());
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        // Same vertex layout as the individual meshes
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexSize, (const void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(sizeof(GLfloat) * 3));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(sizeof(GLfloat) * 5));
+        glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    for (size_t i = 0; i < m_draws.size(); ++i)
+    {
+        Object &object = m_objects[m_draws[i].objectIndex];
+        Mesh *mesh = m_geometries[m_draws[i].geometryIndex].mesh;
+        object.levelCount = std::max(object.levelCount, mesh->getLevelOfDetailCount());
+    }
+
+    // Sort the draws so that the ones
+    // sharing textures are contiguous
+    std::stable_sort(m_draws.begin(), m_draws.end(), [](const Draw &a, const Draw &b) {
+        if (a.textureArray != b.textureArray) return a.textureArray < b.textureArray;
+        return a.texture < b.texture;
+    });
+
+    // The per-draw data is fed through instanced attributes
+    // so that it also works without ARB_shader_draw_parameters.
+    // They are pointed at the streamed data by every render.
+    glBindVertexArray(m_vaoID);
+
+        glEnableVertexAttribArray(INDIRECT_TRANSFORM_INDEX_ATTRIBUTE_LOCATION);
+        glVertexAttribDivisor(INDIRECT_TRANSFORM_INDEX_ATTRIBUTE_LOCATION, 1);
+
+        glEnableVertexAttribArray(TEXTURE_LAYER_ATTRIBUTE_LOCATION);
+        glVertexAttribDivisor(TEXTURE_LAYER_ATTRIBUTE_LOCATION, 1);
+
+        glEnableVertexAttribArray(DRAW_MATERIAL_ATTRIBUTE_LOCATION);
+        glVertexAttribDivisor(DRAW_MATERIAL_ATTRIBUTE_LOCATION, 1);
+
+    glBindVertexArray(0);
+
+    // The transforms are uploaded by the first render
+    m_transformsDirty = true;
+
+    return true;
+}
+
+void IndirectBatch::buildCommands()
+{
+    m_commands.clear();
+    m_drawInstances.clear();
+    m_drawGroups.clear();
+
+    // The instances are sorted once per object, the
+    // meshes of the object all draw the same order
+    m_sortedInstances.clear();
+    m_levelStarts.clear();
+    for (size_t i = 0; i < m_objects.size(); ++i)
+    {
+        if (m_objects[i].instanceLevels || m_objects[i].instanceVisibility)
+        {
+            sortInstancesByLevel(m_objects[i]);
+        }
+    }
+
+    for (size_t i = 0; i < m_draws.size(); ++i)
+    {
+        const Draw &draw = m_draws[i];
+        const Geometry &geometry = m_geometries[draw.geometryIndex];
+        const Object &object = m_objects[draw.objectIndex];
+        if (!object.visible)
+        {
+            continue;
+        }
+
+        // Instanced attributes are offset by the base instance
+        // of a draw, so pointing the base instance at the first
+        // entry of this draw makes every instance of it read
+        // its own entry (baseInstance + gl_InstanceID)
+        GLuint baseInstance = m_drawInstances.size();
+
+        if (object.instanceLevels || object.instanceVisibility)
+        {
+            for (unsigned int level = 0; level < object.levelCount; ++level)
+            {
+                GLsizei firstInstance = m_levelStarts[object.firstLevelStart + level];
+                GLsizei instanceCount = m_levelStarts[object.firstLevelStart + level + 1] - firstInstance;
+                if (!instanceCount)
+                {
+                    continue;
+                }
+
+                baseInstance = m_drawInstances.size();
+                addInstances(object, draw, &m_sortedInstances[firstInstance], instanceCount);
+                addCommand(
+                    draw,
+                    geometry.mesh->getLevelIndexCount(level),
+                    geometry.mesh->getLevelFirstIndex(level),
+                    instanceCount,
+                    baseInstance);
+            }
+            continue;
+        }
+
+        addInstances(object, draw, nullptr, object.instanceCount);
+
+        // The clusters only cover the full detail level
+        // and are culled with the matrix of the object
+        if (object.clusterCuller && object.level == 0 && object.instanceCount == 1 &&
+            !geometry.mesh->getClusters().empty())
+        {
+            object.clusterCuller->cullClusters(
+                geometry.mesh->getClusters(),
+                m_transforms[object.firstTransformIndex],
+                m_clusterVisibility);
+            addClusterCommands(draw, object.instanceCount, baseInstance);
+            continue;
+        }
+
+        addCommand(
+            draw,
+            geometry.mesh->getLevelIndexCount(object.level),
+            geometry.mesh->getLevelFirstIndex(object.level),
+            object.instanceCount,
+            baseInstance);
+    }
+}
+
+void IndirectBatch::sortInstancesByLevel(Object &object)
+{
+    // The levels are few, so each one takes a
+    // pass over the instances in their order
+    object.firstLevelStart = m_levelStarts.size();
+    for (unsigned int level = 0; level < object.levelCount; ++level)
+    {
+        m_levelStarts.push_back(m_sortedInstances.size());
+
+        for (GLsizei instance = 0; instance < object.instanceCount; ++instance)
+        {
+            if (object.instanceVisibility && !object.instanceVisibility[instance])
+            {
+                continue;
+            }
+
+            unsigned int instanceLevel = object.instanceLevels ? object.instanceLevels[instance] : 0;
+            if (std::min(instanceLevel, object.levelCount - 1) == level)
+            {
+                m_sortedInstances.push_back(instance);
+            }
+        }
+    }
+    m_levelStarts.push_back(m_sortedInstances.size());
+}
+
+void IndirectBatch::addInstances(
+    const Object &object,
+    const Draw &draw,
+    const GLuint *instances,
+    GLsizei instanceCount)
+{
+    // Without a list the instances are drawn in order
+    for (GLsizei i = 0; i < instanceCount; ++i)
+    {
+        DrawInstanceData drawInstance;
+        drawInstance.transformIndex = object.firstTransformIndex + (instances ? instances[i] : i);
+        drawInstance.textureLayer = draw.textureLayer;
+        drawInstance.specularIntensity = draw.material ? draw.material->getSpecularIntensity() : 0.0f;
+        drawInstance.shininess = draw.material ? draw.material->getShininess() : 1.0f;
+        m_drawInstances.push_back(drawInstance);
+    }
+}
+
+void IndirectBatch::addCommand(
+    const Draw &draw,
+    GLuint count,
+    GLuint firstIndex,
+    GLsizei instanceCount,
+    GLuint baseInstance)
+{
+    if (!count || !instanceCount)
+    {
+        return;
+    }
+
+    // The first index is relative to the start of the mesh
+    const Geometry &geometry = m_geometries[draw.geometryIndex];
+
+    DrawElementsIndirectCommand command;
+    command.count = count;
+    command.instanceCount = instanceCount;
+    command.firstIndex = geometry.firstIndex + firstIndex;
+    command.baseVertex = geometry.baseVertex;
+    command.baseInstance = baseInstance;
+    m_commands.push_back(command);
+
+    if (m_drawGroups.empty() ||
+        m_drawGroups.back().texture != draw.texture ||
+        m_drawGroups.back().textureArray != draw.textureArray)
+    {
+        DrawGroup group;
+        group.texture = draw.texture;
+        group.textureArray = draw.textureArray;
+        group.firstCommand = m_commands.size() - 1;
+        group.commandCount = 0;
+        m_drawGroups.push_back(group);
+    }
+    m_drawGroups.back().commandCount++;
+}
+
+void IndirectBatch::addClusterCommands(
+    const Draw &draw,
+    GLsizei instanceCount,
+    GLuint baseInstance)
+{
+    const std::vector<MeshCluster> &clusters = m_geometries[draw.geometryIndex].mesh->getClusters();
+    size_t clusterCount = std::min(clusters.size(), m_clusterVisibility.size());
+
+    GLuint rangeFirstIndex = 0;
+    GLuint rangeEnd = 0;
+    bool rangeOpen = false;
+    for (size_t i = 0; i < clusterCount; ++i)
+    {
+        if (!m_clusterVisibility[i])
+        {
+            continue;
+        }
+
+        const MeshCluster &cluster = clusters[i];
+        if (rangeOpen && cluster.firstIndex != rangeEnd)
+        {
+            addCommand(draw, rangeEnd - rangeFirstIndex, rangeFirstIndex, instanceCount, baseInstance);
+            rangeOpen = false;
+        }
+
+        if (!rangeOpen)
+        {
+            rangeFirstIndex = cluster.firstIndex;
+            rangeOpen = true;
+        }
+        rangeEnd = cluster.firstIndex + cluster.indexCount;
+    }
+
+    if (rangeOpen)
+    {
+        addCommand(draw, rangeEnd - rangeFirstIndex, rangeFirstIndex, instanceCount, baseInstance);
+    }
+}
+
+void IndirectBatch::render(ShaderManager *shader)
+{
+    if (!m_vaoID)
+    {
+        return;
+    }
+
+    // The transforms only change when an object moves
+    if (m_transformsDirty)
+    {
+        if (!m_transformBuffer.updateRegion(m_transforms.data(), sizeof(glm::mat4) * m_transforms.size()))
+        {
+            return;
+        }
+        m_transformsDirty = false;
+    }
+
+    buildCommands();
+    if (m_commands.empty())
+    {
+        return;
+    }
+
+    if (!m_commandBuffer.updateRegion(m_commands.data(), sizeof(DrawElementsIndirectCommand) * m_commands.size()) ||
+        !m_drawInstanceBuffer.updateRegion(m_drawInstances.data(), sizeof(DrawInstanceData) * m_drawInstances.size()))
+    {
+        return;
+    }
+
+    glBindVertexArray(m_vaoID);
+
+        // The per-draw data lands in another region of
+        // the stream every render, so the attributes are
+        // pointed at the region that was just written
+        GLintptr drawInstanceOffset = m_drawInstanceBuffer.getRegionOffset();
+        glBindBuffer(GL_ARRAY_BUFFER, m_drawInstanceBuffer.getBufferID());
+        glVertexAttribIPointer(INDIRECT_TRANSFORM_INDEX_ATTRIBUTE_LOCATION, 1, GL_UNSIGNED_INT, sizeof(DrawInstanceData),
+            (const void*)drawInstanceOffset);
+        glVertexAttribPointer(TEXTURE_LAYER_ATTRIBUTE_LOCATION, 1, GL_FLOAT, GL_FALSE, sizeof(DrawInstanceData),
+            (const void*)(drawInstanceOffset + offsetof(DrawInstanceData, textureLayer)));
+        glVertexAttribPointer(DRAW_MATERIAL_ATTRIBUTE_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(DrawInstanceData),
+            (const void*)(drawInstanceOffset + offsetof(DrawInstanceData, specularIntensity)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLintptr commandOffset = m_commandBuffer.getRegionOffset();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer.getBufferID());
+    glBindBufferRange(
+        GL_SHADER_STORAGE_BUFFER,
+        INDIRECT_TRANSFORM_BUFFER_BINDING,
+        m_transformBuffer.getBufferID(),
+        m_transformBuffer.getRegionOffset(),
+        m_transformBuffer.getRegionSize());
+
+        if (!shader)
+        {
+            // Nothing to rebind between the draws, so
+            // the whole scene goes out in one call
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)commandOffset, m_commands.size(), 0);
+        }
+        else
+        {
+            for (size_t i = 0; i < m_drawGroups.size(); ++i)
+            {
+                const DrawGroup &group = m_drawGroups[i];
+
+                if (group.textureArray)
+                {
+                    group.textureArray->useTextureArray();
+                }
+                else if (group.texture)
+                {
+                    group.texture->useTexture();
+                }
+
+                glMultiDrawElementsIndirect(
+                    GL_TRIANGLES,
+                    GL_UNSIGNED_INT,
+                    (const void*)(commandOffset + sizeof(DrawElementsIndirectCommand) * group.firstCommand),
+                    group.commandCount,
+                    0);
+            }
+        }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void IndirectBatch::clearBatch()
+{
+    if (m_vaoID)
+    {
+        GLuint buffers[] = {
+            m_vboID,
+            m_iboID
+        };
+        for (size_t i = 0; i < 2; ++i)
+        {
+            GetGpuResourceRegistry().removeResource(GPU_RESOURCE_BUFFER, buffers[i]);
+        }
+        glDeleteBuffers(2, buffers);
+        glDeleteVertexArrays(1, &m_vaoID);
+
+        m_vaoID = 0;
+        m_vboID = 0;
+        m_iboID = 0;
+    }
+
+    m_transformBuffer.clearStreamingBuffer();
+    m_commandBuffer.clearStreamingBuffer();
+    m_drawInstanceBuffer.clearStreamingBuffer();
+
+    m_objects.clear();
+    m_geometries.clear();
+    m_geometryLookup.clear();
+    m_draws.clear();
+    m_commands.clear();
+    m_drawInstances.clear();
+    m_drawGroups.clear();
+    m_clusterVisibility.clear();
+    m_sortedInstances.clear();
+    m_levelStarts.clear();
+    m_transforms.clear();
+    m_transformsDirty = false;
+}
+
+IndirectBatch::~IndirectBatch()
+{
+    clearBatch();
+}
@@ -0,0 +1,245 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "cluster-culler.h"
+#include "material.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader-manager.h"
+#include "streaming-buffer.h"
+#include "texture.h"
+#include "texture-array.h"
+
+// Layout of a single draw command as expected
+// by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Submits a whole scene with a handful of
+// glMultiDrawElementsIndirect calls. The geometry
+// of all the meshes (every level of detail) is
+// copied into one shared vertex and index buffer
+// and each draw looks up its model matrix from a
+// shader storage buffer. The draw commands are
+// written every render from what the pass selected
+// of each object, so they follow the levels of
+// detail picked on the CPU.
+class IndirectBatch
+{
+public:
+    IndirectBatch();
+
+    // Multi draw indirect and shader storage
+    // buffers need an OpenGL 4.3 context
+    static bool isSupported();
+
+    // Reserves transform slots for an object
+    // drawn instanceCount times and returns
+    // the index of the object
+    unsigned int addObject(GLsizei instanceCount = 1);
+
+    void addMesh(
+        unsigned int objectIndex,
+        Mesh *mesh,
+        Texture *texture,
+        Material *material);
+    void addMesh(
+        unsigned int objectIndex,
+        Mesh *mesh,
+        TextureArray *textureArray,
+        GLuint textureLayer,
+        Material *material);
+    void addModel(
+        unsigned int objectIndex,
+        Model &model,
+        Material *material);
+
+    void setTransform(
+        unsigned int objectIndex,
+        const glm::mat4 &transform);
+    void setInstanceTransforms(
+        unsigned int objectIndex,
+        const glm::mat4 *transforms,
+        GLsizei instanceCount);
+
+    // What the next render draws of an object, kept until
+    // changed. Objects start visible and at full detail,
+    // hidden objects get no commands at all.
+    void setObjectLevelOfDetail(
+        unsigned int objectIndex,
+        unsigned int level);
+    void setObjectVisible(
+        unsigned int objectIndex,
+        bool visible);
+
+    // Per instance levels and visibility (1 visible, 0 hidden) of
+    // an object drawn several times, either may be nullptr. Every
+    // mesh draws each level with a single command over the visible
+    // instances sorted by level. The lists are only read by the
+    // render, they have to stay valid until then.
+    void setInstanceSelection(
+        unsigned int objectIndex,
+        const unsigned int *instanceLevels,
+        const unsigned char *instanceVisibility);
+
+    // Culls the clusters of a single instance object
+    // drawn at full detail, nullptr draws them all
+    void setObjectClusterCuller(
+        unsigned int objectIndex,
+        ClusterCuller *clusterCuller);
+
+    // Creates the GL buffers once all
+    // objects have been added
+    bool build();
+
+    // Pass a shader to bind the textures of the
+    // draws, with one call per texture, or nullptr
+    // to submit everything in a single call (e.g.
+    // for depth only passes). The materials are
+    // part of the per-draw data either way.
+    void render(ShaderManager *shader);
+
+    void clearBatch();
+
+    ~IndirectBatch();
+
+private:
+    struct Object
+    {
+        unsigned int firstTransformIndex;
+        GLsizei instanceCount;
+        unsigned int level;
+        bool visible;
+        ClusterCuller *clusterCuller;
+
+        const unsigned int *instanceLevels;
+        const unsigned char *instanceVisibility;
+
+        // Most levels any of the meshes has, and where
+        // the instances sorted by level start this render
+        unsigned int levelCount;
+        size_t firstLevelStart;
+    };
+
+    struct Geometry
+    {
+        Mesh *mesh;
+        GLuint firstIndex;
+        GLint baseVertex;
+    };
+
+    struct Draw
+    {
+        unsigned int objectIndex;
+        unsigned int geometryIndex;
+        Texture *texture;
+        TextureArray *textureArray;
+        GLuint textureLayer;
+        Material *material;
+    };
+
+    // Range of commands sharing the same texture
+    struct DrawGroup
+    {
+        Texture *texture;
+        TextureArray *textureArray;
+        GLsizei firstCommand;
+        GLsizei commandCount;
+    };
+
+    // Per-draw (and per-instance) vertex attributes,
+    // indexed through the base instance of each command
+    struct DrawInstanceData
+    {
+        GLuint transformIndex;
+        GLfloat textureLayer;
+        GLfloat specularIntensity;
+        GLfloat shininess;
+    };
+
+    unsigned int addGeometry(Mesh *mesh);
+
+    // Writes the commands and the per-draw data
+    // for the current selection of the objects
+    void buildCommands();
+    void sortInstancesByLevel(Object &object);
+    void addInstances(
+        const Object &object,
+        const Draw &draw,
+        const GLuint *instances,
+        GLsizei instanceCount);
+    void addCommand(
+        const Draw &draw,
+        GLuint count,
+        GLuint firstIndex,
+        GLsizei instanceCount,
+        GLuint baseInstance);
+
+    // One command per range of visible clusters,
+    // clusters next to each other are merged
+    void addClusterCommands(
+        const Draw &draw,
+        GLsizei instanceCount,
+        GLuint baseInstance);
+
+    std::vector<Object> m_objects;
+    std::vector<Geometry> m_geometries;
+    std::map<Mesh*, unsigned int> m_geometryLookup;
+    std::vector<Draw> m_draws;
+    std::vector<glm::mat4> m_transforms;
+    bool m_transformsDirty;
+
+    // Rebuilt by every render, the vectors keep
+    // their capacity from one render to the next
+    std::vector<DrawElementsIndirectCommand> m_commands;
+    std::vector<DrawInstanceData> m_drawInstances;
+    std::vector<DrawGroup> m_drawGroups;
+    std::vector<unsigned char> m_clusterVisibility;
+    std::vector<GLuint> m_sortedInstances;
+    std::vector<GLsizei> m_levelStarts;
+
+    // Transforms are rewritten every frame, so they
+    // are streamed instead of updated in place, and
+    // so are the commands and the per-draw data
+    StreamingBuffer m_transformBuffer;
+    StreamingBuffer m_commandBuffer;
+    StreamingBuffer m_drawInstanceBuffer;
+
+    GLuint m_vaoID, m_vboID, m_iboID;
+};
@@ -0,0 +1,109 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstdio>
+
+#include "input-event-queue.h"
+
+InputEventQueue::InputEventQueue() :
+    m_mask(0),
+    m_head(0),
+    m_tail(0)
+{
+}
+
+bool InputEventQueue::createInputEventQueue(size_t capacity)
+{
+    if (!capacity)
+    {
+        printf("Error: InputEventQueue::createInputEventQueue(): The capacity can not be zero\n");
+        return false;
+    }
+
+    // A power of two lets the positions wrap with a mask
+    size_t roundedCapacity = 1;
+    while (roundedCapacity < capacity)
+    {
+        roundedCapacity *= 2;
+    }
+
+    m_events.assign(roundedCapacity, InputEvent());
+    m_mask = roundedCapacity - 1;
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+bool InputEventQueue::pushEvent(const InputEvent &event)
+{
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+    if (head - tail == m_events.size())
+    {
+        return false;
+    }
+
+    m_events[head & m_mask] = event;
+
+    // The event is written before the consumer can see it
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool InputEventQueue::popEvent(InputEvent &event)
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t head = m_head.load(std::memory_order_acquire);
+    if (tail == head)
+    {
+        return false;
+    }
+
+    event = m_events[tail & m_mask];
+
+    // The slot is read before the producer can reuse it
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool InputEventQueue::peekEvent(InputEvent &event)
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t head = m_head.load(std::memory_order_acquire);
+    if (tail == head)
+    {
+        return false;
+    }
+
+    event = m_events[tail & m_mask];
+    return true;
+}
+
+void InputEventQueue::clearInputEventQueue()
+{
+    std::vector<InputEvent>().swap(m_events);
+    m_mask = 0;
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+}
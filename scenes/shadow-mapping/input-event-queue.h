@@ -0,0 +1,99 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include <glad/glad.h>
+
+enum InputEventType
+{
+    INPUT_EVENT_KEY_PRESSED,
+    INPUT_EVENT_KEY_RELEASED,
+    INPUT_EVENT_MOUSE_MOVED
+};
+
+struct InputEvent
+{
+    InputEventType type;
+
+    // GLFW key code of the key events
+    int key;
+
+    // Cursor movement of the mouse events since the previous one
+    GLfloat xChange;
+    GLfloat yChange;
+
+    // When the event came in, in seconds of GetInputEventTime()
+    double timeStamp;
+};
+
+// Seconds of the steady clock, the clock the events are stamped
+// with and the one a consumer times its own work against
+inline double GetInputEventTime()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Ring of input events handed from the thread polling the window
+// to one other thread. One thread pushes and one thread pops, and
+// neither takes a lock: each only writes its own end of the ring
+// and publishes it with release ordering for the other to acquire.
+class InputEventQueue
+{
+public:
+    InputEventQueue();
+
+    // The capacity is rounded up to a power of two
+    bool createInputEventQueue(size_t capacity);
+
+    // Returns false when the ring is full, the event is not queued
+    bool pushEvent(const InputEvent &event);
+
+    // Returns false when there is no event to take
+    bool popEvent(InputEvent &event);
+
+    // Same as popEvent but leaves the event in the
+    // ring, only ever called by the popping thread
+    bool peekEvent(InputEvent &event);
+
+    size_t getCapacity() const { return m_events.size(); }
+
+    // Only safe while neither end is in use
+    void clearInputEventQueue();
+
+private:
+    InputEventQueue(const InputEventQueue&) = delete;
+    InputEventQueue& operator=(const InputEventQueue&) = delete;
+
+    std::vector<InputEvent> m_events;
+    size_t m_mask;
+
+    // Kept on cache lines of their own, each end writes one of them
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+};
@@ -0,0 +1,78 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "instance-buffer.h"
+
+InstanceBuffer::InstanceBuffer() :
+    m_streamingBuffer(GL_ARRAY_BUFFER),
+    m_instanceCount(0)
+{
+}
+
+void InstanceBuffer::updateInstanceData(
+    const glm::mat4 *modelMatrices,
+    GLsizei instanceCount)
+{
+    // Each update goes into a fresh region of the streaming
+    // buffer, so we never wait on the GPU still drawing
+    // with the matrices of the previous frames
+    if (!m_streamingBuffer.updateRegion(modelMatrices, sizeof(glm::mat4) * instanceCount))
+    {
+        m_instanceCount = 0;
+        return;
+    }
+
+    m_instanceCount = instanceCount;
+}
+
+GLuint InstanceBuffer::getBufferID()
+{
+    return m_streamingBuffer.getBufferID();
+}
+
+unsigned int InstanceBuffer::getStorageGeneration()
+{
+    return m_streamingBuffer.getStorageGeneration();
+}
+
+GLintptr InstanceBuffer::getBufferOffset()
+{
+    return m_streamingBuffer.getRegionOffset();
+}
+
+GLsizei InstanceBuffer::getInstanceCount()
+{
+    return m_instanceCount;
+}
+
+void InstanceBuffer::clearInstanceBuffer()
+{
+    m_streamingBuffer.clearStreamingBuffer();
+    m_instanceCount = 0;
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    clearInstanceBuffer();
+}
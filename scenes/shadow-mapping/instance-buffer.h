@@ -0,0 +1,61 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "streaming-buffer.h"
+
+// Holds the per-instance model matrices used
+// for instanced drawing. The buffer is shared
+// between all the meshes of a model so that the
+// matrices are uploaded only once per frame.
+// The matrices are streamed into a ring of regions,
+// so the offset of the current region has to be
+// used when pointing the attributes at the buffer.
+class InstanceBuffer
+{
+public:
+    InstanceBuffer();
+
+    void updateInstanceData(
+        const glm::mat4 *modelMatrices,
+        GLsizei instanceCount);
+
+    GLuint getBufferID();
+    unsigned int getStorageGeneration();
+    GLintptr getBufferOffset();
+    GLsizei getInstanceCount();
+
+    void clearInstanceBuffer();
+
+    ~InstanceBuffer();
+
+private:
+    StreamingBuffer m_streamingBuffer;
+    GLsizei m_instanceCount;
+};
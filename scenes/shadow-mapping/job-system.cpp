@@ -0,0 +1,415 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+
+#include "job-system.h"
+
+// Queue of the worker running on the current thread, threads
+// outside the pool have none and use the shared queue
+static thread_local const JobSystem *currentJobSystem = nullptr;
+static thread_local unsigned int currentQueueIndex = 0;
+
+JobCounter::JobCounter() :
+    m_pending(0)
+{
+}
+
+bool JobCounter::isDone() const
+{
+    return m_pending == 0;
+}
+
+JobSystem::JobSystem() :
+    m_queuedJobs(0),
+    m_stopWorkers(false)
+{
+}
+
+void JobSystem::createJobSystem(unsigned int workerCount)
+{
+    clearJobSystem();
+
+    if (workerCount == 0)
+    {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    m_mainThread = std::this_thread::get_id();
+
+    // One queue per worker plus the shared one at the end
+    for (unsigned int i = 0; i <= workerCount; ++i)
+    {
+        m_queues.push_back(std::unique_ptr<JobQueue>(new JobQueue()));
+    }
+
+    m_stopWorkers = false;
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        m_workers.push_back(std::thread(&JobSystem::runWorker, this, i));
+    }
+}
+
+unsigned int JobSystem::getWorkerCount() const
+{
+    return m_workers.size();
+}
+
+void JobSystem::runJob(std::function<void()> function, JobCounter *counter)
+{
+    // Without workers nobody would pick the job up
+    if (m_workers.empty())
+    {
+        function();
+        return;
+    }
+
+    if (counter)
+    {
+        ++counter->m_pending;
+    }
+
+    Job job;
+    job.function = std::move(function);
+    job.counter = counter;
+    pushJob(job);
+}
+
+void JobSystem::runJobAfter(
+    JobCounter &dependency,
+    std::function<void()> function,
+    JobCounter *counter)
+{
+    {
+        // The counter is checked under the lock finishJob()
+        // takes to release the dependents, so the job is either
+        // added before the release or queued right here
+        std::lock_guard<std::mutex> lock(dependency.m_mutex);
+        if (dependency.m_pending != 0)
+        {
+            if (counter)
+            {
+                ++counter->m_pending;
+            }
+
+            Job job;
+            job.function = std::move(function);
+            job.counter = counter;
+            dependency.m_dependents.push_back(std::move(job));
+            return;
+        }
+    }
+
+    runJob(std::move(function), counter);
+}
+
+void JobSystem::parallelFor(
+    size_t count,
+    size_t grainSize,
+    const std::function<void(size_t first, size_t last)> &body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (grainSize == 0)
+    {
+        grainSize = 1;
+    }
+
+    if (m_workers.empty() || count <= grainSize)
+    {
+        body(0, count);
+        return;
+    }
+
+    // The jobs capture no more than a pointer and an index,
+    // which std::function stores without a heap allocation
+    struct ParallelForTask
+    {
+        const std::function<void(size_t first, size_t last)> *body;
+        size_t grainSize;
+        size_t count;
+    };
+    ParallelForTask task = { &body, grainSize, count };
+    const ParallelForTask *taskPointer = &task;
+
+    // The calling thread takes the first range itself
+    JobCounter counter;
+    for (size_t first = grainSize; first < count; first += grainSize)
+    {
+        runJob([taskPointer, first] {
+            (*taskPointer->body)(first, std::min(first + taskPointer->grainSize, taskPointer->count));
+        }, &counter);
+    }
+
+    body(0, std::min(grainSize, count));
+    waitForCounter(counter);
+}
+
+void JobSystem::waitForCounter(JobCounter &counter)
+{
+    bool mainThread = isMainThread();
+    unsigned int queueIndex = getQueueIndex();
+
+    while (counter.m_pending != 0)
+    {
+        if (mainThread)
+        {
+            runMainThreadTasks();
+        }
+
+        if (!runQueuedJob(queueIndex))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // The last job may still be releasing the dependents,
+    // the counter must not go away before it is finished
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::runOnMainThread(std::function<void()> function, JobCounter *counter)
+{
+    if (counter)
+    {
+        ++counter->m_pending;
+    }
+
+    Job job;
+    job.function = std::move(function);
+    job.counter = counter;
+
+    std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+    m_mainThreadJobs.push_back(std::move(job));
+}
+
+void JobSystem::runMainThreadTasks()
+{
+    std::vector<Job> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+        jobs.swap(m_mainThreadJobs);
+    }
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        jobs[i].function();
+        finishJob(jobs[i].counter);
+    }
+}
+
+void JobSystem::runWorker(unsigned int queueIndex)
+{
+    currentJobSystem = this;
+    currentQueueIndex = queueIndex;
+
+    while (true)
+    {
+        if (runQueuedJob(queueIndex))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_jobQueued.wait(lock, [this] { return m_stopWorkers || m_queuedJobs != 0; });
+
+        if (m_stopWorkers)
+        {
+            return;
+        }
+    }
+}
+
+void JobSystem::pushJob(Job &job)
+{
+    JobQueue &queue = *m_queues[getQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.pushBack(job);
+    }
+
+    // Counted after the push, so a woken worker
+    // always finds the job in one of the queues
+    ++m_queuedJobs;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_jobQueued.notify_one();
+}
+
+void JobSystem::JobQueue::pushBack(Job &job)
+{
+    if (count == jobs.size())
+    {
+        // Unroll the ring into a larger one
+        std::vector<Job> grown(jobs.empty() ? 64 : jobs.size() * 2);
+        for (size_t i = 0; i < count; ++i)
+        {
+            grown[i] = std::move(jobs[(first + i) % jobs.size()]);
+        }
+        jobs.swap(grown);
+        first = 0;
+    }
+
+    jobs[(first + count) % jobs.size()] = std::move(job);
+    ++count;
+}
+
+bool JobSystem::JobQueue::popBack(Job &job)
+{
+    if (!count)
+    {
+        return false;
+    }
+
+    --count;
+    job = std::move(jobs[(first + count) % jobs.size()]);
+    return true;
+}
+
+bool JobSystem::JobQueue::popFront(Job &job)
+{
+    if (!count)
+    {
+        return false;
+    }
+
+    job = std::move(jobs[first]);
+    first = (first + 1) % jobs.size();
+    --count;
+    return true;
+}
+
+bool JobSystem::runQueuedJob(unsigned int queueIndex)
+{
+    if (m_queues.empty())
+    {
+        return false;
+    }
+
+    Job job;
+    bool found = false;
+
+    // Newest job of the own queue first
+    {
+        JobQueue &queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        found = queue.popBack(job);
+    }
+
+    // Then the oldest job of any other queue
+    for (size_t i = 1; !found && i < m_queues.size(); ++i)
+    {
+        JobQueue &queue = *m_queues[(queueIndex + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        found = queue.popFront(job);
+    }
+
+    if (!found)
+    {
+        return false;
+    }
+
+    --m_queuedJobs;
+    job.function();
+    finishJob(job.counter);
+    return true;
+}
+
+void JobSystem::finishJob(JobCounter *counter)
+{
+    if (!counter)
+    {
+        return;
+    }
+
+    std::vector<Job> dependents;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if (--counter->m_pending == 0)
+        {
+            dependents.swap(counter->m_dependents);
+        }
+    }
+
+    // The counter may be gone from here on
+    for (size_t i = 0; i < dependents.size(); ++i)
+    {
+        if (m_workers.empty())
+        {
+            dependents[i].function();
+            finishJob(dependents[i].counter);
+        }
+        else
+        {
+            pushJob(dependents[i]);
+        }
+    }
+}
+
+unsigned int JobSystem::getQueueIndex() const
+{
+    if (currentJobSystem == this)
+    {
+        return currentQueueIndex;
+    }
+
+    return m_queues.size() - 1;
+}
+
+bool JobSystem::isMainThread() const
+{
+    return std::this_thread::get_id() == m_mainThread;
+}
+
+void JobSystem::clearJobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopWorkers = true;
+    }
+    m_jobQueued.notify_all();
+
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i].join();
+    }
+    m_workers.clear();
+
+    // Jobs left behind are dropped without running
+    m_queues.clear();
+    m_queuedJobs = 0;
+
+    std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+    m_mainThreadJobs.clear();
+}
+
+JobSystem::~JobSystem()
+{
+    clearJobSystem();
+}
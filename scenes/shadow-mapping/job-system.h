@@ -0,0 +1,139 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+struct Job
+{
+    std::function<void()> function;
+    JobCounter *counter;
+};
+
+// Number of unfinished jobs of a group. A counter can be
+// waited on and other jobs can be held back until it reaches
+// zero, it must outlive the jobs it counts.
+class JobCounter
+{
+public:
+    JobCounter();
+
+    bool isDone() const;
+
+private:
+    friend class JobSystem;
+
+    std::atomic<unsigned int> m_pending;
+    std::mutex m_mutex;
+    std::vector<Job> m_dependents;
+};
+
+// Runs jobs on a pool of worker threads. Every worker keeps
+// its own queue, taking its newest job first and stealing the
+// oldest job of another queue when its own runs dry, so jobs
+// spawned by jobs stay on the thread that made them. Threads
+// outside the pool share one more queue. Waiting threads run
+// jobs themselves instead of blocking.
+//
+// GL calls are only allowed on the thread that created the
+// job system, jobs hand them over with runOnMainThread().
+class JobSystem
+{
+public:
+    JobSystem();
+
+    // Starts workerCount threads, or one per core
+    // besides the calling thread when workerCount is 0
+    void createJobSystem(unsigned int workerCount = 0);
+    unsigned int getWorkerCount() const;
+
+    void runJob(std::function<void()> function, JobCounter *counter = nullptr);
+
+    // Queues the job once every job counted by dependency is done
+    void runJobAfter(
+        JobCounter &dependency,
+        std::function<void()> function,
+        JobCounter *counter = nullptr);
+
+    // Calls body with consecutive ranges of at most grainSize
+    // indices covering [0, count) and returns once all are done
+    void parallelFor(
+        size_t count,
+        size_t grainSize,
+        const std::function<void(size_t first, size_t last)> &body);
+
+    void waitForCounter(JobCounter &counter);
+
+    // Queues a task for the main thread, run the next time
+    // it calls runMainThreadTasks() or waits for a counter
+    void runOnMainThread(std::function<void()> function, JobCounter *counter = nullptr);
+    void runMainThreadTasks();
+
+    void clearJobSystem();
+
+    ~JobSystem();
+
+private:
+    // Ring of jobs that only ever grows, so queueing jobs
+    // frame after frame does not go back to the heap
+    struct JobQueue
+    {
+        std::mutex mutex;
+        std::vector<Job> jobs;
+        size_t first = 0;
+        size_t count = 0;
+
+        void pushBack(Job &job);
+        bool popBack(Job &job);
+        bool popFront(Job &job);
+    };
+
+    void runWorker(unsigned int queueIndex);
+    void pushJob(Job &job);
+    bool runQueuedJob(unsigned int queueIndex);
+    void finishJob(JobCounter *counter);
+    unsigned int getQueueIndex() const;
+    bool isMainThread() const;
+
+    std::vector<std::unique_ptr<JobQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_queuedJobs;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_jobQueued;
+    bool m_stopWorkers;
+
+    std::thread::id m_mainThread;
+    std::mutex m_mainThreadMutex;
+    std::vector<Job> m_mainThreadJobs;
+};
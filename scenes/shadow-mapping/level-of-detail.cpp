@@ -0,0 +1,108 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "level-of-detail.h"
+
+// Fraction a threshold has to be crossed
+// by before the level actually changes
+static const GLfloat LEVEL_OF_DETAIL_HYSTERESIS = 0.15f;
+
+LevelOfDetailSelector::LevelOfDetailSelector() :
+    m_cameraPosition(0.0f),
+    m_projectionScale(1.0f),
+    m_screenSizeScale(1.0f),
+    m_fullDetailScreenRadius(120.0f)
+{
+}
+
+void LevelOfDetailSelector::setView(
+    const glm::mat4 &projection,
+    const glm::vec3 &cameraPosition,
+    GLfloat viewportHeight)
+{
+    // projection[1][1] is cot(fov / 2), which maps
+    // a view space height to normalised device units
+    m_projectionScale = projection[1][1] * viewportHeight * 0.5f;
+    m_cameraPosition = cameraPosition;
+}
+
+void LevelOfDetailSelector::setScreenSizeScale(GLfloat screenSizeScale)
+{
+    m_screenSizeScale = screenSizeScale;
+}
+
+void LevelOfDetailSelector::setFullDetailScreenRadius(GLfloat screenRadius)
+{
+    m_fullDetailScreenRadius = screenRadius;
+}
+
+GLfloat LevelOfDetailSelector::getScreenRadius(const glm::vec3 &center, GLfloat radius)
+{
+    GLfloat distance = glm::length(center - m_cameraPosition);
+
+    // Inside the bounding sphere the object fills the screen
+    if (distance <= radius)
+    {
+        return m_projectionScale * m_screenSizeScale;
+    }
+
+    return radius / distance * m_projectionScale * m_screenSizeScale;
+}
+
+GLfloat LevelOfDetailSelector::getLevelThreshold(unsigned int level)
+{
+    // Smallest screen radius still drawn with the given level
+    return m_fullDetailScreenRadius / (GLfloat)(1u << level);
+}
+
+unsigned int LevelOfDetailSelector::selectLevel(
+    const glm::vec3 &center,
+    GLfloat radius,
+    unsigned int currentLevel,
+    unsigned int levelCount)
+{
+    if (levelCount <= 1)
+    {
+        return 0;
+    }
+
+    unsigned int level = currentLevel < levelCount ? currentLevel : levelCount - 1;
+    GLfloat screenRadius = getScreenRadius(center, radius);
+
+    while (level > 0 && screenRadius > getLevelThreshold(level - 1) * (1.0f + LEVEL_OF_DETAIL_HYSTERESIS))
+    {
+        --level;
+    }
+
+    while (level + 1 < levelCount && screenRadius < getLevelThreshold(level) * (1.0f - LEVEL_OF_DETAIL_HYSTERESIS))
+    {
+        ++level;
+    }
+
+    return level;
+}
+
+LevelOfDetailSelector::~LevelOfDetailSelector()
+{
+}
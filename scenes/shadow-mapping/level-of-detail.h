@@ -0,0 +1,74 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+// Picks the level of detail of an object from the radius
+// its bounding sphere covers on screen. Each coarser level
+// takes over once the object shrinks to half the size needed
+// by the previous one, and a hysteresis band around every
+// threshold stops objects from flickering between two levels
+// while they hover at the switching distance.
+class LevelOfDetailSelector
+{
+public:
+    LevelOfDetailSelector();
+
+    // Called once per frame before selecting levels
+    void setView(
+        const glm::mat4 &projection,
+        const glm::vec3 &cameraPosition,
+        GLfloat viewportHeight);
+
+    // Scales the projected size before comparing it to the
+    // thresholds, values below 1 favour the coarser levels
+    void setScreenSizeScale(GLfloat screenSizeScale);
+
+    // Screen radius in pixels above which the full detail level is kept
+    void setFullDetailScreenRadius(GLfloat screenRadius);
+
+    GLfloat getScreenRadius(const glm::vec3 &center, GLfloat radius);
+
+    unsigned int selectLevel(
+        const glm::vec3 &center,
+        GLfloat radius,
+        unsigned int currentLevel,
+        unsigned int levelCount);
+
+    ~LevelOfDetailSelector();
+
+private:
+    GLfloat getLevelThreshold(unsigned int level);
+
+    glm::vec3 m_cameraPosition;
+
+    // Pixels covered by one unit at a distance of one unit
+    GLfloat m_projectionScale;
+    GLfloat m_screenSizeScale;
+    GLfloat m_fullDetailScreenRadius;
+};
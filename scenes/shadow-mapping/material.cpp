@@ -40,6 +40,16 @@ void Material::setShininess(GLfloat shininess)
     m_shininess = shininess;
 }
 
+GLfloat Material::getSpecularIntensity()
+{
+    return m_specularIntensity;
+}
+
+GLfloat Material::getShininess()
+{
+    return m_shininess;
+}
+
 void Material::useMaterial(
         GLuint specularIntensityLocation,
         GLuint shininessLocation)
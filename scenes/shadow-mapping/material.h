@@ -33,6 +33,8 @@ public:
 
     void setSpecularIntensity(GLfloat specularIntensity);
     void setShininess(GLfloat shininess);
+    GLfloat getSpecularIntensity();
+    GLfloat getShininess();
 
     void useMaterial(
         GLuint specularIntensityLocation,
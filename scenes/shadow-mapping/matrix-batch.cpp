@@ -0,0 +1,410 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MATRIX_BATCH_X86
+#include <immintrin.h>
+#if defined(__SSE2__)
+#define MATRIX_BATCH_SSE
+#endif
+#endif
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "matrix-batch.h"
+#include "frustum.h"
+
+#if !defined(MATRIX_BATCH_SSE)
+// A stride of 0 for the left matrices multiplies
+// all the right matrices by the same left matrix
+static void MultiplyScalar(
+    const glm::mat4 *left,
+    size_t leftStride,
+    const glm::mat4 *right,
+    glm::mat4 *result,
+    size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        result[i] = left[i * leftStride] * right[i];
+    }
+}
+#endif
+
+#if defined(MATRIX_BATCH_SSE)
+// A stride of 0 for the left matrices multiplies all the right
+// matrices by the same left matrix. Each result column is the sum
+// of the left columns scaled by the elements of the right column
+static void MultiplySSE(
+    const GLfloat *left,
+    size_t leftStride,
+    const GLfloat *right,
+    GLfloat *result,
+    size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const GLfloat *l = left + i * leftStride * 16;
+        __m128 l0 = _mm_loadu_ps(l);
+        __m128 l1 = _mm_loadu_ps(l + 4);
+        __m128 l2 = _mm_loadu_ps(l + 8);
+        __m128 l3 = _mm_loadu_ps(l + 12);
+
+        for (int column = 0; column < 4; ++column)
+        {
+            __m128 r = _mm_loadu_ps(right + i * 16 + column * 4);
+            __m128 sum = _mm_mul_ps(l0, _mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(l1, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1))));
+            sum = _mm_add_ps(sum, _mm_mul_ps(l2, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2))));
+            sum = _mm_add_ps(sum, _mm_mul_ps(l3, _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3))));
+            _mm_storeu_ps(result + i * 16 + column * 4, sum);
+        }
+    }
+}
+#endif
+
+#if defined(MATRIX_BATCH_X86)
+// Two result columns per iteration, one in each 128 bit lane,
+// compiled for AVX2 and FMA regardless of the build flags and
+// only called when the CPU reports support for it
+__attribute__((target("avx2,fma")))
+static void MultiplyAVX2(
+    const GLfloat *left,
+    size_t leftStride,
+    const GLfloat *right,
+    GLfloat *result,
+    size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const GLfloat *l = left + i * leftStride * 16;
+        __m256 l0 = _mm256_broadcast_ps((const __m128 *)l);
+        __m256 l1 = _mm256_broadcast_ps((const __m128 *)(l + 4));
+        __m256 l2 = _mm256_broadcast_ps((const __m128 *)(l + 8));
+        __m256 l3 = _mm256_broadcast_ps((const __m128 *)(l + 12));
+
+        for (int half = 0; half < 2; ++half)
+        {
+            __m256 r = _mm256_loadu_ps(right + i * 16 + half * 8);
+            __m256 sum = _mm256_mul_ps(l0, _mm256_permute_ps(r, 0x00));
+            sum = _mm256_fmadd_ps(l1, _mm256_permute_ps(r, 0x55), sum);
+            sum = _mm256_fmadd_ps(l2, _mm256_permute_ps(r, 0xAA), sum);
+            sum = _mm256_fmadd_ps(l3, _mm256_permute_ps(r, 0xFF), sum);
+            _mm256_storeu_ps(result + i * 16 + half * 8, sum);
+        }
+    }
+}
+
+static bool UseAVX2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+#endif
+
+static void Multiply(
+    const glm::mat4 *left,
+    size_t leftStride,
+    const glm::mat4 *right,
+    glm::mat4 *result,
+    size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+#if defined(MATRIX_BATCH_X86)
+    if (UseAVX2())
+    {
+        MultiplyAVX2(glm::value_ptr(left[0]), leftStride, glm::value_ptr(right[0]), glm::value_ptr(result[0]), count);
+        return;
+    }
+#endif
+
+#if defined(MATRIX_BATCH_SSE)
+    MultiplySSE(glm::value_ptr(left[0]), leftStride, glm::value_ptr(right[0]), glm::value_ptr(result[0]), count);
+#else
+    MultiplyScalar(left, leftStride, right, result, count);
+#endif
+}
+
+void MultiplyMatrices(
+    const glm::mat4 &left,
+    const glm::mat4 *right,
+    glm::mat4 *result,
+    size_t count)
+{
+    Multiply(&left, 0, right, result, count);
+}
+
+void MultiplyMatrixArrays(
+    const glm::mat4 *left,
+    const glm::mat4 *right,
+    glm::mat4 *result,
+    size_t count)
+{
+    Multiply(left, 1, right, result, count);
+}
+
+// The transformed box is centered on the transformed center,
+// its half size on each axis adds up the absolute contributions
+// of the model space half sizes (Arvo)
+static void TransformBoxesScalar(
+    const glm::mat4 *matrices,
+    const glm::vec3 *boundsMin,
+    const glm::vec3 *boundsMax,
+    glm::vec3 *transformedMin,
+    glm::vec3 *transformedMax,
+    size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const glm::mat4 &m = matrices[i];
+        glm::vec3 center = (boundsMin[i] + boundsMax[i]) * 0.5f;
+        glm::vec3 extent = (boundsMax[i] - boundsMin[i]) * 0.5f;
+
+        glm::vec3 worldCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+        glm::vec3 worldExtent(
+            std::fabs(m[0][0]) * extent.x + std::fabs(m[1][0]) * extent.y + std::fabs(m[2][0]) * extent.z,
+            std::fabs(m[0][1]) * extent.x + std::fabs(m[1][1]) * extent.y + std::fabs(m[2][1]) * extent.z,
+            std::fabs(m[0][2]) * extent.x + std::fabs(m[1][2]) * extent.y + std::fabs(m[2][2]) * extent.z);
+
+        transformedMin[i] = worldCenter - worldExtent;
+        transformedMax[i] = worldCenter + worldExtent;
+    }
+}
+
+void TransformBoxes(
+    const glm::mat4 *matrices,
+    const glm::vec3 *boundsMin,
+    const glm::vec3 *boundsMax,
+    glm::vec3 *transformedMin,
+    glm::vec3 *transformedMax,
+    size_t count)
+{
+    // Same as TransformBoxesScalar with the
+    // columns of each matrix in a register
+#if defined(MATRIX_BATCH_SSE)
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const GLfloat *m = glm::value_ptr(matrices[i]);
+        __m128 m0 = _mm_loadu_ps(m);
+        __m128 m1 = _mm_loadu_ps(m + 4);
+        __m128 m2 = _mm_loadu_ps(m + 8);
+        __m128 m3 = _mm_loadu_ps(m + 12);
+
+        __m128 low = _mm_set_ps(0.0f, boundsMin[i].z, boundsMin[i].y, boundsMin[i].x);
+        __m128 high = _mm_set_ps(0.0f, boundsMax[i].z, boundsMax[i].y, boundsMax[i].x);
+        __m128 center = _mm_mul_ps(_mm_add_ps(low, high), half);
+        __m128 extent = _mm_mul_ps(_mm_sub_ps(high, low), half);
+
+        __m128 worldCenter = _mm_add_ps(m3, _mm_mul_ps(m0, _mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0))));
+        worldCenter = _mm_add_ps(worldCenter, _mm_mul_ps(m1, _mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1))));
+        worldCenter = _mm_add_ps(worldCenter, _mm_mul_ps(m2, _mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2))));
+
+        __m128 worldExtent = _mm_mul_ps(_mm_andnot_ps(signMask, m0), _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(0, 0, 0, 0)));
+        worldExtent = _mm_add_ps(worldExtent, _mm_mul_ps(_mm_andnot_ps(signMask, m1), _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(1, 1, 1, 1))));
+        worldExtent = _mm_add_ps(worldExtent, _mm_mul_ps(_mm_andnot_ps(signMask, m2), _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(2, 2, 2, 2))));
+
+        GLfloat minimum[4], maximum[4];
+        _mm_storeu_ps(minimum, _mm_sub_ps(worldCenter, worldExtent));
+        _mm_storeu_ps(maximum, _mm_add_ps(worldCenter, worldExtent));
+        transformedMin[i] = glm::vec3(minimum[0], minimum[1], minimum[2]);
+        transformedMax[i] = glm::vec3(maximum[0], maximum[1], maximum[2]);
+    }
+#else
+    TransformBoxesScalar(matrices, boundsMin, boundsMax, transformedMin, transformedMax, count);
+#endif
+}
+
+void ExtractFrustumPlanesBatch(
+    const glm::mat4 *matrices,
+    glm::vec4 *planes,
+    size_t count)
+{
+#if defined(MATRIX_BATCH_SSE)
+    for (size_t i = 0; i < count; ++i)
+    {
+        // The planes are sums and differences of the
+        // rows, so transpose the columns into rows first
+        const GLfloat *m = glm::value_ptr(matrices[i]);
+        __m128 row0 = _mm_loadu_ps(m);
+        __m128 row1 = _mm_loadu_ps(m + 4);
+        __m128 row2 = _mm_loadu_ps(m + 8);
+        __m128 row3 = _mm_loadu_ps(m + 12);
+        _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+        __m128 coefficients[6] = {
+            _mm_add_ps(row3, row0), _mm_sub_ps(row3, row0),
+            _mm_add_ps(row3, row1), _mm_sub_ps(row3, row1),
+            _mm_add_ps(row3, row2), _mm_sub_ps(row3, row2)
+        };
+
+        for (int plane = 0; plane < 6; ++plane)
+        {
+            __m128 squared = _mm_mul_ps(coefficients[plane], coefficients[plane]);
+            __m128 length = _mm_add_ss(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 1, 1, 1)));
+            length = _mm_add_ss(length, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 2, 2, 2)));
+            length = _mm_sqrt_ss(length);
+            length = _mm_shuffle_ps(length, length, _MM_SHUFFLE(0, 0, 0, 0));
+
+            GLfloat plane4[4];
+            _mm_storeu_ps(plane4, _mm_div_ps(coefficients[plane], length));
+            planes[i * 6 + plane] = glm::vec4(plane4[0], plane4[1], plane4[2], plane4[3]);
+        }
+    }
+#else
+    for (size_t i = 0; i < count; ++i)
+    {
+        ExtractFrustumPlanes(matrices[i], &planes[i * 6]);
+    }
+#endif
+}
+
+// Keeps the compiler from dropping the benchmarked
+// loops whose results are otherwise never read
+static volatile GLfloat benchmarkSink;
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BenchmarkMatrixBatch(size_t count, unsigned int iterations)
+{
+    if (count == 0 || iterations == 0)
+    {
+        return;
+    }
+
+    std::vector<glm::mat4> models(count);
+    std::vector<glm::mat4> results(count);
+    std::vector<glm::vec3> boundsMin(count, glm::vec3(-1.0f, -2.0f, -0.5f));
+    std::vector<glm::vec3> boundsMax(count, glm::vec3(1.5f, 2.0f, 0.5f));
+    std::vector<glm::vec3> worldMin(count);
+    std::vector<glm::vec3> worldMax(count);
+    std::vector<glm::vec4> planes(count * 6);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        GLfloat angle = i * 0.01f;
+        glm::mat4 model(1.0f);
+        model[0][0] = std::cos(angle);
+        model[0][2] = -std::sin(angle);
+        model[2][0] = std::sin(angle);
+        model[2][2] = std::cos(angle);
+        model[3] = glm::vec4(i * 0.5f, 1.0f, -(GLfloat)i, 1.0f);
+        models[i] = model;
+    }
+
+    glm::mat4 projectionView(1.0f);
+    projectionView[2][3] = -1.0f;
+    projectionView[3][2] = -0.2f;
+    projectionView[3][3] = 0.0f;
+
+    // Matrix products
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            results[i] = projectionView * models[i];
+        }
+        benchmarkSink = results[iteration % count][3][3];
+    }
+    double glmMultiply = MillisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+    {
+        MultiplyMatrices(projectionView, &models[0], &results[0], count);
+        benchmarkSink = results[iteration % count][3][3];
+    }
+    double batchMultiply = MillisecondsSince(start);
+
+    // Boxes, both paths use the same method so the
+    // difference is down to the batched kernels alone
+    start = std::chrono::steady_clock::now();
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+    {
+        TransformBoxesScalar(&models[0], &boundsMin[0], &boundsMax[0], &worldMin[0], &worldMax[0], count);
+        benchmarkSink = worldMax[iteration % count].x;
+    }
+    double scalarBoxes = MillisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+    {
+        TransformBoxes(&models[0], &boundsMin[0], &boundsMax[0], &worldMin[0], &worldMax[0], count);
+        benchmarkSink = worldMax[iteration % count].x;
+    }
+    double batchBoxes = MillisecondsSince(start);
+
+    // Frustum planes of the model view projection matrices
+    MultiplyMatrices(projectionView, &models[0], &results[0], count);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            ExtractFrustumPlanes(results[i], &planes[i * 6]);
+        }
+        benchmarkSink = planes[iteration % count].w;
+    }
+    double glmPlanes = MillisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+    {
+        ExtractFrustumPlanesBatch(&results[0], &planes[0], count);
+        benchmarkSink = planes[iteration % count].w;
+    }
+    double batchPlanes = MillisecondsSince(start);
+
+    const char *kernels = "glm";
+#if defined(MATRIX_BATCH_SSE)
+    kernels = "SSE";
+#endif
+#if defined(MATRIX_BATCH_X86)
+    if (UseAVX2())
+    {
+        kernels = "AVX2";
+    }
+#endif
+
+    printf("Matrix batch benchmark, %zu objects x %u iterations, %s kernels\n", count, iterations, kernels);
+    printf("  Matrix products: glm %.3f ms, batch %.3f ms\n", glmMultiply, batchMultiply);
+    printf("  Box transforms:  scalar %.3f ms, batch %.3f ms\n", scalarBoxes, batchBoxes);
+    printf("  Frustum planes:  glm %.3f ms, batch %.3f ms\n", glmPlanes, batchPlanes);
+}
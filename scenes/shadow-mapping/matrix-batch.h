@@ -0,0 +1,72 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+// Matrix math over arrays of objects, run with SSE or with AVX2
+// and FMA when the CPU supports them and with glm otherwise.
+// The arrays may not overlap unless stated otherwise.
+
+// result[i] = left * right[i], e.g. projection * view * model
+// for every model matrix of a set of objects
+void MultiplyMatrices(
+    const glm::mat4 &left,
+    const glm::mat4 *right,
+    glm::mat4 *result,
+    size_t count);
+
+// result[i] = left[i] * right[i], e.g. parent world
+// matrices times the local matrices of their children
+void MultiplyMatrixArrays(
+    const glm::mat4 *left,
+    const glm::mat4 *right,
+    glm::mat4 *result,
+    size_t count);
+
+// Transforms each model space box by its affine matrix and writes
+// the world space box around it. The output may be the input.
+void TransformBoxes(
+    const glm::mat4 *matrices,
+    const glm::vec3 *boundsMin,
+    const glm::vec3 *boundsMax,
+    glm::vec3 *transformedMin,
+    glm::vec3 *transformedMax,
+    size_t count);
+
+// Six normalised planes per matrix, in the order and
+// convention of ExtractFrustumPlanes() in frustum.h
+void ExtractFrustumPlanesBatch(
+    const glm::mat4 *matrices,
+    glm::vec4 *planes,
+    size_t count);
+
+// Times the functions above against the equivalent glm code
+// over count matrices and prints the results
+void BenchmarkMatrixBatch(size_t count, unsigned int iterations);
@@ -0,0 +1,224 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cmath>
+#include <deque>
+
+#include "mesh-cluster.h"
+
+static glm::vec3 GetVertexPosition(
+    const GLfloat *vertices,
+    unsigned int vertexStride,
+    unsigned int vertex)
+{
+    const GLfloat *position = vertices + vertex * vertexStride;
+    return glm::vec3(position[0], position[1], position[2]);
+}
+
+static void ComputeClusterBounds(
+    const GLfloat *vertices,
+    unsigned int vertexStride,
+    const unsigned int *indices,
+    MeshCluster &cluster)
+{
+    // Sphere around the bounding box of the cluster
+    glm::vec3 boundsMin = GetVertexPosition(vertices, vertexStride, indices[0]);
+    glm::vec3 boundsMax = boundsMin;
+    for (GLsizei i = 1; i < cluster.indexCount; ++i)
+    {
+        glm::vec3 position = GetVertexPosition(vertices, vertexStride, indices[i]);
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+
+    cluster.center = (boundsMin + boundsMax) * 0.5f;
+    cluster.radius = 0.0f;
+    for (GLsizei i = 0; i < cluster.indexCount; ++i)
+    {
+        glm::vec3 position = GetVertexPosition(vertices, vertexStride, indices[i]);
+        cluster.radius = glm::max(cluster.radius, glm::length(position - cluster.center));
+    }
+
+    // The face normals follow the winding of the triangles,
+    // which is what decides whether they are back facing
+    std::vector<glm::vec3> normals;
+    glm::vec3 normalSum(0.0f);
+    for (GLsizei i = 0; i + 2 < cluster.indexCount; i += 3)
+    {
+        glm::vec3 p0 = GetVertexPosition(vertices, vertexStride, indices[i]);
+        glm::vec3 p1 = GetVertexPosition(vertices, vertexStride, indices[i + 1]);
+        glm::vec3 p2 = GetVertexPosition(vertices, vertexStride, indices[i + 2]);
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        GLfloat length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normals.push_back(normal / length);
+            normalSum += normal / length;
+        }
+    }
+
+    // Never culled unless the cone is narrower than a hemisphere
+    cluster.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    cluster.coneCutoff = 2.0f;
+
+    GLfloat normalSumLength = glm::length(normalSum);
+    if (normals.empty() || normalSumLength <= 0.0f)
+    {
+        return;
+    }
+
+    glm::vec3 axis = normalSum / normalSumLength;
+    GLfloat minimumDot = 1.0f;
+    for (size_t i = 0; i < normals.size(); ++i)
+    {
+        minimumDot = glm::min(minimumDot, glm::dot(axis, normals[i]));
+    }
+
+    if (minimumDot <= 0.0f)
+    {
+        return;
+    }
+
+    // sin of the cone half angle, every normal is within
+    // acos(minimumDot) of the axis
+    cluster.coneAxis = axis;
+    cluster.coneCutoff = sqrtf(1.0f - minimumDot * minimumDot);
+}
+
+void BuildMeshClusters(
+    const GLfloat *vertices,
+    unsigned int vertexCount,
+    unsigned int vertexStride,
+    const std::vector<unsigned int> &indices,
+    std::vector<unsigned int> &clusteredIndices,
+    std::vector<MeshCluster> &clusters)
+{
+    clusteredIndices.clear();
+    clusters.clear();
+
+    unsigned int triangleCount = indices.size() / 3;
+
+    // Triangles around each vertex, stored back to back
+    std::vector<unsigned int> triangleOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        triangleOffsets[indices[i] + 1]++;
+    }
+    for (unsigned int vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        triangleOffsets[vertex + 1] += triangleOffsets[vertex];
+    }
+
+    std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+    std::vector<unsigned int> fillPosition(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        vertexTriangles[fillPosition[indices[i]]++] = i / 3;
+    }
+
+    std::vector<bool> triangleUsed(triangleCount, false);
+
+    // Last cluster each vertex was added to, for counting
+    // the unique vertices of the cluster being grown
+    std::vector<unsigned int> vertexCluster(vertexCount, ~0u);
+
+    std::deque<unsigned int> frontier;
+    unsigned int seedTriangle = 0;
+
+    while (true)
+    {
+        // Seed the next cluster with the first unused triangle,
+        // keeping the original order which tends to be local
+        while (seedTriangle < triangleCount && triangleUsed[seedTriangle])
+        {
+            ++seedTriangle;
+        }
+        if (seedTriangle == triangleCount)
+        {
+            break;
+        }
+
+        MeshCluster cluster;
+        cluster.firstIndex = clusteredIndices.size();
+        cluster.indexCount = 0;
+
+        unsigned int clusterID = clusters.size();
+        unsigned int clusterVertexCount = 0;
+        unsigned int clusterTriangleCount = 0;
+
+        frontier.clear();
+        frontier.push_back(seedTriangle);
+
+        // Grow the cluster across shared vertices, breadth
+        // first so that it stays roughly round and compact
+        while (!frontier.empty() && clusterTriangleCount < MAX_CLUSTER_TRIANGLES)
+        {
+            unsigned int triangle = frontier.front();
+            frontier.pop_front();
+
+            if (triangleUsed[triangle])
+            {
+                continue;
+            }
+
+            unsigned int newVertexCount = 0;
+            for (unsigned int corner = 0; corner < 3; ++corner)
+            {
+                if (vertexCluster[indices[triangle * 3 + corner]] != clusterID)
+                {
+                    ++newVertexCount;
+                }
+            }
+
+            if (clusterVertexCount + newVertexCount > MAX_CLUSTER_VERTICES)
+            {
+                continue;
+            }
+
+            triangleUsed[triangle] = true;
+            ++clusterTriangleCount;
+            clusterVertexCount += newVertexCount;
+
+            for (unsigned int corner = 0; corner < 3; ++corner)
+            {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                vertexCluster[vertex] = clusterID;
+                clusteredIndices.push_back(vertex);
+
+                for (unsigned int i = triangleOffsets[vertex]; i < triangleOffsets[vertex + 1]; ++i)
+                {
+                    if (!triangleUsed[vertexTriangles[i]])
+                    {
+                        frontier.push_back(vertexTriangles[i]);
+                    }
+                }
+            }
+        }
+
+        cluster.indexCount = clusterTriangleCount * 3;
+        ComputeClusterBounds(vertices, vertexStride, &clusteredIndices[cluster.firstIndex], cluster);
+        clusters.push_back(cluster);
+    }
+}
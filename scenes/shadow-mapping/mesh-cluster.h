@@ -0,0 +1,69 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+// Upper limits of a cluster, small enough for the bounds to stay
+// tight and large enough for the per-cluster cost to stay low
+const unsigned int MAX_CLUSTER_TRIANGLES = 124;
+const unsigned int MAX_CLUSTER_VERTICES = 64;
+
+// A small patch of neighbouring triangles stored as a contiguous
+// range of a mesh's index buffer, with the bounds needed to reject
+// the whole patch when it is out of view or facing away
+struct MeshCluster
+{
+    // Bounding sphere in model space
+    glm::vec3 center;
+    GLfloat radius;
+
+    // Cone containing the triangle normals, the cluster
+    // faces away from every viewer for which
+    // dot(center - viewer, axis) >= cutoff * |center - viewer| + radius.
+    // The cutoff is above 1 when the normals spread too wide to cull.
+    glm::vec3 coneAxis;
+    GLfloat coneCutoff;
+
+    GLuint firstIndex;
+    GLsizei indexCount;
+};
+
+// Splits the triangles of indices into clusters of neighbouring
+// triangles. The triangles are written to clusteredIndices
+// reordered so that every cluster is a contiguous range of it.
+// The position is expected in the first three floats of every
+// vertex, vertexStride in floats.
+void BuildMeshClusters(
+    const GLfloat *vertices,
+    unsigned int vertexCount,
+    unsigned int vertexStride,
+    const std::vector<unsigned int> &indices,
+    std::vector<unsigned int> &clusteredIndices,
+    std::vector<MeshCluster> &clusters);
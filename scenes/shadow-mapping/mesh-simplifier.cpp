@@ -0,0 +1,402 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+#include "mesh-simplifier.h"
+
+// A level has to drop at least this share of the
+// triangles of the previous one to be worth keeping
+static const float MIN_LEVEL_REDUCTION = 0.15f;
+
+static void Cross(const double *a, const double *b, double *result)
+{
+    result[0] = a[1] * b[2] - a[2] * b[1];
+    result[1] = a[2] * b[0] - a[0] * b[2];
+    result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void TriangleNormal(
+    const GLfloat *p0,
+    const GLfloat *p1,
+    const GLfloat *p2,
+    double *normal)
+{
+    double edge0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    double edge1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    Cross(edge0, edge1, normal);
+}
+
+void MeshSimplifier::Quadric::add(const Quadric &quadric)
+{
+    a2 += quadric.a2; ab += quadric.ab; ac += quadric.ac; ad += quadric.ad;
+    b2 += quadric.b2; bc += quadric.bc; bd += quadric.bd;
+    c2 += quadric.c2; cd += quadric.cd;
+    d2 += quadric.d2;
+}
+
+double MeshSimplifier::Quadric::evaluate(const GLfloat *position) const
+{
+    double x = position[0], y = position[1], z = position[2];
+
+    // p^T A p + 2 b.p + c for the plane equations summed into the quadric
+    return a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+         + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+         + c2 * z * z + 2.0 * cd * z
+         + d2;
+}
+
+MeshSimplifier::MeshSimplifier(
+    const GLfloat *vertices,
+    unsigned int vertexCount,
+    unsigned int vertexStride) :
+    m_vertices(vertices),
+    m_vertexCount(vertexCount),
+    m_vertexStride(vertexStride)
+{
+}
+
+const GLfloat* MeshSimplifier::getPosition(unsigned int vertex) const
+{
+    return m_vertices + vertex * m_vertexStride;
+}
+
+void MeshSimplifier::lockSeamVertices()
+{
+    // Vertices split along a UV or normal seam share the exact
+    // same position, moving one of them would tear the seam open
+    struct PositionKey
+    {
+        GLfloat x, y, z;
+        bool operator<(const PositionKey &other) const
+        {
+            if (x != other.x) return x < other.x;
+            if (y != other.y) return y < other.y;
+            return z < other.z;
+        }
+    };
+
+    std::map<PositionKey, unsigned int> firstVertexAtPosition;
+    for (unsigned int vertex = 0; vertex < m_vertexCount; ++vertex)
+    {
+        const GLfloat *position = getPosition(vertex);
+        PositionKey key = { position[0], position[1], position[2] };
+
+        std::map<PositionKey, unsigned int>::iterator it = firstVertexAtPosition.find(key);
+        if (it == firstVertexAtPosition.end())
+        {
+            firstVertexAtPosition[key] = vertex;
+        }
+        else
+        {
+            m_lockedVertices[vertex] = true;
+            m_lockedVertices[it->second] = true;
+        }
+    }
+}
+
+void MeshSimplifier::lockBorderVertices(const std::vector<unsigned int> &indices)
+{
+    // An edge used by a single triangle lies on an open border
+    std::unordered_map<unsigned long long, unsigned int> edgeUseCount;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (unsigned int corner = 0; corner < 3; ++corner)
+        {
+            unsigned long long a = indices[i + corner];
+            unsigned long long b = indices[i + (corner + 1) % 3];
+            unsigned long long edge = a < b ? (a << 32) | b : (b << 32) | a;
+            edgeUseCount[edge]++;
+        }
+    }
+
+    for (std::unordered_map<unsigned long long, unsigned int>::const_iterator it = edgeUseCount.begin(); it != edgeUseCount.end(); ++it)
+    {
+        if (it->second == 1)
+        {
+            m_lockedVertices[it->first >> 32] = true;
+            m_lockedVertices[it->first & 0xFFFFFFFFULL] = true;
+        }
+    }
+}
+
+void MeshSimplifier::computeQuadrics(const std::vector<unsigned int> &indices)
+{
+    Quadric zero;
+    memset(&zero, 0, sizeof(zero));
+    m_quadrics.assign(m_vertexCount, zero);
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const GLfloat *p0 = getPosition(indices[i]);
+
+        double normal[3];
+        TriangleNormal(p0, getPosition(indices[i + 1]), getPosition(indices[i + 2]), normal);
+
+        double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length <= 0.0)
+        {
+            continue;
+        }
+
+        // Plane ax + by + cz + d = 0 weighted by the triangle area,
+        // so that large triangles resist being distorted the most
+        double area = length * 0.5;
+        double a = normal[0] / length;
+        double b = normal[1] / length;
+        double c = normal[2] / length;
+        double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+
+        Quadric quadric;
+        quadric.a2 = a * a * area; quadric.ab = a * b * area; quadric.ac = a * c * area; quadric.ad = a * d * area;
+        quadric.b2 = b * b * area; quadric.bc = b * c * area; quadric.bd = b * d * area;
+        quadric.c2 = c * c * area; quadric.cd = c * d * area;
+        quadric.d2 = d * d * area;
+
+        for (unsigned int corner = 0; corner < 3; ++corner)
+        {
+            m_quadrics[indices[i + corner]].add(quadric);
+        }
+    }
+}
+
+bool MeshSimplifier::collapseFlipsTriangles(
+    const std::vector<unsigned int> &indices,
+    const std::vector<unsigned int> &triangles,
+    unsigned int from,
+    unsigned int to) const
+{
+    const GLfloat *target = getPosition(to);
+
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        const unsigned int *triangle = &indices[triangles[i] * 3];
+
+        // Triangles along the collapsed edge disappear
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            continue;
+        }
+
+        const GLfloat *before[3];
+        const GLfloat *after[3];
+        for (unsigned int corner = 0; corner < 3; ++corner)
+        {
+            before[corner] = getPosition(triangle[corner]);
+            after[corner] = triangle[corner] == from ? target : before[corner];
+        }
+
+        double normalBefore[3], normalAfter[3];
+        TriangleNormal(before[0], before[1], before[2], normalBefore);
+        TriangleNormal(after[0], after[1], after[2], normalAfter);
+
+        double dot = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2];
+        if (dot <= 0.0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void MeshSimplifier::simplify(
+    const std::vector<unsigned int> &indices,
+    unsigned int targetIndexCount,
+    std::vector<unsigned int> &result)
+{
+    result = indices;
+
+    m_lockedVertices.assign(m_vertexCount, false);
+    lockSeamVertices();
+    lockBorderVertices(indices);
+    computeQuadrics(indices);
+
+    std::vector<unsigned int> remap(m_vertexCount);
+    std::vector<bool> touched(m_vertexCount);
+    std::vector<unsigned int> triangleOffsets(m_vertexCount + 1);
+    std::vector<unsigned int> vertexTriangles;
+    std::vector<Collapse> collapses;
+
+    // Every pass collapses a batch of the cheapest independent
+    // edges and then rebuilds the triangle list, until the target
+    // is met or no edge can be collapsed any more
+    while (result.size() > targetIndexCount)
+    {
+        size_t triangleCount = result.size() / 3;
+
+        // Triangles around each vertex, stored back to back
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            triangleOffsets[result[i] + 1]++;
+        }
+        for (unsigned int vertex = 0; vertex < m_vertexCount; ++vertex)
+        {
+            triangleOffsets[vertex + 1] += triangleOffsets[vertex];
+        }
+
+        vertexTriangles.resize(result.size());
+        std::vector<unsigned int> fillPosition(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            vertexTriangles[fillPosition[result[i]]++] = i / 3;
+        }
+
+        // Cost of moving either end of every edge onto the other
+        collapses.clear();
+        for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+        {
+            for (unsigned int corner = 0; corner < 3; ++corner)
+            {
+                unsigned int a = result[triangle * 3 + corner];
+                unsigned int b = result[triangle * 3 + (corner + 1) % 3];
+
+                Quadric quadric = m_quadrics[a];
+                quadric.add(m_quadrics[b]);
+
+                if (!m_lockedVertices[a])
+                {
+                    Collapse collapse = { quadric.evaluate(getPosition(b)), a, b };
+                    collapses.push_back(collapse);
+                }
+                if (!m_lockedVertices[b])
+                {
+                    Collapse collapse = { quadric.evaluate(getPosition(a)), b, a };
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            return a.cost < b.cost;
+        });
+
+        for (unsigned int vertex = 0; vertex < m_vertexCount; ++vertex)
+        {
+            remap[vertex] = vertex;
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        // Each collapse along an interior edge removes two triangles
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t trianglesRemoved = 0;
+
+        for (size_t i = 0; i < collapses.size() && trianglesRemoved < trianglesToRemove; ++i)
+        {
+            const Collapse &collapse = collapses[i];
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            std::vector<unsigned int> triangles(
+                vertexTriangles.begin() + triangleOffsets[collapse.from],
+                vertexTriangles.begin() + triangleOffsets[collapse.from + 1]);
+
+            if (collapseFlipsTriangles(result, triangles, collapse.from, collapse.to))
+            {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            m_quadrics[collapse.to].add(m_quadrics[collapse.from]);
+
+            // The triangles around the moved vertex are stale
+            // until the next pass, so leave their corners alone
+            for (size_t j = 0; j < triangles.size(); ++j)
+            {
+                for (unsigned int corner = 0; corner < 3; ++corner)
+                {
+                    unsigned int vertex = result[triangles[j] * 3 + corner];
+                    touched[vertex] = true;
+                    if (vertex == collapse.to)
+                    {
+                        trianglesRemoved++;
+                    }
+                }
+            }
+        }
+
+        if (!trianglesRemoved)
+        {
+            break;
+        }
+
+        // Apply the collapses and drop the triangles
+        // that became degenerate along the way
+        size_t writePosition = 0;
+        for (size_t i = 0; i + 2 < result.size(); i += 3)
+        {
+            unsigned int a = remap[result[i]];
+            unsigned int b = remap[result[i + 1]];
+            unsigned int c = remap[result[i + 2]];
+
+            if (a == b || b == c || a == c)
+            {
+                continue;
+            }
+
+            result[writePosition++] = a;
+            result[writePosition++] = b;
+            result[writePosition++] = c;
+        }
+        result.resize(writePosition);
+    }
+}
+
+void MeshSimplifier::generateLevelsOfDetail(
+    const std::vector<unsigned int> &indices,
+    unsigned int levelCount,
+    std::vector<std::vector<unsigned int> > &levels)
+{
+    levels.clear();
+    levels.push_back(indices);
+
+    for (unsigned int level = 1; level < levelCount; ++level)
+    {
+        const std::vector<unsigned int> &previous = levels.back();
+
+        // Halve the triangle count of the previous level
+        unsigned int targetIndexCount = (previous.size() / 6) * 3;
+        if (targetIndexCount < 3)
+        {
+            break;
+        }
+
+        std::vector<unsigned int> simplified;
+        simplify(previous, targetIndexCount, simplified);
+
+        if (simplified.size() > previous.size() * (1.0f - MIN_LEVEL_REDUCTION))
+        {
+            break;
+        }
+
+        levels.push_back(simplified);
+    }
+}
@@ -0,0 +1,97 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+// Builds simplified index lists for a mesh with quadric error
+// metric edge collapses. Collapses only ever move a vertex onto
+// one of its neighbours, so every level of detail indexes into
+// the original vertex buffer and no new vertices are created.
+// Vertices sharing their position with another vertex (UV and
+// normal seams) and vertices on open borders are never moved,
+// which keeps the seams and the silhouette of holes intact.
+class MeshSimplifier
+{
+public:
+    // The position is expected in the first three
+    // floats of every vertex, vertexStride in floats
+    MeshSimplifier(
+        const GLfloat *vertices,
+        unsigned int vertexCount,
+        unsigned int vertexStride);
+
+    // Reduces the triangles of indices down to about targetIndexCount
+    // indices, or as far as possible without flipping triangles
+    void simplify(
+        const std::vector<unsigned int> &indices,
+        unsigned int targetIndexCount,
+        std::vector<unsigned int> &result);
+
+    // Fills levels with up to levelCount index lists, starting with the
+    // original indices and halving the triangle count at every level.
+    // The chain stops early once a level no longer shrinks noticeably.
+    void generateLevelsOfDetail(
+        const std::vector<unsigned int> &indices,
+        unsigned int levelCount,
+        std::vector<std::vector<unsigned int> > &levels);
+
+private:
+    // Symmetric 4x4 matrix measuring the squared distance
+    // of a point to the planes of the triangles around a vertex
+    struct Quadric
+    {
+        double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+        void add(const Quadric &quadric);
+        double evaluate(const GLfloat *position) const;
+    };
+
+    struct Collapse
+    {
+        double cost;
+        unsigned int from;
+        unsigned int to;
+    };
+
+    const GLfloat* getPosition(unsigned int vertex) const;
+    void lockSeamVertices();
+    void lockBorderVertices(const std::vector<unsigned int> &indices);
+    void computeQuadrics(const std::vector<unsigned int> &indices);
+    bool collapseFlipsTriangles(
+        const std::vector<unsigned int> &indices,
+        const std::vector<unsigned int> &triangles,
+        unsigned int from,
+        unsigned int to) const;
+
+    const GLfloat *m_vertices;
+    unsigned int m_vertexCount;
+    unsigned int m_vertexStride;
+
+    std::vector<bool> m_lockedVertices;
+    std::vector<Quadric> m_quadrics;
+};
@@ -22,56 +22,174 @@
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#include <algorithm>
+
+#include "constants.h"
+#include "gpu-resource-registry.h"
 #include "mesh.h"
+#include "mesh-simplifier.h"
 
 Mesh::Mesh() :
-    m_vaoID(0),
     m_vboID(0),
     m_iboID(0),
-    m_indexCount(0)
+    m_geometryPool(nullptr),
+    m_geometry(GeometryPool::INVALID_GEOMETRY),
+    m_vertexCount(0),
+    m_indexCount(0),
+    m_resourceLabel("Mesh")
+{
+}
+
+void Mesh::setGeometryPool(GeometryPool *geometryPool)
+{
+    m_geometryPool = geometryPool;
+}
+
+void Mesh::setResourceLabel(const std::string &label)
 {
+    m_resourceLabel = label;
 }
 
 void Mesh::createMesh(GLfloat *vertices, 
         unsigned int* indices,
         unsigned int numberOfVertices,
         unsigned int numberOfIndices)
+{
+    createMeshBuffers(vertices, indices, numberOfVertices, numberOfIndices);
+    createVertexArray();
+}
+
+void Mesh::createMeshBuffers(const GLfloat *vertices,
+        const unsigned int *indices,
+        unsigned int numberOfVertices,
+        unsigned int numberOfIndices)
 {
     // Index count is needed later while 
     // drawing the mesh
     m_indexCount = numberOfIndices;
 
+    LevelOfDetail fullDetail = { 0, (GLsizei)numberOfIndices };
+    m_levelsOfDetail.assign(1, fullDetail);
+
+    // Each vertex is made up of 8 floats
+    // (position, texture coordinates, normal)
+    m_vertexCount = numberOfVertices / 8;
+
+    if (m_geometryPool)
+    {
+        m_geometry = m_geometryPool->allocateGeometry(vertices, m_vertexCount, indices, numberOfIndices);
+        return;
+    }
+
+    // Specify a VBO to pass in the index data which will be
+    // used for index drawing. It is filled through the copy
+    // target to leave the element binding of any VAO alone.
+    glGenBuffers(1, &m_iboID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_iboID);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(indices[0]) * numberOfIndices, indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    GetGpuResourceRegistry().addResource(GPU_RESOURCE_BUFFER, m_iboID, sizeof(indices[0]) * numberOfIndices, m_resourceLabel);
+
+    // Loading up the vertex data into a VBO
+    glGenBuffers(1, &m_vboID);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * numberOfVertices, vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GetGpuResourceRegistry().addResource(GPU_RESOURCE_BUFFER, m_vboID, sizeof(vertices[0]) * numberOfVertices, m_resourceLabel);
+}
+
+void Mesh::uploadVertices(const GLfloat *vertices,
+        GLuint firstVertex,
+        GLuint vertexCount)
+{
+    const GLsizeiptr vertexSize = sizeof(GLfloat) * 8;
+
+    glBindBuffer(GL_ARRAY_BUFFER, getVertexBufferID());
+    glBufferSubData(GL_ARRAY_BUFFER, vertexSize * (getBaseVertex() + firstVertex), vertexSize * vertexCount, vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::uploadIndices(const unsigned int *indices,
+        GLuint firstIndex,
+        GLuint indexCount)
+{
+    // Through the copy target, like when the buffer was created
+    glBindBuffer(GL_COPY_WRITE_BUFFER, getIndexBufferID());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(GLuint) * (getFirstIndex() + firstIndex), sizeof(GLuint) * indexCount, indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void Mesh::moveIntoGeometryPool(GeometryPool *geometryPool)
+{
+    if (m_geometry != GeometryPool::INVALID_GEOMETRY || !m_vboID)
+    {
+        createVertexArray();
+        return;
+    }
+
+    const GLsizeiptr vertexSize = sizeof(GLfloat) * 8;
+    GLsizei indexCount = getAllLevelsIndexCount();
+
+    m_geometryPool = geometryPool;
+    m_geometry = m_geometryPool->allocateGeometry(nullptr, m_vertexCount, nullptr, indexCount);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, m_vboID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, getVertexBufferID());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+        0, vertexSize * getBaseVertex(), vertexSize * m_vertexCount);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, m_iboID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, getIndexBufferID());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+        0, sizeof(GLuint) * getFirstIndex(), sizeof(GLuint) * indexCount);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // The driver frees the staging buffers
+    // once the copies have been executed
+    GLuint buffers[] = { m_vboID, m_iboID };
+    for (size_t i = 0; i < 2; ++i)
+    {
+        GetGpuResourceRegistry().removeResource(GPU_RESOURCE_BUFFER, buffers[i]);
+    }
+    glDeleteBuffers(2, buffers);
+    m_vboID = 0;
+    m_iboID = 0;
+}
+
+void Mesh::createVertexArray()
+{
+    // Pooled meshes draw with the vertex array of their page
+    if (m_geometry != GeometryPool::INVALID_GEOMETRY)
+    {
+        return;
+    }
+
     // Specify a VAO for the mesh
-    glGenVertexArrays(1, &m_vaoID);
-    glBindVertexArray(m_vaoID);
+    glGenVertexArrays(1, &m_vertexArray.vaoID);
+    glBindVertexArray(m_vertexArray.vaoID);
 
-        // Specify a VBO to pass in the index data
-        // which will be used for index drawing
-        glGenBuffers(1, &m_iboID);
+        // Bind the index buffer to the above VAO
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iboID);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * numberOfIndices, indices, GL_STATIC_DRAW);
 
-        // Specify a VBO to bind to the above VAO
-        glGenBuffers(1, &m_vboID);
+        // Bind the vertex buffer for the attribute pointers
         glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
 
-            // Loading up the data of the tetrahedron into the VBO
-            glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * numberOfVertices, vertices, GL_STATIC_DRAW);
-
             // Setting up attribute pointer for shader access
             // Arguments: layout location, number of components in the vertex position attribute, 
                 // type of the attribute, normalise?, stride, offset
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertices[0]) * 8, (const void*)0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 8, (const void*)0);
             // Enables the vertex position attribute
             // array specified at index 0
             glEnableVertexAttribArray(0);
             
             // Setting the data the texture coordinates in a separate attribute pointer
-            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertices[0]) * 8, (const void*)(sizeof(vertices[0]) * 3));
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 8, (const void*)(sizeof(GLfloat) * 3));
             glEnableVertexAttribArray(1);
 
             // Setting the data the normal data in a separate attribute pointer
-            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(vertices[0]) * 8, (const void*)(sizeof(vertices[0]) * 5));
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 8, (const void*)(sizeof(GLfloat) * 5));
             glEnableVertexAttribArray(2);
 
     // Unbinding the VAO
@@ -82,39 +200,372 @@ void Mesh::createMesh(GLfloat *vertices,
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void Mesh::renderMesh()
+void Mesh::createMeshWithLevelsOfDetail(GLfloat *vertices,
+        unsigned int* indices,
+        unsigned int numberOfVertices,
+        unsigned int numberOfIndices,
+        unsigned int levelCount)
+{
+    std::vector<unsigned int> levelIndices;
+    std::vector<GLsizei> levelIndexCounts;
+    buildLevelsOfDetail(vertices, indices, numberOfVertices, numberOfIndices, levelCount, levelIndices, levelIndexCounts);
+    createMeshFromLevelsOfDetail(vertices, &levelIndices[0], numberOfVertices, levelIndexCounts);
+}
+
+void Mesh::buildLevelsOfDetail(const GLfloat *vertices,
+        const unsigned int *indices,
+        unsigned int numberOfVertices,
+        unsigned int numberOfIndices,
+        unsigned int levelCount,
+        std::vector<unsigned int> &levelIndices,
+        std::vector<GLsizei> &levelIndexCounts)
+{
+    std::vector<std::vector<unsigned int> > levels;
+    MeshSimplifier simplifier(vertices, numberOfVertices / 8, 8);
+    simplifier.generateLevelsOfDetail(
+        std::vector<unsigned int>(indices, indices + numberOfIndices),
+        levelCount,
+        levels);
+
+    size_t totalIndexCount = 0;
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        totalIndexCount += levels[i].size();
+    }
+
+    levelIndices.clear();
+    levelIndices.reserve(totalIndexCount);
+    levelIndexCounts.clear();
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        levelIndexCounts.push_back(levels[i].size());
+        levelIndices.insert(levelIndices.end(), levels[i].begin(), levels[i].end());
+    }
+}
+
+void Mesh::createMeshFromLevelsOfDetail(GLfloat *vertices,
+        unsigned int *levelIndices,
+        unsigned int numberOfVertices,
+        const std::vector<GLsizei> &levelIndexCounts)
+{
+    createMeshBuffersFromLevelsOfDetail(vertices, levelIndices, numberOfVertices, levelIndexCounts);
+    createVertexArray();
+}
+
+void Mesh::createMeshBuffersFromLevelsOfDetail(const GLfloat *vertices,
+        const unsigned int *levelIndices,
+        unsigned int numberOfVertices,
+        const std::vector<GLsizei> &levelIndexCounts)
+{
+    std::vector<LevelOfDetail> levelsOfDetail;
+    GLuint firstIndex = 0;
+    for (size_t i = 0; i < levelIndexCounts.size(); ++i)
+    {
+        LevelOfDetail levelOfDetail = { firstIndex, levelIndexCounts[i] };
+        levelsOfDetail.push_back(levelOfDetail);
+        firstIndex += levelIndexCounts[i];
+    }
+
+    createMeshBuffers(vertices, levelIndices, numberOfVertices, firstIndex);
+
+    m_indexCount = levelIndexCounts.empty() ? 0 : levelIndexCounts[0];
+    m_levelsOfDetail = levelsOfDetail;
+}
+
+const Mesh::LevelOfDetail& Mesh::getLevelOfDetail(unsigned int level)
+{
+    if (level >= m_levelsOfDetail.size())
+    {
+        level = m_levelsOfDetail.size() - 1;
+    }
+
+    return m_levelsOfDetail[level];
+}
+
+VertexArrayBinding& Mesh::getVertexArray()
 {
-    glBindVertexArray(m_vaoID);
+    if (m_geometry != GeometryPool::INVALID_GEOMETRY)
+    {
+        return m_geometryPool->getVertexArray(m_geometry);
+    }
+
+    return m_vertexArray;
+}
+
+void Mesh::renderMesh(unsigned int level)
+{
+    const LevelOfDetail &levelOfDetail = getLevelOfDetail(level);
+
+    glBindVertexArray(getVertexArray().vaoID);
         // Perform the draw call to initialise the rendering pipeline.
         // Arguments: drawing mode, number of indices, type of the index data, 
-            // pointer to indices (0 because the data is already bound to IBO)
-        glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
+            // byte offset of the first index in the IBO bound to the VAO,
+            // value added to every index (the start of a pooled range)
+        glDrawElementsBaseVertex(GL_TRIANGLES, levelOfDetail.indexCount, GL_UNSIGNED_INT,
+            (const void*)(sizeof(GLuint) * (getFirstIndex() + levelOfDetail.firstIndex)),
+            getBaseVertex());
+    glBindVertexArray(0);
+}
+
+void Mesh::renderInstanced(
+    const glm::mat4 *modelMatrices,
+    GLsizei instanceCount)
+{
+    m_instanceBuffer.updateInstanceData(modelMatrices, instanceCount);
+    renderInstanced(m_instanceBuffer);
+}
+
+void Mesh::renderInstanced(
+    InstanceBuffer &instanceBuffer,
+    unsigned int level)
+{
+    renderInstanced(instanceBuffer, level, 0, instanceBuffer.getInstanceCount());
+}
+
+void Mesh::renderInstanced(
+    InstanceBuffer &instanceBuffer,
+    unsigned int level,
+    GLsizei firstInstance,
+    GLsizei instanceCount)
+{
+    if (!instanceCount)
+    {
+        return;
+    }
+
+    const LevelOfDetail &levelOfDetail = getLevelOfDetail(level);
+
+    // The attributes start at the first matrix to draw, as
+    // base instances need a newer context than the scene asks for
+    GLintptr instanceOffset = instanceBuffer.getBufferOffset() + sizeof(glm::mat4) * firstInstance;
+
+    VertexArrayBinding &vertexArray = getVertexArray();
+    glBindVertexArray(vertexArray.vaoID);
+        // Rewire the instance attributes only if a different
+        // instance buffer, storage or region of it is being used,
+        // the meshes of a pool page share the one vertex array
+        if (vertexArray.attachedInstanceBufferID != instanceBuffer.getBufferID() ||
+            vertexArray.attachedInstanceStorageGeneration != instanceBuffer.getStorageGeneration() ||
+            vertexArray.attachedInstanceBufferOffset != instanceOffset)
+        {
+            attachInstanceBuffer(vertexArray, instanceBuffer.getBufferID(),
+                instanceBuffer.getStorageGeneration(), instanceOffset);
+        }
+
+        // Same as glDrawElements but the vertex shader is
+        // invoked once per vertex for each of the instances
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, levelOfDetail.indexCount, GL_UNSIGNED_INT,
+            (const void*)(sizeof(GLuint) * (getFirstIndex() + levelOfDetail.firstIndex)),
+            instanceCount, getBaseVertex());
     glBindVertexArray(0);
 }
 
+void Mesh::setClusters(const std::vector<MeshCluster> &clusters)
+{
+    m_clusters = clusters;
+}
+
+const std::vector<MeshCluster>& Mesh::getClusters()
+{
+    return m_clusters;
+}
+
+void Mesh::renderVisibleClusters(
+    const std::vector<unsigned char> &visibility,
+    LinearArena &scratchArena)
+{
+    size_t clusterCount = std::min(m_clusters.size(), visibility.size());
+    if (!clusterCount)
+    {
+        return;
+    }
+
+    // There are never more ranges than clusters, and
+    // the lists are only needed for the one draw call
+    ArenaScope scope(scratchArena);
+    GLsizei *rangeCounts = scratchArena.allocateArray<GLsizei>(clusterCount);
+    const void **rangeOffsets = scratchArena.allocateArray<const void*>(clusterCount);
+    GLint *rangeBaseVertices = scratchArena.allocateArray<GLint>(clusterCount);
+    size_t rangeCount = 0;
+
+    GLuint firstIndex = getFirstIndex();
+
+    GLuint rangeEnd = 0;
+    for (size_t i = 0; i < clusterCount; ++i)
+    {
+        if (!visibility[i])
+        {
+            continue;
+        }
+
+        const MeshCluster &cluster = m_clusters[i];
+        if (rangeCount && cluster.firstIndex == rangeEnd)
+        {
+            rangeCounts[rangeCount - 1] += cluster.indexCount;
+        }
+        else
+        {
+            rangeCounts[rangeCount] = cluster.indexCount;
+            rangeOffsets[rangeCount] = (const void*)(sizeof(GLuint) * (firstIndex + cluster.firstIndex));
+            rangeBaseVertices[rangeCount] = getBaseVertex();
+            ++rangeCount;
+        }
+
+        rangeEnd = cluster.firstIndex + cluster.indexCount;
+    }
+
+    if (!rangeCount)
+    {
+        return;
+    }
+
+    glBindVertexArray(getVertexArray().vaoID);
+        // Same as glDrawElementsBaseVertex called once per range
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, rangeCounts, GL_UNSIGNED_INT,
+            rangeOffsets, rangeCount, rangeBaseVertices);
+    glBindVertexArray(0);
+}
+
+void Mesh::attachInstanceBuffer(
+    VertexArrayBinding &vertexArray,
+    GLuint instanceBufferID,
+    unsigned int instanceStorageGeneration,
+    GLintptr instanceBufferOffset)
+{
+    // Assumes the VAO of the mesh is currently bound
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+
+        // A mat4 attribute is too large for a single attribute
+        // slot, so it is split into 4 vec4 columns that occupy
+        // consecutive attribute locations. The divisor of 1 advances
+        // the attribute once per instance instead of once per vertex.
+        for (GLuint column = 0; column < 4; ++column)
+        {
+            GLuint location = INSTANCE_MODEL_ATTRIBUTE_LOCATION + column;
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (const void*)(instanceBufferOffset + sizeof(glm::vec4) * column));
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    vertexArray.attachedInstanceBufferID = instanceBufferID;
+    vertexArray.attachedInstanceStorageGeneration = instanceStorageGeneration;
+    vertexArray.attachedInstanceBufferOffset = instanceBufferOffset;
+}
+
+GLuint Mesh::getVertexBufferID()
+{
+    if (m_geometry != GeometryPool::INVALID_GEOMETRY)
+    {
+        return m_geometryPool->getVertexBufferID(m_geometry);
+    }
+
+    return m_vboID;
+}
+
+GLuint Mesh::getIndexBufferID()
+{
+    if (m_geometry != GeometryPool::INVALID_GEOMETRY)
+    {
+        return m_geometryPool->getIndexBufferID(m_geometry);
+    }
+
+    return m_iboID;
+}
+
+GLint Mesh::getBaseVertex()
+{
+    if (m_geometry != GeometryPool::INVALID_GEOMETRY)
+    {
+        return m_geometryPool->getBaseVertex(m_geometry);
+    }
+
+    return 0;
+}
+
+GLuint Mesh::getFirstIndex()
+{
+    if (m_geometry != GeometryPool::INVALID_GEOMETRY)
+    {
+        return m_geometryPool->getFirstIndex(m_geometry);
+    }
+
+    return 0;
+}
+
+GLsizei Mesh::getVertexCount()
+{
+    return m_vertexCount;
+}
+
+GLsizei Mesh::getIndexCount()
+{
+    return m_indexCount;
+}
+
+unsigned int Mesh::getLevelOfDetailCount()
+{
+    return m_levelsOfDetail.size();
+}
+
+GLuint Mesh::getLevelFirstIndex(unsigned int level)
+{
+    return getLevelOfDetail(level).firstIndex;
+}
+
+GLsizei Mesh::getLevelIndexCount(unsigned int level)
+{
+    return getLevelOfDetail(level).indexCount;
+}
+
+GLsizei Mesh::getAllLevelsIndexCount()
+{
+    if (m_levelsOfDetail.empty())
+    {
+        return 0;
+    }
+
+    const LevelOfDetail &lastLevel = m_levelsOfDetail.back();
+    return lastLevel.firstIndex + lastLevel.indexCount;
+}
+
 void Mesh::clearMesh()
 {
     // To free VBO and IBO buffers use glDeleteBuffers()
     if (m_iboID)
     {
+        GetGpuResourceRegistry().removeResource(GPU_RESOURCE_BUFFER, m_iboID);
         glDeleteBuffers(1, &m_iboID);
         m_iboID = 0;
     }
 
     if (m_vboID)
     {
+        GetGpuResourceRegistry().removeResource(GPU_RESOURCE_BUFFER, m_vboID);
         glDeleteBuffers(1, &m_vboID);
         m_vboID = 0;
     }
 
     // To free a VAO use glDeleteVertexArrays()
-    if (m_vaoID)
+    if (m_vertexArray.vaoID)
+    {
+        glDeleteVertexArrays(1, &m_vertexArray.vaoID);
+    }
+    m_vertexArray = VertexArrayBinding();
+
+    // A pooled range goes back to the pool
+    if (m_geometry != GeometryPool::INVALID_GEOMETRY)
     {
-        glDeleteVertexArrays(1, &m_vaoID);
-        m_vaoID = 0;
+        m_geometryPool->freeGeometry(m_geometry);
+        m_geometry = GeometryPool::INVALID_GEOMETRY;
     }
 
+    m_vertexCount = 0;
     m_indexCount = 0;
+    m_levelsOfDetail.clear();
+    m_clusters.clear();
+    m_instanceBuffer.clearInstanceBuffer();
 }
 
 Mesh::~Mesh()
@@ -24,23 +24,182 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <glad/glad.h>
 
+#include <glm/glm.hpp>
+
+#include "frame-allocator.h"
+#include "geometry-pool.h"
+#include "instance-buffer.h"
+#include "mesh-cluster.h"
+
 class Mesh
 {
 public:
     Mesh();
+
+    // Meshes given a pool before they are created take a range
+    // of its shared buffers instead of buffers of their own
+    void setGeometryPool(GeometryPool *geometryPool);
+
+    // Owner the buffers of the mesh are recorded under
+    // in the GPU resource registry (e.g. a model file)
+    void setResourceLabel(const std::string &label);
     void createMesh(GLfloat *vertices, 
         unsigned int* indices,
         unsigned int numberOfVertices,
         unsigned int numberOfIndices);
 
-    void renderMesh();
+    // Same as createMesh but also generates up to levelCount
+    // simplified versions of the mesh. The index lists of all
+    // levels are stored back to back in the index buffer and
+    // share the vertex buffer of the full detail mesh.
+    void createMeshWithLevelsOfDetail(GLfloat *vertices,
+        unsigned int* indices,
+        unsigned int numberOfVertices,
+        unsigned int numberOfIndices,
+        unsigned int levelCount);
+
+    // The two halves of createMeshWithLevelsOfDetail. Building
+    // the levels makes no GL calls and is safe on any thread,
+    // it stores the index lists of all levels back to back in
+    // levelIndices and the length of each in levelIndexCounts.
+    static void buildLevelsOfDetail(const GLfloat *vertices,
+        const unsigned int *indices,
+        unsigned int numberOfVertices,
+        unsigned int numberOfIndices,
+        unsigned int levelCount,
+        std::vector<unsigned int> &levelIndices,
+        std::vector<GLsizei> &levelIndexCounts);
+    void createMeshFromLevelsOfDetail(GLfloat *vertices,
+        unsigned int *levelIndices,
+        unsigned int numberOfVertices,
+        const std::vector<GLsizei> &levelIndexCounts);
+
+    // The two halves of creating the mesh in GL. Buffers are
+    // shared between contexts and can be filled on an upload
+    // context, the vertex array is not and has to be created
+    // on the context drawing the mesh once the buffers are done.
+    // Null vertices and indices leave the buffers unfilled.
+    void createMeshBuffers(const GLfloat *vertices,
+        const unsigned int *indices,
+        unsigned int numberOfVertices,
+        unsigned int numberOfIndices);
+    void createMeshBuffersFromLevelsOfDetail(const GLfloat *vertices,
+        const unsigned int *levelIndices,
+        unsigned int numberOfVertices,
+        const std::vector<GLsizei> &levelIndexCounts);
+    void createVertexArray();
+
+    // Fill the buffers created without data a part at a time,
+    // the counts and offsets are in vertices and indices
+    void uploadVertices(const GLfloat *vertices,
+        GLuint firstVertex,
+        GLuint vertexCount);
+    void uploadIndices(const unsigned int *indices,
+        GLuint firstIndex,
+        GLuint indexCount);
+
+    // Copies the buffers of a mesh filled on an upload context
+    // into a range of the pool on the GPU and deletes them, on
+    // the context owning the pool. Replaces createVertexArray().
+    void moveIntoGeometryPool(GeometryPool *geometryPool);
+
+    // Level 0 is the full detail mesh, levels
+    // past the coarsest one draw the coarsest
+    void renderMesh(unsigned int level = 0);
+
+    // Draws one copy of the mesh per model matrix
+    // using the mesh's own instance buffer
+    void renderInstanced(
+        const glm::mat4 *modelMatrices,
+        GLsizei instanceCount);
+
+    // Draws the mesh using an instance buffer
+    // shared with other meshes (e.g. of a model)
+    void renderInstanced(
+        InstanceBuffer &instanceBuffer,
+        unsigned int level = 0);
+
+    // Same as above for instanceCount of the matrices
+    // in the buffer starting at firstInstance
+    void renderInstanced(
+        InstanceBuffer &instanceBuffer,
+        unsigned int level,
+        GLsizei firstInstance,
+        GLsizei instanceCount);
+
+    // Clusters of the full detail level, their index
+    // ranges have to match the ones passed to createMesh
+    void setClusters(const std::vector<MeshCluster> &clusters);
+    const std::vector<MeshCluster>& getClusters();
+
+    // Draws the full detail level skipping the clusters with
+    // a visibility of 0, clusters next to each other in the
+    // index buffer are merged into a single range. The ranges
+    // are listed in the scratch arena for the draw call.
+    void renderVisibleClusters(
+        const std::vector<unsigned char> &visibility,
+        LinearArena &scratchArena);
+
     void clearMesh();
 
+    // Accessors used when the mesh geometry is
+    // copied into shared buffers for batched drawing.
+    // Pooled meshes start at the base vertex and first
+    // index of their range in the buffers of the pool.
+    GLuint getVertexBufferID();
+    GLuint getIndexBufferID();
+    GLint getBaseVertex();
+    GLuint getFirstIndex();
+    GLsizei getVertexCount();
+    GLsizei getIndexCount();
+    unsigned int getLevelOfDetailCount();
+
+    // Index range of a level relative to getFirstIndex(),
+    // levels past the last one return the coarsest level
+    GLuint getLevelFirstIndex(unsigned int level);
+    GLsizei getLevelIndexCount(unsigned int level);
+
+    // Indices of all the levels, stored one after the other
+    GLsizei getAllLevelsIndexCount();
+
     ~Mesh();
 
 private:
-    GLuint m_vaoID, m_vboID, m_iboID;
-    GLsizei m_indexCount;
+    // Owns GL buffers, a copy would delete them twice
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    // Range of the index buffer drawn for a level of detail
+    struct LevelOfDetail
+    {
+        GLuint firstIndex;
+        GLsizei indexCount;
+    };
+
+    const LevelOfDetail& getLevelOfDetail(unsigned int level);
+    VertexArrayBinding& getVertexArray();
+    void attachInstanceBuffer(
+        VertexArrayBinding &vertexArray,
+        GLuint instanceBufferID,
+        unsigned int instanceStorageGeneration,
+        GLintptr instanceBufferOffset);
+
+    // Either buffers of the mesh's own or a range of a pool
+    GLuint m_vboID, m_iboID;
+    VertexArrayBinding m_vertexArray;
+    GeometryPool *m_geometryPool;
+    unsigned int m_geometry;
+    // The index count is the one of the full detail level
+    GLsizei m_vertexCount, m_indexCount;
+    std::vector<LevelOfDetail> m_levelsOfDetail;
+
+    std::vector<MeshCluster> m_clusters;
+
+    InstanceBuffer m_instanceBuffer;
+    std::string m_resourceLabel;
 };
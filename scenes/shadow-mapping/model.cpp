@@ -22,14 +22,94 @@
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
+#include "constants.h"
 #include "model.h"
 
-Model::Model()
+// Vertices converted by a job at a time
+static const size_t VERTICES_PER_JOB = 4096;
+
+// Most geometry written by one upload step, a multiple
+// of the vertex size so every step writes whole vertices
+static const size_t UPLOAD_STEP_BYTES = 1 << 20;
+
+static double MillisecondsBetween(
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+Model::Model() :
+    m_levelOfDetailCount(1),
+    m_jobSystem(nullptr),
+    m_geometryPool(nullptr),
+    m_boundsMin(FLT_MAX),
+    m_boundsMax(-FLT_MAX),
+    m_boundingCenter(0.0f),
+    m_boundingRadius(0.0f),
+    m_nextPendingMesh(0),
+    m_uploadingMesh(nullptr),
+    m_uploadedVertices(0),
+    m_uploadedIndices(0),
+    m_nextPendingTexture(0),
+    m_textureArrayPending(false),
+    m_vertexArraysPending(false),
+    m_packTextures(false)
 {
 }
 
-bool Model::loadModel(const std::string& fileName)
+void Model::setJobSystem(JobSystem *jobSystem)
+{
+    m_jobSystem = jobSystem;
+}
+
+void Model::setGeometryPool(GeometryPool *geometryPool)
+{
+    m_geometryPool = geometryPool;
+}
+
+bool Model::loadModel(
+    const std::string& fileName,
+    bool packTextures,
+    unsigned int levelOfDetailCount)
+{
+    if (!importModel(fileName, packTextures, levelOfDetailCount))
+    {
+        return false;
+    }
+
+    while (uploadModelStep())
+    {
+    }
+
+    printf("Model %s: %zu meshes, import %.1f ms, conversion %.1f ms, textures %.1f ms, upload %.1f ms\n",
+        fileName.c_str(),
+        m_meshList.size(),
+        m_loadTimes.importMilliseconds,
+        m_loadTimes.conversionMilliseconds,
+        m_loadTimes.textureMilliseconds,
+        m_loadTimes.uploadMilliseconds);
+
+    return true;
+}
+
+bool Model::importModel(
+    const std::string& fileName,
+    bool packTextures,
+    unsigned int levelOfDetailCount)
 {
+    m_fileName = fileName;
+    m_packTextures = packTextures;
+    m_levelOfDetailCount = levelOfDetailCount ? levelOfDetailCount : 1;
+    m_loadTimes = ModelLoadTimes();
+    m_textureArray.setResourceLabel(fileName);
+
+    std::chrono::steady_clock::time_point importStart = std::chrono::steady_clock::now();
+
     Assimp::Importer importer;
     const aiScene *scene = importer.ReadFile(
         fileName,
@@ -44,69 +124,388 @@ bool Model::loadModel(const std::string& fileName)
         return false;
     }
     
-    loadNode(scene->mRootNode, scene);
-    loadMaterials(scene);
+    std::vector<const aiMesh*> meshes;
+    std::vector<glm::mat4> meshTransforms;
+    loadNode(scene->mRootNode, scene, ModelNode::NO_PARENT, glm::mat4(1.0f), meshes, meshTransforms);
+
+    // Convert all the meshes side by side on the workers,
+    // they are uploaded one after the other later on
+    std::chrono::steady_clock::time_point conversionStart = std::chrono::steady_clock::now();
+
+    m_pendingMeshes.resize(meshes.size());
+    m_nextPendingMesh = 0;
+    std::function<void(size_t, size_t)> convertMeshes = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+        {
+            convertMesh(meshes[i], meshTransforms[i], m_pendingMeshes[i]);
+        }
+    };
+
+    if (m_jobSystem)
+    {
+        m_jobSystem->parallelFor(meshes.size(), 1, convertMeshes);
+    }
+    else
+    {
+        convertMeshes(0, meshes.size());
+    }
+
+    for (size_t i = 0; i < m_pendingMeshes.size(); ++i)
+    {
+        m_boundsMin = glm::min(m_boundsMin, m_pendingMeshes[i].boundsMin);
+        m_boundsMax = glm::max(m_boundsMax, m_pendingMeshes[i].boundsMax);
+    }
+    computeBoundingSphere();
+
+    std::chrono::steady_clock::time_point textureStart = std::chrono::steady_clock::now();
+
+    if (m_packTextures)
+    {
+        decodePackedMaterials(scene);
+    }
+    else
+    {
+        decodeMaterials(scene);
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    m_loadTimes.importMilliseconds = MillisecondsBetween(importStart, conversionStart);
+    m_loadTimes.conversionMilliseconds = MillisecondsBetween(conversionStart, textureStart);
+    m_loadTimes.textureMilliseconds = MillisecondsBetween(textureStart, end);
 
     return true;
 }
 
-void Model::loadNode(aiNode *node, const aiScene *scene)
+bool Model::uploadModelStep(bool sharedContext)
 {
-    for (size_t i = 0; i < node->mNumMeshes; ++i)
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (m_nextPendingMesh < m_pendingMeshes.size())
+    {
+        // The converted geometry is not needed once uploaded
+        if (uploadMeshStep(m_pendingMeshes[m_nextPendingMesh], sharedContext))
+        {
+            m_pendingMeshes[m_nextPendingMesh] = ConvertedMesh();
+            ++m_nextPendingMesh;
+        }
+    }
+    else if (m_packTextures && m_textureArrayPending)
+    {
+        // A layer per step, the array is only
+        // sampled once all of them are in
+        if (!m_textureArray.uploadTextureArrayLayer())
+        {
+            printf("Error: Model::uploadModelStep(): Failed to create the texture array\n");
+            m_textureArrayPending = false;
+        }
+        else if (!m_textureArray.hasPendingLayers())
+        {
+            m_textureArrayPending = false;
+        }
+    }
+    else if (!m_packTextures && m_nextPendingTexture < m_textureList.size())
     {
-        loadMesh(scene->mMeshes[node->mMeshes[i]], scene);
+        size_t i = m_nextPendingTexture++;
+        if (!m_textureList[i]->uploadTexture(m_textureWithAlpha[i] != 0))
+        {
+            delete m_textureList[i];
+            m_textureList[i] = loadPlainTexture();
+        }
     }
 
-    for(size_t i = 0; i < node->mNumChildren; ++i)
+    m_loadTimes.uploadMilliseconds += MillisecondsBetween(start, std::chrono::steady_clock::now());
+
+    if (!hasPendingUploads())
     {
-        loadNode(node->mChildren[i], scene);
+        m_pendingMeshes.clear();
+        m_nextPendingMesh = 0;
+        return false;
     }
+
+    return true;
 }
 
-void Model::loadMesh(aiMesh *mesh, const aiScene *scene)
+void Model::createVertexArrays()
 {
-    std::vector<GLfloat> vertices;
-    std::vector<unsigned int> indices;
-
-    for (size_t i = 0; i < mesh->mNumVertices; ++i)
+    // Meshes filled on an upload context are moved into
+    // the pool here, where it can be used, so that they
+    // share its buffers and leave it defragmentable
+    for (size_t i = 0; i < m_meshList.size(); ++i)
     {
-        vertices.insert(vertices.end(), {mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z});
-        
-        if (mesh->mTextureCoords[0])
+        if (m_geometryPool)
         {
-            vertices.insert(vertices.end(), {mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y});
+            m_meshList[i]->moveIntoGeometryPool(m_geometryPool);
         }
         else
         {
-            vertices.insert(vertices.end(), { 0.0f, 0.0f });
+            m_meshList[i]->createVertexArray();
+        }
+    }
+    m_vertexArraysPending = false;
+}
+
+bool Model::isModelResident()
+{
+    return !hasPendingUploads() && !m_vertexArraysPending;
+}
+
+bool Model::hasPendingUploads()
+{
+    return m_nextPendingMesh < m_pendingMeshes.size() ||
+        m_textureArrayPending ||
+        (!m_packTextures && m_nextPendingTexture < m_textureList.size());
+}
+
+const ModelLoadTimes& Model::getLoadTimes()
+{
+    return m_loadTimes;
+}
+
+void Model::loadNode(
+    const aiNode *node,
+    const aiScene *scene,
+    unsigned int parent,
+    const glm::mat4 &parentTransform,
+    std::vector<const aiMesh*> &meshes,
+    std::vector<glm::mat4> &meshTransforms)
+{
+    ModelNode modelNode;
+    modelNode.name = node->mName.C_Str();
+    modelNode.parent = parent;
+
+    // Assimp matrices are row major, GLM ones column major
+    for (unsigned int row = 0; row < 4; ++row)
+    {
+        for (unsigned int column = 0; column < 4; ++column)
+        {
+            modelNode.transform[column][row] = node->mTransformation[row][column];
+        }
+    }
+
+    unsigned int nodeIndex = m_nodes.size();
+    m_nodes.push_back(modelNode);
+
+    // Transform of the node relative to the model root,
+    // the meshes of the node are converted into that space
+    glm::mat4 transform = parentTransform * modelNode.transform;
+
+    // The meshes are only gathered here, they end
+    // up in the mesh list in the same order
+    for (size_t i = 0; i < node->mNumMeshes; ++i)
+    {
+        m_nodes[nodeIndex].meshes.push_back(m_meshList.size() + meshes.size());
+        meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+        meshTransforms.push_back(transform);
+    }
+
+    for(size_t i = 0; i < node->mNumChildren; ++i)
+    {
+        loadNode(node->mChildren[i], scene, nodeIndex, transform, meshes, meshTransforms);
+    }
+}
+
+void Model::convertMesh(const aiMesh *mesh, const glm::mat4 &transform, ConvertedMesh &converted)
+{
+    // The vertices are moved from the space of their node into
+    // the space of the model once here, so every path draws the
+    // meshes with the one model matrix of the object
+    glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+
+    // Both buffers are sized up front, nothing
+    // is reallocated while they are filled
+    std::vector<GLfloat> vertices(mesh->mNumVertices * 8);
+
+    size_t indexCount = 0;
+    for (size_t i = 0; i < mesh->mNumFaces; ++i)
+    {
+        indexCount += mesh->mFaces[i].mNumIndices;
+    }
+    std::vector<unsigned int> indices(indexCount);
+
+    // Every range of vertices keeps its own bounds, merged once all are done
+    size_t rangeCount = (mesh->mNumVertices + VERTICES_PER_JOB - 1) / VERTICES_PER_JOB;
+    std::vector<glm::vec3> rangeMin(rangeCount, glm::vec3(FLT_MAX));
+    std::vector<glm::vec3> rangeMax(rangeCount, glm::vec3(-FLT_MAX));
+
+    std::function<void(size_t, size_t)> convertVertices = [&](size_t first, size_t last) {
+        glm::vec3 &boundsMin = rangeMin[first / VERTICES_PER_JOB];
+        glm::vec3 &boundsMax = rangeMax[first / VERTICES_PER_JOB];
+
+        for (size_t i = first; i < last; ++i)
+        {
+            GLfloat *vertex = &vertices[i * 8];
+            glm::vec3 position = glm::vec3(transform * glm::vec4(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z, 1.0f));
+            vertex[0] = position.x;
+            vertex[1] = position.y;
+            vertex[2] = position.z;
+
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
+
+            if (mesh->mTextureCoords[0])
+            {
+                vertex[3] = mesh->mTextureCoords[0][i].x;
+                vertex[4] = mesh->mTextureCoords[0][i].y;
+            }
+            else
+            {
+                vertex[3] = 0.0f;
+                vertex[4] = 0.0f;
+            }
+
+            // Find out why the normals need to be inverted
+            glm::vec3 normal = normalTransform * glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+            vertex[5] = -normal.x;
+            vertex[6] = -normal.y;
+            vertex[7] = -normal.z;
         }
+    };
+
+    if (m_jobSystem)
+    {
+        m_jobSystem->parallelFor(mesh->mNumVertices, VERTICES_PER_JOB, convertVertices);
+    }
+    else
+    {
+        convertVertices(0, mesh->mNumVertices);
+    }
 
-        // Find out why the normals need to be inverted
-        vertices.insert(vertices.end(), {-mesh->mNormals[i].x, -mesh->mNormals[i].y, -mesh->mNormals[i].z});
+    converted.boundsMin = glm::vec3(FLT_MAX);
+    converted.boundsMax = glm::vec3(-FLT_MAX);
+    for (size_t i = 0; i < rangeCount; ++i)
+    {
+        converted.boundsMin = glm::min(converted.boundsMin, rangeMin[i]);
+        converted.boundsMax = glm::max(converted.boundsMax, rangeMax[i]);
     }
 
+    unsigned int *index = indexCount ? &indices[0] : nullptr;
     for (size_t i = 0; i < mesh->mNumFaces; ++i)
     {
-        aiFace face = mesh->mFaces[i];
+        const aiFace &face = mesh->mFaces[i];
         for (size_t j = 0; j < face.mNumIndices; ++j)
         {
-            indices.push_back(face.mIndices[j]);
+            *index++ = face.mIndices[j];
         }
     }
 
-    Mesh *newMesh = new Mesh();
-    newMesh->createMesh(&vertices[0], &indices[0], vertices.size(), indices.size());
-    m_meshList.push_back(newMesh);
-    m_meshToTexture.push_back(mesh->mMaterialIndex);
+    // Reorder the triangles into clusters, the simplified
+    // levels are generated from the clustered order and the
+    // full detail level keeps it as is
+    std::vector<unsigned int> clusteredIndices;
+    BuildMeshClusters(&vertices[0], mesh->mNumVertices, 8, indices, clusteredIndices, converted.clusters);
+
+    if (m_levelOfDetailCount > 1)
+    {
+        Mesh::buildLevelsOfDetail(
+            &vertices[0],
+            &clusteredIndices[0],
+            vertices.size(),
+            clusteredIndices.size(),
+            m_levelOfDetailCount,
+            converted.indices,
+            converted.levelIndexCounts);
+    }
+    else
+    {
+        converted.levelIndexCounts.assign(1, clusteredIndices.size());
+        converted.indices.swap(clusteredIndices);
+    }
+
+    converted.vertices.swap(vertices);
+    converted.materialIndex = mesh->mMaterialIndex;
 }
 
-void Model::loadMaterials(const aiScene *scene)
+bool Model::uploadMeshStep(ConvertedMesh &converted, bool sharedContext)
 {
-    m_textureList.resize(scene->mNumMaterials);
+    GLuint vertexCount = converted.vertices.size() / 8;
+    GLuint indexCount = converted.indices.size();
+
+    if (!m_uploadingMesh)
+    {
+        // The pool belongs to the GL thread, meshes filled on
+        // an upload context are staged in buffers of their own
+        // and moved into the pool by createVertexArrays()
+        m_uploadingMesh = new Mesh();
+        m_uploadingMesh->setResourceLabel(m_fileName);
+        if (!sharedContext)
+        {
+            m_uploadingMesh->setGeometryPool(m_geometryPool);
+        }
+
+        // Created empty and filled in parts below, so
+        // no step writes more than UPLOAD_STEP_BYTES
+        m_uploadingMesh->createMeshBuffersFromLevelsOfDetail(
+            nullptr,
+            nullptr,
+            converted.vertices.size(),
+            converted.levelIndexCounts);
+        m_uploadedVertices = 0;
+        m_uploadedIndices = 0;
+    }
+
+    const size_t vertexSize = sizeof(GLfloat) * 8;
+    size_t stepBytes = UPLOAD_STEP_BYTES;
+
+    if (m_uploadedVertices < vertexCount)
+    {
+        GLuint count = std::min<size_t>(vertexCount - m_uploadedVertices, stepBytes / vertexSize);
+        m_uploadingMesh->uploadVertices(&converted.vertices[m_uploadedVertices * 8], m_uploadedVertices, count);
+        m_uploadedVertices += count;
+        stepBytes -= vertexSize * count;
+    }
+
+    if (m_uploadedVertices == vertexCount && m_uploadedIndices < indexCount && stepBytes >= sizeof(GLuint))
+    {
+        GLuint count = std::min<size_t>(indexCount - m_uploadedIndices, stepBytes / sizeof(GLuint));
+        m_uploadingMesh->uploadIndices(&converted.indices[m_uploadedIndices], m_uploadedIndices, count);
+        m_uploadedIndices += count;
+    }
+
+    if (m_uploadedVertices < vertexCount || m_uploadedIndices < indexCount)
+    {
+        return false;
+    }
+
+    if (sharedContext)
+    {
+        m_vertexArraysPending = true;
+    }
+    else
+    {
+        m_uploadingMesh->createVertexArray();
+    }
+
+    m_uploadingMesh->setClusters(converted.clusters);
+    m_meshList.push_back(m_uploadingMesh);
+    m_meshToTexture.push_back(converted.materialIndex);
+    m_uploadingMesh = nullptr;
+
+    return true;
+}
+
+void Model::computeBoundingSphere()
+{
+    if (m_boundsMin.x > m_boundsMax.x)
+    {
+        return;
+    }
+
+    // The sphere around the bounding box is looser than
+    // a minimal one but good enough to estimate screen size
+    m_boundingCenter = (m_boundsMin + m_boundsMax) * 0.5f;
+    m_boundingRadius = glm::length(m_boundsMax - m_boundingCenter);
+}
+
+void Model::decodeMaterials(const aiScene *scene)
+{
+    m_textureList.assign(scene->mNumMaterials, nullptr);
+    m_textureWithAlpha.assign(scene->mNumMaterials, 0);
+    m_nextPendingTexture = 0;
+
     for (size_t i = 0; i < scene->mNumMaterials; ++i)
     {
         aiMaterial *material = scene->mMaterials[i];
-        m_textureList[i] = nullptr;
+        std::string texturePath;
 
         if (material->GetTextureCount(aiTextureType_DIFFUSE))
         {
@@ -115,43 +514,291 @@ void Model::loadMaterials(const aiScene *scene)
             {
                 int idx = std::string(path.data).rfind("\\");
                 std::string filename = std::string(path.data).substr(idx + 1);
-                std::string texturePath = std::string("./scenes/shadow-mapping/assets/textures/") + filename;
-                m_textureList[i] = new Texture();
-                m_textureList[i]->createTexture(texturePath.c_str());
-
-                if (!m_textureList[i]->loadTextureRGBOnly())
-                {
-                    printf("Error: Model::loadMaterials(): Failed to load texture at %s\n", texturePath.c_str());
-                    delete m_textureList[i];
-                    m_textureList[i] = nullptr;
-                }
+                texturePath = std::string("./scenes/shadow-mapping/assets/textures/") + filename;
             }
         }
 
-        if (!m_textureList[i])
+        // Materials without a texture use the plain one
+        if (texturePath.empty())
         {
-            m_textureList[i] = new Texture();
+            texturePath = "./scenes/shadow-mapping/assets/textures/plain.png";
+            m_textureWithAlpha[i] = 1;
+        }
+
+        m_textureList[i] = new Texture();
+        m_textureList[i]->createTexture(texturePath.c_str());
+    }
+
+    std::function<void(size_t, size_t)> decodeTextures = [this](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+        {
+            if (m_textureList[i]->decodeTexture())
+            {
+                continue;
+            }
+
+            printf("Error: Model::decodeMaterials(): Falling back to the plain texture\n");
             m_textureList[i]->createTexture("./scenes/shadow-mapping/assets/textures/plain.png");
-            m_textureList[i]->loadTextureWithAlpha();
+            m_textureList[i]->decodeTexture();
+            m_textureWithAlpha[i] = 1;
+        }
+    };
+
+    if (m_jobSystem)
+    {
+        m_jobSystem->parallelFor(m_textureList.size(), 1, decodeTextures);
+    }
+    else
+    {
+        decodeTextures(0, m_textureList.size());
+    }
+}
+
+Texture* Model::loadPlainTexture()
+{
+    Texture *texture = new Texture();
+    texture->createTexture("./scenes/shadow-mapping/assets/textures/plain.png");
+    texture->loadTextureWithAlpha();
+    return texture;
+}
+
+void Model::decodePackedMaterials(const aiScene *scene)
+{
+    m_materialToTextureLayer.resize(scene->mNumMaterials);
+    for (size_t i = 0; i < scene->mNumMaterials; ++i)
+    {
+        aiMaterial *material = scene->mMaterials[i];
+        std::string texturePath = "./scenes/shadow-mapping/assets/textures/plain.png";
+
+        if (material->GetTextureCount(aiTextureType_DIFFUSE))
+        {
+            aiString path;
+            if (material->GetTexture(aiTextureType_DIFFUSE, 0, &path) == AI_SUCCESS)
+            {
+                int idx = std::string(path.data).rfind("\\");
+                std::string filename = std::string(path.data).substr(idx + 1);
+                texturePath = std::string("./scenes/shadow-mapping/assets/textures/") + filename;
+            }
         }
+
+        // Materials without a texture share the plain texture layer
+        m_materialToTextureLayer[i] = m_textureArray.addTexture(texturePath);
+    }
+
+    m_textureArrayPending = m_textureArray.decodeTextureArray(m_jobSystem);
+    if (!m_textureArrayPending)
+    {
+        printf("Error: Model::decodePackedMaterials(): Failed to decode the texture array\n");
+    }
+}
+
+void Model::useMeshTexture(size_t meshIndex)
+{
+    unsigned int materialIndex = m_meshToTexture[meshIndex];
+
+    if (m_packTextures)
+    {
+        // The texture array stays bound for the whole model,
+        // only the layer changes. As the attribute array is
+        // not enabled in the mesh VAOs, the shader reads this
+        // constant value for every vertex of the draw.
+        if (materialIndex < m_materialToTextureLayer.size())
+        {
+            glVertexAttrib1f(TEXTURE_LAYER_ATTRIBUTE_LOCATION, m_materialToTextureLayer[materialIndex]);
+        }
+    }
+    else if (materialIndex < m_textureList.size() && m_textureList[materialIndex])
+    {
+        m_textureList[materialIndex]->useTexture();
+    }
+}
+
+void Model::renderModel(unsigned int level)
+{
+    if (m_packTextures)
+    {
+        m_textureArray.useTextureArray();
+    }
+
+    for (size_t i = 0; i < m_meshList.size(); ++i)
+    {
+        useMeshTexture(i);
+        m_meshList[i]->renderMesh(level);
     }
 }
 
-void Model::renderModel()
+void Model::renderVisibleClusters(
+    ClusterCuller &culler,
+    const glm::mat4 &modelMatrix,
+    LinearArena &scratchArena)
 {
+    if (m_packTextures)
+    {
+        m_textureArray.useTextureArray();
+    }
+
     for (size_t i = 0; i < m_meshList.size(); ++i)
     {
-        unsigned int materialIndex = m_meshToTexture[i];
+        culler.cullClusters(m_meshList[i]->getClusters(), modelMatrix, m_clusterVisibility);
+
+        useMeshTexture(i);
+        m_meshList[i]->renderVisibleClusters(m_clusterVisibility, scratchArena);
+    }
+}
+
+void Model::renderInstanced(
+    const glm::mat4 *modelMatrices,
+    GLsizei instanceCount,
+    unsigned int level)
+{
+    m_instanceBuffer.updateInstanceData(modelMatrices, instanceCount);
+
+    if (m_packTextures)
+    {
+        m_textureArray.useTextureArray();
+    }
 
-        if (materialIndex < m_textureList.size() && m_textureList[materialIndex])
+    for (size_t i = 0; i < m_meshList.size(); ++i)
+    {
+        useMeshTexture(i);
+        m_meshList[i]->renderInstanced(m_instanceBuffer, level);
+    }
+}
+
+void Model::renderInstancedLevels(
+    const glm::mat4 *modelMatrices,
+    const GLsizei *levelInstanceCounts,
+    unsigned int levelCount)
+{
+    GLsizei instanceCount = 0;
+    for (unsigned int level = 0; level < levelCount; ++level)
+    {
+        instanceCount += levelInstanceCounts[level];
+    }
+
+    if (!instanceCount)
+    {
+        return;
+    }
+
+    // One region of the streaming buffer for all the levels,
+    // each draw points the attributes at the matrices of its level
+    m_instanceBuffer.updateInstanceData(modelMatrices, instanceCount);
+
+    if (m_packTextures)
+    {
+        m_textureArray.useTextureArray();
+    }
+
+    GLsizei firstInstance = 0;
+    for (unsigned int level = 0; level < levelCount; ++level)
+    {
+        if (levelInstanceCounts[level])
         {
-            m_textureList[materialIndex]->useTexture();
+            for (size_t i = 0; i < m_meshList.size(); ++i)
+            {
+                useMeshTexture(i);
+                m_meshList[i]->renderInstanced(m_instanceBuffer, level, firstInstance, levelInstanceCounts[level]);
+            }
         }
 
-        m_meshList[i]->renderMesh();
+        firstInstance += levelInstanceCounts[level];
     }
 }
 
+unsigned int Model::getLevelOfDetailCount()
+{
+    unsigned int levelOfDetailCount = 1;
+    for (size_t i = 0; i < m_meshList.size(); ++i)
+    {
+        if (m_meshList[i]->getLevelOfDetailCount() > levelOfDetailCount)
+        {
+            levelOfDetailCount = m_meshList[i]->getLevelOfDetailCount();
+        }
+    }
+
+    return levelOfDetailCount;
+}
+
+const glm::vec3& Model::getBoundsMin()
+{
+    return m_boundsMin;
+}
+
+const glm::vec3& Model::getBoundsMax()
+{
+    return m_boundsMax;
+}
+
+GLfloat Model::getBoundingRadius()
+{
+    return m_boundingRadius;
+}
+
+unsigned int Model::selectLevelOfDetail(
+    LevelOfDetailSelector &selector,
+    const glm::mat4 &modelMatrix,
+    unsigned int currentLevel)
+{
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(m_boundingCenter, 1.0f));
+
+    // Non-uniform scales grow the sphere by the largest axis
+    GLfloat scale = glm::max(
+        glm::length(glm::vec3(modelMatrix[0])),
+        glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+
+    return selector.selectLevel(center, m_boundingRadius * scale, currentLevel, getLevelOfDetailCount());
+}
+
+size_t Model::getNodeCount() const
+{
+    return m_nodes.size();
+}
+
+const ModelNode& Model::getNode(size_t nodeIndex) const
+{
+    return m_nodes[nodeIndex];
+}
+
+size_t Model::getMeshCount()
+{
+    return m_meshList.size();
+}
+
+Mesh* Model::getMesh(size_t meshIndex)
+{
+    return m_meshList[meshIndex];
+}
+
+Texture* Model::getMeshTexture(size_t meshIndex)
+{
+    unsigned int materialIndex = m_meshToTexture[meshIndex];
+
+    if (materialIndex < m_textureList.size())
+    {
+        return m_textureList[materialIndex];
+    }
+
+    return nullptr;
+}
+
+TextureArray* Model::getTextureArray()
+{
+    return m_packTextures ? &m_textureArray : nullptr;
+}
+
+GLuint Model::getMeshTextureLayer(size_t meshIndex)
+{
+    unsigned int materialIndex = m_meshToTexture[meshIndex];
+
+    if (materialIndex < m_materialToTextureLayer.size())
+    {
+        return m_materialToTextureLayer[materialIndex];
+    }
+
+    return 0;
+}
+
 void Model::clearModel()
 {
     for (size_t i = 0; i < m_meshList.size(); ++i)
@@ -162,6 +809,14 @@ void Model::clearModel()
             m_meshList[i] = nullptr;
         }
     }
+    m_meshList.clear();
+    m_meshToTexture.clear();
+
+    // Dropped halfway through its upload
+    delete m_uploadingMesh;
+    m_uploadingMesh = nullptr;
+    m_uploadedVertices = 0;
+    m_uploadedIndices = 0;
 
     for (size_t i = 0; i < m_textureList.size(); ++i)
     {
@@ -171,8 +826,28 @@ void Model::clearModel()
             m_textureList[i] = nullptr;
         }
     }
+    m_textureList.clear();
+
+    m_fileName.clear();
+    m_nodes.clear();
+    m_instanceBuffer.clearInstanceBuffer();
+    m_textureArray.clearTextureArray();
+    m_materialToTextureLayer.clear();
+
+    m_pendingMeshes.clear();
+    m_nextPendingMesh = 0;
+    m_nextPendingTexture = 0;
+    m_textureWithAlpha.clear();
+    m_textureArrayPending = false;
+    m_vertexArraysPending = false;
+
+    m_boundsMin = glm::vec3(FLT_MAX);
+    m_boundsMax = glm::vec3(-FLT_MAX);
+    m_boundingCenter = glm::vec3(0.0f);
+    m_boundingRadius = 0.0f;
 }
 
 Model::~Model()
 {
+    clearModel();
 }
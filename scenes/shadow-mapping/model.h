@@ -31,26 +31,207 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "cluster-culler.h"
+#include "job-system.h"
+#include "level-of-detail.h"
 #include "mesh.h"
 #include "texture.h"
+#include "texture-array.h"
+
+// Time spent in each phase of loading a model
+struct ModelLoadTimes
+{
+    double importMilliseconds = 0.0;
+    double conversionMilliseconds = 0.0;
+    double textureMilliseconds = 0.0;
+    double uploadMilliseconds = 0.0;
+};
+
+// Node of the hierarchy of an imported model, with the
+// transform relative to its parent and the meshes it holds
+struct ModelNode
+{
+    static const unsigned int NO_PARENT = 0xFFFFFFFF;
+
+    std::string name;
+    unsigned int parent;
+    glm::mat4 transform;
+    std::vector<unsigned int> meshes;
+};
 
 class Model
 {
 public:
     Model();
 
-    bool loadModel(const std::string& fileName);
-    void renderModel();
+    // Loads on the workers of the job system, the model
+    // is loaded on the calling thread alone without one
+    void setJobSystem(JobSystem *jobSystem);
+
+    // Meshes uploaded by the GL thread take their
+    // buffers from the pool, when one is given
+    void setGeometryPool(GeometryPool *geometryPool);
+
+    // When packTextures is set, all the material textures
+    // are packed into a single texture array so that the
+    // whole model renders without texture rebinds
+    // A levelOfDetailCount above 1 generates simplified
+    // versions of every mesh for drawing the model far away
+    bool loadModel(
+        const std::string& fileName,
+        bool packTextures = false,
+        unsigned int levelOfDetailCount = 1);
+
+    // The two halves of loadModel. Importing reads, converts
+    // and decodes everything without GL calls and is safe on
+    // any thread. Each upload step then sends a bounded part of
+    // a mesh, a texture or a texture array layer to GL and returns
+    // false once nothing is left. Steps run on a shared context
+    // leave out the vertex arrays, created by createVertexArrays()
+    // on the drawing context, which also moves the meshes into
+    // the geometry pool.
+    bool importModel(
+        const std::string& fileName,
+        bool packTextures = false,
+        unsigned int levelOfDetailCount = 1);
+    bool uploadModelStep(bool sharedContext = false);
+    void createVertexArrays();
+    bool isModelResident();
+    const ModelLoadTimes& getLoadTimes();
+
+    void renderModel(unsigned int level = 0);
+
+    // Draws the full detail meshes leaving out the clusters
+    // rejected by the culler for the given model matrix, with
+    // the lists of the draw calls kept in the scratch arena
+    void renderVisibleClusters(
+        ClusterCuller &culler,
+        const glm::mat4 &modelMatrix,
+        LinearArena &scratchArena);
+    void renderInstanced(
+        const glm::mat4 *modelMatrices,
+        GLsizei instanceCount,
+        unsigned int level = 0);
+
+    // Draws the instances of every level from a single upload,
+    // the matrices are sorted by level and levelInstanceCounts
+    // holds how many of them each of the levelCount levels has
+    void renderInstancedLevels(
+        const glm::mat4 *modelMatrices,
+        const GLsizei *levelInstanceCounts,
+        unsigned int levelCount);
+
+    // Number of levels of the most detailed mesh, meshes
+    // with fewer levels draw their coarsest one beyond it
+    unsigned int getLevelOfDetailCount();
+
+    // Model space bounding box of all the meshes
+    const glm::vec3& getBoundsMin();
+    const glm::vec3& getBoundsMax();
+    GLfloat getBoundingRadius();
+
+    // Level to draw the model with for the given model matrix,
+    // based on the level it was drawn with the previous frame
+    unsigned int selectLevelOfDetail(
+        LevelOfDetailSelector &selector,
+        const glm::mat4 &modelMatrix,
+        unsigned int currentLevel);
     void clearModel();
 
+    // Nodes are stored parents first, node 0 being the root.
+    // The node transforms are baked into the vertices of
+    // their meshes, which are all in the space of the model.
+    size_t getNodeCount() const;
+    const ModelNode& getNode(size_t nodeIndex) const;
+
+    size_t getMeshCount();
+    Mesh* getMesh(size_t meshIndex);
+    Texture* getMeshTexture(size_t meshIndex);
+    TextureArray* getTextureArray();
+    GLuint getMeshTextureLayer(size_t meshIndex);
+
     ~Model();
 
 private:
-    void loadNode(aiNode *node, const aiScene *scene);
-    void loadMesh(aiMesh *mesh, const aiScene *scene);
-    void loadMaterials(const aiScene *scene);
+    // Owns its meshes and textures, a copy would delete them twice
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    // Geometry of a mesh ready for upload, with the
+    // index lists of all its levels back to back
+    struct ConvertedMesh
+    {
+        std::vector<GLfloat> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<GLsizei> levelIndexCounts;
+        std::vector<MeshCluster> clusters;
+        glm::vec3 boundsMin, boundsMax;
+        unsigned int materialIndex;
+    };
+
+    void loadNode(
+        const aiNode *node,
+        const aiScene *scene,
+        unsigned int parent,
+        const glm::mat4 &parentTransform,
+        std::vector<const aiMesh*> &meshes,
+        std::vector<glm::mat4> &meshTransforms);
+
+    // Converting makes no GL calls and runs on the
+    // workers, uploading is left to the GL thread
+    void convertMesh(const aiMesh *mesh, const glm::mat4 &transform, ConvertedMesh &converted);
+    // Returns true once the whole mesh has been uploaded
+    bool uploadMeshStep(ConvertedMesh &converted, bool sharedContext);
+    bool hasPendingUploads();
+    void computeBoundingSphere();
+    void decodeMaterials(const aiScene *scene);
+    Texture* loadPlainTexture();
+    void decodePackedMaterials(const aiScene *scene);
+    void useMeshTexture(size_t meshIndex);
+
+    // The GL objects of the model are
+    // recorded under its file name
+    std::string m_fileName;
 
+    std::vector<ModelNode> m_nodes;
     std::vector<Mesh*> m_meshList;
     std::vector<Texture*> m_textureList;
     std::vector<unsigned int> m_meshToTexture;
+    unsigned int m_levelOfDetailCount;
+    JobSystem *m_jobSystem;
+    GeometryPool *m_geometryPool;
+
+    // Model space bounds of all meshes, kept
+    // up to date while the meshes are loaded
+    glm::vec3 m_boundsMin, m_boundsMax;
+    glm::vec3 m_boundingCenter;
+    GLfloat m_boundingRadius;
+
+    // Imported but not uploaded yet
+    std::vector<ConvertedMesh> m_pendingMeshes;
+    size_t m_nextPendingMesh;
+
+    // Mesh being written over several steps,
+    // and how much of it has been written
+    Mesh *m_uploadingMesh;
+    GLuint m_uploadedVertices, m_uploadedIndices;
+
+    size_t m_nextPendingTexture;
+    std::vector<unsigned char> m_textureWithAlpha;
+    bool m_textureArrayPending;
+    bool m_vertexArraysPending;
+    ModelLoadTimes m_loadTimes;
+
+    // Used instead of the texture list
+    // when the textures are packed
+    bool m_packTextures;
+    TextureArray m_textureArray;
+    std::vector<GLuint> m_materialToTextureLayer;
+
+    // Shared by all meshes so the instance
+    // matrices are uploaded once per draw
+    InstanceBuffer m_instanceBuffer;
+
+    // Scratch visibility of the clusters of a mesh
+    std::vector<unsigned char> m_clusterVisibility;
 };
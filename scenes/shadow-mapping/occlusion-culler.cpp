@@ -0,0 +1,565 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OCCLUSION_CULLER_X86
+#include <immintrin.h>
+#if defined(__SSE2__)
+#define OCCLUSION_CULLER_SSE
+#endif
+#endif
+
+#include "occlusion-culler.h"
+#include "matrix-batch.h"
+
+// Depth of an empty pixel, the far plane
+static const GLfloat CLEAR_DEPTH = 1.0f;
+
+// Edge functions and depth plane of a triangle in pixel
+// coordinates, all of them linear in x and y: a * x + b * y + c
+struct TriangleSetup
+{
+    GLfloat edgeA[3], edgeB[3], edgeC[3];
+    GLfloat depthA, depthB, depthC;
+    int minX, maxX, minY, maxY;
+};
+
+#if !defined(OCCLUSION_CULLER_SSE)
+static void RasterizeTriangleScalar(
+    const TriangleSetup &setup,
+    GLfloat *depthBuffer,
+    unsigned int width)
+{
+    for (int y = setup.minY; y <= setup.maxY; ++y)
+    {
+        GLfloat *row = depthBuffer + y * width;
+        GLfloat pixelY = y + 0.5f;
+
+        for (int x = setup.minX; x <= setup.maxX; ++x)
+        {
+            GLfloat pixelX = x + 0.5f;
+
+            bool inside = true;
+            for (int edge = 0; edge < 3; ++edge)
+            {
+                if (setup.edgeA[edge] * pixelX + setup.edgeB[edge] * pixelY + setup.edgeC[edge] < 0.0f)
+                {
+                    inside = false;
+                }
+            }
+
+            GLfloat depth = setup.depthA * pixelX + setup.depthB * pixelY + setup.depthC;
+            if (inside && depth < row[x])
+            {
+                row[x] = depth;
+            }
+        }
+    }
+}
+
+#endif
+
+#if defined(OCCLUSION_CULLER_SSE)
+// 4 pixels of a row per iteration, the rows are
+// padded to a multiple of 8 so no pixel is out of bounds
+static void RasterizeTriangleSSE(
+    const TriangleSetup &setup,
+    GLfloat *depthBuffer,
+    unsigned int width)
+{
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    int startX = setup.minX & ~3;
+
+    for (int y = setup.minY; y <= setup.maxY; ++y)
+    {
+        GLfloat *row = depthBuffer + y * width;
+        GLfloat pixelY = y + 0.5f;
+
+        __m128 rowEdge0 = _mm_set1_ps(setup.edgeB[0] * pixelY + setup.edgeC[0]);
+        __m128 rowEdge1 = _mm_set1_ps(setup.edgeB[1] * pixelY + setup.edgeC[1]);
+        __m128 rowEdge2 = _mm_set1_ps(setup.edgeB[2] * pixelY + setup.edgeC[2]);
+        __m128 rowDepth = _mm_set1_ps(setup.depthB * pixelY + setup.depthC);
+
+        for (int x = startX; x <= setup.maxX; x += 4)
+        {
+            __m128 pixelX = _mm_add_ps(_mm_set1_ps((GLfloat)x), laneOffsets);
+
+            __m128 edge0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(setup.edgeA[0]), pixelX), rowEdge0);
+            __m128 edge1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(setup.edgeA[1]), pixelX), rowEdge1);
+            __m128 edge2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(setup.edgeA[2]), pixelX), rowEdge2);
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(edge0, zero),
+                _mm_and_ps(_mm_cmpge_ps(edge1, zero), _mm_cmpge_ps(edge2, zero)));
+
+            __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(setup.depthA), pixelX), rowDepth);
+            __m128 current = _mm_loadu_ps(row + x);
+            __m128 write = _mm_and_ps(inside, _mm_cmplt_ps(depth, current));
+
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(write, depth), _mm_andnot_ps(write, current)));
+        }
+    }
+}
+#endif
+
+#if defined(OCCLUSION_CULLER_X86)
+// Same as the SSE version with 8 pixels per iteration, compiled
+// for AVX2 and FMA regardless of the build flags and only called when
+// the CPU reports support for it
+__attribute__((target("avx2,fma")))
+static void RasterizeTriangleAVX2(
+    const TriangleSetup &setup,
+    GLfloat *depthBuffer,
+    unsigned int width)
+{
+    const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    int startX = setup.minX & ~7;
+
+    for (int y = setup.minY; y <= setup.maxY; ++y)
+    {
+        GLfloat *row = depthBuffer + y * width;
+        GLfloat pixelY = y + 0.5f;
+
+        __m256 rowEdge0 = _mm256_set1_ps(setup.edgeB[0] * pixelY + setup.edgeC[0]);
+        __m256 rowEdge1 = _mm256_set1_ps(setup.edgeB[1] * pixelY + setup.edgeC[1]);
+        __m256 rowEdge2 = _mm256_set1_ps(setup.edgeB[2] * pixelY + setup.edgeC[2]);
+        __m256 rowDepth = _mm256_set1_ps(setup.depthB * pixelY + setup.depthC);
+
+        for (int x = startX; x <= setup.maxX; x += 8)
+        {
+            __m256 pixelX = _mm256_add_ps(_mm256_set1_ps((GLfloat)x), laneOffsets);
+
+            __m256 edge0 = _mm256_fmadd_ps(_mm256_set1_ps(setup.edgeA[0]), pixelX, rowEdge0);
+            __m256 edge1 = _mm256_fmadd_ps(_mm256_set1_ps(setup.edgeA[1]), pixelX, rowEdge1);
+            __m256 edge2 = _mm256_fmadd_ps(_mm256_set1_ps(setup.edgeA[2]), pixelX, rowEdge2);
+            __m256 inside = _mm256_and_ps(_mm256_cmp_ps(edge0, zero, _CMP_GE_OQ),
+                _mm256_and_ps(_mm256_cmp_ps(edge1, zero, _CMP_GE_OQ), _mm256_cmp_ps(edge2, zero, _CMP_GE_OQ)));
+
+            __m256 depth = _mm256_fmadd_ps(_mm256_set1_ps(setup.depthA), pixelX, rowDepth);
+            __m256 current = _mm256_loadu_ps(row + x);
+            __m256 write = _mm256_and_ps(inside, _mm256_cmp_ps(depth, current, _CMP_LT_OQ));
+
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, depth, write));
+        }
+    }
+}
+#endif
+
+OcclusionCuller::OcclusionCuller() :
+    m_width(0),
+    m_height(0),
+    m_projectionView(1.0f),
+    m_useAVX2(false),
+    m_testedBoxes(0),
+    m_culledBoxes(0)
+{
+}
+
+void OcclusionCuller::createOcclusionCuller(unsigned int width, unsigned int height)
+{
+    m_width = (width + 7) & ~7u;
+    m_height = height ? height : 1;
+    m_depthBuffer.assign(m_width * m_height, CLEAR_DEPTH);
+
+    // Each level halves the previous one, rounding up,
+    // down to a single texel covering the whole screen
+    m_pyramid.clear();
+    unsigned int levelWidth = m_width, levelHeight = m_height;
+    while (true)
+    {
+        PyramidLevel level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.minimumDepth.assign(levelWidth * levelHeight, CLEAR_DEPTH);
+        level.maximumDepth.assign(levelWidth * levelHeight, CLEAR_DEPTH);
+        m_pyramid.push_back(level);
+
+        if (levelWidth == 1 && levelHeight == 1)
+        {
+            break;
+        }
+
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+
+#if defined(OCCLUSION_CULLER_X86)
+    m_useAVX2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+unsigned int OcclusionCuller::addOccluder(
+    const GLfloat *vertices,
+    unsigned int vertexCount,
+    unsigned int vertexStride,
+    const unsigned int *indices,
+    unsigned int indexCount)
+{
+    Occluder occluder;
+    occluder.modelMatrix = glm::mat4(1.0f);
+    occluder.indices.assign(indices, indices + indexCount);
+
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        const GLfloat *position = vertices + i * vertexStride;
+        occluder.positions.push_back(glm::vec4(position[0], position[1], position[2], 1.0f));
+    }
+
+    m_occluders.push_back(occluder);
+    return m_occluders.size() - 1;
+}
+
+void OcclusionCuller::setOccluderTransform(unsigned int occluder, const glm::mat4 &modelMatrix)
+{
+    m_occluders[occluder].modelMatrix = modelMatrix;
+}
+
+void OcclusionCuller::renderOccluders(const glm::mat4 &projectionView)
+{
+    m_projectionView = projectionView;
+    std::fill(m_depthBuffer.begin(), m_depthBuffer.end(), CLEAR_DEPTH);
+
+    for (size_t i = 0; i < m_occluders.size(); ++i)
+    {
+        const Occluder &occluder = m_occluders[i];
+        glm::mat4 transform = projectionView * occluder.modelMatrix;
+
+        m_clipPositions.resize(occluder.positions.size());
+        for (size_t vertex = 0; vertex < occluder.positions.size(); ++vertex)
+        {
+            m_clipPositions[vertex] = transform * occluder.positions[vertex];
+        }
+
+        for (size_t index = 0; index + 2 < occluder.indices.size(); index += 3)
+        {
+            glm::vec4 triangle[3] = {
+                m_clipPositions[occluder.indices[index]],
+                m_clipPositions[occluder.indices[index + 1]],
+                m_clipPositions[occluder.indices[index + 2]]
+            };
+            rasterizeClippedTriangle(triangle);
+        }
+    }
+
+    buildDepthPyramid();
+}
+
+void OcclusionCuller::rasterizeClippedTriangle(const glm::vec4 *clipPositions)
+{
+    // Clip against the near plane (z >= -w), which leaves up to
+    // four corners, so that the divide by w is always safe
+    glm::vec4 polygon[4];
+    unsigned int cornerCount = 0;
+
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        const glm::vec4 &current = clipPositions[i];
+        const glm::vec4 &next = clipPositions[(i + 1) % 3];
+        GLfloat currentDistance = current.z + current.w;
+        GLfloat nextDistance = next.z + next.w;
+
+        if (currentDistance >= 0.0f)
+        {
+            polygon[cornerCount++] = current;
+        }
+
+        if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+        {
+            GLfloat t = currentDistance / (currentDistance - nextDistance);
+            polygon[cornerCount++] = current + (next - current) * t;
+        }
+    }
+
+    if (cornerCount < 3)
+    {
+        return;
+    }
+
+    glm::vec3 screenPositions[4];
+    for (unsigned int i = 0; i < cornerCount; ++i)
+    {
+        // A corner exactly on the near plane of a
+        // perspective projection still has w > 0
+        GLfloat w = polygon[i].w > 1e-6f ? polygon[i].w : 1e-6f;
+        screenPositions[i] = glm::vec3(
+            (polygon[i].x / w * 0.5f + 0.5f) * m_width,
+            (polygon[i].y / w * 0.5f + 0.5f) * m_height,
+            polygon[i].z / w * 0.5f + 0.5f);
+    }
+
+    rasterizeTriangle(screenPositions);
+    if (cornerCount == 4)
+    {
+        glm::vec3 secondTriangle[3] = { screenPositions[0], screenPositions[2], screenPositions[3] };
+        rasterizeTriangle(secondTriangle);
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const glm::vec3 *screenPositions)
+{
+    glm::vec3 v0 = screenPositions[0];
+    glm::vec3 v1 = screenPositions[1];
+    glm::vec3 v2 = screenPositions[2];
+
+    // Occluders are double sided, so flip clockwise
+    // triangles to keep the inside of every edge positive
+    GLfloat area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (fabsf(area) < 1e-8f)
+    {
+        return;
+    }
+    if (area < 0.0f)
+    {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    TriangleSetup setup;
+    setup.minX = std::max(0, (int)floorf(std::min(v0.x, std::min(v1.x, v2.x))));
+    setup.maxX = std::min((int)m_width - 1, (int)ceilf(std::max(v0.x, std::max(v1.x, v2.x))));
+    setup.minY = std::max(0, (int)floorf(std::min(v0.y, std::min(v1.y, v2.y))));
+    setup.maxY = std::min((int)m_height - 1, (int)ceilf(std::max(v0.y, std::max(v1.y, v2.y))));
+    if (setup.minX > setup.maxX || setup.minY > setup.maxY)
+    {
+        return;
+    }
+
+    // Edge i runs from corner i to corner i + 1 and is
+    // positive on the side of the remaining corner
+    const glm::vec3 *corners[3] = { &v0, &v1, &v2 };
+    for (int edge = 0; edge < 3; ++edge)
+    {
+        const glm::vec3 &a = *corners[edge];
+        const glm::vec3 &b = *corners[(edge + 1) % 3];
+        setup.edgeA[edge] = -(b.y - a.y);
+        setup.edgeB[edge] = b.x - a.x;
+        setup.edgeC[edge] = (b.y - a.y) * a.x - (b.x - a.x) * a.y;
+    }
+
+    // The weight of a corner is the edge opposite to it over the
+    // area, which makes the interpolated depth linear in x and y
+    setup.depthA = (setup.edgeA[1] * v0.z + setup.edgeA[2] * v1.z + setup.edgeA[0] * v2.z) / area;
+    setup.depthB = (setup.edgeB[1] * v0.z + setup.edgeB[2] * v1.z + setup.edgeB[0] * v2.z) / area;
+    setup.depthC = (setup.edgeC[1] * v0.z + setup.edgeC[2] * v1.z + setup.edgeC[0] * v2.z) / area;
+
+#if defined(OCCLUSION_CULLER_X86)
+    if (m_useAVX2)
+    {
+        RasterizeTriangleAVX2(setup, &m_depthBuffer[0], m_width);
+        return;
+    }
+#endif
+
+#if defined(OCCLUSION_CULLER_SSE)
+    RasterizeTriangleSSE(setup, &m_depthBuffer[0], m_width);
+#else
+    RasterizeTriangleScalar(setup, &m_depthBuffer[0], m_width);
+#endif
+}
+
+void OcclusionCuller::buildDepthPyramid()
+{
+    PyramidLevel &base = m_pyramid[0];
+    base.minimumDepth = m_depthBuffer;
+    base.maximumDepth = m_depthBuffer;
+
+    for (size_t level = 1; level < m_pyramid.size(); ++level)
+    {
+        const PyramidLevel &source = m_pyramid[level - 1];
+        PyramidLevel &target = m_pyramid[level];
+
+        for (unsigned int y = 0; y < target.height; ++y)
+        {
+            unsigned int y0 = y * 2;
+            unsigned int y1 = std::min(y0 + 1, source.height - 1);
+
+            for (unsigned int x = 0; x < target.width; ++x)
+            {
+                unsigned int x0 = x * 2;
+                unsigned int x1 = std::min(x0 + 1, source.width - 1);
+
+                unsigned int texels[4] = {
+                    y0 * source.width + x0, y0 * source.width + x1,
+                    y1 * source.width + x0, y1 * source.width + x1
+                };
+
+                GLfloat minimumDepth = source.minimumDepth[texels[0]];
+                GLfloat maximumDepth = source.maximumDepth[texels[0]];
+                for (int i = 1; i < 4; ++i)
+                {
+                    minimumDepth = std::min(minimumDepth, source.minimumDepth[texels[i]]);
+                    maximumDepth = std::max(maximumDepth, source.maximumDepth[texels[i]]);
+                }
+
+                target.minimumDepth[y * target.width + x] = minimumDepth;
+                target.maximumDepth[y * target.width + x] = maximumDepth;
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isBoxVisible(
+    const glm::vec3 &boundsMin,
+    const glm::vec3 &boundsMax,
+    const glm::mat4 &modelMatrix)
+{
+    if (m_pyramid.empty())
+    {
+        return true;
+    }
+
+    return isClipBoxVisible(boundsMin, boundsMax, m_projectionView * modelMatrix);
+}
+
+void OcclusionCuller::areBoxesVisible(
+    const glm::vec3 &boundsMin,
+    const glm::vec3 &boundsMax,
+    const glm::mat4 *modelMatrices,
+    size_t count,
+    unsigned char *visibility)
+{
+    if (m_pyramid.empty())
+    {
+        return;
+    }
+
+    m_boxTransforms.resize(count);
+    MultiplyMatrices(m_projectionView, modelMatrices, m_boxTransforms.data(), count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (visibility[i])
+        {
+            visibility[i] = isClipBoxVisible(boundsMin, boundsMax, m_boxTransforms[i]);
+        }
+    }
+}
+
+bool OcclusionCuller::isClipBoxVisible(
+    const glm::vec3 &boundsMin,
+    const glm::vec3 &boundsMax,
+    const glm::mat4 &transform)
+{
+    ++m_testedBoxes;
+
+    GLfloat screenMinX = 1e30f, screenMaxX = -1e30f;
+    GLfloat screenMinY = 1e30f, screenMaxY = -1e30f;
+    GLfloat nearestDepth = 1e30f;
+
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec4 position(
+            (corner & 1) ? boundsMax.x : boundsMin.x,
+            (corner & 2) ? boundsMax.y : boundsMin.y,
+            (corner & 4) ? boundsMax.z : boundsMin.z,
+            1.0f);
+        glm::vec4 clipPosition = transform * position;
+
+        // Boxes crossing the near plane are too close to cull
+        if (clipPosition.w <= 1e-6f || clipPosition.z < -clipPosition.w)
+        {
+            return true;
+        }
+
+        GLfloat x = (clipPosition.x / clipPosition.w * 0.5f + 0.5f) * m_width;
+        GLfloat y = (clipPosition.y / clipPosition.w * 0.5f + 0.5f) * m_height;
+        screenMinX = std::min(screenMinX, x);
+        screenMaxX = std::max(screenMaxX, x);
+        screenMinY = std::min(screenMinY, y);
+        screenMaxY = std::max(screenMaxY, y);
+        nearestDepth = std::min(nearestDepth, clipPosition.z / clipPosition.w * 0.5f + 0.5f);
+    }
+
+    // In front of every occluder on screen
+    if (nearestDepth <= m_pyramid.back().minimumDepth[0])
+    {
+        return true;
+    }
+
+    // Off screen boxes are left to frustum culling
+    if (screenMaxX < 0.0f || screenMaxY < 0.0f || screenMinX >= m_width || screenMinY >= m_height)
+    {
+        return true;
+    }
+
+    int minX = std::max(0, (int)floorf(screenMinX));
+    int maxX = std::min((int)m_width - 1, (int)floorf(screenMaxX));
+    int minY = std::max(0, (int)floorf(screenMinY));
+    int maxY = std::min((int)m_height - 1, (int)floorf(screenMaxY));
+
+    // Pick the level where the box spans about two texels
+    // per axis, so only a handful of them need reading
+    unsigned int level = 0;
+    int size = std::max(maxX - minX, maxY - minY) + 1;
+    while ((size >> level) > 2 && level + 1 < m_pyramid.size())
+    {
+        ++level;
+    }
+
+    const PyramidLevel &pyramidLevel = m_pyramid[level];
+    for (int y = minY >> level; y <= (maxY >> level); ++y)
+    {
+        for (int x = minX >> level; x <= (maxX >> level); ++x)
+        {
+            // Some pixel under the box has no occluder in front
+            if (nearestDepth <= pyramidLevel.maximumDepth[y * pyramidLevel.width + x])
+            {
+                return true;
+            }
+        }
+    }
+
+    ++m_culledBoxes;
+    return false;
+}
+
+void OcclusionCuller::getStatistics(size_t &testedBoxes, size_t &culledBoxes)
+{
+    testedBoxes = m_testedBoxes;
+    culledBoxes = m_culledBoxes;
+}
+
+void OcclusionCuller::resetStatistics()
+{
+    m_testedBoxes = 0;
+    m_culledBoxes = 0;
+}
+
+void OcclusionCuller::clearOcclusionCuller()
+{
+    m_depthBuffer.clear();
+    m_pyramid.clear();
+    m_occluders.clear();
+    m_clipPositions.clear();
+    m_boxTransforms.clear();
+    m_width = 0;
+    m_height = 0;
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+}
@@ -0,0 +1,122 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+// Culls objects hidden behind a few large occluders without any
+// help from the GPU. The occluder triangles are rasterized into a
+// small depth buffer on the CPU, a few pixels at a time with SSE
+// or AVX2 when available, and a pyramid of the minimum and maximum
+// depth of every block of pixels is built from it. An object is
+// culled when its bounding box lies behind the farthest occluder
+// depth over the whole screen area the box covers.
+class OcclusionCuller
+{
+public:
+    OcclusionCuller();
+
+    // The width is rounded up to a multiple of 8 pixels
+    void createOcclusionCuller(unsigned int width, unsigned int height);
+
+    // Keeps a copy of the positions of a mesh, which are expected
+    // in the first three floats of every vertex, vertexStride in floats.
+    // Returns the id used to place the occluder in the scene.
+    unsigned int addOccluder(
+        const GLfloat *vertices,
+        unsigned int vertexCount,
+        unsigned int vertexStride,
+        const unsigned int *indices,
+        unsigned int indexCount);
+
+    void setOccluderTransform(unsigned int occluder, const glm::mat4 &modelMatrix);
+
+    // Rasterizes all occluders for the view and
+    // rebuilds the depth pyramid, once per frame
+    void renderOccluders(const glm::mat4 &projectionView);
+
+    // False when the model space box is hidden by the occluders
+    bool isBoxVisible(
+        const glm::vec3 &boundsMin,
+        const glm::vec3 &boundsMax,
+        const glm::mat4 &modelMatrix);
+
+    // Tests the same model space box under many model matrices,
+    // the boxes whose visibility is already 0 are skipped and
+    // the others get 0 written when they are hidden
+    void areBoxesVisible(
+        const glm::vec3 &boundsMin,
+        const glm::vec3 &boundsMax,
+        const glm::mat4 *modelMatrices,
+        size_t count,
+        unsigned char *visibility);
+
+    // Boxes tested and hidden since the last reset
+    void getStatistics(size_t &testedBoxes, size_t &culledBoxes);
+    void resetStatistics();
+
+    void clearOcclusionCuller();
+
+    ~OcclusionCuller();
+
+private:
+    struct Occluder
+    {
+        std::vector<glm::vec4> positions;
+        std::vector<unsigned int> indices;
+        glm::mat4 modelMatrix;
+    };
+
+    struct PyramidLevel
+    {
+        unsigned int width, height;
+        std::vector<GLfloat> minimumDepth;
+        std::vector<GLfloat> maximumDepth;
+    };
+
+    void rasterizeClippedTriangle(const glm::vec4 *clipPositions);
+    void rasterizeTriangle(const glm::vec3 *screenPositions);
+    void buildDepthPyramid();
+    bool isClipBoxVisible(
+        const glm::vec3 &boundsMin,
+        const glm::vec3 &boundsMax,
+        const glm::mat4 &transform);
+
+    unsigned int m_width, m_height;
+    std::vector<GLfloat> m_depthBuffer;
+    std::vector<PyramidLevel> m_pyramid;
+    std::vector<Occluder> m_occluders;
+    std::vector<glm::vec4> m_clipPositions;
+
+    glm::mat4 m_projectionView;
+    std::vector<glm::mat4> m_boxTransforms;
+    bool m_useAVX2;
+
+    size_t m_testedBoxes, m_culledBoxes;
+};
@@ -0,0 +1,224 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "occlusion-queries.h"
+
+// The queries of the previous frame are rendered against while
+// the ones of the current frame are being issued
+static const unsigned int QUERY_FRAME_COUNT = 2;
+
+// Boxes the camera is closer than this to are clipped by the near
+// plane and could pass no samples, so they are always drawn
+static const GLfloat NEAR_PLANE_MARGIN = 0.2f;
+
+OcclusionQueries::OcclusionQueries() :
+    m_objectCount(0),
+    m_frame(0),
+    m_uniformModelLocation(-1),
+    m_cameraPosition(0.0f),
+    m_queriedObjects(0),
+    m_hiddenObjects(0)
+{
+}
+
+void OcclusionQueries::createOcclusionQueries(unsigned int objectCount)
+{
+    clearOcclusionQueries();
+
+    m_objectCount = objectCount;
+    m_queryIDs.resize(objectCount * QUERY_FRAME_COUNT);
+    m_queryIssued.assign(objectCount * QUERY_FRAME_COUNT, false);
+    m_conditionalRenderActive.assign(objectCount, false);
+    glGenQueries(m_queryIDs.size(), &m_queryIDs[0]);
+
+    // Corners of the unit cube, only the positions are used
+    GLfloat vertices[8 * 8];
+    for (unsigned int corner = 0; corner < 8; ++corner)
+    {
+        GLfloat *vertex = vertices + corner * 8;
+        vertex[0] = (corner & 1) ? 1.0f : 0.0f;
+        vertex[1] = (corner & 2) ? 1.0f : 0.0f;
+        vertex[2] = (corner & 4) ? 1.0f : 0.0f;
+        for (unsigned int i = 3; i < 8; ++i)
+        {
+            vertex[i] = 0.0f;
+        }
+    }
+
+    unsigned int indices[] = {
+        0, 2, 1,    1, 2, 3,
+        4, 5, 6,    5, 7, 6,
+        0, 1, 4,    1, 5, 4,
+        2, 6, 3,    3, 6, 7,
+        0, 4, 2,    2, 4, 6,
+        1, 3, 5,    3, 7, 5
+    };
+
+    m_boxMesh.createMesh(vertices, indices, 64, 36);
+}
+
+void OcclusionQueries::beginQueries(GLint uniformModelLocation, const glm::vec3 &cameraPosition)
+{
+    ++m_frame;
+    m_uniformModelLocation = uniformModelLocation;
+    m_cameraPosition = cameraPosition;
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+}
+
+void OcclusionQueries::queryBoundingBox(
+    unsigned int object,
+    const glm::vec3 &boundsMin,
+    const glm::vec3 &boundsMax,
+    const glm::mat4 &modelMatrix)
+{
+    unsigned int slot = (m_frame % QUERY_FRAME_COUNT) * m_objectCount + object;
+
+    // Leave the object to be drawn unconditionally
+    // next frame when the camera is inside its box
+    glm::vec3 camera = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(m_cameraPosition, 1.0f));
+    glm::vec3 margin(NEAR_PLANE_MARGIN / glm::length(glm::vec3(modelMatrix[0])));
+    if (camera.x > boundsMin.x - margin.x && camera.x < boundsMax.x + margin.x &&
+        camera.y > boundsMin.y - margin.y && camera.y < boundsMax.y + margin.y &&
+        camera.z > boundsMin.z - margin.z && camera.z < boundsMax.z + margin.z)
+    {
+        m_queryIssued[slot] = false;
+        return;
+    }
+
+    glm::mat4 boxMatrix = glm::translate(modelMatrix, boundsMin);
+    boxMatrix = glm::scale(boxMatrix, boundsMax - boundsMin);
+    glUniformMatrix4fv(m_uniformModelLocation, 1, GL_FALSE, glm::value_ptr(boxMatrix));
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, m_queryIDs[slot]);
+        m_boxMesh.renderMesh();
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+    m_queryIssued[slot] = true;
+}
+
+void OcclusionQueries::endQueries()
+{
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+}
+
+void OcclusionQueries::beginConditionalRender(unsigned int object)
+{
+    // The queries issued at the end of the previous frame
+    unsigned int slot = (m_frame % QUERY_FRAME_COUNT) * m_objectCount + object;
+    if (!m_queryIssued[slot])
+    {
+        return;
+    }
+
+    ++m_queriedObjects;
+    if (isQueryHidden(slot))
+    {
+        ++m_hiddenObjects;
+    }
+
+    // Draws anyway if the result is not ready yet
+    glBeginConditionalRender(m_queryIDs[slot], GL_QUERY_NO_WAIT);
+    m_conditionalRenderActive[object] = true;
+}
+
+void OcclusionQueries::endConditionalRender(unsigned int object)
+{
+    if (m_conditionalRenderActive[object])
+    {
+        glEndConditionalRender();
+        m_conditionalRenderActive[object] = false;
+    }
+}
+
+bool OcclusionQueries::isObjectHidden(unsigned int object)
+{
+    unsigned int slot = (m_frame % QUERY_FRAME_COUNT) * m_objectCount + object;
+    if (!m_queryIssued[slot])
+    {
+        return false;
+    }
+
+    ++m_queriedObjects;
+    if (!isQueryHidden(slot))
+    {
+        return false;
+    }
+
+    ++m_hiddenObjects;
+    return true;
+}
+
+bool OcclusionQueries::isQueryHidden(unsigned int slot)
+{
+    // The statistics and the indirect draws
+    // must never make the CPU wait for the GPU
+    GLuint resultAvailable = GL_FALSE;
+    glGetQueryObjectuiv(m_queryIDs[slot], GL_QUERY_RESULT_AVAILABLE, &resultAvailable);
+    if (!resultAvailable)
+    {
+        return false;
+    }
+
+    GLuint samplesPassed = 0;
+    glGetQueryObjectuiv(m_queryIDs[slot], GL_QUERY_RESULT, &samplesPassed);
+    return !samplesPassed;
+}
+
+void OcclusionQueries::getStatistics(size_t &queriedObjects, size_t &hiddenObjects)
+{
+    queriedObjects = m_queriedObjects;
+    hiddenObjects = m_hiddenObjects;
+}
+
+void OcclusionQueries::resetStatistics()
+{
+    m_queriedObjects = 0;
+    m_hiddenObjects = 0;
+}
+
+void OcclusionQueries::clearOcclusionQueries()
+{
+    if (!m_queryIDs.empty())
+    {
+        glDeleteQueries(m_queryIDs.size(), &m_queryIDs[0]);
+        m_queryIDs.clear();
+    }
+
+    m_queryIssued.clear();
+    m_conditionalRenderActive.clear();
+    m_objectCount = 0;
+    m_frame = 0;
+    m_boxMesh.clearMesh();
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+    clearOcclusionQueries();
+}
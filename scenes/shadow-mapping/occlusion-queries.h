@@ -0,0 +1,103 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+
+// Skips the draws of objects hidden by the rest of the scene on the
+// GPU. Every frame the bounding box of each object is drawn without
+// writing color or depth inside an occlusion query, and the next
+// frame draws the object itself under conditional rendering on that
+// query. As the queries are a frame old they have usually finished,
+// so the GPU never waits on them and the CPU only ever reads the
+// results that are already there.
+class OcclusionQueries
+{
+public:
+    OcclusionQueries();
+
+    // One query per object and frame in flight
+    void createOcclusionQueries(unsigned int objectCount);
+
+    // Disables color and depth writes for the bounding boxes, the
+    // shader used is expected to transform position 0 by its model
+    // uniform, and advances to the queries of the next frame
+    void beginQueries(GLint uniformModelLocation, const glm::vec3 &cameraPosition);
+
+    // Draws the model space box of the object inside its query
+    void queryBoundingBox(
+        unsigned int object,
+        const glm::vec3 &boundsMin,
+        const glm::vec3 &boundsMax,
+        const glm::mat4 &modelMatrix);
+
+    // Restores the color and depth writes
+    void endQueries();
+
+    // Draws issued between these calls are skipped by the GPU when
+    // the last finished query of the object found no samples
+    void beginConditionalRender(unsigned int object);
+    void endConditionalRender(unsigned int object);
+
+    // For draws that cannot be rendered conditionally (e.g. the
+    // commands of a multi draw indirect call), true when the last
+    // finished query of the object found no samples. Never waits,
+    // a result that is not available yet counts as visible.
+    bool isObjectHidden(unsigned int object);
+
+    // Objects queried, and found hidden by the queries whose results
+    // were already available, since the statistics were last reset
+    void getStatistics(size_t &queriedObjects, size_t &hiddenObjects);
+    void resetStatistics();
+
+    void clearOcclusionQueries();
+
+    ~OcclusionQueries();
+
+private:
+    // Peeks at the result only if it is already there
+    bool isQueryHidden(unsigned int slot);
+
+    // Queries of all objects for one frame after the other
+    std::vector<GLuint> m_queryIDs;
+    std::vector<bool> m_queryIssued;
+    std::vector<bool> m_conditionalRenderActive;
+    unsigned int m_objectCount;
+    unsigned int m_frame;
+
+    // Unit cube drawn scaled to the bounding boxes
+    Mesh m_boxMesh;
+
+    GLint m_uniformModelLocation;
+    glm::vec3 m_cameraPosition;
+
+    size_t m_queriedObjects, m_hiddenObjects;
+};
@@ -0,0 +1,213 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "program-binary-cache.h"
+
+// Tags the start of every cache file so that
+// anything else in the directory is ignored
+static const GLuint PROGRAM_BINARY_FILE_MAGIC = 0x4E494250; // "PBIN"
+
+// FNV-1a, good enough to tell shader
+// sources apart without any dependency
+static unsigned long long HashString(
+    const char* string,
+    unsigned long long hash)
+{
+    for (; *string; ++string)
+    {
+        hash ^= (unsigned char)*string;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+ProgramBinaryCache::ProgramBinaryCache() :
+    m_enabled(false)
+{
+}
+
+bool ProgramBinaryCache::isSupported()
+{
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+    {
+        return false;
+    }
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+bool ProgramBinaryCache::createProgramBinaryCache(const char* cacheDirectory)
+{
+    m_enabled = false;
+
+    if (!isSupported())
+    {
+        printf("Warning: ProgramBinaryCache::createProgramBinaryCache(): Program binaries are not supported, shaders will always be compiled\n");
+        return false;
+    }
+
+    // The directory may already exist from a previous launch
+    mkdir(cacheDirectory, 0755);
+
+    struct stat directoryInfo;
+    if (stat(cacheDirectory, &directoryInfo) != 0 || !S_ISDIR(directoryInfo.st_mode))
+    {
+        printf("Error: ProgramBinaryCache::createProgramBinaryCache(): Failed to create the cache directory %s\n", cacheDirectory);
+        return false;
+    }
+
+    m_cacheDirectory = cacheDirectory;
+    if (m_cacheDirectory.back() != '/')
+    {
+        m_cacheDirectory.append("/");
+    }
+
+    // Binaries are only valid for the exact
+    // driver build that produced them
+    const GLubyte* vendor = glGetString(GL_VENDOR);
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+    const GLubyte* version = glGetString(GL_VERSION);
+
+    m_driverIdentity.clear();
+    m_driverIdentity.append(vendor ? (const char*)vendor : "");
+    m_driverIdentity.append("\n");
+    m_driverIdentity.append(renderer ? (const char*)renderer : "");
+    m_driverIdentity.append("\n");
+    m_driverIdentity.append(version ? (const char*)version : "");
+
+    m_enabled = true;
+    return true;
+}
+
+std::string ProgramBinaryCache::computeProgramKey(
+    const char* vertexShaderCode,
+    const char* fragmentShaderCode)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = HashString(m_driverIdentity.c_str(), hash);
+    hash = HashString("\nvertex\n", hash);
+    hash = HashString(vertexShaderCode, hash);
+    hash = HashString("\nfragment\n", hash);
+    hash = HashString(fragmentShaderCode, hash);
+
+    char key[17] = {'\0'};
+    snprintf(key, sizeof(key), "%016llx", hash);
+    return key;
+}
+
+std::string ProgramBinaryCache::getProgramBinaryPath(const std::string &programKey)
+{
+    return m_cacheDirectory + programKey + ".bin";
+}
+
+bool ProgramBinaryCache::loadProgramBinary(
+    GLuint programID,
+    const std::string &programKey)
+{
+    if (!m_enabled)
+    {
+        return false;
+    }
+
+    std::ifstream fileStream(getProgramBinaryPath(programKey).c_str(), std::ios::in | std::ios::binary);
+    if (!fileStream.is_open())
+    {
+        return false;
+    }
+
+    // File layout: magic, binary format, binary length, binary
+    GLuint magic = 0;
+    GLenum binaryFormat = 0;
+    GLint binaryLength = 0;
+    fileStream.read((char*)&magic, sizeof(magic));
+    fileStream.read((char*)&binaryFormat, sizeof(binaryFormat));
+    fileStream.read((char*)&binaryLength, sizeof(binaryLength));
+    if (!fileStream || magic != PROGRAM_BINARY_FILE_MAGIC || binaryLength <= 0)
+    {
+        return false;
+    }
+
+    std::vector<char> binary(binaryLength);
+    fileStream.read(&binary[0], binaryLength);
+    if (!fileStream)
+    {
+        return false;
+    }
+    fileStream.close();
+
+    // The driver is free to reject a binary (e.g. after
+    // an update that kept the same version string), in
+    // which case the program is simply left unlinked. The
+    // link status is left for the caller to query so that
+    // the load does not block with parallel compilation.
+    glProgramBinary(programID, binaryFormat, &binary[0], binaryLength);
+    return true;
+}
+
+void ProgramBinaryCache::saveProgramBinary(
+    GLuint programID,
+    const std::string &programKey)
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+
+    GLint binaryLength = 0;
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if (binaryLength <= 0)
+    {
+        return;
+    }
+
+    std::vector<char> binary(binaryLength);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(programID, binaryLength, &binaryLength, &binaryFormat, &binary[0]);
+
+    std::ofstream fileStream(getProgramBinaryPath(programKey).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!fileStream.is_open())
+    {
+        printf("Error: ProgramBinaryCache::saveProgramBinary(): Failed to write the binary for program %s\n", programKey.c_str());
+        return;
+    }
+
+    fileStream.write((const char*)&PROGRAM_BINARY_FILE_MAGIC, sizeof(PROGRAM_BINARY_FILE_MAGIC));
+    fileStream.write((const char*)&binaryFormat, sizeof(binaryFormat));
+    fileStream.write((const char*)&binaryLength, sizeof(binaryLength));
+    fileStream.write(&binary[0], binaryLength);
+    fileStream.close();
+}
+
+bool ProgramBinaryCache::isEnabled()
+{
+    return m_enabled;
+}
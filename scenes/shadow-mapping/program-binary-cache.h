@@ -0,0 +1,71 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <string>
+
+#include <glad/glad.h>
+
+// Stores linked shader programs on disk with glGetProgramBinary
+// so that later launches can skip compiling and linking them.
+// Each binary is keyed by a hash of the shader sources (which
+// include any injected #defines) and of the vendor, renderer
+// and version strings of the driver, so a driver update or a
+// shader edit never picks up a stale binary.
+class ProgramBinaryCache
+{
+public:
+    ProgramBinaryCache();
+
+    // Program binaries need OpenGL 4.1 or ARB_get_program_binary
+    // and a driver that exposes at least one binary format
+    static bool isSupported();
+
+    bool createProgramBinaryCache(const char* cacheDirectory);
+
+    std::string computeProgramKey(
+        const char* vertexShaderCode,
+        const char* fragmentShaderCode);
+
+    // Returns false if there is no binary for the key. The
+    // driver may still reject the binary, which shows up as
+    // a failed link status and the program then has to be
+    // compiled from source
+    bool loadProgramBinary(
+        GLuint programID,
+        const std::string &programKey);
+    void saveProgramBinary(
+        GLuint programID,
+        const std::string &programKey);
+
+    bool isEnabled();
+
+private:
+    std::string getProgramBinaryPath(const std::string &programKey);
+
+    std::string m_cacheDirectory;
+    std::string m_driverIdentity;
+    bool m_enabled;
+};
@@ -0,0 +1,377 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "range-allocator.h"
+
+#include <stdio.h>
+
+// Index of the highest and lowest set bit, the
+// value must not be 0 for either of them
+static unsigned int HighestBit(unsigned int value)
+{
+    return 31 - __builtin_clz(value);
+}
+
+static unsigned int LowestBit(unsigned int value)
+{
+    return __builtin_ctz(value);
+}
+
+RangeAllocator::RangeAllocator() :
+    m_capacity(0),
+    m_usedSize(0),
+    m_freeBlockCount(0),
+    m_usedBlockCount(0),
+    m_firstLevelBitmap(0)
+{
+    for (unsigned int i = 0; i < FIRST_LEVEL_COUNT; ++i)
+    {
+        m_secondLevelBitmaps[i] = 0;
+        for (unsigned int j = 0; j < SECOND_LEVEL_COUNT; ++j)
+        {
+            m_freeLists[i][j] = NO_BLOCK;
+        }
+    }
+}
+
+void RangeAllocator::createRangeAllocator(GLuint capacity)
+{
+    clearRangeAllocator();
+    m_capacity = capacity;
+
+    if (!capacity)
+    {
+        return;
+    }
+
+    // The whole span starts out as one free range
+    unsigned int block = createBlock();
+    m_blocks[block].offset = 0;
+    m_blocks[block].size = capacity;
+    insertFreeBlock(block);
+}
+
+unsigned int RangeAllocator::allocateRange(GLuint size)
+{
+    if (!size)
+    {
+        size = 1;
+    }
+
+    unsigned int block = findFreeBlock(size);
+    if (block == NO_BLOCK)
+    {
+        return INVALID_RANGE;
+    }
+    removeFreeBlock(block);
+
+    // Give the tail back to the free lists
+    if (m_blocks[block].size > size)
+    {
+        unsigned int remainder = createBlock();
+        Block &split = m_blocks[remainder];
+        Block &used = m_blocks[block];
+        split.offset = used.offset + size;
+        split.size = used.size - size;
+        split.previousBlock = block;
+        split.nextBlock = used.nextBlock;
+        if (used.nextBlock != NO_BLOCK)
+        {
+            m_blocks[used.nextBlock].previousBlock = remainder;
+        }
+        used.nextBlock = remainder;
+        used.size = size;
+        insertFreeBlock(remainder);
+    }
+
+    m_blocks[block].free = false;
+    m_usedSize += size;
+    ++m_usedBlockCount;
+    return block;
+}
+
+void RangeAllocator::freeRange(unsigned int range)
+{
+    if (range >= m_blocks.size() || m_blocks[range].free)
+    {
+        printf("Error: RangeAllocator::freeRange(): Range %u is not allocated\n", range);
+        return;
+    }
+
+    m_usedSize -= m_blocks[range].size;
+    --m_usedBlockCount;
+    m_blocks[range].free = true;
+
+    // Merge with the free ranges on either side
+    unsigned int next = m_blocks[range].nextBlock;
+    if (next != NO_BLOCK && m_blocks[next].free)
+    {
+        removeFreeBlock(next);
+        m_blocks[range].size += m_blocks[next].size;
+        m_blocks[range].nextBlock = m_blocks[next].nextBlock;
+        if (m_blocks[next].nextBlock != NO_BLOCK)
+        {
+            m_blocks[m_blocks[next].nextBlock].previousBlock = range;
+        }
+        destroyBlock(next);
+    }
+
+    unsigned int previous = m_blocks[range].previousBlock;
+    if (previous != NO_BLOCK && m_blocks[previous].free)
+    {
+        removeFreeBlock(previous);
+        m_blocks[previous].size += m_blocks[range].size;
+        m_blocks[previous].nextBlock = m_blocks[range].nextBlock;
+        if (m_blocks[range].nextBlock != NO_BLOCK)
+        {
+            m_blocks[m_blocks[range].nextBlock].previousBlock = previous;
+        }
+        destroyBlock(range);
+        range = previous;
+    }
+
+    insertFreeBlock(range);
+}
+
+GLuint RangeAllocator::getRangeOffset(unsigned int range) const
+{
+    return m_blocks[range].offset;
+}
+
+GLuint RangeAllocator::getRangeSize(unsigned int range) const
+{
+    return m_blocks[range].size;
+}
+
+GLuint RangeAllocator::getCapacity() const
+{
+    return m_capacity;
+}
+
+GLuint RangeAllocator::getUsedSize() const
+{
+    return m_usedSize;
+}
+
+GLuint RangeAllocator::getLargestFreeRange() const
+{
+    if (!m_firstLevelBitmap)
+    {
+        return 0;
+    }
+
+    // Only the ranges of the highest class
+    // in use can be the largest one
+    unsigned int firstLevel = HighestBit(m_firstLevelBitmap);
+    unsigned int secondLevel = HighestBit(m_secondLevelBitmaps[firstLevel]);
+
+    GLuint largest = 0;
+    for (unsigned int block = m_freeLists[firstLevel][secondLevel]; block != NO_BLOCK; block = m_blocks[block].nextFree)
+    {
+        if (m_blocks[block].size > largest)
+        {
+            largest = m_blocks[block].size;
+        }
+    }
+
+    return largest;
+}
+
+size_t RangeAllocator::getFreeRangeCount() const
+{
+    return m_freeBlockCount;
+}
+
+size_t RangeAllocator::getRangeCount() const
+{
+    return m_usedBlockCount;
+}
+
+void RangeAllocator::clearRangeAllocator()
+{
+    m_blocks.clear();
+    m_unusedBlocks.clear();
+    m_capacity = 0;
+    m_usedSize = 0;
+    m_freeBlockCount = 0;
+    m_usedBlockCount = 0;
+
+    m_firstLevelBitmap = 0;
+    for (unsigned int i = 0; i < FIRST_LEVEL_COUNT; ++i)
+    {
+        m_secondLevelBitmaps[i] = 0;
+        for (unsigned int j = 0; j < SECOND_LEVEL_COUNT; ++j)
+        {
+            m_freeLists[i][j] = NO_BLOCK;
+        }
+    }
+}
+
+void RangeAllocator::mapSize(GLuint size, unsigned int &firstLevel, unsigned int &secondLevel)
+{
+    // Sizes below the step count get a list each in the
+    // first class, larger ones are split into steps of
+    // an eighth of their power of two
+    if (size < SECOND_LEVEL_COUNT)
+    {
+        firstLevel = 0;
+        secondLevel = size;
+        return;
+    }
+
+    unsigned int highestBit = HighestBit(size);
+    firstLevel = highestBit - SECOND_LEVEL_BITS + 1;
+    secondLevel = (size >> (highestBit - SECOND_LEVEL_BITS)) - SECOND_LEVEL_COUNT;
+}
+
+unsigned int RangeAllocator::findFreeBlock(GLuint size) const
+{
+    // Round up to the next size class so that
+    // any range of the list found is large enough
+    GLuint roundedSize = size;
+    if (size >= SECOND_LEVEL_COUNT)
+    {
+        GLuint step = (1u << (HighestBit(size) - SECOND_LEVEL_BITS)) - 1;
+        roundedSize = size > 0xFFFFFFFF - step ? 0xFFFFFFFF : size + step;
+    }
+
+    unsigned int firstLevel = 0, secondLevel = 0;
+    mapSize(roundedSize, firstLevel, secondLevel);
+
+    unsigned int secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (!secondLevelMap && firstLevel + 1 < FIRST_LEVEL_COUNT)
+    {
+        unsigned int firstLevelMap = m_firstLevelBitmap & (~0u << (firstLevel + 1));
+        if (firstLevelMap)
+        {
+            firstLevel = LowestBit(firstLevelMap);
+            secondLevelMap = m_secondLevelBitmaps[firstLevel];
+        }
+    }
+
+    if (secondLevelMap)
+    {
+        return m_freeLists[firstLevel][LowestBit(secondLevelMap)];
+    }
+
+    // The list of the size itself may still hold a range
+    // large enough, e.g. when asking for all that is left
+    mapSize(size, firstLevel, secondLevel);
+    for (unsigned int block = m_freeLists[firstLevel][secondLevel]; block != NO_BLOCK; block = m_blocks[block].nextFree)
+    {
+        if (m_blocks[block].size >= size)
+        {
+            return block;
+        }
+    }
+
+    return NO_BLOCK;
+}
+
+void RangeAllocator::insertFreeBlock(unsigned int block)
+{
+    unsigned int firstLevel = 0, secondLevel = 0;
+    mapSize(m_blocks[block].size, firstLevel, secondLevel);
+
+    unsigned int head = m_freeLists[firstLevel][secondLevel];
+    m_blocks[block].free = true;
+    m_blocks[block].previousFree = NO_BLOCK;
+    m_blocks[block].nextFree = head;
+    if (head != NO_BLOCK)
+    {
+        m_blocks[head].previousFree = block;
+    }
+
+    m_freeLists[firstLevel][secondLevel] = block;
+    m_firstLevelBitmap |= 1u << firstLevel;
+    m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    ++m_freeBlockCount;
+}
+
+void RangeAllocator::removeFreeBlock(unsigned int block)
+{
+    unsigned int firstLevel = 0, secondLevel = 0;
+    mapSize(m_blocks[block].size, firstLevel, secondLevel);
+
+    Block &removed = m_blocks[block];
+    if (removed.previousFree != NO_BLOCK)
+    {
+        m_blocks[removed.previousFree].nextFree = removed.nextFree;
+    }
+    else
+    {
+        m_freeLists[firstLevel][secondLevel] = removed.nextFree;
+    }
+
+    if (removed.nextFree != NO_BLOCK)
+    {
+        m_blocks[removed.nextFree].previousFree = removed.previousFree;
+    }
+
+    if (m_freeLists[firstLevel][secondLevel] == NO_BLOCK)
+    {
+        m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (!m_secondLevelBitmaps[firstLevel])
+        {
+            m_firstLevelBitmap &= ~(1u << firstLevel);
+        }
+    }
+
+    removed.previousFree = NO_BLOCK;
+    removed.nextFree = NO_BLOCK;
+    --m_freeBlockCount;
+}
+
+unsigned int RangeAllocator::createBlock()
+{
+    unsigned int block = 0;
+    if (!m_unusedBlocks.empty())
+    {
+        block = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+    }
+    else
+    {
+        block = m_blocks.size();
+        m_blocks.push_back(Block());
+    }
+
+    Block &created = m_blocks[block];
+    created.offset = 0;
+    created.size = 0;
+    created.previousBlock = NO_BLOCK;
+    created.nextBlock = NO_BLOCK;
+    created.previousFree = NO_BLOCK;
+    created.nextFree = NO_BLOCK;
+    created.free = false;
+    return block;
+}
+
+void RangeAllocator::destroyBlock(unsigned int block)
+{
+    // Marked free so that a stale range is caught by freeRange()
+    m_blocks[block].free = true;
+    m_blocks[block].size = 0;
+    m_unusedBlocks.push_back(block);
+}
@@ -0,0 +1,99 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+// Hands out ranges of a fixed span of elements (e.g. the
+// vertices of a buffer) with the two level segregated fit
+// scheme of TLSF. Free ranges are kept in lists by size
+// class, a power of two split into eight steps, and a bitmap
+// per level tells which lists hold anything, so finding a
+// large enough range and freeing one both take constant time.
+// Freed ranges are merged with the free ranges next to them.
+class RangeAllocator
+{
+public:
+    static const unsigned int INVALID_RANGE = 0xFFFFFFFF;
+
+    RangeAllocator();
+
+    void createRangeAllocator(GLuint capacity);
+
+    // Returns INVALID_RANGE when no free range is large enough
+    unsigned int allocateRange(GLuint size);
+    void freeRange(unsigned int range);
+
+    GLuint getRangeOffset(unsigned int range) const;
+    GLuint getRangeSize(unsigned int range) const;
+
+    GLuint getCapacity() const;
+    GLuint getUsedSize() const;
+    GLuint getLargestFreeRange() const;
+    size_t getFreeRangeCount() const;
+    size_t getRangeCount() const;
+
+    void clearRangeAllocator();
+
+private:
+    static const unsigned int NO_BLOCK = 0xFFFFFFFF;
+    static const unsigned int SECOND_LEVEL_BITS = 3;
+    static const unsigned int SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_BITS;
+    static const unsigned int FIRST_LEVEL_COUNT = 32 - SECOND_LEVEL_BITS;
+
+    // A range of the span, free or handed out, linked to its
+    // neighbours in the span and, when free, in its free list
+    struct Block
+    {
+        GLuint offset;
+        GLuint size;
+        unsigned int previousBlock;
+        unsigned int nextBlock;
+        unsigned int previousFree;
+        unsigned int nextFree;
+        bool free;
+    };
+
+    static void mapSize(GLuint size, unsigned int &firstLevel, unsigned int &secondLevel);
+    unsigned int findFreeBlock(GLuint size) const;
+    void insertFreeBlock(unsigned int block);
+    void removeFreeBlock(unsigned int block);
+    unsigned int createBlock();
+    void destroyBlock(unsigned int block);
+
+    GLuint m_capacity;
+    GLuint m_usedSize;
+    size_t m_freeBlockCount;
+    size_t m_usedBlockCount;
+
+    std::vector<Block> m_blocks;
+    std::vector<unsigned int> m_unusedBlocks;
+
+    unsigned int m_firstLevelBitmap;
+    unsigned int m_secondLevelBitmaps[FIRST_LEVEL_COUNT];
+    unsigned int m_freeLists[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+};
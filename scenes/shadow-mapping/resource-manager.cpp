@@ -0,0 +1,309 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "resource-manager.h"
+
+#include <chrono>
+#include <stdio.h>
+
+ResourceManager::ResourceManager() :
+    m_jobSystem(nullptr),
+    m_uploadThread(nullptr),
+    m_geometryPool(nullptr)
+{
+}
+
+void ResourceManager::createResourceManager(
+    JobSystem *jobSystem,
+    UploadThread *uploadThread,
+    GeometryPool *geometryPool)
+{
+    m_jobSystem = jobSystem;
+    m_geometryPool = geometryPool;
+    m_uploadThread = uploadThread && uploadThread->isRunning() ? uploadThread : nullptr;
+}
+
+ModelHandle ResourceManager::requestModel(
+    const std::string& fileName,
+    bool packTextures,
+    unsigned int levelOfDetailCount)
+{
+    unsigned int index = 0;
+    if (!m_freeSlots.empty())
+    {
+        index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        index = m_slots.size();
+        m_slots.push_back(ModelSlot());
+    }
+
+    ModelSlot &slot = m_slots[index];
+    slot.model.reset(new Model());
+    slot.model->setJobSystem(m_jobSystem);
+    slot.model->setGeometryPool(m_geometryPool);
+    slot.fileName = fileName;
+    slot.state = RESOURCE_IMPORTING;
+    slot.released = false;
+    slot.uploadingOnThread = false;
+
+    ModelHandle handle;
+    handle.index = index;
+    handle.generation = slot.generation;
+
+    // The job only touches the model itself, the slots are
+    // left to this thread which the result is handed back to
+    Model *model = slot.model.get();
+    if (!m_jobSystem)
+    {
+        finishImport(index, model->importModel(fileName, packTextures, levelOfDetailCount));
+        return handle;
+    }
+
+    m_jobSystem->runJob([this, model, index, fileName, packTextures, levelOfDetailCount] {
+        bool imported = model->importModel(fileName, packTextures, levelOfDetailCount);
+        m_jobSystem->runOnMainThread([this, index, imported] {
+            finishImport(index, imported);
+        }, &m_imports);
+    }, &m_imports);
+
+    return handle;
+}
+
+void ResourceManager::uploadResources(double budgetMilliseconds)
+{
+    if (m_uploadThread)
+    {
+        m_uploadThread->collectUploads();
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool madeProgress = false;
+
+    while (!m_uploadQueue.empty())
+    {
+        double elapsed = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        if (madeProgress && elapsed >= budgetMilliseconds)
+        {
+            break;
+        }
+
+        unsigned int index = m_uploadQueue.front();
+        ModelSlot &slot = m_slots[index];
+        madeProgress = true;
+
+        if (slot.model->uploadModelStep())
+        {
+            continue;
+        }
+
+        m_uploadQueue.pop_front();
+        slot.state = RESOURCE_RESIDENT;
+        printLoadTimes(slot);
+    }
+}
+
+bool ResourceManager::isModelResident(ModelHandle handle)
+{
+    ModelSlot *slot = getSlot(handle);
+    return slot && slot->state == RESOURCE_RESIDENT;
+}
+
+bool ResourceManager::hasModelFailed(ModelHandle handle)
+{
+    ModelSlot *slot = getSlot(handle);
+    return !slot || slot->state == RESOURCE_FAILED;
+}
+
+Model* ResourceManager::getModel(ModelHandle handle)
+{
+    return isModelResident(handle) ? m_slots[handle.index].model.get() : nullptr;
+}
+
+void ResourceManager::releaseModel(ModelHandle handle)
+{
+    ModelSlot *slot = getSlot(handle);
+    if (!slot)
+    {
+        return;
+    }
+
+    // The import job or the upload thread still uses the
+    // model, it is freed when they hand their result back
+    slot->released = true;
+    ++slot->generation;
+    if (slot->state != RESOURCE_IMPORTING && !slot->uploadingOnThread)
+    {
+        freeSlot(handle.index);
+    }
+}
+
+void ResourceManager::clearResourceManager()
+{
+    // Let the outstanding imports and uploads finish,
+    // they write into the models about to be freed
+    if (m_jobSystem)
+    {
+        m_jobSystem->waitForCounter(m_imports);
+    }
+
+    if (m_uploadThread)
+    {
+        m_uploadThread->finishUploads();
+    }
+
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        if (m_slots[i].model)
+        {
+            m_slots[i].model->clearModel();
+        }
+    }
+
+    m_slots.clear();
+    m_freeSlots.clear();
+    m_uploadQueue.clear();
+    m_jobSystem = nullptr;
+    m_uploadThread = nullptr;
+    m_geometryPool = nullptr;
+}
+
+ResourceManager::~ResourceManager()
+{
+    clearResourceManager();
+}
+
+ResourceManager::ModelSlot* ResourceManager::getSlot(ModelHandle handle)
+{
+    if (handle.index >= m_slots.size())
+    {
+        return nullptr;
+    }
+
+    ModelSlot &slot = m_slots[handle.index];
+    if (slot.generation != handle.generation || slot.released)
+    {
+        return nullptr;
+    }
+
+    return &slot;
+}
+
+void ResourceManager::finishImport(unsigned int index, bool imported)
+{
+    ModelSlot &slot = m_slots[index];
+    if (slot.released)
+    {
+        freeSlot(index);
+        return;
+    }
+
+    if (!imported)
+    {
+        printf("Error: ResourceManager::finishImport(): Failed to import %s\n", slot.fileName.c_str());
+        slot.state = RESOURCE_FAILED;
+        slot.model->clearModel();
+        slot.model.reset();
+        return;
+    }
+
+    slot.state = RESOURCE_UPLOADING;
+    if (!m_uploadThread)
+    {
+        m_uploadQueue.push_back(index);
+        return;
+    }
+
+    // The whole model goes to GL in one go on the
+    // upload thread, nothing else touches it meanwhile
+    Model *model = slot.model.get();
+    slot.uploadingOnThread = true;
+    m_uploadThread->submitUpload([model] {
+        while (model->uploadModelStep(true))
+        {
+        }
+    }, [this, index] {
+        finishUpload(index);
+    });
+}
+
+void ResourceManager::finishUpload(unsigned int index)
+{
+    ModelSlot &slot = m_slots[index];
+    slot.uploadingOnThread = false;
+    if (slot.released)
+    {
+        freeSlot(index);
+        return;
+    }
+
+    // The buffers are complete, the vertex arrays
+    // referring to them can be set up on this context
+    slot.model->createVertexArrays();
+    slot.state = RESOURCE_RESIDENT;
+    printLoadTimes(slot);
+}
+
+void ResourceManager::printLoadTimes(const ModelSlot &slot)
+{
+    const ModelLoadTimes &times = slot.model->getLoadTimes();
+    printf("Model %s resident: import %.1f ms, conversion %.1f ms, textures %.1f ms, upload %.1f ms\n",
+        slot.fileName.c_str(),
+        times.importMilliseconds,
+        times.conversionMilliseconds,
+        times.textureMilliseconds,
+        times.uploadMilliseconds);
+}
+
+void ResourceManager::freeSlot(unsigned int index)
+{
+    ModelSlot &slot = m_slots[index];
+    for (std::deque<unsigned int>::iterator it = m_uploadQueue.begin(); it != m_uploadQueue.end(); ++it)
+    {
+        if (*it == index)
+        {
+            m_uploadQueue.erase(it);
+            break;
+        }
+    }
+
+    if (slot.model)
+    {
+        slot.model->clearModel();
+        slot.model.reset();
+
+        // The meshes of the model leave holes in
+        // the geometry pool, closed up right away
+        if (m_geometryPool)
+        {
+            m_geometryPool->defragmentGeometryPool();
+        }
+    }
+    slot.fileName.clear();
+    slot.state = RESOURCE_FAILED;
+    m_freeSlots.push_back(index);
+}
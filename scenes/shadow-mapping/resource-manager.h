@@ -0,0 +1,121 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "model.h"
+#include "job-system.h"
+#include "upload-thread.h"
+
+// Refers to a model of a resource manager, the generation
+// tells a released model apart from the model later
+// requested in the same slot
+struct ModelHandle
+{
+    unsigned int index;
+    unsigned int generation;
+};
+
+// Loads models in the background while the scene keeps
+// rendering. A request returns a handle straight away, the
+// model is read, converted and its textures decoded by a job
+// and then sent to GL a piece at a time within the budget
+// the render loop hands to uploadResources() every frame.
+// Until then getModel() returns nullptr and the caller
+// draws whatever stands in for the model. Given an upload
+// thread, the models are sent to GL on its context instead
+// and the render thread only creates their vertex arrays.
+class ResourceManager
+{
+public:
+    ResourceManager();
+
+    // Without a job system the models are imported
+    // on the calling thread when requested
+    void createResourceManager(
+        JobSystem *jobSystem,
+        UploadThread *uploadThread = nullptr,
+        GeometryPool *geometryPool = nullptr);
+
+    ModelHandle requestModel(
+        const std::string& fileName,
+        bool packTextures = false,
+        unsigned int levelOfDetailCount = 1);
+
+    // Called by the GL thread once per frame, always makes
+    // some progress even when the budget is already spent
+    void uploadResources(double budgetMilliseconds);
+
+    bool isModelResident(ModelHandle handle);
+    bool hasModelFailed(ModelHandle handle);
+    Model* getModel(ModelHandle handle);
+
+    // Models still being imported are freed once the import is done
+    void releaseModel(ModelHandle handle);
+
+    void clearResourceManager();
+
+    ~ResourceManager();
+
+private:
+    enum ResourceState
+    {
+        RESOURCE_IMPORTING,
+        RESOURCE_UPLOADING,
+        RESOURCE_RESIDENT,
+        RESOURCE_FAILED
+    };
+
+    struct ModelSlot
+    {
+        std::unique_ptr<Model> model;
+        std::string fileName;
+        ResourceState state = RESOURCE_FAILED;
+        unsigned int generation = 0;
+        bool released = false;
+        bool uploadingOnThread = false;
+    };
+
+    ModelSlot* getSlot(ModelHandle handle);
+    void finishImport(unsigned int index, bool imported);
+    void finishUpload(unsigned int index);
+    void printLoadTimes(const ModelSlot &slot);
+    void freeSlot(unsigned int index);
+
+    JobSystem *m_jobSystem;
+    UploadThread *m_uploadThread;
+    GeometryPool *m_geometryPool;
+    JobCounter m_imports;
+
+    std::vector<ModelSlot> m_slots;
+    std::vector<unsigned int> m_freeSlots;
+
+    // Imported models waiting for their upload, oldest first
+    std::deque<unsigned int> m_uploadQueue;
+};
@@ -0,0 +1,208 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "model.h"
+#include "scene-graph.h"
+
+SceneGraph::SceneGraph() :
+    m_updatedNodeCount(0)
+{
+}
+
+unsigned int SceneGraph::addNode(unsigned int parent, const std::string &name)
+{
+    Node node;
+    node.name = name;
+    node.parent = parent;
+    node.depth = parent == ROOT_PARENT ? 0 : m_nodes[parent].depth + 1;
+    node.position = glm::vec3(0.0f);
+    node.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    node.scale = glm::vec3(1.0f);
+    node.useLocalMatrix = false;
+    node.localMatrix = glm::mat4(1.0f);
+    node.worldMatrix = glm::mat4(1.0f);
+    node.dirty = false;
+
+    unsigned int nodeIndex = m_nodes.size();
+    m_nodes.push_back(node);
+
+    if (parent != ROOT_PARENT)
+    {
+        m_nodes[parent].children.push_back(nodeIndex);
+    }
+
+    // The world matrix has to be computed once
+    markDirty(nodeIndex);
+
+    return nodeIndex;
+}
+
+unsigned int SceneGraph::addModelNodes(const Model &model, unsigned int parent)
+{
+    // The model nodes are stored parents first, so their
+    // parents are always added before them
+    std::vector<unsigned int> sceneNodes(model.getNodeCount());
+    for (size_t i = 0; i < model.getNodeCount(); ++i)
+    {
+        const ModelNode &modelNode = model.getNode(i);
+        unsigned int nodeParent = modelNode.parent == ModelNode::NO_PARENT ? parent : sceneNodes[modelNode.parent];
+
+        sceneNodes[i] = addNode(nodeParent, modelNode.name);
+        setLocalMatrix(sceneNodes[i], modelNode.transform);
+    }
+
+    return sceneNodes.empty() ? addNode(parent) : sceneNodes[0];
+}
+
+void SceneGraph::markDirty(unsigned int node)
+{
+    if (!m_nodes[node].dirty)
+    {
+        m_nodes[node].dirty = true;
+        m_dirtyNodes.push_back(node);
+    }
+}
+
+void SceneGraph::setPosition(unsigned int node, const glm::vec3 &position)
+{
+    m_nodes[node].position = position;
+    m_nodes[node].useLocalMatrix = false;
+    markDirty(node);
+}
+
+void SceneGraph::setRotation(unsigned int node, const glm::quat &rotation)
+{
+    m_nodes[node].rotation = rotation;
+    m_nodes[node].useLocalMatrix = false;
+    markDirty(node);
+}
+
+void SceneGraph::setScale(unsigned int node, const glm::vec3 &scale)
+{
+    m_nodes[node].scale = scale;
+    m_nodes[node].useLocalMatrix = false;
+    markDirty(node);
+}
+
+void SceneGraph::setLocalMatrix(unsigned int node, const glm::mat4 &localMatrix)
+{
+    m_nodes[node].localMatrix = localMatrix;
+    m_nodes[node].useLocalMatrix = true;
+    markDirty(node);
+}
+
+void SceneGraph::updateWorldMatrices()
+{
+    m_updatedNodeCount = 0;
+    if (m_dirtyNodes.empty())
+    {
+        return;
+    }
+
+    // Updating the shallowest nodes first brings the
+    // dirty nodes below them up to date along the way
+    std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end(), [this](unsigned int a, unsigned int b) {
+        return m_nodes[a].depth < m_nodes[b].depth;
+    });
+
+    for (size_t i = 0; i < m_dirtyNodes.size(); ++i)
+    {
+        if (m_nodes[m_dirtyNodes[i]].dirty)
+        {
+            updateSubtree(m_dirtyNodes[i]);
+        }
+    }
+
+    m_dirtyNodes.clear();
+}
+
+void SceneGraph::updateSubtree(unsigned int nodeIndex)
+{
+    Node &node = m_nodes[nodeIndex];
+
+    if (!node.useLocalMatrix)
+    {
+        // Scale first, then rotate, then translate
+        node.localMatrix = glm::translate(glm::mat4(1.0f), node.position) *
+            glm::mat4_cast(node.rotation) *
+            glm::scale(glm::mat4(1.0f), node.scale);
+    }
+
+    if (node.parent == ROOT_PARENT)
+    {
+        node.worldMatrix = node.localMatrix;
+    }
+    else
+    {
+        node.worldMatrix = m_nodes[node.parent].worldMatrix * node.localMatrix;
+    }
+
+    node.dirty = false;
+    ++m_updatedNodeCount;
+
+    for (size_t i = 0; i < node.children.size(); ++i)
+    {
+        updateSubtree(node.children[i]);
+    }
+}
+
+const glm::mat4& SceneGraph::getWorldMatrix(unsigned int node) const
+{
+    return m_nodes[node].worldMatrix;
+}
+
+unsigned int SceneGraph::getParent(unsigned int node) const
+{
+    return m_nodes[node].parent;
+}
+
+const std::string& SceneGraph::getName(unsigned int node) const
+{
+    return m_nodes[node].name;
+}
+
+size_t SceneGraph::getNodeCount() const
+{
+    return m_nodes.size();
+}
+
+size_t SceneGraph::getUpdatedNodeCount() const
+{
+    return m_updatedNodeCount;
+}
+
+void SceneGraph::clearSceneGraph()
+{
+    m_nodes.clear();
+    m_dirtyNodes.clear();
+    m_updatedNodeCount = 0;
+}
+
+SceneGraph::~SceneGraph()
+{
+}
@@ -0,0 +1,107 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+class Model;
+
+// Hierarchy of transforms where every node has a local position,
+// rotation and scale relative to its parent. World matrices are
+// cached and only recomputed for the nodes changed since the last
+// update and the nodes below them, so a static node costs nothing
+// per frame no matter how large the rest of the scene is.
+class SceneGraph
+{
+public:
+    // Parent of the nodes at the top of the hierarchy
+    static const unsigned int ROOT_PARENT = 0xFFFFFFFF;
+
+    SceneGraph();
+
+    unsigned int addNode(
+        unsigned int parent = ROOT_PARENT,
+        const std::string &name = "");
+
+    // Adds the node hierarchy of a loaded model below parent
+    // and returns the node standing in for the model's root.
+    // The model's meshes already have their node transforms
+    // applied, these nodes locate the parts of the model.
+    unsigned int addModelNodes(const Model &model, unsigned int parent = ROOT_PARENT);
+
+    void setPosition(unsigned int node, const glm::vec3 &position);
+    void setRotation(unsigned int node, const glm::quat &rotation);
+    void setScale(unsigned int node, const glm::vec3 &scale);
+
+    // For transforms that do not decompose into position, rotation
+    // and scale, such as the node transforms of imported models
+    void setLocalMatrix(unsigned int node, const glm::mat4 &localMatrix);
+
+    // Brings the world matrices of all changed nodes up to date
+    void updateWorldMatrices();
+
+    const glm::mat4& getWorldMatrix(unsigned int node) const;
+    unsigned int getParent(unsigned int node) const;
+    const std::string& getName(unsigned int node) const;
+    size_t getNodeCount() const;
+
+    // Nodes whose world matrix was recomputed by the last update
+    size_t getUpdatedNodeCount() const;
+
+    void clearSceneGraph();
+
+    ~SceneGraph();
+
+private:
+    struct Node
+    {
+        std::string name;
+        unsigned int parent;
+        unsigned int depth;
+        std::vector<unsigned int> children;
+
+        glm::vec3 position;
+        glm::quat rotation;
+        glm::vec3 scale;
+
+        // Set instead of the position, rotation and scale
+        bool useLocalMatrix;
+        glm::mat4 localMatrix;
+        glm::mat4 worldMatrix;
+
+        bool dirty;
+    };
+
+    void markDirty(unsigned int node);
+    void updateSubtree(unsigned int node);
+
+    std::vector<Node> m_nodes;
+    std::vector<unsigned int> m_dirtyNodes;
+    size_t m_updatedNodeCount;
+};
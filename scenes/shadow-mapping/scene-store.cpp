@@ -0,0 +1,336 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstdio>
+
+#include "scene-store.h"
+#include "frustum.h"
+#include "matrix-batch.h"
+
+const unsigned int SceneStore::INVALID_SLOT = 0xFFFFFFFF;
+
+SceneStore::SceneStore() :
+    m_anyDirty(false)
+{
+}
+
+void SceneStore::reserveObjects(size_t count)
+{
+    m_positions.reserve(count);
+    m_rotations.reserve(count);
+    m_scales.reserve(count);
+    m_worldMatrices.reserve(count);
+    m_boundsMin.reserve(count);
+    m_boundsMax.reserve(count);
+    m_worldBoundsMin.reserve(count);
+    m_worldBoundsMax.reserve(count);
+    m_renderables.reserve(count);
+    m_dirty.reserve(count);
+    m_visibility.reserve(count);
+    m_slotHandles.reserve(count);
+}
+
+SceneObjectHandle SceneStore::createObject(
+    unsigned int renderable,
+    const glm::vec3 &boundsMin,
+    const glm::vec3 &boundsMax)
+{
+    SceneObjectHandle object;
+    if (!m_freeHandles.empty())
+    {
+        object.index = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+    else
+    {
+        // Generations start at 1 so that a zeroed
+        // handle never refers to a live object
+        object.index = m_handleSlots.size();
+        m_handleSlots.push_back(INVALID_SLOT);
+        m_handleGenerations.push_back(1);
+    }
+    object.generation = m_handleGenerations[object.index];
+
+    unsigned int slot = m_positions.size();
+    m_handleSlots[object.index] = slot;
+
+    m_positions.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+    m_rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    m_scales.push_back(glm::vec3(1.0f, 1.0f, 1.0f));
+    m_worldMatrices.push_back(glm::mat4(1.0f));
+    m_boundsMin.push_back(boundsMin);
+    m_boundsMax.push_back(boundsMax);
+    m_worldBoundsMin.push_back(boundsMin);
+    m_worldBoundsMax.push_back(boundsMax);
+    m_renderables.push_back(renderable);
+    m_dirty.push_back(1);
+    m_visibility.push_back(1);
+    m_slotHandles.push_back(object.index);
+
+    m_anyDirty = true;
+    return object;
+}
+
+void SceneStore::destroyObject(SceneObjectHandle object)
+{
+    unsigned int slot = findSlot(object);
+    if (slot == INVALID_SLOT)
+    {
+        printf("Warning: Destroying a scene object that does not exist!\n");
+        return;
+    }
+
+    // Fill the hole with the last object so
+    // that the arrays stay tightly packed
+    unsigned int last = m_positions.size() - 1;
+    if (slot != last)
+    {
+        m_positions[slot] = m_positions[last];
+        m_rotations[slot] = m_rotations[last];
+        m_scales[slot] = m_scales[last];
+        m_worldMatrices[slot] = m_worldMatrices[last];
+        m_boundsMin[slot] = m_boundsMin[last];
+        m_boundsMax[slot] = m_boundsMax[last];
+        m_worldBoundsMin[slot] = m_worldBoundsMin[last];
+        m_worldBoundsMax[slot] = m_worldBoundsMax[last];
+        m_renderables[slot] = m_renderables[last];
+        m_dirty[slot] = m_dirty[last];
+        m_visibility[slot] = m_visibility[last];
+        m_slotHandles[slot] = m_slotHandles[last];
+        m_handleSlots[m_slotHandles[slot]] = slot;
+    }
+
+    m_positions.pop_back();
+    m_rotations.pop_back();
+    m_scales.pop_back();
+    m_worldMatrices.pop_back();
+    m_boundsMin.pop_back();
+    m_boundsMax.pop_back();
+    m_worldBoundsMin.pop_back();
+    m_worldBoundsMax.pop_back();
+    m_renderables.pop_back();
+    m_dirty.pop_back();
+    m_visibility.pop_back();
+    m_slotHandles.pop_back();
+
+    // Outdate every handle to the destroyed object
+    m_handleSlots[object.index] = INVALID_SLOT;
+    ++m_handleGenerations[object.index];
+    m_freeHandles.push_back(object.index);
+}
+
+bool SceneStore::isObjectAlive(SceneObjectHandle object) const
+{
+    return findSlot(object) != INVALID_SLOT;
+}
+
+void SceneStore::setPosition(SceneObjectHandle object, const glm::vec3 &position)
+{
+    unsigned int slot = findSlot(object);
+    if (slot != INVALID_SLOT)
+    {
+        m_positions[slot] = position;
+        m_dirty[slot] = 1;
+        m_anyDirty = true;
+    }
+}
+
+void SceneStore::setRotation(SceneObjectHandle object, const glm::quat &rotation)
+{
+    unsigned int slot = findSlot(object);
+    if (slot != INVALID_SLOT)
+    {
+        m_rotations[slot] = rotation;
+        m_dirty[slot] = 1;
+        m_anyDirty = true;
+    }
+}
+
+void SceneStore::setScale(SceneObjectHandle object, const glm::vec3 &scale)
+{
+    unsigned int slot = findSlot(object);
+    if (slot != INVALID_SLOT)
+    {
+        m_scales[slot] = scale;
+        m_dirty[slot] = 1;
+        m_anyDirty = true;
+    }
+}
+
+void SceneStore::updateTransforms()
+{
+    if (!m_anyDirty)
+    {
+        return;
+    }
+
+    size_t objectCount = m_positions.size();
+    size_t slot = 0;
+    while (slot < objectCount)
+    {
+        if (!m_dirty[slot])
+        {
+            ++slot;
+            continue;
+        }
+
+        // Rebuild the matrices of a run of changed objects,
+        // then transform the boxes of the run in one batch
+        size_t first = slot;
+        for (; slot < objectCount && m_dirty[slot]; ++slot)
+        {
+            // Translation * rotation * scale,
+            // built without any matrix products
+            glm::mat4 world = glm::mat4_cast(m_rotations[slot]);
+            world[0] *= m_scales[slot].x;
+            world[1] *= m_scales[slot].y;
+            world[2] *= m_scales[slot].z;
+            world[3] = glm::vec4(m_positions[slot], 1.0f);
+            m_worldMatrices[slot] = world;
+
+            m_dirty[slot] = 0;
+        }
+
+        TransformBoxes(
+            &m_worldMatrices[first],
+            &m_boundsMin[first],
+            &m_boundsMax[first],
+            &m_worldBoundsMin[first],
+            &m_worldBoundsMax[first],
+            slot - first);
+    }
+
+    m_anyDirty = false;
+}
+
+void SceneStore::cullObjects(const glm::mat4 &projectionView)
+{
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(projectionView, planes);
+
+    size_t objectCount = m_positions.size();
+    for (size_t slot = 0; slot < objectCount; ++slot)
+    {
+        glm::vec3 center = (m_worldBoundsMin[slot] + m_worldBoundsMax[slot]) * 0.5f;
+        glm::vec3 extent = (m_worldBoundsMax[slot] - m_worldBoundsMin[slot]) * 0.5f;
+
+        // The box is outside once the corner furthest
+        // along a plane normal is behind that plane
+        unsigned char visible = 1;
+        for (int plane = 0; plane < 6; ++plane)
+        {
+            const glm::vec4 &p = planes[plane];
+            GLfloat distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+            GLfloat reach = glm::abs(p.x) * extent.x + glm::abs(p.y) * extent.y + glm::abs(p.z) * extent.z;
+            if (distance + reach < 0.0f)
+            {
+                visible = 0;
+                break;
+            }
+        }
+
+        m_visibility[slot] = visible;
+    }
+}
+
+size_t SceneStore::getObjectSlot(SceneObjectHandle object) const
+{
+    return findSlot(object);
+}
+
+size_t SceneStore::getObjectCount() const
+{
+    return m_positions.size();
+}
+
+const glm::mat4 *SceneStore::getWorldMatrices() const
+{
+    return m_worldMatrices.data();
+}
+
+const glm::vec3 *SceneStore::getWorldBoundsMin() const
+{
+    return m_worldBoundsMin.data();
+}
+
+const glm::vec3 *SceneStore::getWorldBoundsMax() const
+{
+    return m_worldBoundsMax.data();
+}
+
+const unsigned int *SceneStore::getRenderables() const
+{
+    return m_renderables.data();
+}
+
+const unsigned char *SceneStore::getVisibility() const
+{
+    return m_visibility.data();
+}
+
+unsigned int SceneStore::findSlot(SceneObjectHandle object) const
+{
+    if (object.index >= m_handleSlots.size() ||
+        m_handleGenerations[object.index] != object.generation)
+    {
+        return INVALID_SLOT;
+    }
+
+    return m_handleSlots[object.index];
+}
+
+void SceneStore::clearSceneStore()
+{
+    m_positions.clear();
+    m_rotations.clear();
+    m_scales.clear();
+    m_worldMatrices.clear();
+    m_boundsMin.clear();
+    m_boundsMax.clear();
+    m_worldBoundsMin.clear();
+    m_worldBoundsMax.clear();
+    m_renderables.clear();
+    m_dirty.clear();
+    m_visibility.clear();
+    m_slotHandles.clear();
+
+    // Keep the generations so that handles
+    // from before the clear stay outdated
+    for (size_t i = 0; i < m_handleSlots.size(); ++i)
+    {
+        if (m_handleSlots[i] != INVALID_SLOT)
+        {
+            m_handleSlots[i] = INVALID_SLOT;
+            ++m_handleGenerations[i];
+            m_freeHandles.push_back(i);
+        }
+    }
+
+    m_anyDirty = false;
+}
+
+SceneStore::~SceneStore()
+{
+    clearSceneStore();
+}
@@ -0,0 +1,119 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Refers to an object of a scene store. The generation tells
+// a handle to a destroyed object apart from the handle of
+// the object later created in the same place.
+struct SceneObjectHandle
+{
+    unsigned int index;
+    unsigned int generation;
+};
+
+// Keeps the transforms, bounds and renderables of many scene
+// objects in one contiguous array per component instead of one
+// structure per object. The objects are packed at the front of
+// the arrays, so updating the transforms and culling the bounds
+// are straight loops over memory that is read sequentially.
+// Destroying an object moves the last object into its place,
+// the handles keep pointing at the right object regardless.
+class SceneStore
+{
+public:
+    SceneStore();
+
+    void reserveObjects(size_t count);
+
+    // The renderable is whatever the caller draws the object
+    // with, the bounds are in the model space of that renderable
+    SceneObjectHandle createObject(
+        unsigned int renderable,
+        const glm::vec3 &boundsMin,
+        const glm::vec3 &boundsMax);
+    void destroyObject(SceneObjectHandle object);
+    bool isObjectAlive(SceneObjectHandle object) const;
+
+    void setPosition(SceneObjectHandle object, const glm::vec3 &position);
+    void setRotation(SceneObjectHandle object, const glm::quat &rotation);
+    void setScale(SceneObjectHandle object, const glm::vec3 &scale);
+
+    // Recomputes the world matrices and world space
+    // bounds of the objects changed since the last call
+    void updateTransforms();
+
+    // Writes 1 into the visibility of every object whose
+    // world space box is at least partly inside the frustum
+    void cullObjects(const glm::mat4 &projectionView);
+
+    // Position of the object in the packed arrays,
+    // valid until an object is destroyed
+    size_t getObjectSlot(SceneObjectHandle object) const;
+    size_t getObjectCount() const;
+
+    // Packed arrays, getObjectCount() entries long
+    const glm::mat4 *getWorldMatrices() const;
+    const glm::vec3 *getWorldBoundsMin() const;
+    const glm::vec3 *getWorldBoundsMax() const;
+    const unsigned int *getRenderables() const;
+    const unsigned char *getVisibility() const;
+
+    void clearSceneStore();
+
+    ~SceneStore();
+
+private:
+    static const unsigned int INVALID_SLOT;
+
+    unsigned int findSlot(SceneObjectHandle object) const;
+
+    // Components of the objects, indexed by slot
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::quat> m_rotations;
+    std::vector<glm::vec3> m_scales;
+    std::vector<glm::mat4> m_worldMatrices;
+    std::vector<glm::vec3> m_boundsMin;
+    std::vector<glm::vec3> m_boundsMax;
+    std::vector<glm::vec3> m_worldBoundsMin;
+    std::vector<glm::vec3> m_worldBoundsMax;
+    std::vector<unsigned int> m_renderables;
+    std::vector<unsigned char> m_dirty;
+    std::vector<unsigned char> m_visibility;
+    std::vector<unsigned int> m_slotHandles;
+
+    // Slot and generation of each handle index,
+    // and the handle indices free for reuse
+    std::vector<unsigned int> m_handleSlots;
+    std::vector<unsigned int> m_handleGenerations;
+    std::vector<unsigned int> m_freeHandles;
+    bool m_anyDirty;
+};
@@ -24,9 +24,20 @@
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include "gpu-resource-registry.h"
 #include "shader-manager.h"
+#include "shader-source-loader.h"
+
+// Shared by every ShaderManager so that the
+// chunk cache spans all the programs
+static ShaderSourceLoader shaderSourceLoader;
 
 ShaderManager::ShaderManager():
+    m_programBinaryCache(nullptr),
+    m_programStatus(PROGRAM_EMPTY),
+    m_vertexShaderID(0),
+    m_fragmentShaderID(0),
+    m_resourceLabel("Shader program"),
     m_uniformDirectionalLight(DirectLightProperties()),
     m_shaderProgramID(0),
     m_uniformModelLocation(0),
@@ -63,12 +74,90 @@ void ShaderManager::createShaderProgramFromFiles(
     const char* vertexShaderPath,
     const char* fragmentShaderPath)
 {
+    m_resourceLabel = vertexShaderPath;
     std::string vertexShaderString, fragmentShaderString;
     readShaderFile(vertexShaderPath, vertexShaderString);
     readShaderFile(fragmentShaderPath, fragmentShaderString);
     compileShader(vertexShaderString.c_str(), fragmentShaderString.c_str());
 }
 
+void ShaderManager::submitShaderProgramFromFiles(
+    const char* vertexShaderPath,
+    const char* fragmentShaderPath,
+    const std::string &defines)
+{
+    m_resourceLabel = vertexShaderPath;
+    std::string vertexShaderString, fragmentShaderString;
+    readShaderFile(vertexShaderPath, vertexShaderString);
+    readShaderFile(fragmentShaderPath, fragmentShaderString);
+    injectDefines(vertexShaderString, defines);
+    injectDefines(fragmentShaderString, defines);
+    submitShaderProgram(vertexShaderString.c_str(), fragmentShaderString.c_str());
+}
+
+void ShaderManager::createShaderProgramFromFiles(
+    const char* vertexShaderPath,
+    const char* fragmentShaderPath,
+    const std::string &defines)
+{
+    m_resourceLabel = vertexShaderPath;
+    std::string vertexShaderString, fragmentShaderString;
+    readShaderFile(vertexShaderPath, vertexShaderString);
+    readShaderFile(fragmentShaderPath, fragmentShaderString);
+    injectDefines(vertexShaderString, defines);
+    injectDefines(fragmentShaderString, defines);
+    compileShader(vertexShaderString.c_str(), fragmentShaderString.c_str());
+}
+
+void ShaderManager::setProgramBinaryCache(ProgramBinaryCache *programBinaryCache)
+{
+    m_programBinaryCache = programBinaryCache;
+}
+
+GLint ShaderManager::getUniformLocation(unsigned int nameHash)
+{
+    return m_uniformTable.getUniformLocation(nameHash);
+}
+
+void ShaderManager::bindUniformBlock(
+    unsigned int nameHash,
+    GLuint bindingPoint)
+{
+    GLuint blockIndex = m_uniformTable.getUniformBlockIndex(nameHash);
+    if (blockIndex != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(m_shaderProgramID, blockIndex, bindingPoint);
+    }
+}
+
+void ShaderManager::setUniformInt(
+    unsigned int nameHash,
+    GLint value)
+{
+    glUniform1i(m_uniformTable.getUniformLocation(nameHash), value);
+}
+
+void ShaderManager::setUniformFloat(
+    unsigned int nameHash,
+    GLfloat value)
+{
+    glUniform1f(m_uniformTable.getUniformLocation(nameHash), value);
+}
+
+void ShaderManager::setUniformVec3(
+    unsigned int nameHash,
+    const glm::vec3 &value)
+{
+    glUniform3f(m_uniformTable.getUniformLocation(nameHash), value.x, value.y, value.z);
+}
+
+void ShaderManager::setUniformMat4(
+    unsigned int nameHash,
+    const glm::mat4 &value)
+{
+    glUniformMatrix4fv(m_uniformTable.getUniformLocation(nameHash), 1, GL_FALSE, glm::value_ptr(value));
+}
+
 GLuint ShaderManager::getUniformModelLocation()
 {
     return m_uniformModelLocation;
@@ -167,28 +256,66 @@ void ShaderManager::setDirectionalLightShadowMap(GLuint textureUnit)
 
 void ShaderManager::readShaderFile(const char* filePath, std::string &contents)
 {
-    std::ifstream fileStream(filePath, std::ios::in);
-    if (!fileStream.is_open())
+    // Included chunks are shared between all the
+    // programs, so they are only read and parsed once
+    if (!shaderSourceLoader.loadShaderSource(filePath, contents))
     {
         printf(
             "Error: Failed to read file at %s , file does not exist.",
             filePath);
         return;
     }
+}
+
+void ShaderManager::injectDefines(
+    std::string &shaderSource,
+    const std::string &defines)
+{
+    if (defines.empty())
+    {
+        return;
+    }
 
-    std::string line = "";
-    while (!fileStream.eof())
+    // The #version directive has to stay the first
+    // statement of the shader, so the definitions go
+    // on the line right after it
+    size_t versionPosition = shaderSource.find("#version");
+    if (versionPosition == std::string::npos)
     {
-        std::getline(fileStream, line);
-        contents.append(line + "\n");
+        shaderSource.insert(0, defines);
+        return;
     }
 
-    fileStream.close();
+    size_t lineEnd = shaderSource.find('\n', versionPosition);
+    if (lineEnd == std::string::npos)
+    {
+        shaderSource.append("\n");
+        lineEnd = shaderSource.size() - 1;
+    }
+
+    shaderSource.insert(lineEnd + 1, defines);
 }
 
 void ShaderManager::compileShader(
         const char* vertexShaderCode,
         const char* fragmentShaderCode)
+{
+    submitShaderProgram(vertexShaderCode, fragmentShaderCode);
+    waitForShaderProgram();
+}
+
+void ShaderManager::waitForShaderProgram()
+{
+    // Querying the link status blocks until the driver is done,
+    // the loop only repeats when a cached binary got rejected
+    while (!advanceShaderProgram())
+    {
+    }
+}
+
+void ShaderManager::submitShaderProgram(
+        const char* vertexShaderCode,
+        const char* fragmentShaderCode)
 {
     // Create an empty shader program object
     m_shaderProgramID = glCreateProgram();
@@ -197,29 +324,122 @@ void ShaderManager::compileShader(
     if (!m_shaderProgramID)
     {
         printf("Error: Generation of shader program failed!\n");
+        m_programStatus = PROGRAM_FAILED;
         return;
     }
 
+    // The size is only known once the program is linked
+    GetGpuResourceRegistry().addResource(GPU_RESOURCE_PROGRAM, m_shaderProgramID, 0, m_resourceLabel);
+
+    // Keep the sources around in case a
+    // cached binary is rejected later on
+    m_vertexShaderSource = vertexShaderCode;
+    m_fragmentShaderSource = fragmentShaderCode;
+
+    // Try to skip the compilation altogether with
+    // a binary of the program from a previous launch
+    m_programKey.clear();
+    if (m_programBinaryCache && m_programBinaryCache->isEnabled())
+    {
+        m_programKey = m_programBinaryCache->computeProgramKey(vertexShaderCode, fragmentShaderCode);
+        if (m_programBinaryCache->loadProgramBinary(m_shaderProgramID, m_programKey))
+        {
+            m_programStatus = PROGRAM_LOADING_BINARY;
+            return;
+        }
+    }
+
+    submitShaderCompile();
+}
+
+void ShaderManager::submitShaderCompile()
+{
+    if (!m_programKey.empty())
+    {
+        // Ask the driver to keep the binary around
+        // so that it can be retrieved after linking
+        glProgramParameteri(m_shaderProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
     // Attaching our vertex and fragment shaders to the shader program
-    AddShader(vertexShaderCode, GL_VERTEX_SHADER);
-    AddShader(fragmentShaderCode, GL_FRAGMENT_SHADER);
+    m_vertexShaderID = AddShader(m_vertexShaderSource.c_str(), GL_VERTEX_SHADER);
+    m_fragmentShaderID = AddShader(m_fragmentShaderSource.c_str(), GL_FRAGMENT_SHADER);
+
+    // Perform shader program linking, none of the status
+    // checks happen here so that the driver can carry on
+    // compiling while we submit the other programs
+    glLinkProgram(m_shaderProgramID);
+
+    m_programStatus = PROGRAM_COMPILING;
+}
+
+bool ShaderManager::pollShaderProgram()
+{
+    if (m_programStatus == PROGRAM_READY || m_programStatus == PROGRAM_FAILED)
+    {
+        return true;
+    }
+
+    // Without the extension there is no way to ask
+    // without blocking, so the first poll waits
+    if (isParallelCompileSupported())
+    {
+        GLint completed = 0;
+        glGetProgramiv(m_shaderProgramID, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed)
+        {
+            return false;
+        }
+    }
+
+    return advanceShaderProgram();
+}
+
+bool ShaderManager::advanceShaderProgram()
+{
+    if (m_programStatus == PROGRAM_READY || m_programStatus == PROGRAM_FAILED)
+    {
+        return true;
+    }
 
     // Setting up error logging objects
     GLint result = 0;
     GLchar log[1024] = { 0 };
 
-    // Perform shader program linking
-    glLinkProgram(m_shaderProgramID);
-
-    // Find and log errors if any from the linking process done above
     glGetProgramiv(m_shaderProgramID, GL_LINK_STATUS, &result);
+
+    if (m_programStatus == PROGRAM_LOADING_BINARY)
+    {
+        if (!result)
+        {
+            // The driver refused the cached binary,
+            // build the program from source instead
+            submitShaderCompile();
+            return false;
+        }
+
+        getUniformLocations();
+        recordProgramSize();
+        m_programStatus = PROGRAM_READY;
+        return true;
+    }
+
+    // Find and log errors if any from the compilation and linking
     if (!result)
     {
+        logShaderCompileErrors(m_vertexShaderID, GL_VERTEX_SHADER);
+        logShaderCompileErrors(m_fragmentShaderID, GL_FRAGMENT_SHADER);
+
         glGetProgramInfoLog(m_shaderProgramID, sizeof(log), NULL, log);
         printf("Error: Linking of the shader program failed, '%s'\n", log);
-        return;
+        releaseShaders();
+        m_programStatus = PROGRAM_FAILED;
+        return true;
     }
 
+    // The shader objects are no longer needed once linked
+    releaseShaders();
+
     // Perform shader program validation
     glValidateProgram(m_shaderProgramID);
 
@@ -229,90 +449,141 @@ void ShaderManager::compileShader(
     {
         glGetProgramInfoLog(m_shaderProgramID, sizeof(log), NULL, log);
         printf("Error: Shader program validation failed, '%s'", log);
+        m_programStatus = PROGRAM_FAILED;
+        return true;
+    }
+
+    if (!m_programKey.empty())
+    {
+        m_programBinaryCache->saveProgramBinary(m_shaderProgramID, m_programKey);
+    }
+
+    getUniformLocations();
+    recordProgramSize();
+    m_programStatus = PROGRAM_READY;
+    return true;
+}
+
+void ShaderManager::recordProgramSize()
+{
+    // The length of the program binary is the closest
+    // thing to the memory the driver keeps for it
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+    {
         return;
     }
 
+    GLint binaryLength = 0;
+    glGetProgramiv(m_shaderProgramID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    GetGpuResourceRegistry().resizeResource(GPU_RESOURCE_PROGRAM, m_shaderProgramID, binaryLength);
+}
+
+void ShaderManager::releaseShaders()
+{
+    GLuint shaderIDs[] = { m_vertexShaderID, m_fragmentShaderID };
+    for (size_t i = 0; i < 2; ++i)
+    {
+        if (shaderIDs[i])
+        {
+            glDetachShader(m_shaderProgramID, shaderIDs[i]);
+            glDeleteShader(shaderIDs[i]);
+        }
+    }
+
+    m_vertexShaderID = 0;
+    m_fragmentShaderID = 0;
+    m_vertexShaderSource.clear();
+    m_fragmentShaderSource.clear();
+}
+
+void ShaderManager::getUniformLocations()
+{
+    // Ask the program for all of its active uniforms once,
+    // every lookup below (and any later one) is served from
+    // the table instead of the driver
+    m_uniformTable.reflectProgram(m_shaderProgramID);
+
     // Get the location of the uniform variables to
     // provide the transform information to the shader
-    m_uniformModelLocation = glGetUniformLocation(m_shaderProgramID, "model");
-    m_uniformProjectionLocation = glGetUniformLocation(m_shaderProgramID, "projection");
-    m_uniformViewLocation = glGetUniformLocation(m_shaderProgramID, "view");
-    m_uniformSpecularIntensityLocation = glGetUniformLocation(m_shaderProgramID, "material.specularIntensity");
-    m_uniformShininessLocation = glGetUniformLocation(m_shaderProgramID, "material.shininess");
-    m_uniformCameraPosition = glGetUniformLocation(m_shaderProgramID, "cameraPosition");
-    m_uniformDirectionalLight.base.m_uniformLightColorLocation = glGetUniformLocation(m_shaderProgramID, "directLight.base.lightColor");
-    m_uniformDirectionalLight.base.m_uniformAmbientIntensityLocation = glGetUniformLocation(m_shaderProgramID, "directLight.base.ambientLightIntensity");
-    m_uniformDirectionalLight.base.m_uniformDiffuseIntensityLocation = glGetUniformLocation(m_shaderProgramID, "directLight.base.diffuseLightIntensity");
-    m_uniformDirectionalLight.m_uniformDirectLightDirectionLocation = glGetUniformLocation(m_shaderProgramID, "directLight.directLightDirection");
+    m_uniformModelLocation = m_uniformTable.getUniformLocation(HashUniformName("model"));
+    m_uniformProjectionLocation = m_uniformTable.getUniformLocation(HashUniformName("projection"));
+    m_uniformViewLocation = m_uniformTable.getUniformLocation(HashUniformName("view"));
+    m_uniformSpecularIntensityLocation = m_uniformTable.getUniformLocation(HashUniformName("material.specularIntensity"));
+    m_uniformShininessLocation = m_uniformTable.getUniformLocation(HashUniformName("material.shininess"));
+    m_uniformCameraPosition = m_uniformTable.getUniformLocation(HashUniformName("cameraPosition"));
+    m_uniformDirectionalLight.base.m_uniformLightColorLocation = m_uniformTable.getUniformLocation(HashUniformName("directLight.base.lightColor"));
+    m_uniformDirectionalLight.base.m_uniformAmbientIntensityLocation = m_uniformTable.getUniformLocation(HashUniformName("directLight.base.ambientLightIntensity"));
+    m_uniformDirectionalLight.base.m_uniformDiffuseIntensityLocation = m_uniformTable.getUniformLocation(HashUniformName("directLight.base.diffuseLightIntensity"));
+    m_uniformDirectionalLight.m_uniformDirectLightDirectionLocation = m_uniformTable.getUniformLocation(HashUniformName("directLight.directLightDirection"));
 
     // Get point light properties locations
-    m_uniformNumberOfPointLightsLocation = glGetUniformLocation(m_shaderProgramID, "numberOfPointLights");
+    m_uniformNumberOfPointLightsLocation = m_uniformTable.getUniformLocation(HashUniformName("numberOfPointLights"));
 
     for (size_t i = 0; i < MAX_POINT_LIGHTS; ++i)
     {
         char locationStringBuffer[100] = {'\0'};
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "pointLights[%lu].base.lightColor", i);
-        m_uniformPointLights[i].base.m_uniformLightColorLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformPointLights[i].base.m_uniformLightColorLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "pointLights[%lu].base.ambientLightIntensity", i);
-        m_uniformPointLights[i].base.m_uniformAmbientIntensityLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformPointLights[i].base.m_uniformAmbientIntensityLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "pointLights[%lu].base.diffuseLightIntensity", i);
-        m_uniformPointLights[i].base.m_uniformDiffuseIntensityLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformPointLights[i].base.m_uniformDiffuseIntensityLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "pointLights[%lu].position", i);
-        m_uniformPointLights[i].m_uniformPointLightPositionLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformPointLights[i].m_uniformPointLightPositionLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "pointLights[%lu].constant", i);
-        m_uniformPointLights[i].m_uniformConstantLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformPointLights[i].m_uniformConstantLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "pointLights[%lu].linear", i);
-        m_uniformPointLights[i].m_uniformLinearLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformPointLights[i].m_uniformLinearLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "pointLights[%lu].exponent", i);
-        m_uniformPointLights[i].m_uniformExponentLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformPointLights[i].m_uniformExponentLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
     }
 
     // Get spot light properties locations
-    m_uniformNumberOfSpotLightsLocation = glGetUniformLocation(m_shaderProgramID, "numberOfSpotLights");
+    m_uniformNumberOfSpotLightsLocation = m_uniformTable.getUniformLocation(HashUniformName("numberOfSpotLights"));
 
     for (size_t i = 0; i < MAX_SPOT_LIGHTS; ++i)
     {
         char locationStringBuffer[100] = {'\0'};
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "spotLights[%lu].pointLightBase.base.lightColor", i);
-        m_uniformSpotLights[i].pointLightBase.base.m_uniformLightColorLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformSpotLights[i].pointLightBase.base.m_uniformLightColorLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "spotLights[%lu].pointLightBase.base.ambientLightIntensity", i);
-        m_uniformSpotLights[i].pointLightBase.base.m_uniformAmbientIntensityLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformSpotLights[i].pointLightBase.base.m_uniformAmbientIntensityLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "spotLights[%lu].pointLightBase.base.diffuseLightIntensity", i);
-        m_uniformSpotLights[i].pointLightBase.base.m_uniformDiffuseIntensityLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformSpotLights[i].pointLightBase.base.m_uniformDiffuseIntensityLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "spotLights[%lu].pointLightBase.position", i);
-        m_uniformSpotLights[i].pointLightBase.m_uniformPointLightPositionLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformSpotLights[i].pointLightBase.m_uniformPointLightPositionLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "spotLights[%lu].pointLightBase.constant", i);
-        m_uniformSpotLights[i].pointLightBase.m_uniformConstantLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformSpotLights[i].pointLightBase.m_uniformConstantLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "spotLights[%lu].pointLightBase.linear", i);
-        m_uniformSpotLights[i].pointLightBase.m_uniformLinearLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformSpotLights[i].pointLightBase.m_uniformLinearLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "spotLights[%lu].pointLightBase.exponent", i);
-        m_uniformSpotLights[i].pointLightBase.m_uniformExponentLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformSpotLights[i].pointLightBase.m_uniformExponentLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "spotLights[%lu].direction", i);
-        m_uniformSpotLights[i].m_uniformSpotLightDirectionLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformSpotLights[i].m_uniformSpotLightDirectionLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
 
         snprintf(locationStringBuffer, sizeof(locationStringBuffer), "spotLights[%lu].cosineCutOffAngle", i);
-        m_uniformSpotLights[i].m_uniformCosineCutOffLocation = glGetUniformLocation(m_shaderProgramID, locationStringBuffer);
+        m_uniformSpotLights[i].m_uniformCosineCutOffLocation = m_uniformTable.getUniformLocation(HashUniformName(locationStringBuffer));
     }
 
-    m_uniformPrimaryTextureLocation = glGetUniformLocation(m_shaderProgramID, "textureSampler");
-    m_uniformDirectionalLightTransformLocation = glGetUniformLocation(m_shaderProgramID, "directionalLightTransform");
-    m_uniformDirectionalLightShadowMapLocation = glGetUniformLocation(m_shaderProgramID, "directionalLightShadowMapSampler");
+    m_uniformPrimaryTextureLocation = m_uniformTable.getUniformLocation(HashUniformName("textureSampler"));
+    m_uniformDirectionalLightTransformLocation = m_uniformTable.getUniformLocation(HashUniformName("directionalLightTransform"));
+    m_uniformDirectionalLightShadowMapLocation = m_uniformTable.getUniformLocation(HashUniformName("directionalLightShadowMapSampler"));
 }
 
-void ShaderManager::AddShader(
+GLuint ShaderManager::AddShader(
     const char* shaderSource,
     GLenum shaderType)
 {
@@ -334,8 +605,24 @@ void ShaderManager::AddShader(
     glShaderSource(shaderID, 1, sourceCode, sourceLength);
     glCompileShader(shaderID);
 
+    // Attach the shader to the shader program, the result
+    // of the compilation is only checked after linking
+    glAttachShader(m_shaderProgramID, shaderID);
+
+    return shaderID;
+}
+
+void ShaderManager::logShaderCompileErrors(
+    GLuint shaderID,
+    GLenum shaderType)
+{
+    if (!shaderID)
+    {
+        return;
+    }
+
     // Find and log error if any from 
-    // the above compilation process
+    // the compilation of the shader
     GLint result = 0;
     GLchar log[1024] = { 0 };
 
@@ -344,11 +631,41 @@ void ShaderManager::AddShader(
     {
         glGetShaderInfoLog(shaderID, sizeof(log), NULL, log);
         printf("Error: Compilation of shader of type %d failed, '%s'\n", shaderType, log);
-        return;
+
+        // The log refers to the files by their
+        // source string number, so list them
+        for (unsigned int i = 0; i < shaderSourceLoader.getSourceCount(); ++i)
+        {
+            printf("    source %u: %s\n", i, shaderSourceLoader.getSourceName(i).c_str());
+        }
     }
+}
 
-    // Attach the shader to the shader program
-    glAttachShader(m_shaderProgramID, shaderID);
+bool ShaderManager::isParallelCompileSupported()
+{
+    return GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+}
+
+void ShaderManager::setMaxCompilerThreads(GLuint threadCount)
+{
+    if (GLAD_GL_KHR_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsKHR(threadCount);
+    }
+    else if (GLAD_GL_ARB_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsARB(threadCount);
+    }
+}
+
+bool ShaderManager::isShaderProgramReady()
+{
+    return m_programStatus == PROGRAM_READY;
+}
+
+bool ShaderManager::isShaderProgramFailed()
+{
+    return m_programStatus == PROGRAM_FAILED;
 }
 
 void ShaderManager::useShader()
@@ -358,13 +675,19 @@ void ShaderManager::useShader()
 
 void ShaderManager::clearShader()
 {
+    releaseShaders();
+    m_programKey.clear();
+    m_programStatus = PROGRAM_EMPTY;
+
     if (m_shaderProgramID)
     {
         // Free the shader program from memory (graphics)
+        GetGpuResourceRegistry().removeResource(GPU_RESOURCE_PROGRAM, m_shaderProgramID);
         glDeleteProgram(m_shaderProgramID);
         m_shaderProgramID = 0;
     }
 
+    m_uniformTable.clearUniformTable();
     m_uniformModelLocation = 0;
     m_uniformProjectionLocation = 0;
     m_uniformViewLocation = 0;
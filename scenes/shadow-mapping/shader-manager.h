@@ -28,13 +28,16 @@
 #include <string.h> // for strlen
 #include <iostream>
 #include <fstream>
+#include <string>
 
 #include <glad/glad.h>
 
 #include "constants.h"
 #include "directional-light.h"
 #include "point-light.h"
+#include "program-binary-cache.h"
 #include "spot-light.h"
+#include "uniform-table.h"
 
 class ShaderManager
 {
@@ -47,6 +50,59 @@ public:
         const char* vertexShaderPath,
         const char* fragmentShaderPath);
 
+    // Same as above but the given preprocessor
+    // definitions (e.g. "#define USE_TEXTURE_ARRAY\n")
+    // are inserted right after the #version line
+    // of both the shader sources
+    void createShaderProgramFromFiles(
+        const char* vertexShaderPath,
+        const char* fragmentShaderPath,
+        const std::string &defines);
+
+    // Kicks off the compilation and linking of the program
+    // without waiting on the driver, call pollShaderProgram()
+    // until it returns true before using the program
+    void submitShaderProgramFromFiles(
+        const char* vertexShaderPath,
+        const char* fragmentShaderPath,
+        const std::string &defines = "");
+
+    // Returns true once the submitted program has either
+    // finished linking (its uniforms are then resolved)
+    // or failed, never blocks with KHR_parallel_shader_compile
+    bool pollShaderProgram();
+    void waitForShaderProgram();
+    bool isShaderProgramReady();
+    bool isShaderProgramFailed();
+
+    // Lets the driver compile shaders on its own threads
+    static bool isParallelCompileSupported();
+    static void setMaxCompilerThreads(GLuint threadCount);
+
+    // Programs created after this call are loaded from
+    // and stored into the given cache of program binaries
+    void setProgramBinaryCache(ProgramBinaryCache *programBinaryCache);
+
+    // Generic access to any uniform of the program through its
+    // reflected table, the names are given as HashUniformName()
+    // hashes so that no string lookup happens per frame
+    GLint getUniformLocation(unsigned int nameHash);
+    void bindUniformBlock(
+        unsigned int nameHash,
+        GLuint bindingPoint);
+    void setUniformInt(
+        unsigned int nameHash,
+        GLint value);
+    void setUniformFloat(
+        unsigned int nameHash,
+        GLfloat value);
+    void setUniformVec3(
+        unsigned int nameHash,
+        const glm::vec3 &value);
+    void setUniformMat4(
+        unsigned int nameHash,
+        const glm::mat4 &value);
+
     GLuint getUniformModelLocation();
     GLuint getUniformProjectionLocation();
     GLuint getUniformViewLocation();
@@ -67,15 +123,55 @@ public:
     ~ShaderManager();
 
 private:
+    // Owns a GL program, a copy would delete it twice
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
     void readShaderFile(
         const char* filePath,
         std::string &contents);
+    void injectDefines(
+        std::string &shaderSource,
+        const std::string &defines);
     void compileShader(
         const char* vertexShaderCode,
         const char* fragmentShaderCode);
-    void AddShader(
+    void submitShaderProgram(
+        const char* vertexShaderCode,
+        const char* fragmentShaderCode);
+    void submitShaderCompile();
+    bool advanceShaderProgram();
+    void releaseShaders();
+    GLuint AddShader(
         const char* shaderSource,
         GLenum shaderType);
+    void logShaderCompileErrors(
+        GLuint shaderID,
+        GLenum shaderType);
+    void getUniformLocations();
+    void recordProgramSize();
+
+    enum ProgramStatus
+    {
+        PROGRAM_EMPTY,
+        PROGRAM_LOADING_BINARY,
+        PROGRAM_COMPILING,
+        PROGRAM_READY,
+        PROGRAM_FAILED
+    };
+
+    ProgramBinaryCache *m_programBinaryCache;
+    ProgramStatus m_programStatus;
+    UniformTable m_uniformTable;
+
+    // Sources and shader objects of a program that
+    // is still being compiled, released once linked
+    std::string m_vertexShaderSource, m_fragmentShaderSource;
+    GLuint m_vertexShaderID, m_fragmentShaderID;
+    std::string m_programKey;
+
+    // Owner of the program in the GPU resource registry
+    std::string m_resourceLabel;
 
     struct LightBaseProperties
     {
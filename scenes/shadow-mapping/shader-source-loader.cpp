@@ -0,0 +1,274 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include <cstdio>
+
+#include "shader-source-loader.h"
+
+// Extracts the quoted path of an #include directive,
+// returns false for any other line
+static bool ParseIncludeDirective(
+    const std::string &line,
+    std::string &includePath)
+{
+    size_t position = line.find_first_not_of(" \t");
+    if (position == std::string::npos || line.compare(position, 8, "#include") != 0)
+    {
+        return false;
+    }
+
+    size_t pathStart = line.find('"', position + 8);
+    if (pathStart == std::string::npos)
+    {
+        return false;
+    }
+
+    size_t pathEnd = line.find('"', pathStart + 1);
+    if (pathEnd == std::string::npos)
+    {
+        return false;
+    }
+
+    includePath = line.substr(pathStart + 1, pathEnd - pathStart - 1);
+    return true;
+}
+
+ShaderSourceLoader::ShaderSourceLoader()
+{
+}
+
+bool ShaderSourceLoader::readFile(
+    const std::string &filePath,
+    std::string &contents)
+{
+    FILE *file = fopen(filePath.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    // Size the string up front and read the whole file at once
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (fileSize < 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    contents.resize(fileSize);
+    size_t bytesRead = fileSize ? fread(&contents[0], 1, fileSize, file) : 0;
+    fclose(file);
+
+    return bytesRead == (size_t)fileSize;
+}
+
+const ShaderSourceLoader::Chunk* ShaderSourceLoader::getChunk(const std::string &filePath)
+{
+    std::map<std::string, Chunk>::iterator it = m_chunks.find(filePath);
+    if (it != m_chunks.end())
+    {
+        return &it->second;
+    }
+
+    std::string contents;
+    if (!readFile(filePath, contents))
+    {
+        return nullptr;
+    }
+
+    // Split the file into runs of plain lines
+    // separated by the include directives
+    Chunk chunk;
+    chunk.sourceNumber = m_sourceNames.size();
+    m_sourceNames.push_back(filePath);
+
+    // Windows line endings would otherwise end up
+    // inside the include paths
+    contents.erase(std::remove(contents.begin(), contents.end(), '\r'), contents.end());
+
+    Segment segment;
+    segment.firstLine = 1;
+
+    unsigned int lineNumber = 1;
+    size_t lineStart = 0;
+    while (lineStart < contents.size())
+    {
+        size_t lineEnd = contents.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+        {
+            lineEnd = contents.size();
+        }
+
+        std::string line = contents.substr(lineStart, lineEnd - lineStart);
+        std::string includePath;
+
+        if (ParseIncludeDirective(line, includePath))
+        {
+            if (!segment.text.empty())
+            {
+                chunk.segments.push_back(segment);
+            }
+
+            Segment include;
+            include.firstLine = lineNumber;
+            include.includePath = includePath;
+            chunk.segments.push_back(include);
+
+            segment = Segment();
+            segment.firstLine = lineNumber + 1;
+        }
+        else
+        {
+            segment.text.append(line);
+            segment.text.append("\n");
+        }
+
+        lineStart = lineEnd + 1;
+        ++lineNumber;
+    }
+
+    if (!segment.text.empty())
+    {
+        chunk.segments.push_back(segment);
+    }
+
+    return &(m_chunks[filePath] = chunk);
+}
+
+bool ShaderSourceLoader::appendChunk(
+    const std::string &filePath,
+    std::set<std::string> &includedFiles,
+    std::vector<std::string> &includeStack,
+    std::string &source)
+{
+    if (std::find(includeStack.begin(), includeStack.end(), filePath) != includeStack.end())
+    {
+        printf("Error: ShaderSourceLoader::appendChunk(): %s includes itself\n", filePath.c_str());
+        return false;
+    }
+
+    const Chunk *chunk = getChunk(filePath);
+    if (!chunk)
+    {
+        printf("Error: ShaderSourceLoader::appendChunk(): Failed to read file at %s\n", filePath.c_str());
+        return false;
+    }
+
+    includedFiles.insert(filePath);
+    includeStack.push_back(filePath);
+
+    // Included paths are relative to the including file
+    std::string directory;
+    size_t slash = filePath.find_last_of('/');
+    if (slash != std::string::npos)
+    {
+        directory = filePath.substr(0, slash + 1);
+    }
+
+    char lineDirective[64] = {'\0'};
+
+    for (size_t i = 0; i < chunk->segments.size(); ++i)
+    {
+        const Segment &segment = chunk->segments[i];
+
+        if (segment.includePath.empty())
+        {
+            if (i == 0 && includeStack.size() == 1)
+            {
+                // The #version directive has to stay the first statement
+                // of the shader, so the top level file gets its numbering
+                // right after it. Definitions injected after the #version
+                // line later on then do not shift the reported lines.
+                std::string text = segment.text;
+                size_t versionPosition = text.find("#version");
+                size_t lineEnd = versionPosition == std::string::npos ? std::string::npos : text.find('\n', versionPosition);
+                if (lineEnd != std::string::npos)
+                {
+                    unsigned int versionLine = segment.firstLine + std::count(text.begin(), text.begin() + versionPosition, '\n');
+                    snprintf(lineDirective, sizeof(lineDirective), "#line %u %u\n", versionLine + 1, chunk->sourceNumber);
+                    text.insert(lineEnd + 1, lineDirective);
+                }
+                source.append(text);
+                continue;
+            }
+
+            // Any other run of lines resets the numbering
+            // back to the file it comes from
+            snprintf(lineDirective, sizeof(lineDirective), "#line %u %u\n", segment.firstLine, chunk->sourceNumber);
+            source.append(lineDirective);
+            source.append(segment.text);
+            continue;
+        }
+
+        // Act as an include guard, each file
+        // only ends up in a program once
+        std::string includePath = directory + segment.includePath;
+        if (includedFiles.count(includePath))
+        {
+            source.append("\n");
+            continue;
+        }
+
+        if (!appendChunk(includePath, includedFiles, includeStack, source))
+        {
+            includeStack.pop_back();
+            return false;
+        }
+    }
+
+    includeStack.pop_back();
+    return true;
+}
+
+bool ShaderSourceLoader::loadShaderSource(
+    const char* filePath,
+    std::string &source)
+{
+    std::set<std::string> includedFiles;
+    std::vector<std::string> includeStack;
+
+    source.clear();
+    return appendChunk(filePath, includedFiles, includeStack, source);
+}
+
+const std::string& ShaderSourceLoader::getSourceName(unsigned int sourceNumber)
+{
+    static const std::string unknownSource = "<unknown>";
+    return sourceNumber < m_sourceNames.size() ? m_sourceNames[sourceNumber] : unknownSource;
+}
+
+unsigned int ShaderSourceLoader::getSourceCount()
+{
+    return m_sourceNames.size();
+}
+
+void ShaderSourceLoader::clearShaderSourceLoader()
+{
+    m_chunks.clear();
+    m_sourceNames.clear();
+}
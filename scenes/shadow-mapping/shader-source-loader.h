@@ -0,0 +1,84 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Loads GLSL sources and resolves their #include "file" directives.
+// Paths are relative to the including file and every file is only
+// pulled into a program once, so the included chunks need no guards
+// of their own. Files are read in one go and parsed once, and the
+// parsed chunks are kept around for all the programs that use them.
+// #line directives keep the line numbers of compile errors pointing
+// at the original file, see getSourceName() for the file numbers.
+class ShaderSourceLoader
+{
+public:
+    ShaderSourceLoader();
+
+    // Returns false if the file or one of its includes
+    // could not be read (or includes itself)
+    bool loadShaderSource(
+        const char* filePath,
+        std::string &source);
+
+    // The file behind the source string number
+    // reported in the shader compiler's log
+    const std::string& getSourceName(unsigned int sourceNumber);
+    unsigned int getSourceCount();
+
+    void clearShaderSourceLoader();
+
+private:
+    // A run of consecutive lines, or an include directive
+    struct Segment
+    {
+        std::string text;
+        unsigned int firstLine;
+        std::string includePath;
+    };
+
+    struct Chunk
+    {
+        unsigned int sourceNumber;
+        std::vector<Segment> segments;
+    };
+
+    const Chunk* getChunk(const std::string &filePath);
+    bool readFile(
+        const std::string &filePath,
+        std::string &contents);
+    bool appendChunk(
+        const std::string &filePath,
+        std::set<std::string> &includedFiles,
+        std::vector<std::string> &includeStack,
+        std::string &source);
+
+    std::map<std::string, Chunk> m_chunks;
+    std::vector<std::string> m_sourceNames;
+};
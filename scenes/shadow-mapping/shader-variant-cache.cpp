@@ -0,0 +1,146 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstdio>
+
+#include "shader-variant-cache.h"
+
+ShaderVariant::ShaderVariant() :
+    pointLightCount(0),
+    spotLightCount(0),
+    shadowsEnabled(true),
+    pcfKernelSize(3),
+    textureEnabled(true),
+    textureArrayEnabled(false)
+{
+}
+
+void ShaderVariant::getKey(char *key, size_t size) const
+{
+    snprintf(key, size, "P%u_S%u_SH%d_PCF%u_T%d_TA%d",
+        pointLightCount < MAX_POINT_LIGHTS ? pointLightCount : MAX_POINT_LIGHTS,
+        spotLightCount < MAX_SPOT_LIGHTS ? spotLightCount : MAX_SPOT_LIGHTS,
+        shadowsEnabled ? 1 : 0,
+        shadowsEnabled ? (pcfKernelSize | 1) : 0,
+        textureEnabled ? 1 : 0,
+        textureEnabled && textureArrayEnabled ? 1 : 0);
+}
+
+std::string ShaderVariant::getDefines() const
+{
+    // The light counts can not exceed the size of
+    // the uniform arrays declared in the shaders
+    unsigned int pointLights = pointLightCount < MAX_POINT_LIGHTS ? pointLightCount : MAX_POINT_LIGHTS;
+    unsigned int spotLights = spotLightCount < MAX_SPOT_LIGHTS ? spotLightCount : MAX_SPOT_LIGHTS;
+
+    // An even kernel would not be centred on the
+    // fragment, so round it up to the next odd size
+    unsigned int kernelSize = pcfKernelSize | 1;
+
+    char defines[300] = {'\0'};
+    snprintf(defines, sizeof(defines),
+        "#define POINT_LIGHT_COUNT %u\n"
+        "#define SPOT_LIGHT_COUNT %u\n"
+        "#define USE_SHADOWS %d\n"
+        "#define PCF_KERNEL_SIZE %u\n"
+        "#define USE_TEXTURE %d\n",
+        pointLights,
+        spotLights,
+        shadowsEnabled ? 1 : 0,
+        kernelSize,
+        textureEnabled ? 1 : 0);
+
+    std::string result = defines;
+    if (textureEnabled && textureArrayEnabled)
+    {
+        result.append("#define USE_TEXTURE_ARRAY\n");
+    }
+    return result;
+}
+
+ShaderVariantCache::ShaderVariantCache() :
+    m_programBinaryCache(nullptr)
+{
+}
+
+void ShaderVariantCache::setShaderFiles(
+    const char* vertexShaderPath,
+    const char* fragmentShaderPath,
+    const std::string &defines)
+{
+    m_vertexShaderPath = vertexShaderPath;
+    m_fragmentShaderPath = fragmentShaderPath;
+    m_defines = defines;
+}
+
+void ShaderVariantCache::setProgramBinaryCache(ProgramBinaryCache *programBinaryCache)
+{
+    m_programBinaryCache = programBinaryCache;
+}
+
+ShaderManager* ShaderVariantCache::requestVariant(const ShaderVariant &variant)
+{
+    char key[100] = {'\0'};
+    variant.getKey(key, sizeof(key));
+
+    std::map<std::string, ShaderManager, std::less<> >::iterator it = m_variants.find(key);
+    if (it != m_variants.end())
+    {
+        return &it->second;
+    }
+
+    // Construct the program in place, ShaderManager
+    // owns a GL program so it is never copied around
+    ShaderManager &shader = m_variants[std::string(key)];
+    shader.setProgramBinaryCache(m_programBinaryCache);
+    shader.submitShaderProgramFromFiles(
+        m_vertexShaderPath.c_str(),
+        m_fragmentShaderPath.c_str(),
+        m_defines + variant.getDefines());
+
+    return &shader;
+}
+
+ShaderManager* ShaderVariantCache::getVariant(const ShaderVariant &variant)
+{
+    ShaderManager *shader = requestVariant(variant);
+    shader->waitForShaderProgram();
+    return shader;
+}
+
+size_t ShaderVariantCache::getVariantCount()
+{
+    return m_variants.size();
+}
+
+void ShaderVariantCache::clearVariants()
+{
+    // Each ShaderManager frees its program on destruction
+    m_variants.clear();
+}
+
+ShaderVariantCache::~ShaderVariantCache()
+{
+    clearVariants();
+}
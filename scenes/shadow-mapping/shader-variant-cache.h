@@ -0,0 +1,98 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+
+#include "shader-manager.h"
+
+// Describes the features a shader program is specialised
+// for. Each field turns into a #define injected after the
+// #version line, which lets the compiler unroll the light
+// loops and strip out the unused code paths entirely.
+struct ShaderVariant
+{
+    ShaderVariant();
+
+    unsigned int pointLightCount;
+    unsigned int spotLightCount;
+    bool shadowsEnabled;
+
+    // Width of the square PCF filter (e.g. 3 for 3x3 taps)
+    unsigned int pcfKernelSize;
+
+    bool textureEnabled;
+    bool textureArrayEnabled;
+
+    // Unique per set of defines, used to look up the program.
+    // Written into a caller buffer so the per frame lookups
+    // don't have to build a std::string on the heap.
+    void getKey(char *key, size_t size) const;
+    std::string getDefines() const;
+};
+
+// Holds one program per variant of a vertex and fragment
+// shader pair. Variants are compiled the first time they are
+// requested and kept around for whenever the scene needs them
+// again, so switching between them never recompiles.
+class ShaderVariantCache
+{
+public:
+    ShaderVariantCache();
+
+    // The defines are added to those of every variant
+    void setShaderFiles(
+        const char* vertexShaderPath,
+        const char* fragmentShaderPath,
+        const std::string &defines = "");
+    void setProgramBinaryCache(ProgramBinaryCache *programBinaryCache);
+
+    // Submits the variant for compilation the first time it is
+    // requested. The program may not be ready yet, poll it with
+    // ShaderManager::pollShaderProgram() before using it.
+    ShaderManager* requestVariant(const ShaderVariant &variant);
+
+    // Same as above but waits for the program to be linked
+    ShaderManager* getVariant(const ShaderVariant &variant);
+
+    size_t getVariantCount();
+
+    void clearVariants();
+
+    ~ShaderVariantCache();
+
+private:
+    std::string m_vertexShaderPath;
+    std::string m_fragmentShaderPath;
+    std::string m_defines;
+    ProgramBinaryCache *m_programBinaryCache;
+
+    // Nodes of a map never move, so the programs handed out
+    // stay valid as variants are added. The transparent
+    // comparator lets lookups use a plain char buffer.
+    std::map<std::string, ShaderManager, std::less<> > m_variants;
+};
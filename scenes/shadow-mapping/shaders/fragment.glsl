@@ -49,43 +49,26 @@ in vec3 worldSpacePosition;
 
 in vec4 directionalLightSpacePosition;
 
-// We keep this in sync with the constant
-// values specified in the constants.h file
-const int MAX_POINT_LIGHTS = 3;
-const int MAX_SPOT_LIGHTS = 3;
-
-// Blueprint of the base light properties
-struct LightBaseProperties
-{
-    vec3 lightColor;
-    float ambientLightIntensity;
-    float diffuseLightIntensity;
-};
-
-// Blueprint of the direct light properties
-struct DirectLightProperties
-{
-    LightBaseProperties base;
-    vec3 directLightDirection;
-};
-
-// Blueprint of the point light properties
-struct PointLightProperties
-{
-    LightBaseProperties base;
-    vec3 position;
-    float constant;
-    float linear;
-    float exponent;
-};
-
-// Blueprint of the spot light properties
-struct SpotLightProperties
-{
-    PointLightProperties pointLightBase;
-    vec3 direction;
-    float cosineCutOffAngle;
-};
+// Light constants and structures
+#include "lights.glsl"
+
+// Shader variants inject these definitions after the
+// #version line. Without them the shader falls back to
+// the runtime light counts with shadows and texturing on.
+// POINT_LIGHT_COUNT and SPOT_LIGHT_COUNT fix the number of
+// lights at compile time so that the loops get unrolled.
+#ifndef USE_SHADOWS
+#define USE_SHADOWS 1
+#endif
+
+// Width of the square percentage closer filter
+#ifndef PCF_KERNEL_SIZE
+#define PCF_KERNEL_SIZE 3
+#endif
+
+#ifndef USE_TEXTURE
+#define USE_TEXTURE 1
+#endif
 
 // The number of active point lights
 // out of the available MAX_POINT_LIGHTS
@@ -116,13 +99,25 @@ struct Material
 
 // The sampler2D object is referring to
 // the default texture unit GL_TEXTURE0.
+// When the textures are packed into a texture
+// array, the layer is chosen per draw.
+#ifdef USE_TEXTURE_ARRAY
+flat in float textureLayer;
+uniform sampler2DArray textureSampler;
+#else
 uniform sampler2D textureSampler;
+#endif
 uniform sampler2D directionalLightShadowMapSampler;
 
 // Material properties required to
 // set the perform specular lighting
-// calculations
+// calculations. Indirect draws pass
+// them on from their per-draw data.
+#ifdef USE_DRAW_MATERIAL
+flat in vec2 drawMaterial;
+#else
 uniform Material material;
+#endif
 
 // We calculate the specular lighting
 // with respect to the camera position
@@ -147,16 +142,17 @@ float calculateDirectionalLightShadowFactor(DirectLightProperties light)
     float bias = max(0.05 * (1 - dot(newNormal, lightDirection)), 0.005);
     float shadowFactor = 0.0; 
     vec2 texelSize = 1.0 / textureSize(directionalLightShadowMapSampler, 0);
-    for (int x = -1; x <= 1; ++x)
+    const int kernelRadius = PCF_KERNEL_SIZE / 2;
+    for (int x = -kernelRadius; x <= kernelRadius; ++x)
     {
-        for (int y = -1; y <= 1; ++y)
+        for (int y = -kernelRadius; y <= kernelRadius; ++y)
         {
             float pcfDepth = texture(directionalLightShadowMapSampler, projectionCoordinates.xy + vec2(x, y) * texelSize).r;
             shadowFactor += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
         }
     }
 
-    shadowFactor /= 9.0;
+    shadowFactor /= float(PCF_KERNEL_SIZE * PCF_KERNEL_SIZE);
 
     if (projectionCoordinates.z > 1.0)
     {
@@ -189,6 +185,10 @@ vec4 calculateLightContribution(LightBaseProperties light, vec3 direction, float
         float specularFactor = dot(FragmentToCamera, lightReflectionDirection);
         if (specularFactor > 0.0f)
         {
+#ifdef USE_DRAW_MATERIAL
+            Material material = Material(drawMaterial.x, drawMaterial.y);
+#endif
+
             // Raise the specular factor to the power of the shininess value
             specularFactor = pow(specularFactor, material.shininess);
             specularColor = vec4(light.lightColor * material.specularIntensity * specularFactor, 1.0f);
@@ -200,7 +200,11 @@ vec4 calculateLightContribution(LightBaseProperties light, vec3 direction, float
 
 vec4 calculateDirectLight()
 {
+#if USE_SHADOWS
     float shadowFactor = calculateDirectionalLightShadowFactor(directLight);
+#else
+    float shadowFactor = 0.0;
+#endif
     return calculateLightContribution(directLight.base, directLight.directLightDirection, shadowFactor);
 }
 
@@ -230,8 +234,14 @@ vec4 calculatePointLights()
     // at a fragment position
     vec4 totalColor = vec4(0.0f, 0.0f, 0.0f, 0.0f);
 
-    // Loop through all the point lights and find their contributions
+    // Loop through all the point lights and find their contributions,
+    // a constant count lets the compiler unroll the loop (or drop
+    // it altogether when there are no point lights)
+#ifdef POINT_LIGHT_COUNT
+    for (int i = 0; i < POINT_LIGHT_COUNT; ++i)
+#else
     for (int i = 0; i < numberOfPointLights; ++i)
+#endif
     {   
         // Add the total color contributions from the given point light
         totalColor += calculatePointLight(pointLights[i]);
@@ -268,7 +278,11 @@ vec4 calculateSpotLights()
     // at a fragment position
     vec4 totalColor = vec4(0.0f, 0.0f, 0.0f, 0.0f);
 
+#ifdef SPOT_LIGHT_COUNT
+    for (int i = 0; i < SPOT_LIGHT_COUNT; ++i)
+#else
     for (int i = 0; i < numberOfSpotLights; ++i)
+#endif
     {
         // Add the total color contributions from the given spot light
         totalColor += calculateSpotLight(spotLights[i]);
@@ -288,5 +302,11 @@ void main()
     lightingColor += calculateSpotLights();
 
     // Compute the final pixel (so called) color based on the texture and light contributions
+#if !USE_TEXTURE
+    color = lightingColor;
+#elif defined(USE_TEXTURE_ARRAY)
+    color = texture(textureSampler, vec3(textureCoordinate, textureLayer)) * lightingColor;
+#else
     color = texture(textureSampler, textureCoordinate) * lightingColor;
+#endif
 }
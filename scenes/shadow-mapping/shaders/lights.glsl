@@ -0,0 +1,64 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Light definitions shared by the lit shaders,
+// pulled in with #include "lights.glsl"
+
+// We keep this in sync with the constant
+// values specified in the constants.h file
+const int MAX_POINT_LIGHTS = 3;
+const int MAX_SPOT_LIGHTS = 3;
+
+// Blueprint of the base light properties
+struct LightBaseProperties
+{
+    vec3 lightColor;
+    float ambientLightIntensity;
+    float diffuseLightIntensity;
+};
+
+// Blueprint of the direct light properties
+struct DirectLightProperties
+{
+    LightBaseProperties base;
+    vec3 directLightDirection;
+};
+
+// Blueprint of the point light properties
+struct PointLightProperties
+{
+    LightBaseProperties base;
+    vec3 position;
+    float constant;
+    float linear;
+    float exponent;
+};
+
+// Blueprint of the spot light properties
+struct SpotLightProperties
+{
+    PointLightProperties pointLightBase;
+    vec3 direction;
+    float cosineCutOffAngle;
+};
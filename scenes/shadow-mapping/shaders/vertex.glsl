@@ -63,12 +63,24 @@ out vec3 worldSpacePosition;
 
 out vec4 directionalLightSpacePosition;
 
+#ifdef USE_TEXTURE_ARRAY
+// Layer of the texture array to sample from. The
+// attribute array is left disabled, so every vertex
+// reads the constant value set before the draw call.
+layout (location = 8) in float inTextureLayer;
+flat out float textureLayer;
+#endif
+
 void main()
 {
     gl_Position = projection * view * model * vec4(position, 1.0f);
     vertexColor = vec4(clamp(position, 0.0f, 1.0f), 1.0f);
     textureCoordinate = inTextureCoordinate;
 
+#ifdef USE_TEXTURE_ARRAY
+    textureLayer = inTextureLayer;
+#endif
+
     // A transformation cannot be directly applied
     // to normals (especially, non-uniform transformations).
     // Instead we make use of the transpose of the inverse of the
@@ -22,9 +22,11 @@
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <cmath>
+#include <thread>
 #include <vector>
 
 #include <glad/glad.h>
@@ -33,6 +35,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include "window-manager.h"
 #include "mesh.h"
@@ -41,12 +44,57 @@
 #include "directional-light.h"
 #include "material.h"
 #include "model.h"
+#include "indirect-batch.h"
+#include "texture-array.h"
+#include "shader-variant-cache.h"
+#include "level-of-detail.h"
+#include "cluster-culler.h"
+#include "occlusion-culler.h"
+#include "occlusion-queries.h"
+#include "scene-graph.h"
+#include "scene-store.h"
+#include "matrix-batch.h"
+#include "job-system.h"
+#include "resource-manager.h"
+#include "upload-thread.h"
+#include "frame-allocator.h"
+#include "allocation-counter.h"
+#include "gpu-resource-registry.h"
+#include "simulation-loop.h"
 
 // Scene data
 WindowManager window;
+
+// The meshes share a few large vertex and index
+// buffers instead of a pair of buffers each
+GeometryPool geometryPool;
+static const GLuint geometryPoolPageVertices = 1 << 18;
+static const GLuint geometryPoolPageIndices = 1 << 20;
+
 std::vector<Mesh*> meshes;
 ShaderManager directLightShadowMapShader;
-std::vector<ShaderManager> shaderManagers;
+ShaderManager directLightShadowMapInstancedShader;
+ShaderManager directLightShadowMapIndirectShader;
+
+// The lit shaders are compiled into one program per
+// combination of lights and features in use, and the
+// pointers below refer to the variants matching the
+// current state of the scene
+ShaderVariantCache mainShaderVariants;
+ShaderVariantCache instancedShaderVariants;
+ShaderVariantCache indirectShaderVariants;
+ShaderManager *mainShader = nullptr;
+ShaderManager *instancedShader = nullptr;
+ShaderManager *indirectShader = nullptr;
+
+// Linked programs are kept on disk next to the executable
+// so that later launches can skip compiling the shaders
+ProgramBinaryCache programBinaryCache;
+static const char* programBinaryCacheDirectory = "./bin/shadow-mapping/shader-cache";
+
+// Programs submitted for compilation whose
+// link status has not been checked yet
+std::vector<ShaderManager*> pendingShaderPrograms;
 Camera camera;
 DirectionalLight directionalLight;
 PointLight pointLights[MAX_POINT_LIGHTS];
@@ -54,14 +102,185 @@ SpotLight spotLights[MAX_SPOT_LIGHTS];
 Texture brickTexture;
 Texture dirtTexture;
 Texture plainTexture;
+TextureArray sceneTextureArray;
 Material shinyMaterial;
 Material dullMaterial;
 Model xWing;
 Model blackhawk;
 
+// Transform hierarchy of the scene, the imported models
+// keep their node hierarchy below the node placing them
+SceneGraph sceneGraph;
+unsigned int firstTetrahedronNode = 0;
+unsigned int secondTetrahedronNode = 0;
+unsigned int floorNode = 0;
+unsigned int xWingNode = 0;
+unsigned int blackHawkOrbitNode = 0;
+unsigned int blackHawkNode = 0;
+
+// Model matrices of the scene objects, copied
+// from the world matrices of the scene graph
+glm::mat4 firstTetrahedronTransform(1.0f);
+glm::mat4 secondTetrahedronTransform(1.0f);
+glm::mat4 floorTransform(1.0f);
+glm::mat4 xWingTransform(1.0f);
+glm::mat4 blackHawkTransform(1.0f);
+
+// The ships of the instanced xwing fleet, kept in packed
+// arrays that are transformed and culled in a single pass
+SceneStore fleetStore;
+
+// Model the fleet is drawn with and its placement, scaled
+// so that any model comes out as large as the xwings
+Model *fleetModel = nullptr;
+glm::vec3 fleetScale(0.006f, 0.006f, 0.006f);
+glm::quat fleetRotation(1.0f, 0.0f, 0.0f, 0.0f);
+
+// Models loaded while the scene is running. Pressing F swaps
+// the fleet between the xwing and a streamed model, drawing
+// the ships as boxes until the new model is resident.
+ResourceManager resourceManager;
+UploadThread uploadThread;
+bool useUploadThread = true;
+ModelHandle streamedFleetModel = {0, 0};
+bool streamedFleetRequested = false;
+bool useStreamedFleet = false;
+bool fleetSwapPending = false;
+bool fleetSwapKeyHeld = false;
+static const char* streamedFleetModelPath = "./scenes/shadow-mapping/assets/models/uh60.obj";
+static const double resourceUploadBudgetMilliseconds = 2.0;
+
+// GPU driven submission of the whole scene, used
+// instead of RenderScene() when OpenGL 4.3 is available
+IndirectBatch sceneBatch;
+bool useIndirectRendering = false;
+unsigned int firstTetrahedronBatchObject = 0;
+unsigned int secondTetrahedronBatchObject = 0;
+unsigned int xWingBatchObject = 0;
+unsigned int blackHawkBatchObject = 0;
+unsigned int fleetBatchObject = 0;
+
+// Pack the textures of the scene and of each model
+// into texture arrays so that the objects select
+// their texture by layer instead of rebinding
+bool useTextureArrays = true;
+GLuint brickTextureLayer = 0;
+GLuint dirtTextureLayer = 0;
+
+// What each pass draws of the models. The models are drawn
+// with simplified meshes once they cover little of the screen,
+// each pass keeping the levels it picked last frame for the
+// hysteresis. The shadow pass settles for coarser levels than
+// the main pass as the silhouette is all it needs, and it draws
+// everything the light sees, so nothing is culled in it.
+// The lists of the fleet are built in the frame arena, the
+// levels of the previous frame are still held by the other one.
+struct PassDrawState
+{
+    LevelOfDetailSelector selector;
+    unsigned int xWingLevel = 0;
+    unsigned int blackHawkLevel = 0;
+    unsigned int *fleetLevels = nullptr;
+    size_t fleetLevelCount = 0;
+    size_t fleetLevelsFrame = 0;
+
+    // No fleet visibility draws every ship
+    bool xWingVisible = true;
+    bool blackHawkVisible = true;
+    unsigned char *fleetVisibility = nullptr;
+
+    ClusterCuller *clusterCuller = nullptr;
+    OcclusionQueries *occlusionQueries = nullptr;
+};
+
+PassDrawState mainPass;
+PassDrawState shadowPass;
+static const GLfloat shadowPassScreenSizeScale = 0.5f;
+
+// Scratch lists built while drawing a frame come from here,
+// the render loop itself should not touch the heap once the
+// scene is loaded, which is checked by counting allocations
+FrameAllocator frameAllocator;
+static const size_t frameAllocatorCapacity = 1 << 20;
+size_t frameHeapAllocations = 0;
+size_t frameCount = 0;
+
+// Allocations are an error once the caches and arenas have
+// warmed up, except in the frames loading the streamed fleet
+static const size_t frameAllocationWarmUpFrames = 120;
+size_t steadyFrameHeapAllocations = 0;
+size_t steadyFramesAllocating = 0;
+GLfloat frameMemoryStatisticsTimeStamp = 0.0f;
+static const GLfloat frameMemoryStatisticsInterval = 5.0f;
+
+// Worker threads shared by model loading and culling,
+// created on the thread that owns the GL context
+JobSystem jobSystem;
+
+// The clusters of the full detail models that are outside the
+// view are skipped in the main pass. The scene draws two-sided,
+// clusters facing away from the camera are only skipped too
+// when back faces are culled for the cluster culled draws.
+ClusterCuller clusterCuller;
+bool useClusterCulling = true;
+bool useBackFaceCulling = false;
+GLfloat clusterCullingStatisticsTimeStamp = 0.0f;
+static const GLfloat clusterCullingStatisticsInterval = 5.0f;
+
+// The floor and the tetrahedra hide the models behind them
+// from the main pass, tested against a depth buffer the
+// occluders are rasterized into on the CPU every frame
+OcclusionCuller occlusionCuller;
+bool useOcclusionCulling = true;
+unsigned int firstTetrahedronOccluder = 0;
+unsigned int secondTetrahedronOccluder = 0;
+unsigned int floorOccluder = 0;
+static const unsigned int occlusionBufferWidth = 256;
+static const unsigned int occlusionBufferHeight = 128;
+
+// The GPU skips drawing the objects whose bounding boxes were
+// hidden last frame, checked with occlusion queries issued
+// at the end of the main pass
+OcclusionQueries occlusionQueries;
+bool useOcclusionQueries = true;
+ShaderManager boundingBoxShader;
+GLfloat occlusionQueryStatisticsTimeStamp = 0.0f;
+static const GLfloat occlusionQueryStatisticsInterval = 5.0f;
+
+// Estimated video memory the scene may take before a
+// warning is printed, checked as the objects are created
+static const size_t bufferMemoryBudget = 256 << 20;
+static const size_t textureMemoryBudget = 256 << 20;
+
+// Times the batched matrix kernels against glm
+// at startup when enabled, off by default
+bool runMatrixBatchBenchmark = false;
+static const size_t matrixBatchBenchmarkObjects = 4096;
+static const unsigned int matrixBatchBenchmarkIterations = 100;
+
+// Objects of the scene drawn under conditional rendering
+enum OcclusionQueryObject
+{
+    FIRST_TETRAHEDRON_QUERY,
+    SECOND_TETRAHEDRON_QUERY,
+    XWING_QUERY,
+    BLACKHAWK_QUERY,
+    FLEET_QUERY,
+    OCCLUSION_QUERY_OBJECT_COUNT
+};
+
+// Bounds of the tetrahedron mesh and, in world
+// space, of the whole fleet for the queries
+const glm::vec3 tetrahedronBoundsMin(-1.0f, -1.0f, -0.6f);
+const glm::vec3 tetrahedronBoundsMax(1.0f, 1.0f, 1.0f);
+glm::vec3 fleetBoundsMin(0.0f);
+glm::vec3 fleetBoundsMax(0.0f);
+
 // Path to the shader files relative to Rosary's Makefile
 static const char* vertexShaderPath = "./scenes/shadow-mapping/shaders/vertex.glsl";
 static const char* fragmentShaderPath = "./scenes/shadow-mapping/shaders/fragment.glsl";
+static const char* instancedVertexShaderPath = "./scenes/shadow-mapping/shaders/instanced-vertex.glsl";
+static const char* indirectVertexShaderPath = "./scenes/shadow-mapping/shaders/indirect-vertex.glsl";
 
 // Special shader uniform locations
 GLuint uniformModelLocation = 0;
@@ -72,8 +291,62 @@ unsigned int numberOfSpotLights = 0;
 // Initialise point lights
 unsigned int numberOfPointLights = 0;
 
-// Blackhawk Rotation
+// Shadow filtering of the directional light
+bool useShadows = true;
+unsigned int shadowFilterKernelSize = 3;
+
+// Blackhawk Rotation, the angle drawn this frame
 float blackHawkAngle = 0.0f;
+static const GLfloat blackHawkDegreesPerSecond = 60.0f;
+
+// The blackhawk and the camera position are advanced in fixed
+// steps apart from the rendering, so that they move at the same
+// speed whatever the frame rate, and drawn blended between the
+// last two steps. The steps can run on a thread of their own,
+// following the movement keys through the input events of the
+// window rather than the key state owned by the render thread.
+enum SceneMoveKey
+{
+    MOVE_KEY_FORWARD,
+    MOVE_KEY_BACKWARD,
+    MOVE_KEY_LEFT,
+    MOVE_KEY_RIGHT,
+    MOVE_KEY_COUNT
+};
+
+struct SceneSimulationState
+{
+    GLfloat blackHawkAngle;
+    glm::vec3 cameraPosition;
+
+    // Movement keys held as of the end of the last step, the time
+    // from which their movement is still to be applied and how long
+    // they have been held since going down
+    bool moveKeyHeld[MOVE_KEY_COUNT];
+    double moveKeyHeldFrom[MOVE_KEY_COUNT];
+    double moveKeyHeldSeconds[MOVE_KEY_COUNT];
+};
+
+// The mouse turns the camera on the render thread, the
+// simulation moves it along the latest directions. The
+// key events are only ever popped by the steps.
+struct SceneSimulationInput
+{
+    glm::vec3 cameraFront;
+    glm::vec3 cameraRight;
+    GLfloat cameraSpeed;
+    InputEventQueue *inputEvents;
+};
+
+SimulationLoop<SceneSimulationState, SceneSimulationInput> sceneSimulation;
+bool useSimulationThread = true;
+static const double simulationStepSeconds = 1.0 / 60.0;
+static const unsigned int maxSimulationStepsPerFrame = 8;
+static const size_t inputEventQueueCapacity = 256;
+
+// Layout of the xwing fleet
+const unsigned int FLEET_ROWS = 10;
+const unsigned int FLEET_COLUMNS = 20;
 
 // Average the normals at the vertex positions
 // for all the triangular surfaces, no interpolation
@@ -206,166 +479,987 @@ void CreateMeshes()
 
     // Generate the tetrahedron meshes
     Mesh *firstTetrahedron = new Mesh();
+    firstTetrahedron->setGeometryPool(&geometryPool);
     firstTetrahedron->createMesh(vertices, indices, 32, 12);
     meshes.push_back(firstTetrahedron);
 
     Mesh *secondTetrahedron = new Mesh();
+    secondTetrahedron->setGeometryPool(&geometryPool);
     secondTetrahedron->createMesh(vertices, indices, 32, 12);
     meshes.push_back(secondTetrahedron);
 
     Mesh *floor = new Mesh();
+    floor->setGeometryPool(&geometryPool);
     floor->createMesh(floorVertices, floorIndices, 32, 6);
     meshes.push_back(floor);
+
+    // Unit cube standing in for models that are still loading,
+    // corner i lies at the positive end of the axes in its bits
+    unsigned int cubeIndices[] = {
+        0, 4, 1,    1, 4, 5,
+        2, 3, 6,    3, 7, 6,
+        0, 2, 4,    2, 6, 4,
+        1, 5, 3,    3, 5, 7,
+        0, 1, 2,    1, 3, 2,
+        4, 6, 5,    5, 6, 7
+    };
+
+    GLfloat cubeVertices[64];
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        GLfloat *vertex = &cubeVertices[i * 8];
+        vertex[0] = (i & 1) ? 0.5f : -0.5f;
+        vertex[1] = (i & 2) ? 0.5f : -0.5f;
+        vertex[2] = (i & 4) ? 0.5f : -0.5f;
+        vertex[3] = (i & 1) ? 1.0f : 0.0f;
+        vertex[4] = (i & 2) ? 1.0f : 0.0f;
+        vertex[5] = 0.0f;
+        vertex[6] = 0.0f;
+        vertex[7] = 0.0f;
+    }
+    calculateNormalsForPhongShading(cubeVertices, 64, cubeIndices, 36, 8, 5);
+
+    Mesh *placeholderCube = new Mesh();
+    placeholderCube->setGeometryPool(&geometryPool);
+    placeholderCube->createMesh(cubeVertices, cubeIndices, 64, 36);
+    meshes.push_back(placeholderCube);
+
+    // Keep the positions of the meshes around for
+    // rasterizing them as occluders on the CPU
+    firstTetrahedronOccluder = occlusionCuller.addOccluder(vertices, 4, 8, indices, 12);
+    secondTetrahedronOccluder = occlusionCuller.addOccluder(vertices, 4, 8, indices, 12);
+    floorOccluder = occlusionCuller.addOccluder(floorVertices, 4, 8, floorIndices, 6);
+}
+
+void SubmitShaderProgram(
+    ShaderManager &shader,
+    const char* vertexShaderPath,
+    const char* fragmentShaderPath)
+{
+    shader.setProgramBinaryCache(&programBinaryCache);
+    shader.submitShaderProgramFromFiles(vertexShaderPath, fragmentShaderPath);
+    pendingShaderPrograms.push_back(&shader);
+}
+
+ShaderVariant GetSceneShaderVariant()
+{
+    ShaderVariant variant;
+    variant.pointLightCount = numberOfPointLights;
+    variant.spotLightCount = numberOfSpotLights;
+    variant.shadowsEnabled = useShadows;
+    variant.pcfKernelSize = shadowFilterKernelSize;
+    variant.textureEnabled = true;
+    variant.textureArrayEnabled = useTextureArrays;
+    return variant;
+}
+
+ShaderManager* SelectShaderVariant(
+    ShaderVariantCache &variants,
+    const ShaderVariant &variant,
+    ShaderManager *currentShader)
+{
+    ShaderManager *shader = variants.requestVariant(variant);
+
+    if (!currentShader || shader == currentShader)
+    {
+        return shader;
+    }
+
+    // A variant that failed to build is never polled
+    // again, the scene keeps the program it already has
+    if (shader->isShaderProgramFailed())
+    {
+        return currentShader;
+    }
+
+    // Keep drawing with the current program until
+    // a newly requested variant has finished linking
+    if (!shader->pollShaderProgram())
+    {
+        return currentShader;
+    }
+
+    if (!shader->isShaderProgramReady())
+    {
+        // Only seen on the poll that finishes the program
+        char key[100] = {'\0'};
+        variant.getKey(key, sizeof(key));
+        printf("Error: Failed to build the shader variant %s, keeping the current program\n", key);
+        return currentShader;
+    }
+
+    return shader;
+}
+
+void SelectShaderVariants()
+{
+    // Picks (and compiles on first use) the programs
+    // specialised for the lights and features that
+    // the scene uses at the moment
+    ShaderVariant variant = GetSceneShaderVariant();
+
+    mainShader = SelectShaderVariant(mainShaderVariants, variant, mainShader);
+    instancedShader = SelectShaderVariant(instancedShaderVariants, variant, instancedShader);
+
+    if (IndirectBatch::isSupported())
+    {
+        indirectShader = SelectShaderVariant(indirectShaderVariants, variant, indirectShader);
+    }
 }
 
 void CreateShaderPrograms()
 {
-    // Load the shaders from file and create shader program object
-    ShaderManager *shaderManager = new ShaderManager();
-    shaderManager->createShaderProgramFromFiles(vertexShaderPath, fragmentShaderPath);
-    shaderManagers.push_back(*shaderManager);
+    // Shaders fall back to being compiled from source
+    // when program binaries are not supported
+    programBinaryCache.createProgramBinaryCache(programBinaryCacheDirectory);
+
+    // Let the driver pick how many threads to compile
+    // the programs on, all of them are submitted below
+    // and only waited on in WaitForShaderPrograms()
+    if (ShaderManager::isParallelCompileSupported())
+    {
+        ShaderManager::setMaxCompilerThreads(0xFFFFFFFF);
+    }
+
+    // The lit shaders share the fragment shader, the instanced
+    // variants take the model matrix as a per-instance vertex
+    // attribute and the indirect ones fetch it from a shader
+    // storage buffer (OpenGL 4.3 only)
+    mainShaderVariants.setShaderFiles(vertexShaderPath, fragmentShaderPath);
+    mainShaderVariants.setProgramBinaryCache(&programBinaryCache);
+    instancedShaderVariants.setShaderFiles(instancedVertexShaderPath, fragmentShaderPath);
+    instancedShaderVariants.setProgramBinaryCache(&programBinaryCache);
+    // The indirect draws take their material from the per-draw
+    // data, so a pass only splits its draws on the textures
+    indirectShaderVariants.setShaderFiles(indirectVertexShaderPath, fragmentShaderPath, "#define USE_DRAW_MATERIAL\n");
+    indirectShaderVariants.setProgramBinaryCache(&programBinaryCache);
+
+    // Submit the variants for the initial state of the scene
+    SelectShaderVariants();
+    pendingShaderPrograms.push_back(mainShader);
+    pendingShaderPrograms.push_back(instancedShader);
+    if (indirectShader)
+    {
+        pendingShaderPrograms.push_back(indirectShader);
+    }
 
     // Creating a separate shader to handle the direct light shadow map
-    directLightShadowMapShader = ShaderManager();
-    directLightShadowMapShader.createShaderProgramFromFiles(
+    SubmitShaderProgram(
+        directLightShadowMapShader,
         "./scenes/shadow-mapping/shaders/directional-light-shadow-map-vertex.glsl",
         "./scenes/shadow-mapping/shaders/directional-light-shadow-map-fragment.glsl");
+
+    SubmitShaderProgram(
+        directLightShadowMapInstancedShader,
+        "./scenes/shadow-mapping/shaders/directional-light-shadow-map-instanced-vertex.glsl",
+        "./scenes/shadow-mapping/shaders/directional-light-shadow-map-fragment.glsl");
+
+    // Bounding boxes drawn for the occlusion queries
+    // only need depth testing, like the shadow pass
+    SubmitShaderProgram(
+        boundingBoxShader,
+        "./scenes/shadow-mapping/shaders/bounding-box-vertex.glsl",
+        "./scenes/shadow-mapping/shaders/directional-light-shadow-map-fragment.glsl");
+
+    if (IndirectBatch::isSupported())
+    {
+        SubmitShaderProgram(
+            directLightShadowMapIndirectShader,
+            "./scenes/shadow-mapping/shaders/directional-light-shadow-map-indirect-vertex.glsl",
+            "./scenes/shadow-mapping/shaders/directional-light-shadow-map-fragment.glsl");
+    }
 }
 
-void RenderScene()
+void WaitForShaderPrograms()
 {
-    // Begin rendering the individual models
-    // Generate the model matrix for the first tetrahedron
-    glm::mat4 model(1.0f);
-    model = glm::translate(model, glm::vec3(0.0f, 0.0f, -2.5f));
+    // Poll every program in turn so that the uniforms of each
+    // one are resolved as soon as it is ready, regardless of
+    // the order the driver finishes them in
+    bool allProgramsDone = false;
+    while (!allProgramsDone)
+    {
+        allProgramsDone = true;
+        for (size_t i = 0; i < pendingShaderPrograms.size(); ++i)
+        {
+            if (!pendingShaderPrograms[i]->pollShaderProgram())
+            {
+                allProgramsDone = false;
+            }
+        }
+
+        if (!allProgramsDone)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    pendingShaderPrograms.clear();
+}
+
+void CreateFleet()
+{
+    // Lay out the xwing fleet in a grid
+    // hovering above the rest of the scene
+    fleetStore.clearSceneStore();
+    fleetStore.reserveObjects(FLEET_ROWS * FLEET_COLUMNS);
+
+    for (unsigned int row = 0; row < FLEET_ROWS; ++row)
+    {
+        for (unsigned int column = 0; column < FLEET_COLUMNS; ++column)
+        {
+            SceneObjectHandle ship = fleetStore.createObject(0, fleetModel->getBoundsMin(), fleetModel->getBoundsMax());
+            fleetStore.setPosition(ship, glm::vec3(
+                (column - FLEET_COLUMNS * 0.5f) * 3.0f,
+                8.0f + (row % 2) * 1.5f,
+                (row - FLEET_ROWS * 0.5f) * 4.0f));
+            fleetStore.setRotation(ship, fleetRotation);
+            fleetStore.setScale(ship, fleetScale);
+        }
+    }
+    fleetStore.updateTransforms();
+
+    // World space box around every ship of the fleet
+    fleetBoundsMin = glm::vec3(1e30f);
+    fleetBoundsMax = glm::vec3(-1e30f);
+    for (size_t i = 0; i < fleetStore.getObjectCount(); ++i)
+    {
+        fleetBoundsMin = glm::min(fleetBoundsMin, fleetStore.getWorldBoundsMin()[i]);
+        fleetBoundsMax = glm::max(fleetBoundsMax, fleetStore.getWorldBoundsMax()[i]);
+    }
+}
+
+void SetFleetModel(Model *model, const glm::quat &rotation)
+{
+    // Match the size of the xwings so that the
+    // fleet keeps its layout whatever it is made of
+    GLfloat radius = model->getBoundingRadius();
+    GLfloat scale = 0.006f * (radius > 0.0f ? xWing.getBoundingRadius() / radius : 1.0f);
+
+    fleetModel = model;
+    fleetScale = glm::vec3(scale, scale, scale);
+    fleetRotation = rotation;
+    CreateFleet();
+}
 
-    // Bind the matrix data to the uniform variable in the shader
-    // Arguments: location, number of matrices, 
+void CreateSceneGraph()
+{
+    firstTetrahedronNode = sceneGraph.addNode(SceneGraph::ROOT_PARENT, "first tetrahedron");
+    sceneGraph.setPosition(firstTetrahedronNode, glm::vec3(0.0f, 0.0f, -2.5f));
+
+    secondTetrahedronNode = sceneGraph.addNode(SceneGraph::ROOT_PARENT, "second tetrahedron");
+    sceneGraph.setPosition(secondTetrahedronNode, glm::vec3(0.0f, 4.0f, -2.5f));
+
+    floorNode = sceneGraph.addNode(SceneGraph::ROOT_PARENT, "floor");
+    sceneGraph.setPosition(floorNode, glm::vec3(0.0f, -2.0f, 0.0f));
+
+    xWingNode = sceneGraph.addNode(SceneGraph::ROOT_PARENT, "xwing");
+    sceneGraph.setPosition(xWingNode, glm::vec3(-7.0f, 0.0f, 10.0f));
+    sceneGraph.setScale(xWingNode, glm::vec3(0.006f, 0.006f, 0.006f));
+    sceneGraph.addModelNodes(xWing, xWingNode);
+
+    // The blackhawk circles the scene, only the rotation of
+    // the orbit node changes from frame to frame while the
+    // placement of the helicopter relative to it is fixed
+    blackHawkOrbitNode = sceneGraph.addNode(SceneGraph::ROOT_PARENT, "blackhawk orbit");
+
+    blackHawkNode = sceneGraph.addNode(blackHawkOrbitNode, "blackhawk");
+    sceneGraph.setPosition(blackHawkNode, glm::vec3(-8.0f, 0.01f, 0.0f));
+    sceneGraph.setRotation(blackHawkNode,
+        glm::angleAxis(-20.0f * toRadians, glm::vec3(0.0f, 0.0f, 1.0f)) *
+        glm::angleAxis(-90.0f * toRadians, glm::vec3(1.0f, 0.0f, 0.0f)));
+    sceneGraph.setScale(blackHawkNode, glm::vec3(0.4f, 0.4f, 0.4f));
+    sceneGraph.addModelNodes(blackhawk, blackHawkNode);
+
+    // The static objects are computed once here
+    // and never touched by the updates again
+    sceneGraph.updateWorldMatrices();
+    firstTetrahedronTransform = sceneGraph.getWorldMatrix(firstTetrahedronNode);
+    secondTetrahedronTransform = sceneGraph.getWorldMatrix(secondTetrahedronNode);
+    floorTransform = sceneGraph.getWorldMatrix(floorNode);
+    xWingTransform = sceneGraph.getWorldMatrix(xWingNode);
+    blackHawkTransform = sceneGraph.getWorldMatrix(blackHawkNode);
+}
+
+int GetSceneMoveKey(int key)
+{
+    switch (key)
+    {
+    case GLFW_KEY_W:
+        return MOVE_KEY_FORWARD;
+    case GLFW_KEY_S:
+        return MOVE_KEY_BACKWARD;
+    case GLFW_KEY_A:
+        return MOVE_KEY_LEFT;
+    case GLFW_KEY_D:
+        return MOVE_KEY_RIGHT;
+    }
+
+    return -1;
+}
+
+void StepSceneSimulation(
+    SceneSimulationState &state,
+    const SceneSimulationInput &input,
+    double stepEndTime,
+    double stepSeconds)
+{
+    state.blackHawkAngle += blackHawkDegreesPerSecond * (GLfloat)stepSeconds;
+    if (state.blackHawkAngle >= 360.0f)
+    {
+        state.blackHawkAngle -= 360.0f;
+    }
+
+    // Seconds of this step each movement key was held for. Time
+    // dropped after a stall is left out, as for the blackhawk.
+    double stepStartTime = stepEndTime - stepSeconds;
+    double moveSeconds[MOVE_KEY_COUNT] = {};
+
+    // Take the key events up to the end of the step, the later
+    // ones are left in the queue for the steps they fall into
+    InputEvent event;
+    while (input.inputEvents && input.inputEvents->peekEvent(event) && event.timeStamp <= stepEndTime)
+    {
+        input.inputEvents->popEvent(event);
+
+        int moveKey = GetSceneMoveKey(event.key);
+        if (event.type == INPUT_EVENT_MOUSE_MOVED || moveKey < 0)
+        {
+            continue;
+        }
+
+        if (event.type == INPUT_EVENT_KEY_PRESSED && !state.moveKeyHeld[moveKey])
+        {
+            state.moveKeyHeld[moveKey] = true;
+            state.moveKeyHeldFrom[moveKey] = event.timeStamp;
+            state.moveKeyHeldSeconds[moveKey] = 0.0;
+        }
+        else if (event.type == INPUT_EVENT_KEY_RELEASED && state.moveKeyHeld[moveKey])
+        {
+            double heldFrom = std::max(state.moveKeyHeldFrom[moveKey], stepStartTime);
+            double heldSeconds = std::max(event.timeStamp - heldFrom, 0.0);
+            moveSeconds[moveKey] += heldSeconds;
+            state.moveKeyHeldSeconds[moveKey] += heldSeconds;
+            state.moveKeyHeld[moveKey] = false;
+
+            // The events are stamped when the window is polled, so a
+            // tap shorter than a frame may come in with no time between
+            // its press and release. It moves for a step at least.
+            if (state.moveKeyHeldSeconds[moveKey] < stepSeconds)
+            {
+                moveSeconds[moveKey] += stepSeconds - state.moveKeyHeldSeconds[moveKey];
+            }
+        }
+    }
+
+    // The keys still down are held through the end of the step
+    for (int moveKey = 0; moveKey < MOVE_KEY_COUNT; ++moveKey)
+    {
+        if (state.moveKeyHeld[moveKey])
+        {
+            double heldFrom = std::max(state.moveKeyHeldFrom[moveKey], stepStartTime);
+            double heldSeconds = stepEndTime - heldFrom;
+            moveSeconds[moveKey] += heldSeconds;
+            state.moveKeyHeldSeconds[moveKey] += heldSeconds;
+            state.moveKeyHeldFrom[moveKey] = stepEndTime;
+        }
+    }
+
+    glm::vec3 motion =
+        input.cameraFront * (GLfloat)(moveSeconds[MOVE_KEY_FORWARD] - moveSeconds[MOVE_KEY_BACKWARD]) +
+        input.cameraRight * (GLfloat)(moveSeconds[MOVE_KEY_RIGHT] - moveSeconds[MOVE_KEY_LEFT]);
+    state.cameraPosition += motion * input.cameraSpeed;
+}
+
+void ApplySceneSimulation()
+{
+    SceneSimulationState previous, current;
+    GLfloat interpolation = 0.0f;
+    sceneSimulation.getSnapshot(previous, current, interpolation);
+
+    // Blend the angle the short way round where it wraps
+    GLfloat angleChange = current.blackHawkAngle - previous.blackHawkAngle;
+    if (angleChange < -180.0f)
+    {
+        angleChange += 360.0f;
+    }
+    blackHawkAngle = previous.blackHawkAngle + angleChange * interpolation;
+
+    camera.setPosition(glm::mix(previous.cameraPosition, current.cameraPosition, interpolation));
+}
+
+void UpdateSceneTransforms()
+{
+    // The blackhawk is placed once per frame so that
+    // the shadow pass and the main pass agree on its position
+    sceneGraph.setRotation(blackHawkOrbitNode,
+        glm::angleAxis(-blackHawkAngle * toRadians, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    // Only the orbit node and the nodes below it are recomputed
+    sceneGraph.updateWorldMatrices();
+    blackHawkTransform = sceneGraph.getWorldMatrix(blackHawkNode);
+
+    if (useIndirectRendering)
+    {
+        // Only the blackhawk moves, the rest of
+        // the batch keeps its transforms from creation
+        sceneBatch.setTransform(blackHawkBatchObject, blackHawkTransform);
+    }
+}
+
+void AddSceneMeshToBatch(
+    unsigned int object,
+    Mesh *mesh,
+    Texture &texture,
+    GLuint textureLayer,
+    Material *material)
+{
+    if (useTextureArrays)
+    {
+        sceneBatch.addMesh(object, mesh, &sceneTextureArray, textureLayer, material);
+    }
+    else
+    {
+        sceneBatch.addMesh(object, mesh, &texture, material);
+    }
+}
+
+void CreateIndirectBatch()
+{
+    if (!IndirectBatch::isSupported())
+    {
+        printf("Warning: OpenGL 4.3 is not available, falling back to per object draw calls\n");
+        return;
+    }
+
+    firstTetrahedronBatchObject = sceneBatch.addObject();
+    AddSceneMeshToBatch(firstTetrahedronBatchObject, meshes[0], brickTexture, brickTextureLayer, &shinyMaterial);
+    sceneBatch.setTransform(firstTetrahedronBatchObject, firstTetrahedronTransform);
+
+    secondTetrahedronBatchObject = sceneBatch.addObject();
+    AddSceneMeshToBatch(secondTetrahedronBatchObject, meshes[1], dirtTexture, dirtTextureLayer, &dullMaterial);
+    sceneBatch.setTransform(secondTetrahedronBatchObject, secondTetrahedronTransform);
+
+    unsigned int object = sceneBatch.addObject();
+    AddSceneMeshToBatch(object, meshes[2], dirtTexture, dirtTextureLayer, &shinyMaterial);
+    sceneBatch.setTransform(object, floorTransform);
+
+    xWingBatchObject = sceneBatch.addObject();
+    sceneBatch.addModel(xWingBatchObject, xWing, &shinyMaterial);
+    sceneBatch.setTransform(xWingBatchObject, xWingTransform);
+
+    blackHawkBatchObject = sceneBatch.addObject();
+    sceneBatch.addModel(blackHawkBatchObject, blackhawk, &shinyMaterial);
+    sceneBatch.setTransform(blackHawkBatchObject, blackHawkTransform);
+
+    // The fleet is a single object with one
+    // transform slot per instance
+    fleetBatchObject = sceneBatch.addObject(fleetStore.getObjectCount());
+    sceneBatch.addModel(fleetBatchObject, *fleetModel, &shinyMaterial);
+    sceneBatch.setInstanceTransforms(fleetBatchObject, fleetStore.getWorldMatrices(), fleetStore.getObjectCount());
+
+    useIndirectRendering = sceneBatch.build();
+}
+
+void UseSceneTexture(Texture &texture, GLuint textureLayer)
+{
+    if (useTextureArrays)
+    {
+        // The layer is read by the shaders as a
+        // constant vertex attribute for the draw
+        sceneTextureArray.useTextureArray();
+        glVertexAttrib1f(TEXTURE_LAYER_ATTRIBUTE_LOCATION, textureLayer);
+    }
+    else
+    {
+        texture.useTexture();
+    }
+}
+
+void UpdateLevelsOfDetail(
+    PassDrawState &pass,
+    const glm::mat4 &projection)
+{
+    pass.selector.setView(projection, camera.getCameraPosition(), window.getBufferheight());
+
+    pass.xWingLevel = xWing.selectLevelOfDetail(pass.selector, xWingTransform, pass.xWingLevel);
+    pass.blackHawkLevel = blackhawk.selectLevelOfDetail(pass.selector, blackHawkTransform, pass.blackHawkLevel);
+
+    // The levels picked last frame are only kept
+    // by the arena through the frame after it
+    const unsigned int *previousLevels = nullptr;
+    if (pass.fleetLevels && pass.fleetLevelsFrame + 1 == frameAllocator.getFrameNumber())
+    {
+        previousLevels = pass.fleetLevels;
+    }
+
+    size_t objectCount = fleetStore.getObjectCount();
+    const glm::mat4 *fleetTransforms = fleetStore.getWorldMatrices();
+    unsigned int *fleetLevels = frameAllocator.getFrameArena().allocateArray<unsigned int>(objectCount);
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        unsigned int currentLevel = previousLevels && i < pass.fleetLevelCount ? previousLevels[i] : 0;
+        fleetLevels[i] = fleetModel->selectLevelOfDetail(pass.selector, fleetTransforms[i], currentLevel);
+    }
+
+    pass.fleetLevels = fleetLevels;
+    pass.fleetLevelCount = objectCount;
+    pass.fleetLevelsFrame = frameAllocator.getFrameNumber();
+}
+
+void UpdateOcclusion(PassDrawState &pass, const glm::mat4 &projectionView)
+{
+    occlusionCuller.setOccluderTransform(firstTetrahedronOccluder, firstTetrahedronTransform);
+    occlusionCuller.setOccluderTransform(secondTetrahedronOccluder, secondTetrahedronTransform);
+    occlusionCuller.setOccluderTransform(floorOccluder, floorTransform);
+    occlusionCuller.renderOccluders(projectionView);
+
+    pass.xWingVisible = occlusionCuller.isBoxVisible(xWing.getBoundsMin(), xWing.getBoundsMax(), xWingTransform);
+    pass.blackHawkVisible = occlusionCuller.isBoxVisible(blackhawk.getBoundsMin(), blackhawk.getBoundsMax(), blackHawkTransform);
+}
+
+void UpdateFleetVisibility(PassDrawState &pass, const glm::mat4 &projectionView)
+{
+    // Frustum cull the whole fleet in one go, the ships
+    // left over are then tested against the occluders
+    fleetStore.cullObjects(projectionView);
+
+    size_t objectCount = fleetStore.getObjectCount();
+    const unsigned char *inFrustum = fleetStore.getVisibility();
+    pass.fleetVisibility = frameAllocator.getFrameArena().allocateArray<unsigned char>(objectCount);
+    std::copy(inFrustum, inFrustum + objectCount, pass.fleetVisibility);
+
+    if (useOcclusionCulling && objectCount)
+    {
+        occlusionCuller.areBoxesVisible(
+            fleetModel->getBoundsMin(),
+            fleetModel->getBoundsMax(),
+            fleetStore.getWorldMatrices(),
+            objectCount,
+            pass.fleetVisibility);
+    }
+}
+
+void BeginSceneObject(const PassDrawState &pass, OcclusionQueryObject object)
+{
+    if (pass.occlusionQueries)
+    {
+        pass.occlusionQueries->beginConditionalRender(object);
+    }
+}
+
+void EndSceneObject(const PassDrawState &pass, OcclusionQueryObject object)
+{
+    if (pass.occlusionQueries)
+    {
+        pass.occlusionQueries->endConditionalRender(object);
+    }
+}
+
+bool AreFleetPlaceholdersDrawn()
+{
+    // Until the model the fleet is switching to has been uploaded
+    return fleetSwapPending && useStreamedFleet;
+}
+
+bool IsSceneObjectHidden(const PassDrawState &pass, OcclusionQueryObject object)
+{
+    return pass.occlusionQueries && pass.occlusionQueries->isObjectHidden(object);
+}
+
+void SelectBatchDraws(const PassDrawState &pass)
+{
+    // The batch draws the models at the levels
+    // the pass picked, like the per object draws
+    sceneBatch.setObjectLevelOfDetail(xWingBatchObject, pass.xWingLevel);
+    sceneBatch.setObjectLevelOfDetail(blackHawkBatchObject, pass.blackHawkLevel);
+
+    // The ships are drawn from the same per level lists
+    // as the instanced draws, leaving out the culled ones
+    sceneBatch.setInstanceSelection(
+        fleetBatchObject,
+        pass.fleetLevelCount == fleetStore.getObjectCount() ? pass.fleetLevels : nullptr,
+        pass.fleetVisibility);
+
+    // Objects behind the occluders, or whose boxes
+    // the last finished queries found hidden, are
+    // left out as the commands cannot be rendered
+    // conditionally one by one
+    sceneBatch.setObjectVisible(firstTetrahedronBatchObject, !IsSceneObjectHidden(pass, FIRST_TETRAHEDRON_QUERY));
+    sceneBatch.setObjectVisible(secondTetrahedronBatchObject, !IsSceneObjectHidden(pass, SECOND_TETRAHEDRON_QUERY));
+    sceneBatch.setObjectVisible(xWingBatchObject, pass.xWingVisible && !IsSceneObjectHidden(pass, XWING_QUERY));
+    sceneBatch.setObjectVisible(blackHawkBatchObject, pass.blackHawkVisible && !IsSceneObjectHidden(pass, BLACKHAWK_QUERY));
+    sceneBatch.setObjectVisible(fleetBatchObject, !AreFleetPlaceholdersDrawn() && !IsSceneObjectHidden(pass, FLEET_QUERY));
+
+    // The visible clusters of the full detail
+    // models become commands of their own
+    sceneBatch.setObjectClusterCuller(xWingBatchObject, pass.clusterCuller);
+    sceneBatch.setObjectClusterCuller(blackHawkBatchObject, pass.clusterCuller);
+}
+
+void RenderSceneModel(
+    Model &model,
+    const glm::mat4 &modelMatrix,
+    unsigned int level,
+    bool visible,
+    ClusterCuller *culler)
+{
+    if (!visible)
+    {
+        return;
+    }
+
+    // The clusters only cover the full detail meshes
+    if (culler && level == 0)
+    {
+        if (useBackFaceCulling)
+        {
+            glEnable(GL_CULL_FACE);
+        }
+
+        model.renderVisibleClusters(*culler, modelMatrix, frameAllocator.getFrameArena());
+
+        if (useBackFaceCulling)
+        {
+            glDisable(GL_CULL_FACE);
+        }
+    }
+    else
+    {
+        model.renderModel(level);
+    }
+}
+
+void RenderScene(const PassDrawState &pass)
+{
+    // Begin rendering the individual models
+    // Bind the matrix data of the first tetrahedron to the uniform variable
+    // in the shader. Arguments: location, number of matrices, 
         // transpose matrices?, pointer to the matrix/matrices
     glUniformMatrix4fv(
         uniformModelLocation,
         1,
         GL_FALSE,
-        glm::value_ptr(model));
+        glm::value_ptr(firstTetrahedronTransform));
 
     // Using the brick texture to render the first tetrahedron
-    brickTexture.useTexture();
+    UseSceneTexture(brickTexture, brickTextureLayer);
 
     // Add in the shiny specular material properties
     // for the first tetrahedron
     shinyMaterial.useMaterial(
-        shaderManagers[0].getUniformSpecularIntensityLocation(),
-        shaderManagers[0].getUniformShininessLocation()
+        mainShader->getUniformSpecularIntensityLocation(),
+        mainShader->getUniformShininessLocation()
     );
 
     // Render the first tetrahedron
+    BeginSceneObject(pass, FIRST_TETRAHEDRON_QUERY);
     meshes[0]->renderMesh();
+    EndSceneObject(pass, FIRST_TETRAHEDRON_QUERY);
 
-    // Setting up the model matrix for the second tetrahedron
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(0.0f, 4.0f, -2.5f));
-
-    // Setting the new model matrix into the shader
+    // Setting the model matrix of the second tetrahedron into the shader
     glUniformMatrix4fv(
         uniformModelLocation,
         1,
         GL_FALSE,
-        glm::value_ptr(model));
+        glm::value_ptr(secondTetrahedronTransform));
 
     // Using the dirt texture to render the second tetrahedron
-    dirtTexture.useTexture();
+    UseSceneTexture(dirtTexture, dirtTextureLayer);
 
     // Add in the dull material properties
     // for the second tetrahedron
     dullMaterial.useMaterial(
-        shaderManagers[0].getUniformSpecularIntensityLocation(),
-        shaderManagers[0].getUniformShininessLocation()
+        mainShader->getUniformSpecularIntensityLocation(),
+        mainShader->getUniformShininessLocation()
     );
     
     // Render the second tetrahedron
+    BeginSceneObject(pass, SECOND_TETRAHEDRON_QUERY);
     meshes[1]->renderMesh();
+    EndSceneObject(pass, SECOND_TETRAHEDRON_QUERY);
 
-    // Setting up the model matrix for the floor
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(0.0f, -2.0f, 0.0f));
-
-    // Setting the new model matrix into the shader
+    // Setting the model matrix of the floor into the shader
     glUniformMatrix4fv(
         uniformModelLocation,
         1,
         GL_FALSE,
-        glm::value_ptr(model));
+        glm::value_ptr(floorTransform));
 
     // Using the plain texture to render the floor
-    dirtTexture.useTexture();
+    UseSceneTexture(dirtTexture, dirtTextureLayer);
 
     // Add in the dull material properties
     // for the floor
     shinyMaterial.useMaterial(
-        shaderManagers[0].getUniformSpecularIntensityLocation(),
-        shaderManagers[0].getUniformShininessLocation()
+        mainShader->getUniformSpecularIntensityLocation(),
+        mainShader->getUniformShininessLocation()
     );
     
     // Render the floor
     meshes[2]->renderMesh();
 
-    // Setting up the model matrix for the xwing model
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-7.0f, 0.0f, 10.0f));
-    model = glm::scale(model, glm::vec3(0.006f, 0.006, 0.006f));
-
-    // Setting the new model matrix into the shader
+    // Setting the model matrix of the xwing into the shader
     glUniformMatrix4fv(
         uniformModelLocation,
         1,
         GL_FALSE,
-        glm::value_ptr(model));
+        glm::value_ptr(xWingTransform));
 
     // Add in the dull material properties
     // for the xwing
     shinyMaterial.useMaterial(
-        shaderManagers[0].getUniformSpecularIntensityLocation(),
-        shaderManagers[0].getUniformShininessLocation()
+        mainShader->getUniformSpecularIntensityLocation(),
+        mainShader->getUniformShininessLocation()
     );
     
     // Render the xwing model
-    xWing.renderModel();
-
-    blackHawkAngle += 1.0f;
-    if (blackHawkAngle > 360.0f)
-    {
-        blackHawkAngle = 0.1f;
-    }
+    BeginSceneObject(pass, XWING_QUERY);
+    RenderSceneModel(xWing, xWingTransform, pass.xWingLevel, pass.xWingVisible, pass.clusterCuller);
+    EndSceneObject(pass, XWING_QUERY);
 
-    // Setting up the model matrix for the black hawk model
-    model = glm::mat4(1.0f);
-    model = glm::rotate(model, -blackHawkAngle * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::translate(model, glm::vec3(-8.0f, 0.01f, 0.0f));
-    model = glm::rotate(model, -20.0f * toRadians, glm::vec3(0.0f, 0.0f, 1.0f));
-    model = glm::rotate(model, -90.0f * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
-    model = glm::scale(model, glm::vec3(0.4f, 0.4f, 0.4f));
-
-    // Setting the new model matrix into the shader
+    // Setting the model matrix of the black hawk into the shader
     glUniformMatrix4fv(
         uniformModelLocation,
         1,
         GL_FALSE,
-        glm::value_ptr(model));
+        glm::value_ptr(blackHawkTransform));
 
     // Add in the dull material properties
     // for the black hawk
     shinyMaterial.useMaterial(
-        shaderManagers[0].getUniformSpecularIntensityLocation(),
-        shaderManagers[0].getUniformShininessLocation()
+        mainShader->getUniformSpecularIntensityLocation(),
+        mainShader->getUniformShininessLocation()
     );
     
     // Render the black hawk model
-    blackhawk.renderModel();
+    BeginSceneObject(pass, BLACKHAWK_QUERY);
+    RenderSceneModel(blackhawk, blackHawkTransform, pass.blackHawkLevel, pass.blackHawkVisible, pass.clusterCuller);
+    EndSceneObject(pass, BLACKHAWK_QUERY);
+}
+
+void RenderFleet(ShaderManager &shader, const PassDrawState &pass)
+{
+    // Add in the shiny specular material
+    // properties for the whole fleet
+    shinyMaterial.useMaterial(
+        shader.getUniformSpecularIntensityLocation(),
+        shader.getUniformShininessLocation()
+    );
+
+    BeginSceneObject(pass, FLEET_QUERY);
+    if (AreFleetPlaceholdersDrawn())
+    {
+        // Boxes in place of the ships until the model
+        // they are switching to has been uploaded
+        UseSceneTexture(plainTexture, dirtTextureLayer);
+
+        ArenaScope scope(frameAllocator.getFrameArena());
+        ArenaVector<glm::mat4> fleetPlaceholderTransforms{ArenaAllocator<glm::mat4>(frameAllocator.getFrameArena())};
+        fleetPlaceholderTransforms.reserve(fleetStore.getObjectCount());
+        for (size_t i = 0; i < fleetStore.getObjectCount(); ++i)
+        {
+            if (!pass.fleetVisibility || pass.fleetVisibility[i])
+            {
+                glm::vec3 boundsMin = fleetStore.getWorldBoundsMin()[i];
+                glm::vec3 boundsMax = fleetStore.getWorldBoundsMax()[i];
+                glm::mat4 transform = glm::translate(glm::mat4(1.0f), (boundsMin + boundsMax) * 0.5f);
+                fleetPlaceholderTransforms.push_back(glm::scale(transform, boundsMax - boundsMin));
+            }
+        }
+
+        if (!fleetPlaceholderTransforms.empty())
+        {
+            meshes[3]->renderInstanced(&fleetPlaceholderTransforms[0], fleetPlaceholderTransforms.size());
+        }
+        EndSceneObject(pass, FLEET_QUERY);
+        return;
+    }
+
+    // Render the ships of the fleet sharing a level of detail
+    // with a single draw call per mesh. The matrices of all the
+    // levels are sorted by level and uploaded once for the pass.
+    ArenaScope scope(frameAllocator.getFrameArena());
+    unsigned int levelCount = fleetModel->getLevelOfDetailCount();
+    ArenaVector<GLsizei> fleetLevelCounts(levelCount, 0, ArenaAllocator<GLsizei>(frameAllocator.getFrameArena()));
+    ArenaVector<GLsizei> fleetLevelStarts(levelCount, 0, ArenaAllocator<GLsizei>(frameAllocator.getFrameArena()));
+    for (size_t i = 0; i < fleetStore.getObjectCount(); ++i)
+    {
+        if (!pass.fleetVisibility || pass.fleetVisibility[i])
+        {
+            ++fleetLevelCounts[std::min(pass.fleetLevels[i], levelCount - 1)];
+        }
+    }
+
+    GLsizei fleetInstanceCount = 0;
+    for (unsigned int level = 0; level < levelCount; ++level)
+    {
+        fleetLevelStarts[level] = fleetInstanceCount;
+        fleetInstanceCount += fleetLevelCounts[level];
+    }
+
+    ArenaVector<glm::mat4> fleetLevelTransforms(fleetInstanceCount, glm::mat4(1.0f),
+        ArenaAllocator<glm::mat4>(frameAllocator.getFrameArena()));
+    for (size_t i = 0; i < fleetStore.getObjectCount(); ++i)
+    {
+        if (!pass.fleetVisibility || pass.fleetVisibility[i])
+        {
+            unsigned int level = std::min(pass.fleetLevels[i], levelCount - 1);
+            fleetLevelTransforms[fleetLevelStarts[level]++] = fleetStore.getWorldMatrices()[i];
+        }
+    }
+
+    if (fleetInstanceCount)
+    {
+        fleetModel->renderInstancedLevels(&fleetLevelTransforms[0], &fleetLevelCounts[0], levelCount);
+    }
+    EndSceneObject(pass, FLEET_QUERY);
+}
+
+void QuerySceneBoundingBoxes(const glm::mat4 &projection, const glm::mat4 &view)
+{
+    // Tested against the depth of the finished main pass,
+    // the results decide what is drawn next frame
+    boundingBoxShader.useShader();
+    glUniformMatrix4fv(boundingBoxShader.getUniformViewLocation(), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(boundingBoxShader.getUniformProjectionLocation(), 1, GL_FALSE, glm::value_ptr(projection));
+
+    occlusionQueries.beginQueries(boundingBoxShader.getUniformModelLocation(), camera.getCameraPosition());
+    occlusionQueries.queryBoundingBox(FIRST_TETRAHEDRON_QUERY, tetrahedronBoundsMin, tetrahedronBoundsMax, firstTetrahedronTransform);
+    occlusionQueries.queryBoundingBox(SECOND_TETRAHEDRON_QUERY, tetrahedronBoundsMin, tetrahedronBoundsMax, secondTetrahedronTransform);
+    occlusionQueries.queryBoundingBox(XWING_QUERY, xWing.getBoundsMin(), xWing.getBoundsMax(), xWingTransform);
+    occlusionQueries.queryBoundingBox(BLACKHAWK_QUERY, blackhawk.getBoundsMin(), blackhawk.getBoundsMax(), blackHawkTransform);
+    occlusionQueries.queryBoundingBox(FLEET_QUERY, fleetBoundsMin, fleetBoundsMax, glm::mat4(1.0f));
+    occlusionQueries.endQueries();
+}
+
+void PrintOcclusionQueryStatistics(GLfloat currentTimeStamp)
+{
+    if (currentTimeStamp - occlusionQueryStatisticsTimeStamp < occlusionQueryStatisticsInterval)
+    {
+        return;
+    }
+
+    size_t queriedObjects = 0, hiddenObjects = 0;
+    occlusionQueries.getStatistics(queriedObjects, hiddenObjects);
+    printf("Occlusion queries: %zu of %zu draws skipped\n", hiddenObjects, queriedObjects);
+
+    occlusionQueries.resetStatistics();
+    occlusionQueryStatisticsTimeStamp = currentTimeStamp;
+}
+
+void PrintClusterCullingStatistics(GLfloat currentTimeStamp)
+{
+    if (currentTimeStamp - clusterCullingStatisticsTimeStamp < clusterCullingStatisticsInterval)
+    {
+        return;
+    }
+
+    size_t testedClusters = 0, culledClusters = 0;
+    clusterCuller.getStatistics(testedClusters, culledClusters);
+    printf("Cluster culling: %zu of %zu clusters skipped\n", culledClusters, testedClusters);
+
+    clusterCuller.resetStatistics();
+    clusterCullingStatisticsTimeStamp = currentTimeStamp;
+}
+
+void PrintFrameMemoryStatistics(GLfloat currentTimeStamp)
+{
+    if (currentTimeStamp - frameMemoryStatisticsTimeStamp < frameMemoryStatisticsInterval)
+    {
+        return;
+    }
+
+    printf("Frame memory: %zu heap allocations over %zu frames\n", frameHeapAllocations, frameCount);
+    frameAllocator.printStatistics();
+
+    if (steadyFramesAllocating)
+    {
+        printf("Error: %zu heap allocations in %zu frames of the render loop after warming up!\n",
+            steadyFrameHeapAllocations, steadyFramesAllocating);
+    }
+
+    frameHeapAllocations = 0;
+    frameCount = 0;
+    steadyFrameHeapAllocations = 0;
+    steadyFramesAllocating = 0;
+    frameMemoryStatisticsTimeStamp = currentTimeStamp;
+}
+
+void UpdateStreamedFleet()
+{
+    // Toggle once per key press rather than every frame it is held
+    bool keyDown = window.getKeys()[GLFW_KEY_F];
+    if (keyDown && !fleetSwapKeyHeld)
+    {
+        useStreamedFleet = !useStreamedFleet;
+        fleetSwapPending = true;
+
+        if (useStreamedFleet && !streamedFleetRequested)
+        {
+            streamedFleetModel = resourceManager.requestModel(
+                streamedFleetModelPath,
+                useTextureArrays,
+                MODEL_LEVEL_OF_DETAIL_COUNT);
+            streamedFleetRequested = true;
+        }
+    }
+    fleetSwapKeyHeld = keyDown;
+
+    resourceManager.uploadResources(resourceUploadBudgetMilliseconds);
+
+    if (!fleetSwapPending)
+    {
+        return;
+    }
+
+    Model *model = &xWing;
+    glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+    if (useStreamedFleet)
+    {
+        if (resourceManager.hasModelFailed(streamedFleetModel))
+        {
+            printf("Warning: The streamed fleet model failed to load, keeping the xwings\n");
+            resourceManager.releaseModel(streamedFleetModel);
+            useStreamedFleet = false;
+            streamedFleetRequested = false;
+        }
+        else
+        {
+            model = resourceManager.getModel(streamedFleetModel);
+            rotation = glm::angleAxis(-90.0f * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
+        }
+    }
+
+    // Still loading, the placeholders are drawn meanwhile
+    if (!model)
+    {
+        return;
+    }
+
+    SetFleetModel(model, rotation);
+    fleetSwapPending = false;
+
+    // The batch holds the fleet by its meshes, so it is
+    // gathered again around the new ones
+    if (useIndirectRendering)
+    {
+        sceneBatch.clearBatch();
+        CreateIndirectBatch();
+    }
+
+    // Back on the xwings nothing draws the streamed model any
+    // more, releasing it gives its pooled ranges back and the
+    // resource manager closes up the holes they leave
+    if (!useStreamedFleet && streamedFleetRequested)
+    {
+        resourceManager.releaseModel(streamedFleetModel);
+        streamedFleetRequested = false;
+        geometryPool.printStatistics();
+    }
 }
 
 void RenderDirectLightShadowMap(DirectionalLight *light)
 {
-    directLightShadowMapShader.useShader();
     DirectionalLightShadowMap* shadowMap = light->getShadowMap();
     glViewport(
         0,
@@ -376,37 +1470,58 @@ void RenderDirectLightShadowMap(DirectionalLight *light)
     shadowMap->write();
     glClear(GL_DEPTH_BUFFER_BIT);
 
+    if (useIndirectRendering)
+    {
+        // No textures or materials are needed for
+        // the depth only pass, so the whole scene
+        // is submitted with a single draw call
+        directLightShadowMapIndirectShader.useShader();
+        directLightShadowMapIndirectShader.setDirectionalLightTransform(light->computeProjectionViewLightTransform());
+        SelectBatchDraws(shadowPass);
+        sceneBatch.render(nullptr);
+
+        // The placeholder boxes are not part of the batch
+        if (AreFleetPlaceholdersDrawn())
+        {
+            directLightShadowMapInstancedShader.useShader();
+            directLightShadowMapInstancedShader.setDirectionalLightTransform(light->computeProjectionViewLightTransform());
+            RenderFleet(directLightShadowMapInstancedShader, shadowPass);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+
+    directLightShadowMapShader.useShader();
     uniformModelLocation = directLightShadowMapShader.getUniformModelLocation();
     directLightShadowMapShader.setDirectionalLightTransform(light->computeProjectionViewLightTransform());
     
-    // Render the whole scene
-    RenderScene();
+    // Render the whole scene, the clusters facing away
+    // from the camera may still cast shadows
+    RenderScene(shadowPass);
+
+    // Render the instanced objects of the scene
+    directLightShadowMapInstancedShader.useShader();
+    directLightShadowMapInstancedShader.setDirectionalLightTransform(light->computeProjectionViewLightTransform());
+    RenderFleet(directLightShadowMapInstancedShader, shadowPass);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void RenderPass(const glm::mat4 &projection, const glm::mat4 &view)
+void SetPassUniforms(
+    ShaderManager &shader,
+    const glm::mat4 &projection,
+    const glm::mat4 &view)
 {
-    // Activate the required shader for drawing
-    shaderManagers[0].useShader();
-
-    uniformModelLocation = shaderManagers[0].getUniformModelLocation();
-    glViewport(0, 0, 1334, 768);
-    
-    // Color to be used for clearing the window
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    // Clear both the color buffer as well as the depth buffer
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
     // Setting up the view and projection matrices
     glUniformMatrix4fv(
-        shaderManagers[0].getUniformViewLocation(),
+        shader.getUniformViewLocation(),
         1,
         GL_FALSE,
         glm::value_ptr(view));
 
     glUniformMatrix4fv(
-        shaderManagers[0].getUniformProjectionLocation(),
+        shader.getUniformProjectionLocation(),
         1,
         GL_FALSE,
         glm::value_ptr(projection));
@@ -414,45 +1529,182 @@ void RenderPass(const glm::mat4 &projection, const glm::mat4 &view)
     // Set camera position in the shader
     // for specular lighting calculations
     glUniform3f(
-        shaderManagers[0].getUniformCameraPosition(),
+        shader.getUniformCameraPosition(),
         camera.getCameraPosition().x,
         camera.getCameraPosition().y,
         camera.getCameraPosition().z);
     
     // Adding lights to the scene
-    shaderManagers[0].setDirectionalLightData(&directionalLight);
-    shaderManagers[0].setPointLightsData(pointLights, numberOfPointLights);
-    shaderManagers[0].setSpotLightsData(spotLights, numberOfSpotLights);
-    shaderManagers[0].setDirectionalLightTransform(directionalLight.computeProjectionViewLightTransform());
+    shader.setDirectionalLightData(&directionalLight);
+    shader.setPointLightsData(pointLights, numberOfPointLights);
+    shader.setSpotLightsData(spotLights, numberOfSpotLights);
+    shader.setDirectionalLightTransform(directionalLight.computeProjectionViewLightTransform());
+
+    shader.setPrimaryTexture(0);
+    shader.setDirectionalLightShadowMap(1);
+}
+
+void RenderPass(const glm::mat4 &projection, const glm::mat4 &view)
+{
+    glViewport(0, 0, 1334, 768);
+    
+    // Color to be used for clearing the window
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    // Clear both the color buffer as well as the depth buffer
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     directionalLight.getShadowMap()->read(GL_TEXTURE1);
-    shaderManagers[0].setPrimaryTexture(0);
-    shaderManagers[0].setDirectionalLightShadowMap(1);
 
-    RenderScene();
+    if (useIndirectRendering)
+    {
+        // One multi draw call per set of
+        // textures and materials in the scene
+        indirectShader->useShader();
+        SetPassUniforms(*indirectShader, projection, view);
+        SelectBatchDraws(mainPass);
+        sceneBatch.render(indirectShader);
+
+        // The placeholder boxes are not part of the batch
+        if (AreFleetPlaceholdersDrawn())
+        {
+            instancedShader->useShader();
+            SetPassUniforms(*instancedShader, projection, view);
+            RenderFleet(*instancedShader, mainPass);
+        }
+
+        if (mainPass.occlusionQueries)
+        {
+            QuerySceneBoundingBoxes(projection, view);
+        }
+        return;
+    }
+
+    // Activate the required shader for drawing
+    mainShader->useShader();
+    uniformModelLocation = mainShader->getUniformModelLocation();
+    SetPassUniforms(*mainShader, projection, view);
+
+    RenderScene(mainPass);
+
+    // Switch over to the instanced shader
+    // to draw the instanced objects
+    instancedShader->useShader();
+    SetPassUniforms(*instancedShader, projection, view);
+
+    RenderFleet(*instancedShader, mainPass);
+
+    if (mainPass.occlusionQueries)
+    {
+        QuerySceneBoundingBoxes(projection, view);
+    }
+}
+
+void DestroyScene()
+{
+    sceneSimulation.clearSimulationLoop();
+
+    // Wait for loads still in flight while
+    // the job system is around to finish them
+    resourceManager.clearResourceManager();
+    uploadThread.clearUploadThread();
+
+    // Everything holding GL objects is released here, while
+    // the context of the window is still current, rather
+    // than left to the destructors of the globals
+    sceneBatch.clearBatch();
+    xWing.clearModel();
+    blackhawk.clearModel();
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        delete meshes[i];
+    }
+    meshes.clear();
+
+    brickTexture.clearTexture();
+    dirtTexture.clearTexture();
+    plainTexture.clearTexture();
+    sceneTextureArray.clearTextureArray();
+
+    pendingShaderPrograms.clear();
+    directLightShadowMapShader.clearShader();
+    directLightShadowMapInstancedShader.clearShader();
+    directLightShadowMapIndirectShader.clearShader();
+    boundingBoxShader.clearShader();
+    mainShaderVariants.clearVariants();
+    instancedShaderVariants.clearVariants();
+    indirectShaderVariants.clearVariants();
+    mainShader = nullptr;
+    instancedShader = nullptr;
+    indirectShader = nullptr;
+
+    directionalLight.clearShadowMap();
+    occlusionQueries.clearOcclusionQueries();
+
+    // The pool goes last, the meshes hand their ranges back to it
+    geometryPool.clearGeometryPool();
+
+    GetGpuResourceRegistry().reportLeaks();
 }
 
 int main()
 {
     // Create a glfw window with an OpenGL context
-    window = WindowManager();
     if (!window.createWindow(800, 600, "Shadow Mapping"))
     {
         printf("Error: Window was not created, exiting the program!\n");
         return 1;
     }
+    if (!window.enableInputEvents(inputEventQueueCapacity))
+    {
+        printf("Error: Input events were not enabled, exiting the program!\n");
+        return 1;
+    }
 //--------------------------------------------------------------------------------------------
-    // Generate the meshes and shaders
+    GetGpuResourceRegistry().setBudget(GPU_RESOURCE_BUFFER, bufferMemoryBudget);
+    GetGpuResourceRegistry().setBudget(GPU_RESOURCE_TEXTURE, textureMemoryBudget);
+
+    // One worker per core besides this thread
+    jobSystem.createJobSystem();
+
+    if (!frameAllocator.createFrameAllocator(frameAllocatorCapacity))
+    {
+        printf("Error: main(): Failed to create the frame allocator!\n");
+        return 1;
+    }
+
+    // Start compiling the shaders first, the driver
+    // works on them while the assets are being loaded
+    CreateShaderPrograms();
+
+    // Generate the meshes
+    geometryPool.createGeometryPool(geometryPoolPageVertices, geometryPoolPageIndices);
     CreateMeshes();
 
     // Load models off the disk
-    xWing = Model();
-    xWing.loadModel("./scenes/shadow-mapping/assets/models/x-wing.obj");
+    xWing.setJobSystem(&jobSystem);
+    xWing.setGeometryPool(&geometryPool);
+    xWing.loadModel("./scenes/shadow-mapping/assets/models/x-wing.obj", useTextureArrays, MODEL_LEVEL_OF_DETAIL_COUNT);
 
-    blackhawk = Model();
-    blackhawk.loadModel("./scenes/shadow-mapping/assets/models/uh60.obj");
+    blackhawk.setJobSystem(&jobSystem);
+    blackhawk.setGeometryPool(&geometryPool);
+    blackhawk.loadModel("./scenes/shadow-mapping/assets/models/uh60.obj", useTextureArrays, MODEL_LEVEL_OF_DETAIL_COUNT);
 
-    CreateShaderPrograms();
+    geometryPool.printStatistics();
+
+    // Generate the transforms of the instanced fleet
+    SetFleetModel(&xWing, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+
+    // Further models are loaded in the background and sent
+    // to GL on a context of their own when one can be made
+    if (useUploadThread && !uploadThread.createUploadThread(window))
+    {
+        printf("Warning: No upload context, streamed models are uploaded by the render thread\n");
+    }
+    resourceManager.createResourceManager(&jobSystem, &uploadThread, &geometryPool);
+
+    // Place the scene objects in the transform hierarchy
+    CreateSceneGraph();
 
     // Generate a camera with default
     // parameters to navigate through the scene
@@ -473,76 +1725,221 @@ int main()
                                 window.getBufferAspectRatio(),
                                 0.1f,
                                 100.0f);
-//--------------------------------------------------------------------------------------------
-    // Load texture
-    brickTexture = Texture();
-    brickTexture.createTexture("./scenes/shadow-mapping/assets/textures/brick.png");
-    if (!brickTexture.loadTextureWithAlpha())
+
+    shadowPass.selector.setScreenSizeScale(shadowPassScreenSizeScale);
+
+    // The render thread culls alongside the workers
+    if (useClusterCulling)
     {
-        printf("Error: main(): Failed to load the brick texture!\n");
-        return 1;
+        clusterCuller.createClusterCuller(&jobSystem);
+        clusterCuller.setBackFaceCulling(useBackFaceCulling);
+        mainPass.clusterCuller = &clusterCuller;
     }
 
-    dirtTexture = Texture();
-    dirtTexture.createTexture("./scenes/shadow-mapping/assets/textures/dirt.png");
-    if (!dirtTexture.loadTextureWithAlpha())
+    occlusionCuller.createOcclusionCuller(occlusionBufferWidth, occlusionBufferHeight);
+
+    if (useOcclusionQueries)
     {
-        printf("Error: main(): Failed to load the dirt texture!\n");
-        return 1;
+        occlusionQueries.createOcclusionQueries(OCCLUSION_QUERY_OBJECT_COUNT);
+        mainPass.occlusionQueries = &occlusionQueries;
     }
-
-    plainTexture = Texture();
-    plainTexture.createTexture("./scenes/shadow-mapping/assets/textures/plain.png");
-    if (!plainTexture.loadTextureWithAlpha())
+//--------------------------------------------------------------------------------------------
+    // Load texture
+    if (useTextureArrays)
     {
-        printf("Error: main(): Failed to load the plain texture!\n");
-        return 1;
+        // Pack the scene textures into the layers of a single texture array
+        sceneTextureArray.setResourceLabel("Scene textures");
+        brickTextureLayer = sceneTextureArray.addTexture("./scenes/shadow-mapping/assets/textures/brick.png");
+        dirtTextureLayer = sceneTextureArray.addTexture("./scenes/shadow-mapping/assets/textures/dirt.png");
+        if (!sceneTextureArray.loadTextureArray(&jobSystem))
+        {
+            printf("Error: main(): Failed to load the scene texture array!\n");
+            return 1;
+        }
+    }
+    else
+    {
+        brickTexture.createTexture("./scenes/shadow-mapping/assets/textures/brick.png");
+        if (!brickTexture.loadTextureWithAlpha())
+        {
+            printf("Error: main(): Failed to load the brick texture!\n");
+            return 1;
+        }
+
+        dirtTexture.createTexture("./scenes/shadow-mapping/assets/textures/dirt.png");
+        if (!dirtTexture.loadTextureWithAlpha())
+        {
+            printf("Error: main(): Failed to load the dirt texture!\n");
+            return 1;
+        }
+
+        plainTexture.createTexture("./scenes/shadow-mapping/assets/textures/plain.png");
+        if (!plainTexture.loadTextureWithAlpha())
+        {
+            printf("Error: main(): Failed to load the plain texture!\n");
+            return 1;
+        }
     }
+//--------------------------------------------------------------------------------------------
+    // Initialise the materials for the objects
+    shinyMaterial = Material();
+    dullMaterial = Material();
+
+    shinyMaterial.setSpecularIntensity(4.0f);
+    shinyMaterial.setShininess(256.0f);
+    dullMaterial.setSpecularIntensity(0.5f);
+    dullMaterial.setShininess(4.0f);
+//--------------------------------------------------------------------------------------------
+    // Gather the whole scene into a single batch
+    // for GPU driven submission when supported
+    UpdateSceneTransforms();
+    CreateIndirectBatch();
 //--------------------------------------------------------------------------------------------
     // Initialising the lights in the scene
     // Initialise a direct light
-    directionalLight = DirectionalLight();
     directionalLight.computeShadowMap();
 
     directionalLight.setDirectLightDirection(glm::vec3(0.0f, -15.0f, 10.0f));
     directionalLight.setAmbientLightIntensity(0.1f);
     directionalLight.setDiffuseLightIntensity(0.8f);
 //--------------------------------------------------------------------------------------------
-    // Initialise the materials for the objects
-    shinyMaterial = Material();
-    dullMaterial = Material();
+    // The shaders have had the whole asset loading
+    // time to compile, collect the results now
+    WaitForShaderPrograms();
 
-    shinyMaterial.setSpecularIntensity(4.0f);
-    shinyMaterial.setShininess(256.0f);
-    dullMaterial.setSpecularIntensity(0.5f);
-    dullMaterial.setShininess(4.0f);
+    // What the loaded scene takes of the video memory
+    GetGpuResourceRegistry().printUsage();
+
+    if (runMatrixBatchBenchmark)
+    {
+        BenchmarkMatrixBatch(matrixBatchBenchmarkObjects, matrixBatchBenchmarkIterations);
+    }
+//--------------------------------------------------------------------------------------------
+    // Start the simulation from the scene as it was set up
+    SceneSimulationState initialState;
+    initialState.blackHawkAngle = blackHawkAngle;
+    initialState.cameraPosition = camera.getCameraPosition();
+    for (int moveKey = 0; moveKey < MOVE_KEY_COUNT; ++moveKey)
+    {
+        initialState.moveKeyHeld[moveKey] = false;
+        initialState.moveKeyHeldFrom[moveKey] = 0.0;
+        initialState.moveKeyHeldSeconds[moveKey] = 0.0;
+    }
+
+    SceneSimulationInput initialInput;
+    initialInput.cameraFront = camera.getCameraFrontDirection();
+    initialInput.cameraRight = camera.getCameraRightDirection();
+    initialInput.cameraSpeed = camera.getMoveSpeed();
+    initialInput.inputEvents = &window.getInputEvents();
+
+    sceneSimulation.createSimulationLoop(
+        initialState,
+        initialInput,
+        StepSceneSimulation,
+        simulationStepSeconds,
+        maxSimulationStepsPerFrame,
+        useSimulationThread);
+
+    // Loading is not part of the first frame
+    previousTimeStamp = glfwGetTime();
 //--------------------------------------------------------------------------------------------
     // Loop until window is closed, a.k.a rendering loop
     while (!window.isWindowClosed())
     {
+        size_t heapAllocations = GetHeapAllocationCount();
+        bool loadingFrame = fleetSwapPending;
+
         // Get and handle user input events
-        glfwPollEvents();
+        window.pollEvents();
+
+        // GL work the jobs handed back to this thread
+        jobSystem.runMainThreadTasks();
 
         // Generate the delta time for current render loop iteration
         GLfloat currentTimeStamp = glfwGetTime();
         GLfloat deltaTime = currentTimeStamp - previousTimeStamp;
         previousTimeStamp = currentTimeStamp;
 
-        // Update camera parameters based on user inputs and generate
-        // the view matrix.
-        camera.updateCameraMotion(window.getKeys(), deltaTime);
+        // The mouse turns the camera right away, the key events
+        // move it through the simulation in fixed steps
         camera.updateCameraOrientation(window.getXChange(), window.getYChange());
+
+        SceneSimulationInput simulationInput;
+        simulationInput.cameraFront = camera.getCameraFrontDirection();
+        simulationInput.cameraRight = camera.getCameraRightDirection();
+        simulationInput.cameraSpeed = camera.getMoveSpeed();
+        simulationInput.inputEvents = &window.getInputEvents();
+        sceneSimulation.setInput(simulationInput);
+
+        // Step the simulation for the time passed, unless it runs on
+        // its own thread, and blend its last two steps for this frame
+        sceneSimulation.updateSimulation(deltaTime);
+        ApplySceneSimulation();
         camera.generateViewMatrix(view);
 
+        // Animate the scene objects
+        UpdateSceneTransforms();
+
+        // Upload what has been loaded in the background
+        // and switch the fleet once its model is ready
+        UpdateStreamedFleet();
+        loadingFrame = loadingFrame || fleetSwapPending;
+
+        // Pick the levels of detail of the models for both passes
+        UpdateLevelsOfDetail(mainPass, projection);
+        UpdateLevelsOfDetail(shadowPass, projection);
+
+        if (useClusterCulling)
+        {
+            clusterCuller.setView(projection, view, camera.getCameraPosition());
+        }
+
+        if (useOcclusionCulling)
+        {
+            UpdateOcclusion(mainPass, projection * view);
+        }
+
+        UpdateFleetVisibility(mainPass, projection * view);
+
+        // Switch to the shader variants matching
+        // the lights and features in use this frame
+        SelectShaderVariants();
+
         RenderDirectLightShadowMap(&directionalLight);
         RenderPass(projection, view);    
 
         // Deactivating shaders for completeness
         glUseProgram(0);
 
+        if (mainPass.occlusionQueries)
+        {
+            PrintOcclusionQueryStatistics(currentTimeStamp);
+        }
+
+        if (mainPass.clusterCuller)
+        {
+            PrintClusterCullingStatistics(currentTimeStamp);
+        }
+
         // Swap buffers after drawing to update the viewport
         window.swapBuffers();
+
+        // What was allocated for this frame stays around through
+        // the next one, which picks its levels of detail from it
+        frameAllocator.endFrame();
+
+        size_t frameAllocations = GetHeapAllocationCount() - heapAllocations;
+        frameHeapAllocations += frameAllocations;
+        ++frameCount;
+        if (frameAllocations && !loadingFrame && frameAllocator.getFrameNumber() > frameAllocationWarmUpFrames)
+        {
+            steadyFrameHeapAllocations += frameAllocations;
+            ++steadyFramesAllocating;
+        }
+        PrintFrameMemoryStatistics(currentTimeStamp);
     }
 
+    DestroyScene();
+
     return 0;
 }
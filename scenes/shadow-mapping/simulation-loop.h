@@ -0,0 +1,260 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "fixed-timestep.h"
+
+// Runs a simulation in fixed steps apart from the rendering,
+// either from the render loop or on a thread of its own. After
+// each batch of steps the last two states are published as a
+// snapshot, which the renderer blends by how far the time is
+// between them. Snapshots are double-buffered: the simulation
+// fills the one the renderer is not reading and then swaps, so
+// neither side waits on the other for longer than the swap.
+// The input is handed over the other way, sampled once per batch.
+// Each step is told the time it ends at, in seconds of the steady
+// clock, so that it can place timestamped input within the step.
+template<typename State, typename Input>
+class SimulationLoop
+{
+public:
+    typedef std::function<void(State &state, const Input &input, double stepEndTime, double stepSeconds)> StepFunction;
+
+    SimulationLoop() :
+        m_publishedSnapshot(0),
+        m_threaded(false),
+        m_running(false)
+    {
+    }
+
+    void createSimulationLoop(
+        const State &initialState,
+        const Input &initialInput,
+        const StepFunction &step,
+        double stepSeconds,
+        unsigned int maxStepsPerUpdate,
+        bool useThread)
+    {
+        clearSimulationLoop();
+
+        m_step = step;
+        m_input = initialInput;
+        m_timestep.createFixedTimestep(stepSeconds, maxStepsPerUpdate);
+        m_previousState = initialState;
+        m_currentState = initialState;
+        publishSnapshot(std::chrono::steady_clock::now());
+        m_snapshots[1 - m_publishedSnapshot] = m_snapshots[m_publishedSnapshot];
+
+        m_threaded = useThread;
+        if (m_threaded)
+        {
+            m_running = true;
+            m_thread = std::thread(&SimulationLoop::runThread, this);
+        }
+    }
+
+    bool isThreaded() const { return m_threaded; }
+
+    // Used by the steps run from then on
+    void setInput(const Input &input)
+    {
+        std::lock_guard<std::mutex> lock(m_inputMutex);
+        m_input = input;
+    }
+
+    // Runs the steps due in the time passed when there is no
+    // thread of its own, the thread keeps time by itself
+    void updateSimulation(double elapsedSeconds)
+    {
+        if (m_threaded)
+        {
+            return;
+        }
+
+        std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
+        runSteps(m_timestep.advanceTime(elapsedSeconds), currentTime);
+        publishSnapshot(currentTime);
+    }
+
+    // The last two states and how far to blend from the previous
+    // one to the current one for the frame being drawn now
+    void getSnapshot(State &previous, State &current, float &interpolation)
+    {
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+
+        const Snapshot &snapshot = m_snapshots[m_publishedSnapshot];
+        previous = snapshot.previous;
+        current = snapshot.current;
+
+        // The thread may not have woken up since, the
+        // time since it published is still pending
+        double pendingSeconds = snapshot.accumulatedSeconds;
+        if (m_threaded)
+        {
+            pendingSeconds += std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - snapshot.publishTime).count();
+        }
+
+        interpolation = (float)(pendingSeconds / m_timestep.getStepSeconds());
+        interpolation = interpolation < 1.0f ? interpolation : 1.0f;
+    }
+
+    unsigned long long getStepCount()
+    {
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        return m_snapshots[m_publishedSnapshot].stepCount;
+    }
+
+    double getDroppedSeconds()
+    {
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        return m_snapshots[m_publishedSnapshot].droppedSeconds;
+    }
+
+    void clearSimulationLoop()
+    {
+        if (m_thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_threadMutex);
+                m_running = false;
+            }
+            m_wakeUp.notify_one();
+            m_thread.join();
+        }
+        m_threaded = false;
+    }
+
+    ~SimulationLoop()
+    {
+        clearSimulationLoop();
+    }
+
+private:
+    struct Snapshot
+    {
+        State previous;
+        State current;
+        double accumulatedSeconds;
+        std::chrono::steady_clock::time_point publishTime;
+        unsigned long long stepCount;
+        double droppedSeconds;
+    };
+
+    void runSteps(unsigned int steps, std::chrono::steady_clock::time_point currentTime)
+    {
+        if (!steps)
+        {
+            return;
+        }
+
+        Input input;
+        {
+            std::lock_guard<std::mutex> lock(m_inputMutex);
+            input = m_input;
+        }
+
+        // The last step ends where the time carried
+        // over to the next batch begins
+        double stepSeconds = m_timestep.getStepSeconds();
+        double batchEndTime = std::chrono::duration<double>(currentTime.time_since_epoch()).count() -
+            m_timestep.getAccumulatedSeconds();
+
+        for (unsigned int i = 0; i < steps; ++i)
+        {
+            m_previousState = m_currentState;
+            m_step(m_currentState, input, batchEndTime - (steps - 1 - i) * stepSeconds, stepSeconds);
+        }
+    }
+
+    void publishSnapshot(std::chrono::steady_clock::time_point publishTime)
+    {
+        // Only this side ever changes which snapshot is published,
+        // so the other one can be filled without holding the lock
+        unsigned int backSnapshot = 1 - m_publishedSnapshot;
+
+        Snapshot &snapshot = m_snapshots[backSnapshot];
+        snapshot.previous = m_previousState;
+        snapshot.current = m_currentState;
+        snapshot.accumulatedSeconds = m_timestep.getAccumulatedSeconds();
+        snapshot.publishTime = publishTime;
+        snapshot.stepCount = m_timestep.getStepCount();
+        snapshot.droppedSeconds = m_timestep.getDroppedSeconds();
+
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        m_publishedSnapshot = backSnapshot;
+    }
+
+    void runThread()
+    {
+        std::chrono::steady_clock::time_point previousTime = std::chrono::steady_clock::now();
+
+        std::unique_lock<std::mutex> lock(m_threadMutex);
+        while (m_running)
+        {
+            lock.unlock();
+
+            std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
+            runSteps(m_timestep.advanceTime(std::chrono::duration<double>(currentTime - previousTime).count()), currentTime);
+            publishSnapshot(currentTime);
+            previousTime = currentTime;
+
+            // Sleep until the next step is due
+            double waitSeconds = m_timestep.getStepSeconds() - m_timestep.getAccumulatedSeconds();
+
+            lock.lock();
+            m_wakeUp.wait_for(lock, std::chrono::duration<double>(waitSeconds), [this] { return !m_running; });
+        }
+    }
+
+    SimulationLoop(const SimulationLoop&) = delete;
+    SimulationLoop& operator=(const SimulationLoop&) = delete;
+
+    StepFunction m_step;
+    FixedTimestep m_timestep;
+
+    // Only touched by the side running the steps
+    State m_previousState;
+    State m_currentState;
+
+    std::mutex m_inputMutex;
+    Input m_input;
+
+    std::mutex m_snapshotMutex;
+    Snapshot m_snapshots[2];
+    unsigned int m_publishedSnapshot;
+
+    bool m_threaded;
+    std::thread m_thread;
+    std::mutex m_threadMutex;
+    std::condition_variable m_wakeUp;
+    bool m_running;
+};
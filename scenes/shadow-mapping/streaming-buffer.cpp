@@ -0,0 +1,310 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstdio>
+#include <cstring>
+
+#include "gpu-resource-registry.h"
+#include "streaming-buffer.h"
+
+// How long to block on a fence in one go (in nanoseconds)
+static const GLuint64 FENCE_WAIT_TIMEOUT = 1000000;
+
+// Shared by all the streaming buffers so that no two storages
+// ever get the same generation, the storage is only ever
+// created on the context drawing with it
+static unsigned int nextStorageGeneration = 1;
+
+StreamingBuffer::StreamingBuffer(GLenum target) :
+    m_target(target),
+    m_bufferID(0),
+    m_storageGeneration(0),
+    m_persistent(false),
+    m_mappedData(nullptr),
+    m_regionMapped(false),
+    m_regionCapacity(0),
+    m_regionIndex(0),
+    m_regionPending(false),
+    m_regionOffset(0),
+    m_regionSize(0)
+{
+    for (unsigned int i = 0; i < STREAMING_BUFFER_REGION_COUNT; ++i)
+    {
+        m_regionFences[i] = 0;
+    }
+}
+
+bool StreamingBuffer::isPersistentMappingSupported()
+{
+    return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+}
+
+bool StreamingBuffer::createBufferStorage(GLsizeiptr regionSize)
+{
+    // Regions bound with glBindBufferRange have to
+    // start at a multiple of the offset alignment
+    GLint alignment = 16;
+    if (m_target == GL_SHADER_STORAGE_BUFFER)
+    {
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    }
+    else if (m_target == GL_UNIFORM_BUFFER)
+    {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    }
+    m_regionCapacity = ((regionSize + alignment - 1) / alignment) * alignment;
+
+    m_persistent = isPersistentMappingSupported();
+
+    glGenBuffers(1, &m_bufferID);
+    m_storageGeneration = nextStorageGeneration++;
+    glBindBuffer(m_target, m_bufferID);
+
+        if (m_persistent)
+        {
+            // Immutable storage stays mapped for the lifetime of
+            // the buffer and coherent writes become visible to the
+            // GPU without any explicit flush
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            const GLsizeiptr bufferSize = m_regionCapacity * STREAMING_BUFFER_REGION_COUNT;
+
+            glBufferStorage(m_target, bufferSize, nullptr, flags);
+            m_mappedData = (GLubyte*)glMapBufferRange(m_target, 0, bufferSize, flags);
+        }
+        else
+        {
+            glBufferData(m_target, m_regionCapacity, nullptr, GL_STREAM_DRAW);
+        }
+
+    glBindBuffer(m_target, 0);
+
+    // Orphaning keeps the size of the buffer the same,
+    // the blocks the driver holds on to are not counted
+    GetGpuResourceRegistry().addResource(
+        GPU_RESOURCE_BUFFER,
+        m_bufferID,
+        m_persistent ? m_regionCapacity * STREAMING_BUFFER_REGION_COUNT : m_regionCapacity,
+        "Streaming buffer");
+
+    if (m_persistent && !m_mappedData)
+    {
+        printf("Error: StreamingBuffer::createBufferStorage(): Failed to map the buffer storage!\n");
+        clearStreamingBuffer();
+        return false;
+    }
+
+    // Start on the last region so that
+    // the first write lands on region 0
+    m_regionIndex = STREAMING_BUFFER_REGION_COUNT - 1;
+
+    return true;
+}
+
+void StreamingBuffer::waitForRegion(unsigned int regionIndex)
+{
+    GLsync fence = m_regionFences[regionIndex];
+    if (!fence)
+    {
+        return;
+    }
+
+    // Usually the GPU is long done with the region by the
+    // time we come back to it, otherwise flush the pending
+    // commands and block until it has finished
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+    }
+
+    if (result == GL_WAIT_FAILED)
+    {
+        printf("Error: StreamingBuffer::waitForRegion(): Failed to wait on the region fence!\n");
+    }
+
+    glDeleteSync(fence);
+    m_regionFences[regionIndex] = 0;
+}
+
+void* StreamingBuffer::mapRegion(GLsizeiptr size)
+{
+    if (m_regionMapped)
+    {
+        unmapRegion();
+    }
+
+    if (size > m_regionCapacity)
+    {
+        // Immutable storage cannot be resized,
+        // so recreate the buffer with enough room
+        clearStreamingBuffer();
+        if (!createBufferStorage(size))
+        {
+            return nullptr;
+        }
+    }
+
+    void *data = nullptr;
+
+    if (m_persistent)
+    {
+        // Every command reading the previous region has been
+        // issued by now, so a fence placed here tells us when
+        // the GPU is done with it
+        if (m_regionPending)
+        {
+            m_regionFences[m_regionIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        m_regionIndex = (m_regionIndex + 1) % STREAMING_BUFFER_REGION_COUNT;
+        waitForRegion(m_regionIndex);
+
+        m_regionOffset = m_regionCapacity * m_regionIndex;
+        data = m_mappedData + m_regionOffset;
+        m_regionPending = true;
+    }
+    else
+    {
+        glBindBuffer(m_target, m_bufferID);
+
+            // Orphan the storage, the driver hands us a fresh block
+            // of memory while the GPU keeps reading the old one, so
+            // mapping it does not need to synchronise
+            glBufferData(m_target, m_regionCapacity, nullptr, GL_STREAM_DRAW);
+            data = glMapBufferRange(m_target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+        glBindBuffer(m_target, 0);
+
+        if (!data)
+        {
+            printf("Error: StreamingBuffer::mapRegion(): Failed to map the buffer!\n");
+            return nullptr;
+        }
+
+        m_regionOffset = 0;
+    }
+
+    m_regionSize = size;
+    m_regionMapped = true;
+
+    return data;
+}
+
+void StreamingBuffer::unmapRegion()
+{
+    if (!m_regionMapped)
+    {
+        return;
+    }
+
+    // Coherent persistent mappings need no
+    // unmapping before the GPU reads them
+    if (!m_persistent)
+    {
+        glBindBuffer(m_target, m_bufferID);
+        glUnmapBuffer(m_target);
+        glBindBuffer(m_target, 0);
+    }
+
+    m_regionMapped = false;
+}
+
+bool StreamingBuffer::updateRegion(
+    const void *data,
+    GLsizeiptr size)
+{
+    void *region = mapRegion(size);
+    if (!region)
+    {
+        return false;
+    }
+
+    memcpy(region, data, size);
+    unmapRegion();
+
+    return true;
+}
+
+GLuint StreamingBuffer::getBufferID()
+{
+    return m_bufferID;
+}
+
+unsigned int StreamingBuffer::getStorageGeneration()
+{
+    return m_storageGeneration;
+}
+
+GLintptr StreamingBuffer::getRegionOffset()
+{
+    return m_regionOffset;
+}
+
+GLsizeiptr StreamingBuffer::getRegionSize()
+{
+    return m_regionSize;
+}
+
+void StreamingBuffer::clearStreamingBuffer()
+{
+    if (m_bufferID)
+    {
+        if (m_mappedData || m_regionMapped)
+        {
+            glBindBuffer(m_target, m_bufferID);
+            glUnmapBuffer(m_target);
+            glBindBuffer(m_target, 0);
+        }
+
+        // The driver keeps the storage alive until
+        // the GPU has finished with it
+        GetGpuResourceRegistry().removeResource(GPU_RESOURCE_BUFFER, m_bufferID);
+        glDeleteBuffers(1, &m_bufferID);
+        m_bufferID = 0;
+        m_storageGeneration = 0;
+    }
+
+    for (unsigned int i = 0; i < STREAMING_BUFFER_REGION_COUNT; ++i)
+    {
+        if (m_regionFences[i])
+        {
+            glDeleteSync(m_regionFences[i]);
+            m_regionFences[i] = 0;
+        }
+    }
+
+    m_persistent = false;
+    m_mappedData = nullptr;
+    m_regionMapped = false;
+    m_regionCapacity = 0;
+    m_regionIndex = 0;
+    m_regionPending = false;
+    m_regionOffset = 0;
+    m_regionSize = 0;
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+    clearStreamingBuffer();
+}
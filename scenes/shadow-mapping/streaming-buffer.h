@@ -0,0 +1,91 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include "constants.h"
+
+// Streams per-frame data to the GPU. On OpenGL 4.4 (or with
+// ARB_buffer_storage) the buffer is mapped persistently and split
+// into regions that are written in turn, each guarded by a fence,
+// so the data is written straight into memory the GPU reads from.
+// Older contexts orphan the buffer storage before every write.
+class StreamingBuffer
+{
+public:
+    StreamingBuffer(GLenum target = GL_ARRAY_BUFFER);
+
+    static bool isPersistentMappingSupported();
+
+    // Returns the memory to write the next size bytes
+    // into, call unmapRegion() before drawing with it
+    void* mapRegion(GLsizeiptr size);
+    void unmapRegion();
+
+    // Copies data into a fresh region
+    bool updateRegion(
+        const void *data,
+        GLsizeiptr size);
+
+    GLuint getBufferID();
+
+    // Changes every time the buffer storage is recreated, the
+    // driver may hand the new storage the name of the old one
+    unsigned int getStorageGeneration();
+
+    // Offset of the last mapped region
+    // from the start of the buffer
+    GLintptr getRegionOffset();
+    GLsizeiptr getRegionSize();
+
+    void clearStreamingBuffer();
+
+    ~StreamingBuffer();
+
+private:
+    bool createBufferStorage(GLsizeiptr regionSize);
+    void waitForRegion(unsigned int regionIndex);
+
+    GLenum m_target;
+    GLuint m_bufferID;
+    unsigned int m_storageGeneration;
+    bool m_persistent;
+
+    // Base of the persistent mapping and the
+    // pointer returned for the orphaned storage
+    GLubyte *m_mappedData;
+    bool m_regionMapped;
+
+    // Capacity of each region, rounded up to
+    // the offset alignment of the target
+    GLsizeiptr m_regionCapacity;
+    unsigned int m_regionIndex;
+    bool m_regionPending;
+    GLsync m_regionFences[STREAMING_BUFFER_REGION_COUNT];
+
+    GLintptr m_regionOffset;
+    GLsizeiptr m_regionSize;
+};
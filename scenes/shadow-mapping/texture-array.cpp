@@ -0,0 +1,341 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include <cstdio>
+
+#include <stb/stb_image.h>
+
+#include "gpu-resource-registry.h"
+#include "texture-array.h"
+
+// Upper bound for the size of each layer to keep
+// the memory used by large arrays in check
+static const GLsizei MAX_LAYER_SIZE = 1024;
+
+static GLsizei nextPowerOfTwo(GLsizei value)
+{
+    GLsizei result = 1;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Bilinear resampling of an RGBA image into the
+// destination size, used for images that do not
+// match the layer size of the array. Only the rows
+// from firstRow up to lastRow are written.
+static void resampleImage(
+    const unsigned char *source,
+    int sourceWidth,
+    int sourceHeight,
+    unsigned char *destination,
+    int destinationWidth,
+    int destinationHeight,
+    int firstRow,
+    int lastRow)
+{
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+        float sourceY = (y + 0.5f) * sourceHeight / destinationHeight - 0.5f;
+        if (sourceY < 0.0f) sourceY = 0.0f;
+        int y0 = (int)sourceY;
+        int y1 = y0 + 1 < sourceHeight ? y0 + 1 : y0;
+        float fy = sourceY - y0;
+
+        for (int x = 0; x < destinationWidth; ++x)
+        {
+            float sourceX = (x + 0.5f) * sourceWidth / destinationWidth - 0.5f;
+            if (sourceX < 0.0f) sourceX = 0.0f;
+            int x0 = (int)sourceX;
+            int x1 = x0 + 1 < sourceWidth ? x0 + 1 : x0;
+            float fx = sourceX - x0;
+
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                float top = source[(y0 * sourceWidth + x0) * 4 + channel] * (1.0f - fx) +
+                            source[(y0 * sourceWidth + x1) * 4 + channel] * fx;
+                float bottom = source[(y1 * sourceWidth + x0) * 4 + channel] * (1.0f - fx) +
+                               source[(y1 * sourceWidth + x1) * 4 + channel] * fx;
+                destination[(y * destinationWidth + x) * 4 + channel] =
+                    (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+}
+
+TextureArray::TextureArray() :
+    m_nextLayer(0),
+    m_textureID(0),
+    m_layerWidth(0),
+    m_layerHeight(0),
+    m_resourceLabel("Texture array")
+{
+}
+
+GLuint TextureArray::addTexture(const std::string &fileLocation)
+{
+    for (size_t i = 0; i < m_fileLocations.size(); ++i)
+    {
+        if (m_fileLocations[i] == fileLocation)
+        {
+            return i;
+        }
+    }
+
+    m_fileLocations.push_back(fileLocation);
+    return m_fileLocations.size() - 1;
+}
+
+// Rows of a layer resampled by a job at a time
+static const size_t RESAMPLE_ROWS_PER_JOB = 64;
+
+bool TextureArray::loadTextureArray(JobSystem *jobSystem)
+{
+    return decodeTextureArray(jobSystem) && uploadTextureArray();
+}
+
+bool TextureArray::decodeTextureArray(JobSystem *jobSystem)
+{
+    if (m_fileLocations.empty())
+    {
+        return false;
+    }
+
+    // Decode all the images up front as the layer
+    // size depends on the largest of them.
+    // Every image is expanded to 4 channels.
+    std::vector<unsigned char*> images(m_fileLocations.size(), nullptr);
+    std::vector<int> widths(m_fileLocations.size(), 0);
+    std::vector<int> heights(m_fileLocations.size(), 0);
+    GLsizei largestWidth = 1, largestHeight = 1;
+
+    std::function<void(size_t, size_t)> decodeImages = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+        {
+            int bitDepth = 0;
+            images[i] = stbi_load(m_fileLocations[i].c_str(), &widths[i], &heights[i], &bitDepth, 4);
+        }
+    };
+
+    if (jobSystem)
+    {
+        jobSystem->parallelFor(m_fileLocations.size(), 1, decodeImages);
+    }
+    else
+    {
+        decodeImages(0, m_fileLocations.size());
+    }
+
+    for (size_t i = 0; i < m_fileLocations.size(); ++i)
+    {
+        if (!images[i])
+        {
+            printf("Error: TextureArray::decodeTextureArray(): Failed to load texture at %s\n", m_fileLocations[i].c_str());
+            continue;
+        }
+
+        if (widths[i] > largestWidth) largestWidth = widths[i];
+        if (heights[i] > largestHeight) largestHeight = heights[i];
+    }
+
+    // OpenGL 3.3 supports textures of at least 1024 texels
+    // on a side, so the layer size cap needs no GL query
+    m_layerWidth = nextPowerOfTwo(largestWidth);
+    m_layerHeight = nextPowerOfTwo(largestHeight);
+    if (m_layerWidth > MAX_LAYER_SIZE) m_layerWidth = MAX_LAYER_SIZE;
+    if (m_layerHeight > MAX_LAYER_SIZE) m_layerHeight = MAX_LAYER_SIZE;
+
+    size_t layerSize = m_layerWidth * m_layerHeight * 4;
+    m_layerData.resize(layerSize * images.size());
+
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        unsigned char *layerData = &m_layerData[layerSize * i];
+
+        if (!images[i])
+        {
+            // Missing images are left plain white
+            std::fill(layerData, layerData + layerSize, 255);
+            continue;
+        }
+
+        std::function<void(size_t, size_t)> resampleRows = [&](size_t first, size_t last) {
+            resampleImage(images[i], widths[i], heights[i], layerData, m_layerWidth, m_layerHeight, first, last);
+        };
+
+        if (jobSystem)
+        {
+            jobSystem->parallelFor(m_layerHeight, RESAMPLE_ROWS_PER_JOB, resampleRows);
+        }
+        else
+        {
+            resampleRows(0, m_layerHeight);
+        }
+
+        // Free the decoded image as it has been
+        // copied into the data of its layer
+        stbi_image_free(images[i]);
+    }
+
+    return true;
+}
+
+bool TextureArray::uploadTextureArray()
+{
+    while (hasPendingLayers())
+    {
+        if (!uploadTextureArrayLayer())
+        {
+            return false;
+        }
+    }
+
+    return m_textureID != 0;
+}
+
+bool TextureArray::uploadTextureArrayLayer()
+{
+    if (m_layerData.empty())
+    {
+        printf("Error: TextureArray::uploadTextureArrayLayer(): The texture array was not decoded\n");
+        return false;
+    }
+
+    if (!m_textureID)
+    {
+        // Creating a texture array object
+        glGenTextures(1, &m_textureID);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+
+            // Setup the texture parameters
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            // Allocate the storage of all the layers, they
+            // are filled in one at a time by the calls below
+            glTexImage3D(
+                GL_TEXTURE_2D_ARRAY,
+                0,
+                GL_RGBA8,
+                m_layerWidth,
+                m_layerHeight,
+                m_fileLocations.size(),
+                0,
+                GL_RGBA,
+                GL_UNSIGNED_BYTE,
+                nullptr);
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        GetGpuResourceRegistry().addResource(
+            GPU_RESOURCE_TEXTURE,
+            m_textureID,
+            GpuResourceRegistry::estimateTextureSize(m_layerWidth, m_layerHeight, m_fileLocations.size(), 4, true),
+            m_resourceLabel);
+
+        m_nextLayer = 0;
+    }
+
+    size_t layerSize = m_layerWidth * m_layerHeight * 4;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+
+        glTexSubImage3D(
+            GL_TEXTURE_2D_ARRAY,
+            0,
+            0,
+            0,
+            m_nextLayer,
+            m_layerWidth,
+            m_layerHeight,
+            1,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            &m_layerData[layerSize * m_nextLayer]);
+        ++m_nextLayer;
+
+        // Generate the other mipmap levels for
+        // every layer once all of them are in
+        if (m_nextLayer == (GLsizei)m_fileLocations.size())
+        {
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+            // The layers now live in the graphics card's memory
+            std::vector<unsigned char>().swap(m_layerData);
+        }
+
+    // Unbind the texture array object
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return true;
+}
+
+bool TextureArray::hasPendingLayers()
+{
+    return !m_layerData.empty();
+}
+
+void TextureArray::useTextureArray()
+{
+    // Texture arrays are bound to the same
+    // texture unit as the regular textures
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+}
+
+GLsizei TextureArray::getLayerCount()
+{
+    return m_fileLocations.size();
+}
+
+void TextureArray::setResourceLabel(const std::string &label)
+{
+    m_resourceLabel = label;
+}
+
+void TextureArray::clearTextureArray()
+{
+    if (m_textureID)
+    {
+        GetGpuResourceRegistry().removeResource(GPU_RESOURCE_TEXTURE, m_textureID);
+        glDeleteTextures(1, &m_textureID);
+        m_textureID = 0;
+    }
+
+    m_fileLocations.clear();
+    std::vector<unsigned char>().swap(m_layerData);
+    m_nextLayer = 0;
+    m_layerWidth = 0;
+    m_layerHeight = 0;
+}
+
+TextureArray::~TextureArray()
+{
+    clearTextureArray();
+}
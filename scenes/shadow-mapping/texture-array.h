@@ -0,0 +1,85 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "job-system.h"
+
+// Packs several image textures into the layers of
+// a single GL_TEXTURE_2D_ARRAY so that all of them
+// can be sampled without rebinding textures.
+// Images of differing sizes are resampled to a
+// common layer size, which keeps the texture
+// coordinates (and GL_REPEAT wrapping) intact.
+class TextureArray
+{
+public:
+    TextureArray();
+
+    // Queues an image for packing and returns the
+    // layer it will occupy. Adding the same file
+    // twice returns the same layer.
+    GLuint addTexture(const std::string &fileLocation);
+
+    // Decodes, resamples and uploads all the queued images,
+    // decoding and resampling on the workers of the job system
+    bool loadTextureArray(JobSystem *jobSystem = nullptr);
+
+    // The two halves of loadTextureArray, decoding makes no
+    // GL calls and keeps the layers around until uploaded
+    bool decodeTextureArray(JobSystem *jobSystem = nullptr);
+    bool uploadTextureArray();
+
+    // Uploads the decoded layers one per call, the storage is
+    // created by the first call and the mipmaps by the last
+    bool uploadTextureArrayLayer();
+    bool hasPendingLayers();
+    void useTextureArray();
+
+    GLsizei getLayerCount();
+
+    // Owner the texture is recorded under in the GPU resource registry
+    void setResourceLabel(const std::string &label);
+
+    void clearTextureArray();
+
+    ~TextureArray();
+
+private:
+    // Owns a GL texture, a copy would delete it twice
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    std::vector<std::string> m_fileLocations;
+    std::vector<unsigned char> m_layerData;
+    GLsizei m_nextLayer;
+    GLuint m_textureID;
+    GLsizei m_layerWidth, m_layerHeight;
+    std::string m_resourceLabel;
+};
@@ -25,6 +25,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
+#include "gpu-resource-registry.h"
 #include "texture.h"
 
 Texture::Texture() :
@@ -32,7 +33,7 @@ Texture::Texture() :
     m_width(0),
     m_height(0),
     m_bitDepth(0),
-    m_fileLocation(nullptr)
+    m_textureData(nullptr)
 {
 }
 
@@ -42,67 +43,40 @@ void Texture::createTexture(const char *fileLocation)
 }
 
 bool Texture::loadTextureRGBOnly()
-{   
+{
+    return decodeTexture() && uploadTexture(false);
+}
+
+bool Texture::loadTextureWithAlpha()
+{
+    return decodeTexture() && uploadTexture(true);
+}
+
+bool Texture::decodeTexture()
+{
     // Loading the image texture off the disk using the stb library
-    unsigned char *textureData = 
-        stbi_load(m_fileLocation, &m_width, &m_height, &m_bitDepth, 0);
-    
+    m_textureData = stbi_load(m_fileLocation.c_str(), &m_width, &m_height, &m_bitDepth, 0);
+
     // If the image file couldn't be read, report it to the user
-    if (!textureData)
+    if (!m_textureData)
     {
-        printf("Error: Texture::loadTextureRGBOnly(): Failed to load texture at %s\n", m_fileLocation);
+        printf("Error: Texture::decodeTexture(): Failed to load texture at %s\n", m_fileLocation.c_str());
         return false;
     }
 
-    // Creating a texture object
-    glGenTextures(1, &m_textureID);
-    glBindTexture(GL_TEXTURE_2D, m_textureID);
-
-        // Setup the texture parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // Load the texture information
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RGB,
-            m_width,
-            m_height,
-            0,
-            GL_RGB,
-            GL_UNSIGNED_BYTE,
-            textureData);
-        
-        // Generate the other mipmap levels
-        glGenerateMipmap(GL_TEXTURE_2D);
-    
-    // Unbind the texture object
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    // Free the loaded image texture
-    // as it has been copied to the
-    // graphics card's memory
-    stbi_image_free(textureData);
-
     return true;
 }
 
-bool Texture::loadTextureWithAlpha()
-{   
-    // Loading the image texture off the disk using the stb library
-    unsigned char *textureData = 
-        stbi_load(m_fileLocation, &m_width, &m_height, &m_bitDepth, 0);
-    
-    // If the image file couldn't be read, report it to the user
-    if (!textureData)
+bool Texture::uploadTexture(bool withAlpha)
+{
+    if (!m_textureData)
     {
-        printf("Error: Texture::loadTextureWithAlpha(): Failed to load texture at %s\n", m_fileLocation);
+        printf("Error: Texture::uploadTexture(): Texture at %s was not decoded\n", m_fileLocation.c_str());
         return false;
     }
 
+    GLenum format = withAlpha ? GL_RGBA : GL_RGB;
+
     // Creating a texture object
     glGenTextures(1, &m_textureID);
     glBindTexture(GL_TEXTURE_2D, m_textureID);
@@ -117,13 +91,13 @@ bool Texture::loadTextureWithAlpha()
         glTexImage2D(
             GL_TEXTURE_2D,
             0,
-            GL_RGBA,
+            format,
             m_width,
             m_height,
             0,
-            GL_RGBA,
+            format,
             GL_UNSIGNED_BYTE,
-            textureData);
+            m_textureData);
         
         // Generate the other mipmap levels
         glGenerateMipmap(GL_TEXTURE_2D);
@@ -131,10 +105,18 @@ bool Texture::loadTextureWithAlpha()
     // Unbind the texture object
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    // Drivers pad RGB textures out to four bytes a texel
+    GetGpuResourceRegistry().addResource(
+        GPU_RESOURCE_TEXTURE,
+        m_textureID,
+        GpuResourceRegistry::estimateTextureSize(m_width, m_height, 1, 4, true),
+        m_fileLocation);
+
     // Free the loaded image texture
     // as it has been copied to the
     // graphics card's memory
-    stbi_image_free(textureData);
+    stbi_image_free(m_textureData);
+    m_textureData = nullptr;
 
     return true;
 }
@@ -159,12 +141,23 @@ void Texture::clearTexture()
     // Remove the texture object from
     // graphics card's memory when
     // not required.
-    glDeleteTextures(1, &m_textureID);
-    m_textureID = 0;
+    if (m_textureID)
+    {
+        GetGpuResourceRegistry().removeResource(GPU_RESOURCE_TEXTURE, m_textureID);
+        glDeleteTextures(1, &m_textureID);
+        m_textureID = 0;
+    }
     m_width = 0;
     m_height = 0;
     m_bitDepth = 0;
-    m_fileLocation = nullptr;
+    m_fileLocation.clear();
+
+    // Decoded but never uploaded
+    if (m_textureData)
+    {
+        stbi_image_free(m_textureData);
+        m_textureData = nullptr;
+    }
 }
 
 Texture::~Texture()
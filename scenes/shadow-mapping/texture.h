@@ -22,6 +22,10 @@
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#pragma once
+
+#include <string>
+
 #include <glad/glad.h>
 
 class Texture
@@ -32,13 +36,25 @@ public:
 
     bool loadTextureRGBOnly();
     bool loadTextureWithAlpha();
+
+    // The two halves of loading, decoding the image
+    // is safe on any thread while uploading it is
+    // left to the thread owning the GL context
+    bool decodeTexture();
+    bool uploadTexture(bool withAlpha);
+
     void useTexture();
     void clearTexture();
 
     ~Texture();
 
 private:
+    // Owns a GL texture, a copy would delete it twice
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
     GLuint m_textureID;
     int m_width, m_height, m_bitDepth;
-    const char *m_fileLocation;
+    std::string m_fileLocation;
+    unsigned char *m_textureData;
 };
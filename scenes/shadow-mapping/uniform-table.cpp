@@ -0,0 +1,172 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "uniform-table.h"
+
+UniformTable::UniformTable()
+{
+}
+
+void UniformTable::addEntry(
+    std::vector<Entry> &entries,
+    const char* name,
+    GLint value)
+{
+    Entry entry;
+    entry.nameHash = HashUniformName(name);
+    entry.value = value;
+    entries.push_back(entry);
+}
+
+void UniformTable::sortEntries(std::vector<Entry> &entries)
+{
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.nameHash < b.nameHash;
+    });
+
+    // Two names sharing a hash would silently alias each
+    // other, so make some noise about it while developing
+    for (size_t i = 1; i < entries.size(); ++i)
+    {
+        if (entries[i].nameHash == entries[i - 1].nameHash)
+        {
+            printf("Error: UniformTable::sortEntries(): Hash collision between two uniform names (0x%08x)\n", entries[i].nameHash);
+        }
+    }
+}
+
+const UniformTable::Entry* UniformTable::findEntry(
+    const std::vector<Entry> &entries,
+    unsigned int nameHash)
+{
+    std::vector<Entry>::const_iterator it = std::lower_bound(
+        entries.begin(),
+        entries.end(),
+        nameHash,
+        [](const Entry &entry, unsigned int hash) {
+            return entry.nameHash < hash;
+        });
+
+    if (it == entries.end() || it->nameHash != nameHash)
+    {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+void UniformTable::reflectProgram(GLuint programID)
+{
+    clearUniformTable();
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> name(maxNameLength + 1, '\0');
+
+    for (GLint i = 0; i < uniformCount; ++i)
+    {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programID, i, name.size(), &nameLength, &arraySize, &type, &name[0]);
+
+        // Members of uniform blocks have no location,
+        // they are set through the block's buffer
+        GLint location = glGetUniformLocation(programID, &name[0]);
+        if (location < 0)
+        {
+            continue;
+        }
+
+        // Arrays of basic types are reported once as "name[0]",
+        // register the bare name and every element so that
+        // all the spellings GLSL accepts can be looked up
+        if (nameLength > 3 && !strcmp(&name[nameLength - 3], "[0]"))
+        {
+            std::string baseName(&name[0], nameLength - 3);
+            addEntry(m_uniforms, baseName.c_str(), location);
+
+            for (GLint element = 0; element < arraySize; ++element)
+            {
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                addEntry(m_uniforms, elementName.c_str(), glGetUniformLocation(programID, elementName.c_str()));
+            }
+        }
+        else
+        {
+            addEntry(m_uniforms, &name[0], location);
+        }
+    }
+
+    GLint blockCount = 0;
+    GLint maxBlockNameLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+
+    std::vector<GLchar> blockName(maxBlockNameLength + 1, '\0');
+
+    for (GLint i = 0; i < blockCount; ++i)
+    {
+        glGetActiveUniformBlockName(programID, i, blockName.size(), NULL, &blockName[0]);
+        addEntry(m_uniformBlocks, &blockName[0], i);
+    }
+
+    sortEntries(m_uniforms);
+    sortEntries(m_uniformBlocks);
+}
+
+GLint UniformTable::getUniformLocation(unsigned int nameHash) const
+{
+    const Entry *entry = findEntry(m_uniforms, nameHash);
+    return entry ? entry->value : -1;
+}
+
+GLuint UniformTable::getUniformBlockIndex(unsigned int nameHash) const
+{
+    const Entry *entry = findEntry(m_uniformBlocks, nameHash);
+    return entry ? (GLuint)entry->value : GL_INVALID_INDEX;
+}
+
+size_t UniformTable::getUniformCount() const
+{
+    return m_uniforms.size();
+}
+
+size_t UniformTable::getUniformBlockCount() const
+{
+    return m_uniformBlocks.size();
+}
+
+void UniformTable::clearUniformTable()
+{
+    m_uniforms.clear();
+    m_uniformBlocks.clear();
+}
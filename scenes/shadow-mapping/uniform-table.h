@@ -0,0 +1,82 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+// FNV-1a hash of a uniform name. Being constexpr, hashes of
+// string literals assigned to constexpr constants are worked
+// out by the compiler, e.g.
+//     constexpr unsigned int MODEL_UNIFORM = HashUniformName("model");
+constexpr unsigned int HashUniformName(
+    const char* name,
+    unsigned int hash = 2166136261u)
+{
+    return *name ? HashUniformName(name + 1, (hash ^ (unsigned char)*name) * 16777619u) : hash;
+}
+
+// Flat table of every active uniform and uniform block of a
+// linked program, filled in by asking the program itself what
+// it uses. Lookups are a binary search over the hashed names,
+// so setting uniforms never goes through the driver's string
+// lookup and new uniforms need no dedicated location fields.
+class UniformTable
+{
+public:
+    UniformTable();
+
+    void reflectProgram(GLuint programID);
+
+    // Both return -1 (or GL_INVALID_INDEX for blocks) for names
+    // the program does not use, which glUniform* calls ignore
+    GLint getUniformLocation(unsigned int nameHash) const;
+    GLuint getUniformBlockIndex(unsigned int nameHash) const;
+
+    size_t getUniformCount() const;
+    size_t getUniformBlockCount() const;
+
+    void clearUniformTable();
+
+private:
+    struct Entry
+    {
+        unsigned int nameHash;
+        GLint value;
+    };
+
+    static void addEntry(
+        std::vector<Entry> &entries,
+        const char* name,
+        GLint value);
+    static void sortEntries(std::vector<Entry> &entries);
+    static const Entry* findEntry(
+        const std::vector<Entry> &entries,
+        unsigned int nameHash);
+
+    std::vector<Entry> m_uniforms;
+    std::vector<Entry> m_uniformBlocks;
+};
@@ -0,0 +1,205 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "upload-thread.h"
+
+#include <stdio.h>
+
+// Time the render thread gives an upload fence per wait
+// when blocking on it, in nanoseconds (1 ms)
+static const GLuint64 UPLOAD_FENCE_WAIT_TIMEOUT = 1000000;
+
+UploadThread::UploadThread() :
+    m_context(nullptr),
+    m_runningUploads(0),
+    m_stopThread(false)
+{
+}
+
+bool UploadThread::createUploadThread(WindowManager &window)
+{
+    m_context = window.createSharedContext();
+    if (!m_context)
+    {
+        return false;
+    }
+
+    m_stopThread = false;
+    m_thread = std::thread(&UploadThread::runUploads, this);
+    return true;
+}
+
+bool UploadThread::isRunning() const
+{
+    return m_context != nullptr;
+}
+
+void UploadThread::submitUpload(
+    std::function<void()> upload,
+    std::function<void()> completion)
+{
+    Upload queued = { upload, completion, 0 };
+
+    // Without a context of its own the upload
+    // is done right away on the calling thread
+    if (!m_context)
+    {
+        queued.upload();
+        queued.completion();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queuedUploads.push_back(queued);
+    }
+    m_uploadQueued.notify_one();
+}
+
+void UploadThread::collectUploads()
+{
+    while (true)
+    {
+        Upload done;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_fencedUploads.empty() || !waitForFence(m_fencedUploads.front().fence, false))
+            {
+                return;
+            }
+
+            done = m_fencedUploads.front();
+            m_fencedUploads.pop_front();
+        }
+
+        // Outside of the lock, a completion may submit more uploads
+        glDeleteSync(done.fence);
+        done.completion();
+    }
+}
+
+void UploadThread::finishUploads()
+{
+    if (!m_context)
+    {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_uploadDone.wait(lock, [this] {
+            return m_queuedUploads.empty() && !m_runningUploads;
+        });
+
+        for (size_t i = 0; i < m_fencedUploads.size(); ++i)
+        {
+            waitForFence(m_fencedUploads[i].fence, true);
+        }
+    }
+
+    collectUploads();
+}
+
+void UploadThread::clearUploadThread()
+{
+    if (!m_context)
+    {
+        return;
+    }
+
+    finishUploads();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopThread = true;
+    }
+    m_uploadQueued.notify_one();
+    m_thread.join();
+
+    // The thread has released the context, which
+    // GLFW only lets the main thread destroy
+    glfwDestroyWindow(m_context);
+    m_context = nullptr;
+}
+
+UploadThread::~UploadThread()
+{
+    clearUploadThread();
+}
+
+void UploadThread::runUploads()
+{
+    glfwMakeContextCurrent(m_context);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_uploadQueued.wait(lock, [this] {
+            return m_stopThread || !m_queuedUploads.empty();
+        });
+
+        if (m_queuedUploads.empty())
+        {
+            break;
+        }
+
+        Upload upload = m_queuedUploads.front();
+        m_queuedUploads.pop_front();
+        ++m_runningUploads;
+        lock.unlock();
+
+        upload.upload();
+
+        // The flush makes sure the fence reaches the GPU,
+        // otherwise the render thread could wait on it forever
+        upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+
+        lock.lock();
+        --m_runningUploads;
+        m_fencedUploads.push_back(upload);
+        m_uploadDone.notify_all();
+    }
+
+    glfwMakeContextCurrent(NULL);
+}
+
+bool UploadThread::waitForFence(GLsync fence, bool block)
+{
+    // The fence was flushed by the upload
+    // thread, no flush is needed on this side
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (block && result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(fence, 0, UPLOAD_FENCE_WAIT_TIMEOUT);
+    }
+
+    if (result == GL_WAIT_FAILED)
+    {
+        printf("Error: UploadThread::waitForFence(): Failed to wait on the upload fence!\n");
+        return true;
+    }
+
+    return result != GL_TIMEOUT_EXPIRED;
+}
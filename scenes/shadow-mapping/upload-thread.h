@@ -0,0 +1,95 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "window-manager.h"
+
+// Creates and fills buffers and textures on a thread of its
+// own, with a GL context sharing its objects with the one of
+// the window. Each upload is followed by a fence, and the
+// render thread runs the completion of an upload once it
+// finds the fence signaled, so it never stalls on the driver
+// copying data unless it asks to wait for the uploads.
+//
+// Vertex arrays and framebuffers are not shared between
+// contexts, the completions create them on the render thread.
+class UploadThread
+{
+public:
+    UploadThread();
+
+    // Called on the main thread, which keeps its context current
+    bool createUploadThread(WindowManager &window);
+    bool isRunning() const;
+
+    // The upload runs on the upload thread, the completion
+    // on the render thread once the GPU has the data
+    void submitUpload(
+        std::function<void()> upload,
+        std::function<void()> completion);
+
+    // Runs the completions of the finished uploads without
+    // waiting on the ones still in flight
+    void collectUploads();
+
+    // Blocks until every submitted upload has completed
+    void finishUploads();
+
+    void clearUploadThread();
+
+    ~UploadThread();
+
+private:
+    struct Upload
+    {
+        std::function<void()> upload;
+        std::function<void()> completion;
+        GLsync fence;
+    };
+
+    void runUploads();
+    bool waitForFence(GLsync fence, bool block);
+
+    GLFWwindow *m_context;
+    std::thread m_thread;
+
+    std::mutex m_mutex;
+    std::condition_variable m_uploadQueued;
+    std::condition_variable m_uploadDone;
+    std::deque<Upload> m_queuedUploads;
+    std::deque<Upload> m_fencedUploads;
+    size_t m_runningUploads;
+    bool m_stopThread;
+};
@@ -30,6 +30,7 @@ WindowManager::WindowManager() :
     m_xChange(0.0f),
     m_yChange(0.0f),
     m_isFirstMouseMovement(true),
+    m_recordInputEvents(false),
     m_window(nullptr),
     m_width(1334),
     m_height(768),
@@ -92,6 +93,7 @@ bool WindowManager::createWindow(
     {
         std::cout << "Failed to initialize OpenGL context" << std::endl;
         glfwDestroyWindow(m_window);
+        m_window = nullptr;
         glfwTerminate();
         return false;
     }
@@ -113,6 +115,24 @@ bool WindowManager::createWindow(
     return true;
 }
 
+GLFWwindow* WindowManager::createSharedContext()
+{
+    // GLFW only creates contexts along with a window, so
+    // an invisible one carries the context. The version
+    // and profile hints are still those of the main window.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *context = glfwCreateWindow(1, 1, "", NULL, m_window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+    if (!context)
+    {
+        printf("Error: WindowManager::createSharedContext(): Failed to create a shared context\n");
+    }
+
+    // Creating the window leaves the current context alone
+    return context;
+}
+
 void WindowManager::createCallbacks()
 {
     // Call the respective callbacks and handlers
@@ -120,6 +140,58 @@ void WindowManager::createCallbacks()
     glfwSetCursorPosCallback(m_window, handleMouse);
 }
 
+void WindowManager::pollEvents()
+{
+    glfwPollEvents();
+    flushInputEvents();
+}
+
+bool WindowManager::enableInputEvents(size_t capacity)
+{
+    m_recordInputEvents = m_inputEvents.createInputEventQueue(capacity);
+    return m_recordInputEvents;
+}
+
+void WindowManager::recordInputEvent(const InputEvent &event)
+{
+    if (!m_recordInputEvents)
+    {
+        return;
+    }
+
+    // Keep the order, nothing goes past the events still waiting
+    flushInputEvents();
+    if (m_pendingInputEvents.empty() && m_inputEvents.pushEvent(event))
+    {
+        return;
+    }
+
+    if (event.type == INPUT_EVENT_MOUSE_MOVED &&
+        !m_pendingInputEvents.empty() &&
+        m_pendingInputEvents.back().type == INPUT_EVENT_MOUSE_MOVED)
+    {
+        InputEvent &mouseEvent = m_pendingInputEvents.back();
+        mouseEvent.xChange += event.xChange;
+        mouseEvent.yChange += event.yChange;
+        mouseEvent.timeStamp = event.timeStamp;
+        return;
+    }
+
+    m_pendingInputEvents.push_back(event);
+}
+
+void WindowManager::flushInputEvents()
+{
+    size_t flushedEvents = 0;
+    while (flushedEvents < m_pendingInputEvents.size() &&
+        m_inputEvents.pushEvent(m_pendingInputEvents[flushedEvents]))
+    {
+        ++flushedEvents;
+    }
+
+    m_pendingInputEvents.erase(m_pendingInputEvents.begin(), m_pendingInputEvents.begin() + flushedEvents);
+}
+
 GLfloat WindowManager::getXChange()
 {
     GLfloat xChange = m_xChange;
@@ -164,6 +236,18 @@ void WindowManager::handleKeys(
             windowManager->m_keys[key] = false;
         }
     }
+
+    // Repeats say nothing new about which keys are held
+    if (action == GLFW_PRESS || action == GLFW_RELEASE)
+    {
+        InputEvent event;
+        event.type = action == GLFW_PRESS ? INPUT_EVENT_KEY_PRESSED : INPUT_EVENT_KEY_RELEASED;
+        event.key = key;
+        event.xChange = 0.0f;
+        event.yChange = 0.0f;
+        event.timeStamp = GetInputEventTime();
+        windowManager->recordInputEvent(event);
+    }
 }
 
 void WindowManager::handleMouse(
@@ -181,10 +265,21 @@ void WindowManager::handleMouse(
         windowManager->m_isFirstMouseMovement = false;
     }
 
-    // Calculate the change in the values of x and y direction
-    windowManager->m_xChange = xPosition - windowManager->m_lastX;
+    // Calculate the change in the values of x and y direction,
+    // several movements between two reads add up
+    GLfloat xChange = xPosition - windowManager->m_lastX;
     // Notice we are trying to avoid inverted y movement here 
-    windowManager->m_yChange = windowManager->m_lastY - yPosition;
+    GLfloat yChange = windowManager->m_lastY - yPosition;
+    windowManager->m_xChange += xChange;
+    windowManager->m_yChange += yChange;
+
+    InputEvent event;
+    event.type = INPUT_EVENT_MOUSE_MOVED;
+    event.key = 0;
+    event.xChange = xChange;
+    event.yChange = yChange;
+    event.timeStamp = GetInputEventTime();
+    windowManager->recordInputEvent(event);
 
     // Store the current xPosition and yPosition
     // for the next iteration
@@ -199,6 +294,10 @@ GLfloat WindowManager::getBufferAspectRatio()
 
 WindowManager::~WindowManager()
 {
-    glfwDestroyWindow(m_window);
-    glfwTerminate();
+    // Creating the window terminates GLFW itself when it fails
+    if (m_window)
+    {
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
+    }
 }
@@ -26,10 +26,13 @@
 
 #include <iostream>
 #include <string.h>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "input-event-queue.h"
+
 class WindowManager
 {
 public:
@@ -43,16 +46,36 @@ public:
     GLfloat getBufferAspectRatio();
 
     // Some hacky convenience function for handling
-    // camera movements
+    // camera movements. The cursor movement adds up
+    // over the polls until it is read.
     bool* getKeys() { return m_keys; }
     GLfloat getXChange();
     GLfloat getYChange();
 
+    // Polls GLFW and hands the events that did not fit in
+    // the input event queue last time over to its consumer
+    void pollEvents();
+
+    // Records every key and mouse event into a queue that
+    // one other thread, such as a simulation, can consume
+    // without locks. Nothing is recorded until enabled.
+    bool enableInputEvents(size_t capacity);
+    InputEventQueue& getInputEvents() { return m_inputEvents; }
+
+    // Hidden window whose context shares its objects with the
+    // context of this window, for loading on another thread.
+    // Has to be created and destroyed on the main thread.
+    GLFWwindow* createSharedContext();
+
     bool isWindowClosed() { return glfwWindowShouldClose(m_window); }
     void swapBuffers() { glfwSwapBuffers(m_window); }
 
     ~WindowManager();
 private:
+    // Owns the window and with it the GL context
+    WindowManager(const WindowManager&) = delete;
+    WindowManager& operator=(const WindowManager&) = delete;
+
     // Involes keyboard and mouse input 
     // callbacks and handlers
     void createCallbacks();
@@ -73,6 +96,9 @@ private:
         double xPosition,
         double yPosition);
 
+    void recordInputEvent(const InputEvent &event);
+    void flushInputEvents();
+
     // Keyboard and mouse input data
     GLfloat m_lastX;
     GLfloat m_lastY;
@@ -81,6 +107,13 @@ private:
     bool m_isFirstMouseMovement;
     bool m_keys[1024];
 
+    // Events are queued in order. The ones that find the queue
+    // full wait here, the cursor movements merged together, so
+    // that no input is lost while the consumer falls behind.
+    InputEventQueue m_inputEvents;
+    std::vector<InputEvent> m_pendingInputEvents;
+    bool m_recordInputEvents;
+
     // Window data
     GLFWwindow* m_window;
     GLint m_width, m_height;
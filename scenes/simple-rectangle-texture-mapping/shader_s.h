@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -67,6 +69,8 @@ public:
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+        // look up every active uniform once so that the setters don't have to
+        reflectUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -78,20 +82,55 @@ public:
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(getUniformLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(getUniformLocation(name), value); 
+    }
+    // returns -1 for uniforms the program doesn't use, which glUniform* ignores
+    // ------------------------------------------------------------------------
+    int getUniformLocation(const std::string &name) const
+    {
+        std::unordered_map<std::string, int>::const_iterator it = uniformLocations.find(name);
+        return it != uniformLocations.end() ? it->second : -1;
     }
 
 private:
+    // locations of the active uniforms, filled in right after linking
+    std::unordered_map<std::string, int> uniformLocations;
+
+    // utility function for asking the linked program which uniforms it uses
+    // ------------------------------------------------------------------------
+    void reflectUniforms()
+    {
+        int uniformCount = 0;
+        int maxNameLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+        std::vector<char> name(maxNameLength + 1, '\0');
+        for (int i = 0; i < uniformCount; ++i)
+        {
+            int size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, i, (GLsizei)name.size(), NULL, &size, &type, &name[0]);
+            int location = glGetUniformLocation(ID, &name[0]);
+            if (location < 0)
+                continue; // part of a uniform block
+            std::string uniformName(&name[0]);
+            uniformLocations[uniformName] = location;
+            // arrays are reported as "name[0]", make the bare name work too
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = location;
+        }
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
@@ -0,0 +1,127 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include <math.h>
+#include <stdio.h>
+
+#include "fixed-timestep.h"
+
+// Self-check of FixedTimestep: the steps due for the time
+// passed, the cap on the steps per advance, the time dropped
+// past the cap and the time carried over to the next frame.
+// Prints what failed and returns non-zero when anything did.
+
+static unsigned int failureCount = 0;
+
+#define CHECK(condition) \
+    if (!(condition)) \
+    { \
+        printf("Error: %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        ++failureCount; \
+    }
+
+static void CheckStepCap()
+{
+    // Steps of a quarter second add up without rounding errors
+    FixedTimestep timestep;
+    timestep.createFixedTimestep(0.25, 4);
+
+    CHECK(timestep.advanceTime(0.125) == 0);
+    CHECK(timestep.getInterpolationFactor() == 0.5f);
+
+    CHECK(timestep.advanceTime(0.25) == 1);
+    CHECK(timestep.getAccumulatedSeconds() == 0.125);
+
+    // Time going backwards is ignored
+    CHECK(timestep.advanceTime(-1.0) == 0);
+    CHECK(timestep.getAccumulatedSeconds() == 0.125);
+
+    // A stall of two seconds owes eight steps, four are taken,
+    // the whole steps past them are dropped and the fraction
+    // of a step is kept
+    CHECK(timestep.advanceTime(2.0) == 4);
+    CHECK(timestep.getDroppedSeconds() == 1.0);
+    CHECK(timestep.getAccumulatedSeconds() == 0.125);
+    CHECK(timestep.getStepCount() == 5);
+
+    // Nothing more is owed after the drop
+    CHECK(timestep.advanceTime(0.0) == 0);
+
+    // At least one step is taken per advance
+    timestep.createFixedTimestep(0.25, 0);
+    CHECK(timestep.advanceTime(1.0) == 1);
+    CHECK(timestep.getDroppedSeconds() == 0.75);
+    CHECK(timestep.getAccumulatedSeconds() == 0.0);
+    CHECK(timestep.getStepCount() == 1);
+}
+
+static void CheckUnevenFrames()
+{
+    const unsigned int maxSteps = 5;
+    FixedTimestep timestep;
+    timestep.createFixedTimestep(1.0 / 60.0, maxSteps);
+
+    // Frame times from well under a step to a stall
+    // of a few hundred milliseconds now and then
+    double totalSeconds = 0.0;
+    unsigned int seed = 4321;
+    for (unsigned int i = 0; i < 100000; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        double elapsedSeconds = (seed >> 8) % 40 * 0.001;
+        if ((seed >> 4) % 500 == 0)
+        {
+            elapsedSeconds = 0.3;
+        }
+        totalSeconds += elapsedSeconds;
+
+        unsigned int steps = timestep.advanceTime(elapsedSeconds);
+        CHECK(steps <= maxSteps);
+        CHECK(timestep.getAccumulatedSeconds() >= 0.0);
+        CHECK(timestep.getAccumulatedSeconds() < timestep.getStepSeconds());
+        CHECK(timestep.getInterpolationFactor() >= 0.0f && timestep.getInterpolationFactor() < 1.0f);
+
+        if (failureCount)
+        {
+            return;
+        }
+    }
+
+    // All the time passed is either stepped, dropped or still
+    // waiting for the next step, and the stalls made some drop
+    double accountedSeconds =
+        timestep.getStepCount() * timestep.getStepSeconds() +
+        timestep.getDroppedSeconds() +
+        timestep.getAccumulatedSeconds();
+    CHECK(fabs(accountedSeconds - totalSeconds) < 1e-6);
+    CHECK(timestep.getDroppedSeconds() > 0.0);
+}
+
+int main()
+{
+    CheckStepCap();
+    CheckUnevenFrames();
+
+    printf("FixedTimestep: %s\n", failureCount ? "failed" : "passed");
+    return failureCount ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "frame-allocator.h"
+
+// Self-check of LinearArena and FrameAllocator: alignment,
+// rewinding to markers, requests overflowing to the heap and
+// the lifetime of the data of each frame. Prints what failed
+// and returns non-zero when anything did.
+
+static unsigned int failureCount = 0;
+
+#define CHECK(condition) \
+    if (!(condition)) \
+    { \
+        printf("Error: %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        ++failureCount; \
+    }
+
+static bool IsInside(const LinearArena &arena, const void *start, const void *memory)
+{
+    const unsigned char *first = static_cast<const unsigned char*>(start);
+    const unsigned char *pointer = static_cast<const unsigned char*>(memory);
+    return pointer >= first && pointer < first + arena.getCapacity();
+}
+
+static void CheckRewind()
+{
+    LinearArena arena;
+    CHECK(arena.createLinearArena(1024));
+
+    void *start = arena.allocate(1, 1);
+    CHECK(arena.getUsedSize() == 1);
+
+    void *aligned = arena.allocate(8, 16);
+    CHECK(reinterpret_cast<uintptr_t>(aligned) % 16 == 0);
+    CHECK(arena.getUsedSize() == 16 + 8 - (reinterpret_cast<uintptr_t>(start) % 16));
+
+    // Everything past the marker is given back
+    size_t marker = arena.getMarker();
+    arena.allocateArray<double>(32);
+    CHECK(arena.getUsedSize() > marker);
+    arena.rewindToMarker(marker);
+    CHECK(arena.getUsedSize() == marker);
+
+    // The next allocation reuses the memory given back
+    void *reused = arena.allocate(8, 8);
+    CHECK(reused == static_cast<unsigned char*>(aligned) + 8);
+
+    // A marker past the offset leaves the arena as it is
+    arena.rewindToMarker(marker + 512);
+    CHECK(arena.getUsedSize() == marker + 8);
+
+    // Scopes rewind on the way out, nested or not
+    size_t beforeScope = arena.getUsedSize();
+    {
+        ArenaScope scope(arena);
+        arena.allocate(100, 4);
+        {
+            ArenaScope innerScope(arena);
+            arena.allocate(100, 4);
+        }
+        CHECK(arena.getUsedSize() == beforeScope + 100);
+
+        ArenaVector<int> values((ArenaAllocator<int>(arena)));
+        values.reserve(16);
+        for (int i = 0; i < 16; ++i)
+        {
+            values.push_back(i);
+        }
+        CHECK(IsInside(arena, start, values.data()));
+        CHECK(values[15] == 15);
+    }
+    CHECK(arena.getUsedSize() == beforeScope);
+
+    // A reset takes the arena back to its start
+    arena.resetArena();
+    CHECK(arena.getUsedSize() == 0);
+    CHECK(arena.allocate(1, 1) == start);
+    CHECK(arena.getOverflowCount() == 0);
+
+    arena.clearLinearArena();
+}
+
+static void CheckOverflow()
+{
+    LinearArena arena;
+    CHECK(arena.createLinearArena(64));
+
+    void *start = arena.allocate(48, 8);
+
+    // Too large for what is left, served from the heap
+    // and still aligned the way it was asked for
+    void *overflow = arena.allocate(100, 32);
+    CHECK(overflow != nullptr);
+    CHECK(!IsInside(arena, start, overflow));
+    CHECK(reinterpret_cast<uintptr_t>(overflow) % 32 == 0);
+    CHECK(arena.getOverflowCount() == 1);
+    CHECK(arena.getUsedSize() == 48);
+    CHECK(arena.getHighWaterMark() >= 148);
+    memset(overflow, 0xAB, 100);
+
+    // Rewinding leaves the overflow alone, the
+    // block itself is handed out again as before
+    arena.rewindToMarker(0);
+    CHECK(arena.allocate(48, 8) == start);
+
+    // The reset grows the block to the busiest use so far,
+    // after which the same requests all fit in the block
+    arena.resetArena();
+    CHECK(arena.getCapacity() >= arena.getHighWaterMark());
+    void *grownStart = arena.allocate(48, 8);
+    void *fitted = arena.allocate(100, 32);
+    CHECK(IsInside(arena, grownStart, fitted));
+    CHECK(arena.getOverflowCount() == 1);
+
+    arena.clearLinearArena();
+    CHECK(arena.getCapacity() == 0);
+    CHECK(arena.getOverflowCount() == 0);
+}
+
+static void CheckFrames()
+{
+    FrameAllocator frames;
+    CHECK(frames.createFrameAllocator(256));
+
+    // The data of a frame is still there through the next one
+    LinearArena *firstArena = &frames.getFrameArena();
+    int *firstFrameData = firstArena->allocateArray<int>(16);
+    for (int i = 0; i < 16; ++i)
+    {
+        firstFrameData[i] = i;
+    }
+
+    frames.endFrame();
+    CHECK(frames.getFrameNumber() == 1);
+    CHECK(&frames.getFrameArena() != firstArena);
+    int *secondFrameData = frames.getFrameArena().allocateArray<int>(16);
+    for (int i = 0; i < 16; ++i)
+    {
+        secondFrameData[i] = -i;
+    }
+    CHECK(firstFrameData[15] == 15);
+
+    // Two frames on the arena is reset and handed out again
+    frames.endFrame();
+    CHECK(frames.getFrameNumber() == 2);
+    CHECK(&frames.getFrameArena() == firstArena);
+    CHECK(firstArena->getUsedSize() == 0);
+    CHECK(firstArena->allocateArray<int>(16) == firstFrameData);
+    CHECK(secondFrameData[15] == -15);
+
+    // A frame overflowing grows its arena when it comes round again
+    frames.getFrameArena().allocate(1024, 16);
+    CHECK(frames.getOverflowCount() == 1);
+    frames.endFrame();
+    frames.endFrame();
+    CHECK(frames.getCapacity() >= 1024);
+    frames.getFrameArena().allocate(1024, 16);
+    CHECK(frames.getOverflowCount() == 1);
+
+    frames.clearFrameAllocator();
+    CHECK(frames.getFrameNumber() == 0);
+}
+
+int main()
+{
+    CheckRewind();
+    CheckOverflow();
+    CheckFrames();
+
+    printf("LinearArena and FrameAllocator: %s\n", failureCount ? "failed" : "passed");
+    return failureCount ? 1 : 0;
+}
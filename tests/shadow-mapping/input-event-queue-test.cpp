@@ -0,0 +1,189 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include <stdio.h>
+#include <thread>
+
+#include "input-event-queue.h"
+
+// Self-check of InputEventQueue: the rounding of the capacity,
+// a full and an empty ring, peeking, the positions wrapping
+// round the ring and a producer and a consumer thread passing
+// events in order. Prints what failed and returns non-zero
+// when anything did.
+
+static unsigned int failureCount = 0;
+
+#define CHECK(condition) \
+    if (!(condition)) \
+    { \
+        printf("Error: %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        ++failureCount; \
+    }
+
+static InputEvent CreateKeyEvent(int key)
+{
+    InputEvent event;
+    event.type = INPUT_EVENT_KEY_PRESSED;
+    event.key = key;
+    event.xChange = 0.0f;
+    event.yChange = 0.0f;
+    event.timeStamp = 0.0;
+    return event;
+}
+
+static void CheckFullAndEmpty()
+{
+    InputEventQueue queue;
+    CHECK(queue.createInputEventQueue(5));
+    CHECK(queue.getCapacity() == 8);
+
+    InputEvent event = CreateKeyEvent(-1);
+    CHECK(!queue.popEvent(event));
+    CHECK(!queue.peekEvent(event));
+    CHECK(event.key == -1);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        CHECK(queue.pushEvent(CreateKeyEvent(i)));
+    }
+
+    // A full ring turns events away and keeps the ones it holds
+    CHECK(!queue.pushEvent(CreateKeyEvent(8)));
+
+    // Peeking leaves the event for the next pop
+    CHECK(queue.peekEvent(event));
+    CHECK(event.key == 0);
+    CHECK(queue.peekEvent(event));
+    CHECK(event.key == 0);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        CHECK(queue.popEvent(event));
+        CHECK(event.key == i);
+    }
+    CHECK(!queue.popEvent(event));
+    CHECK(!queue.peekEvent(event));
+
+    queue.clearInputEventQueue();
+    CHECK(queue.getCapacity() == 0);
+}
+
+static void CheckWrap()
+{
+    InputEventQueue queue;
+    CHECK(queue.createInputEventQueue(4));
+
+    // Pushes and pops out of step with the capacity,
+    // so the positions pass the end of the ring at
+    // every fill level from empty to full
+    int nextPushed = 0;
+    int nextPopped = 0;
+    InputEvent event;
+    for (int round = 0; round < 1000; ++round)
+    {
+        int pushes = 1 + round % 4;
+        for (int i = 0; i < pushes; ++i)
+        {
+            if (queue.pushEvent(CreateKeyEvent(nextPushed)))
+            {
+                ++nextPushed;
+            }
+        }
+        CHECK(nextPushed - nextPopped <= 4);
+
+        CHECK(queue.peekEvent(event));
+        CHECK(event.key == nextPopped);
+
+        int pops = 1 + (round * 7) % 3;
+        for (int i = 0; i < pops && queue.popEvent(event); ++i)
+        {
+            CHECK(event.key == nextPopped);
+            ++nextPopped;
+        }
+    }
+
+    while (queue.popEvent(event))
+    {
+        CHECK(event.key == nextPopped);
+        ++nextPopped;
+    }
+    CHECK(nextPopped == nextPushed);
+    CHECK(nextPushed > 1000);
+
+    queue.clearInputEventQueue();
+}
+
+static void CheckThreads()
+{
+    const int eventCount = 200000;
+    InputEventQueue queue;
+    CHECK(queue.createInputEventQueue(64));
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < eventCount; ++i)
+        {
+            InputEvent event = CreateKeyEvent(i);
+            event.xChange = (GLfloat)i;
+            while (!queue.pushEvent(event))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Every event comes out once, in order and whole
+    int expected = 0;
+    InputEvent event;
+    while (expected < eventCount)
+    {
+        if (!queue.popEvent(event))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (event.key != expected || event.xChange != (GLfloat)expected)
+        {
+            printf("Error: %s:%d: Popped event %d while expecting %d\n", __FILE__, __LINE__, event.key, expected);
+            ++failureCount;
+            break;
+        }
+        ++expected;
+    }
+
+    producer.join();
+    CHECK(!queue.popEvent(event));
+
+    queue.clearInputEventQueue();
+}
+
+int main()
+{
+    CheckFullAndEmpty();
+    CheckWrap();
+    CheckThreads();
+
+    printf("InputEventQueue: %s\n", failureCount ? "failed" : "passed");
+    return failureCount ? 1 : 0;
+}
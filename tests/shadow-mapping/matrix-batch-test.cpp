@@ -0,0 +1,240 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "matrix-batch.h"
+#include "frustum.h"
+
+// Self-check of the batched matrix functions: the SSE or AVX2
+// kernels the CPU picks are held against plain glm math for
+// array sizes that leave every tail length of the loops. Prints
+// what failed and returns non-zero when anything did.
+
+static unsigned int failureCount = 0;
+
+#define CHECK(condition) \
+    if (!(condition)) \
+    { \
+        printf("Error: %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        ++failureCount; \
+    }
+
+static const size_t arraySizes[] = { 1, 2, 3, 4, 5, 7, 8, 9, 16, 17, 31, 64, 257 };
+
+// The kernels add the products in another order than glm
+// and may fuse them, so compare relative to the magnitude
+static bool IsClose(float first, float second)
+{
+    float magnitude = fabsf(first) > fabsf(second) ? fabsf(first) : fabsf(second);
+    return fabsf(first - second) <= 1e-5f * (magnitude > 1.0f ? magnitude : 1.0f);
+}
+
+static bool IsClose(const glm::mat4 &first, const glm::mat4 &second)
+{
+    for (int column = 0; column < 4; ++column)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            if (!IsClose(first[column][row], second[column][row]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool IsClose(const glm::vec3 &first, const glm::vec3 &second)
+{
+    return IsClose(first.x, second.x) && IsClose(first.y, second.y) && IsClose(first.z, second.z);
+}
+
+static bool IsClose(const glm::vec4 &first, const glm::vec4 &second)
+{
+    return IsClose(glm::vec3(first), glm::vec3(second)) && IsClose(first.w, second.w);
+}
+
+static float RandomFloat(unsigned int &seed, float minimum, float maximum)
+{
+    seed = seed * 1664525 + 1013904223;
+    return minimum + (maximum - minimum) * ((seed >> 8) / 16777216.0f);
+}
+
+// Rotations, scales and translations of the kind the scene uses
+static glm::mat4 RandomModelMatrix(unsigned int &seed)
+{
+    glm::mat4 model(1.0f);
+    model = glm::translate(model, glm::vec3(RandomFloat(seed, -50.0f, 50.0f), RandomFloat(seed, -50.0f, 50.0f), RandomFloat(seed, -50.0f, 50.0f)));
+    model = glm::rotate(model, RandomFloat(seed, -3.14f, 3.14f), glm::normalize(glm::vec3(RandomFloat(seed, -1.0f, 1.0f), 1.0f, RandomFloat(seed, -1.0f, 1.0f))));
+    model = glm::scale(model, glm::vec3(RandomFloat(seed, 0.1f, 4.0f), RandomFloat(seed, 0.1f, 4.0f), RandomFloat(seed, 0.1f, 4.0f)));
+    return model;
+}
+
+static glm::mat4 RandomProjectionView(unsigned int &seed)
+{
+    glm::mat4 projection = glm::perspective(RandomFloat(seed, 0.5f, 1.5f), RandomFloat(seed, 1.0f, 2.0f), 0.1f, RandomFloat(seed, 50.0f, 500.0f));
+    glm::vec3 eye(RandomFloat(seed, -20.0f, 20.0f), RandomFloat(seed, 1.0f, 20.0f), RandomFloat(seed, -20.0f, 20.0f));
+    return projection * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+static void CheckMultiply()
+{
+    unsigned int seed = 1;
+    for (size_t size = 0; size < sizeof(arraySizes) / sizeof(arraySizes[0]); ++size)
+    {
+        size_t count = arraySizes[size];
+        std::vector<glm::mat4> left(count), right(count), result(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            left[i] = RandomModelMatrix(seed);
+            right[i] = RandomModelMatrix(seed);
+        }
+
+        glm::mat4 projectionView = RandomProjectionView(seed);
+        MultiplyMatrices(projectionView, right.data(), result.data(), count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            CHECK(IsClose(result[i], projectionView * right[i]));
+        }
+
+        MultiplyMatrixArrays(left.data(), right.data(), result.data(), count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            CHECK(IsClose(result[i], left[i] * right[i]));
+        }
+    }
+
+    // An empty array leaves the output alone
+    glm::mat4 untouched(2.0f);
+    MultiplyMatrices(glm::mat4(1.0f), &untouched, &untouched, 0);
+    CHECK(untouched == glm::mat4(2.0f));
+}
+
+static void CheckBoxes()
+{
+    unsigned int seed = 2;
+    for (size_t size = 0; size < sizeof(arraySizes) / sizeof(arraySizes[0]); ++size)
+    {
+        size_t count = arraySizes[size];
+        std::vector<glm::mat4> matrices(count);
+        std::vector<glm::vec3> boundsMin(count), boundsMax(count), transformedMin(count), transformedMax(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            matrices[i] = RandomModelMatrix(seed);
+            boundsMin[i] = glm::vec3(RandomFloat(seed, -10.0f, 0.0f), RandomFloat(seed, -10.0f, 0.0f), RandomFloat(seed, -10.0f, 0.0f));
+            boundsMax[i] = boundsMin[i] + glm::vec3(RandomFloat(seed, 0.0f, 10.0f), RandomFloat(seed, 0.0f, 10.0f), RandomFloat(seed, 0.0f, 10.0f));
+        }
+
+        TransformBoxes(matrices.data(), boundsMin.data(), boundsMax.data(), transformedMin.data(), transformedMax.data(), count);
+
+        // The box around the eight transformed corners
+        for (size_t i = 0; i < count; ++i)
+        {
+            glm::vec3 cornersMin(INFINITY), cornersMax(-INFINITY);
+            for (int corner = 0; corner < 8; ++corner)
+            {
+                glm::vec3 point(
+                    (corner & 1) ? boundsMax[i].x : boundsMin[i].x,
+                    (corner & 2) ? boundsMax[i].y : boundsMin[i].y,
+                    (corner & 4) ? boundsMax[i].z : boundsMin[i].z);
+                glm::vec3 transformed = glm::vec3(matrices[i] * glm::vec4(point, 1.0f));
+                cornersMin = glm::min(cornersMin, transformed);
+                cornersMax = glm::max(cornersMax, transformed);
+            }
+
+            CHECK(IsClose(transformedMin[i], cornersMin));
+            CHECK(IsClose(transformedMax[i], cornersMax));
+        }
+
+        // Transforming in place gives the same boxes
+        std::vector<glm::vec3> inPlaceMin(boundsMin), inPlaceMax(boundsMax);
+        TransformBoxes(matrices.data(), inPlaceMin.data(), inPlaceMax.data(), inPlaceMin.data(), inPlaceMax.data(), count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            CHECK(inPlaceMin[i] == transformedMin[i]);
+            CHECK(inPlaceMax[i] == transformedMax[i]);
+        }
+    }
+}
+
+static void CheckFrustumPlanes()
+{
+    unsigned int seed = 3;
+    for (size_t size = 0; size < sizeof(arraySizes) / sizeof(arraySizes[0]); ++size)
+    {
+        size_t count = arraySizes[size];
+        std::vector<glm::mat4> matrices(count);
+        std::vector<glm::vec4> planes(count * 6);
+        for (size_t i = 0; i < count; ++i)
+        {
+            matrices[i] = RandomProjectionView(seed);
+        }
+
+        ExtractFrustumPlanesBatch(matrices.data(), planes.data(), count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            glm::vec4 expected[6];
+            ExtractFrustumPlanes(matrices[i], expected);
+            for (int plane = 0; plane < 6; ++plane)
+            {
+                CHECK(IsClose(planes[i * 6 + plane], expected[plane]));
+            }
+
+            // A point inside the clip volume is inside every
+            // plane and one past its right side is outside
+            // the second plane
+            glm::mat4 inverse = glm::inverse(matrices[i]);
+            glm::vec4 inside = inverse * glm::vec4(0.2f, -0.3f, 0.5f, 1.0f);
+            glm::vec4 beyond = inverse * glm::vec4(1.5f, -0.3f, 0.5f, 1.0f);
+            glm::vec3 insidePoint = glm::vec3(inside) / inside.w;
+            glm::vec3 beyondPoint = glm::vec3(beyond) / beyond.w;
+            for (int plane = 0; plane < 6; ++plane)
+            {
+                CHECK(glm::dot(glm::vec3(planes[i * 6 + plane]), insidePoint) + planes[i * 6 + plane].w > 0.0f);
+            }
+            CHECK(glm::dot(glm::vec3(planes[i * 6 + 1]), beyondPoint) + planes[i * 6 + 1].w < 0.0f);
+        }
+    }
+}
+
+int main()
+{
+    CheckMultiply();
+    CheckBoxes();
+    CheckFrustumPlanes();
+
+#if defined(__x86_64__) || defined(__i386__)
+    const char *kernels = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? "AVX2" : "SSE";
+#else
+    const char *kernels = "scalar";
+#endif
+    printf("Matrix batch (%s): %s\n", kernels, failureCount ? "failed" : "passed");
+    return failureCount ? 1 : 0;
+}
@@ -0,0 +1,212 @@
+//
+//  Rosary source code is Copyright(c) 2016-2020 Ganesh Belgur
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  - Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+//  TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+//  PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include <stdio.h>
+#include <vector>
+
+#include "range-allocator.h"
+
+// Self-check of RangeAllocator: the size classes the ranges are
+// looked up by, the merging of freed ranges and a long run of
+// random allocations checked against a plain map of the span.
+// Prints what failed and returns non-zero when anything did.
+
+static unsigned int failureCount = 0;
+
+#define CHECK(condition) \
+    if (!(condition)) \
+    { \
+        printf("Error: %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        ++failureCount; \
+    }
+
+static void CheckSizeClasses()
+{
+    RangeAllocator allocator;
+    allocator.createRangeAllocator(4096);
+
+    // Small ranges get a list each, larger ones share a list with
+    // the sizes up to an eighth of their power of two above them
+    unsigned int small = allocator.allocateRange(3);
+    unsigned int firstGap = allocator.allocateRange(64);
+    unsigned int separator = allocator.allocateRange(16);
+    unsigned int secondGap = allocator.allocateRange(256);
+    unsigned int tail = allocator.allocateRange(16);
+    CHECK(allocator.getRangeOffset(small) == 0);
+    CHECK(allocator.getRangeOffset(firstGap) == 3);
+    CHECK(allocator.getRangeOffset(secondGap) == 83);
+    CHECK(allocator.getUsedSize() == 355);
+
+    allocator.freeRange(firstGap);
+    allocator.freeRange(secondGap);
+    CHECK(allocator.getFreeRangeCount() == 3);
+
+    // A request goes to the smallest class that is certain to
+    // fit it, so 60 lands in the gap of 64 and not in the tail
+    unsigned int fitted = allocator.allocateRange(60);
+    CHECK(allocator.getRangeOffset(fitted) == 3);
+
+    // Every range in the class from 256 up fits 250
+    unsigned int smaller = allocator.allocateRange(250);
+    CHECK(allocator.getRangeOffset(smaller) == 83);
+    allocator.freeRange(smaller);
+
+    // The gap of 256 shares its class with ranges too small for
+    // 257, so the request goes to a class above it, the tail
+    unsigned int larger = allocator.allocateRange(257);
+    CHECK(allocator.getRangeOffset(larger) == 355);
+
+    // Asking for everything that is left has to succeed
+    // even though no class above the size holds a range
+    GLuint left = allocator.getLargestFreeRange();
+    CHECK(left == 4096 - 612);
+    unsigned int rest = allocator.allocateRange(left);
+    CHECK(allocator.getRangeOffset(rest) == 612);
+    CHECK(allocator.allocateRange(257) == RangeAllocator::INVALID_RANGE);
+
+    (void)separator;
+    (void)tail;
+    allocator.clearRangeAllocator();
+}
+
+static void CheckMerging()
+{
+    RangeAllocator allocator;
+    allocator.createRangeAllocator(1000);
+
+    unsigned int first = allocator.allocateRange(100);
+    unsigned int second = allocator.allocateRange(200);
+    unsigned int third = allocator.allocateRange(300);
+    unsigned int fourth = allocator.allocateRange(400);
+    CHECK(allocator.getRangeOffset(second) == 100);
+    CHECK(allocator.getRangeOffset(third) == 300);
+    CHECK(allocator.getRangeOffset(fourth) == 600);
+    CHECK(allocator.getRangeCount() == 4);
+    CHECK(allocator.getFreeRangeCount() == 0);
+
+    // Nothing free next to the second range
+    allocator.freeRange(second);
+    CHECK(allocator.getFreeRangeCount() == 1);
+    CHECK(allocator.getLargestFreeRange() == 200);
+
+    // Merged with the free range after it, which
+    // the whole of can then be handed out again
+    allocator.freeRange(first);
+    CHECK(allocator.getFreeRangeCount() == 1);
+    CHECK(allocator.getLargestFreeRange() == 300);
+    unsigned int merged = allocator.allocateRange(300);
+    CHECK(allocator.getRangeOffset(merged) == 0);
+    allocator.freeRange(merged);
+
+    // Merged with the free range before it
+    allocator.freeRange(third);
+    CHECK(allocator.getFreeRangeCount() == 1);
+    CHECK(allocator.getLargestFreeRange() == 600);
+
+    // Everything merged back into the whole span
+    allocator.freeRange(fourth);
+    CHECK(allocator.getFreeRangeCount() == 1);
+    CHECK(allocator.getRangeCount() == 0);
+    CHECK(allocator.getUsedSize() == 0);
+    CHECK(allocator.getLargestFreeRange() == 1000);
+
+    allocator.clearRangeAllocator();
+}
+
+static void CheckRandomRanges()
+{
+    const GLuint capacity = 1 << 16;
+    RangeAllocator allocator;
+    allocator.createRangeAllocator(capacity);
+
+    // Which range owns each element of the span
+    const unsigned int noOwner = 0xFFFFFFFF;
+    std::vector<unsigned int> owners(capacity, noOwner);
+    std::vector<unsigned int> ranges;
+
+    unsigned int seed = 12345;
+    for (unsigned int i = 0; i < 20000; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        if (ranges.empty() || (seed >> 16) % 3)
+        {
+            GLuint size = 1 + (seed >> 8) % 700;
+            unsigned int range = allocator.allocateRange(size);
+            if (range == RangeAllocator::INVALID_RANGE)
+            {
+                CHECK(allocator.getLargestFreeRange() < size);
+                continue;
+            }
+
+            GLuint offset = allocator.getRangeOffset(range);
+            CHECK(allocator.getRangeSize(range) == size);
+            CHECK(offset + size <= capacity);
+            for (GLuint j = offset; j < offset + size && j < capacity; ++j)
+            {
+                CHECK(owners[j] == noOwner);
+                owners[j] = range;
+            }
+            ranges.push_back(range);
+        }
+        else
+        {
+            size_t index = (seed >> 4) % ranges.size();
+            unsigned int range = ranges[index];
+            GLuint offset = allocator.getRangeOffset(range);
+            for (GLuint j = offset; j < offset + allocator.getRangeSize(range); ++j)
+            {
+                owners[j] = noOwner;
+            }
+            allocator.freeRange(range);
+            ranges[index] = ranges.back();
+            ranges.pop_back();
+        }
+
+        if (failureCount)
+        {
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        allocator.freeRange(ranges[i]);
+    }
+
+    // Everything freed merges back into the whole span
+    CHECK(allocator.getFreeRangeCount() == 1);
+    CHECK(allocator.getLargestFreeRange() == capacity);
+    CHECK(allocator.getUsedSize() == 0);
+
+    allocator.clearRangeAllocator();
+}
+
+int main()
+{
+    CheckSizeClasses();
+    CheckMerging();
+    CheckRandomRanges();
+
+    printf("RangeAllocator: %s\n", failureCount ? "failed" : "passed");
+    return failureCount ? 1 : 0;
+}